@@ -0,0 +1,174 @@
+/*
+A local benchmark comparing a connection per request (`http_connect`) with the
+pooled, keep-alive, HTTP client (`http_client_request`).
+
+The benchmark starts a local "Hello World" server and sends it the same number
+of requests (with the same concurrency) using each approach.
+*/
+#include "http.h"
+#include "http_client.h"
+
+#include "fio_cli.h"
+
+#include <time.h>
+
+static size_t total;       /* requests to send (per phase) */
+static size_t concurrency; /* requests in flight */
+static size_t started;
+static size_t completed;
+static size_t failed;
+static size_t finished; /* connections closed (connection per request) */
+static char url[64];
+static struct timespec phase_start;
+
+static void start_connect_phase(void);
+static void start_pool_phase(void);
+
+/* *****************************************************************************
+The server
+***************************************************************************** */
+
+static void on_request(http_s *h) { http_send_body(h, "Hello World!", 12); }
+
+/* *****************************************************************************
+Helpers
+***************************************************************************** */
+
+static double phase_seconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - phase_start.tv_sec) +
+         ((now.tv_nsec - phase_start.tv_nsec) / 1000000000.0);
+}
+
+static void phase_reset(void) {
+  started = completed = failed = finished = 0;
+  clock_gettime(CLOCK_MONOTONIC, &phase_start);
+}
+
+static void phase_report(const char *name) {
+  double s = phase_seconds();
+  fprintf(stderr, "* %-28s %zu requests (%zu failed) in %.3fs: %.0f req/s\n",
+          name, completed, failed, s, completed / s);
+}
+
+/* *****************************************************************************
+A connection per request (http_connect)
+***************************************************************************** */
+
+static void connect_next(void);
+
+static void connect_on_response(http_s *h) {
+  if (h->status_str == FIOBJ_INVALID) {
+    /* the connection is open, send the request */
+    http_finish(h);
+    return;
+  }
+  ++completed;
+  fio_close(http_uuid(h));
+}
+
+static void connect_on_finish(http_settings_s *settings) {
+  ++finished;
+  connect_next();
+  (void)settings;
+}
+
+static void connect_next(void) {
+  if (started == total) {
+    if (finished == total) {
+      failed = finished - completed;
+      phase_report("connection per request:");
+      start_pool_phase();
+    }
+    return;
+  }
+  ++started;
+  /* `on_finish` is always called, even on error */
+  http_connect(url, NULL, .on_response = connect_on_response,
+               .on_finish = connect_on_finish);
+}
+
+static void start_connect_phase(void) {
+  phase_reset();
+  for (size_t i = 0; i < concurrency && i < total; ++i)
+    connect_next();
+}
+
+/* *****************************************************************************
+Pooled keep-alive connections (http_client_request)
+***************************************************************************** */
+
+static void pool_next(void);
+
+static void pool_on_response(http_s *h) {
+  ++completed;
+  pool_next();
+  (void)h;
+}
+
+static void pool_on_fail(void *udata) {
+  ++failed;
+  pool_next();
+  (void)udata;
+}
+
+static void pool_next(void) {
+  if (started == total) {
+    if (completed + failed == total) {
+      phase_report("pooled keep-alive client:");
+      fio_stop();
+    }
+    return;
+  }
+  ++started;
+  if (http_client_request(url, .on_response = pool_on_response,
+                          .on_fail = pool_on_fail) == -1)
+    ++failed;
+}
+
+static void start_pool_phase(void) {
+  phase_reset();
+  for (size_t i = 0; i < concurrency && i < total; ++i)
+    pool_next();
+}
+
+static void on_start(void *ignr) {
+  start_connect_phase();
+  (void)ignr;
+}
+
+/* *****************************************************************************
+Main
+***************************************************************************** */
+
+int main(int argc, char const *argv[]) {
+  fio_cli_start(
+      argc, argv, 0, 0,
+      "A benchmark comparing a connection per request with the pooled "
+      "keep-alive HTTP client, using a local server.\n"
+      "\nThe following arguments are supported:",
+      FIO_CLI_INT("-port -p The port number for the local server."),
+      FIO_CLI_INT("-requests -n The number of requests per test."),
+      FIO_CLI_INT("-concurrency -c The number of concurrent requests."),
+      FIO_CLI_INT("-connections -k The pool's connection limit."),
+      FIO_CLI_INT("-pipeline -d The pool's pipelining depth."));
+  fio_cli_set_default("-p", "3000");
+  fio_cli_set_default("-n", "20000");
+  fio_cli_set_default("-c", "32");
+  total = fio_cli_get_i("-n");
+  concurrency = fio_cli_get_i("-c");
+  snprintf(url, sizeof(url), "http://127.0.0.1:%s/", fio_cli_get("-p"));
+
+  if (http_listen(fio_cli_get("-p"), "127.0.0.1",
+                  .on_request = on_request) == -1) {
+    perror("couldn't start the local server");
+    exit(-1);
+  }
+  http_client_setup(url, .max_connections = fio_cli_get_i("-k"),
+                    .pipeline = fio_cli_get_i("-d"));
+  fio_state_callback_add(FIO_CALL_ON_START, on_start, NULL);
+  fio_start(.threads = 1, .workers = 1);
+  fio_cli_end();
+  return 0;
+}
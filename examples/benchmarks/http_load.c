@@ -0,0 +1,512 @@
+/*
+A facil.io native HTTP load generator.
+
+The load generator opens a number of keep-alive connections to the target,
+keeps a fixed number of pipelined requests in flight on each connection and
+reports the throughput and latency percentiles once the test is over.
+
+Requests are picked from a weighted request mix (`-paths`), i.e.:
+
+    http_load -u http://127.0.0.1:8080 -r "/plaintext*3,/json" -c 64 -d 4 -s 10
+
+The target is probed (using `http_connect`) before the load is applied, so a
+misconfigured target fails fast. `-wait` polls the target's port until it
+accepts connections, for targets that are still starting up. `make bench` runs
+the load generator against the bundled framework benchmark server over
+loopback.
+*/
+#include "http.h"
+
+#include "fio_cli.h"
+
+#include <netdb.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef LOAD_MAX_PIPELINE
+/** The maximum number of pipelined requests per connection. */
+#define LOAD_MAX_PIPELINE 256
+#endif
+
+#ifndef LOAD_BUFFER
+/** The response buffer (the status line and headers must fit). */
+#define LOAD_BUFFER 16384
+#endif
+
+/* log-linear histogram: 16 sub-buckets per power of 2 (~6% precision) */
+#define LOAD_HIST_SUB_BITS 4
+#define LOAD_HIST_BUCKETS ((64 - LOAD_HIST_SUB_BITS + 1) << LOAD_HIST_SUB_BITS)
+
+/* *****************************************************************************
+State
+***************************************************************************** */
+
+typedef struct {
+  char *data;
+  size_t len;
+} request_s;
+
+static struct {
+  /* settings */
+  fio_url_s url;
+  char *host;
+  char *port;
+  size_t connections;
+  size_t pipeline;
+  size_t duration;
+  /* the request mix (each request repeated by its weight) */
+  request_s *mix;
+  size_t mix_len;
+  FIOBJ probe_path;
+  /* state */
+  volatile uint8_t running;
+  struct timespec start;
+  double seconds;
+  /* statistics */
+  size_t responses;
+  size_t errors;
+  size_t non_2xx;
+  size_t reconnects;
+  size_t bytes;
+  size_t latency_sum;
+  size_t latency_max;
+  size_t histogram[LOAD_HIST_BUCKETS];
+} load;
+
+/* *****************************************************************************
+Helpers
+***************************************************************************** */
+
+static uint64_t now_us(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return ((uint64_t)t.tv_sec * 1000000) + (t.tv_nsec / 1000);
+}
+
+static size_t hist_index(uint64_t us) {
+  if (us < (1 << LOAD_HIST_SUB_BITS))
+    return us;
+  size_t exp = 63 - __builtin_clzll(us);
+  size_t sub =
+      (us >> (exp - LOAD_HIST_SUB_BITS)) & ((1 << LOAD_HIST_SUB_BITS) - 1);
+  return ((exp - LOAD_HIST_SUB_BITS + 1) << LOAD_HIST_SUB_BITS) + sub;
+}
+
+/* the (upper) value represented by a histogram bucket */
+static uint64_t hist_value(size_t index) {
+  if (index < (1 << LOAD_HIST_SUB_BITS))
+    return index;
+  size_t exp = (index >> LOAD_HIST_SUB_BITS) + LOAD_HIST_SUB_BITS - 1;
+  uint64_t sub = index & ((1 << LOAD_HIST_SUB_BITS) - 1);
+  return ((((uint64_t)1 << LOAD_HIST_SUB_BITS) | sub)
+          << (exp - LOAD_HIST_SUB_BITS)) +
+         (((uint64_t)1 << (exp - LOAD_HIST_SUB_BITS)) - 1);
+}
+
+static uint64_t hist_percentile(double pct) {
+  size_t target = (size_t)((load.responses * pct) / 100);
+  if (!target)
+    target = 1;
+  size_t seen = 0;
+  for (size_t i = 0; i < LOAD_HIST_BUCKETS; ++i) {
+    seen += load.histogram[i];
+    if (seen >= target) {
+      uint64_t v = hist_value(i);
+      return (v < load.latency_max ? v : load.latency_max);
+    }
+  }
+  return load.latency_max;
+}
+
+static void record(uint64_t us, int status) {
+  if (!load.running)
+    return;
+  fio_atomic_add(&load.responses, 1);
+  fio_atomic_add(&load.latency_sum, us);
+  fio_atomic_add(load.histogram + hist_index(us), 1);
+  size_t max = load.latency_max;
+  while (us > max &&
+         !__sync_bool_compare_and_swap(&load.latency_max, max, (size_t)us))
+    max = load.latency_max;
+  if (status < 200 || status > 299)
+    fio_atomic_add(&load.non_2xx, 1);
+}
+
+/* *****************************************************************************
+The load generating connections
+***************************************************************************** */
+
+typedef struct {
+  fio_protocol_s pr;
+  size_t next;      /* the position in the request mix */
+  size_t head;      /* the oldest request in flight (ring position) */
+  size_t in_flight; /* requests waiting for a response */
+  size_t body_left; /* response body bytes not yet received */
+  size_t len;       /* buffered (unparsed) bytes */
+  int status;       /* the status of the response being received */
+  uint8_t in_body;  /* receiving a response's body */
+  uint64_t sent[LOAD_MAX_PIPELINE];
+  char buf[LOAD_BUFFER];
+} client_s;
+
+static void client_connect(void);
+
+static void client_send(intptr_t uuid, client_s *c) {
+  request_s *r = load.mix + (c->next++ % load.mix_len);
+  c->sent[(c->head + c->in_flight) % load.pipeline] = now_us();
+  ++c->in_flight;
+  fio_write2(uuid, .data.buffer = r->data, .length = r->len,
+             .after.dealloc = FIO_DEALLOC_NOOP);
+}
+
+/* returns a pointer to the end of the headers, if they were all received */
+static char *find_headers_end(char *start, char *end) {
+  for (char *i = start; end - i >= 4; ++i) {
+    if (!(i = memchr(i, '\r', end - i - 3)))
+      return NULL;
+    if (i[1] == '\n' && i[2] == '\r' && i[3] == '\n')
+      return i + 4;
+  }
+  return NULL;
+}
+
+/* parses a response's status line and headers, returns -1 on error */
+static int client_parse_headers(client_s *c, char *start, char *end) {
+  if (end - start < 12 || memcmp(start, "HTTP/1.", 7))
+    return -1;
+  c->status = atoi(start + 9);
+  c->body_left = 0;
+  int chunked = 0;
+  char *line = memchr(start, '\n', end - start);
+  while (line && ++line < end) {
+    if (end - line > 15 && !strncasecmp(line, "content-length:", 15))
+      c->body_left = strtoul(line + 15, NULL, 10);
+    else if (end - line > 18 && !strncasecmp(line, "transfer-encoding:", 18))
+      chunked = 1;
+    line = memchr(line, '\n', end - line);
+  }
+  /* the bundled servers always send a Content-Length */
+  return (chunked ? -1 : 0);
+}
+
+/* consumes the buffered data, returns -1 on error */
+static int client_consume(intptr_t uuid, client_s *c) {
+  size_t pos = 0;
+  while (pos < c->len) {
+    if (!c->in_body) {
+      char *start = c->buf + pos;
+      char *eol = find_headers_end(start, c->buf + c->len);
+      if (!eol)
+        break;
+      if (client_parse_headers(c, start, eol))
+        return -1;
+      c->in_body = 1;
+      pos = eol - c->buf;
+    }
+    size_t body = c->len - pos;
+    if (body > c->body_left)
+      body = c->body_left;
+    c->body_left -= body;
+    pos += body;
+    if (c->body_left)
+      break;
+    /* a complete response */
+    c->in_body = 0;
+    if (!c->in_flight)
+      return -1;
+    record(now_us() - c->sent[c->head], c->status);
+    c->head = (c->head + 1) % load.pipeline;
+    --c->in_flight;
+    if (load.running)
+      client_send(uuid, c);
+  }
+  fio_atomic_add(&load.bytes, pos);
+  if (pos) {
+    memmove(c->buf, c->buf + pos, c->len - pos);
+    c->len -= pos;
+  } else if (c->len == LOAD_BUFFER) {
+    return -1; /* the response headers are too long */
+  }
+  return 0;
+}
+
+static void client_on_data(intptr_t uuid, fio_protocol_s *pr) {
+  client_s *c = (client_s *)pr;
+  ssize_t r;
+  while ((r = fio_read(uuid, c->buf + c->len, LOAD_BUFFER - c->len)) > 0) {
+    c->len += r;
+    if (client_consume(uuid, c)) {
+      FIO_LOG_ERROR("couldn't parse the response, closing the connection.");
+      fio_close(uuid);
+      return;
+    }
+  }
+}
+
+static void client_on_close(intptr_t uuid, fio_protocol_s *pr) {
+  client_s *c = (client_s *)pr;
+  if (load.running) {
+    /* requests in flight are lost, keep the connection count constant */
+    fio_atomic_add(&load.errors, c->in_flight);
+    fio_atomic_add(&load.reconnects, 1);
+    client_connect();
+  }
+  free(c);
+  (void)uuid;
+}
+
+static void client_ping(intptr_t uuid, fio_protocol_s *pr) {
+  fio_touch(uuid);
+  (void)pr;
+}
+
+static void client_on_open(intptr_t uuid, void *udata) {
+  client_s *c = malloc(sizeof(*c));
+  FIO_ASSERT_ALLOC(c);
+  *c = (client_s){
+      .pr =
+          {
+              .on_data = client_on_data,
+              .on_close = client_on_close,
+              .ping = client_ping,
+          },
+  };
+  fio_attach(uuid, &c->pr);
+  for (size_t i = 0; i < load.pipeline && load.running; ++i)
+    client_send(uuid, c);
+  (void)udata;
+}
+
+static void client_on_fail(intptr_t uuid, void *udata) {
+  fio_atomic_add(&load.errors, 1);
+  if (load.running)
+    client_connect();
+  (void)uuid;
+  (void)udata;
+}
+
+static void client_connect(void) {
+  if (fio_connect(.address = load.host, .port = load.port,
+                  .on_connect = client_on_open,
+                  .on_fail = client_on_fail) == -1)
+    fio_atomic_add(&load.errors, 1);
+}
+
+/* *****************************************************************************
+Running the test
+***************************************************************************** */
+
+static void load_stop(void *ignr) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  load.running = 0;
+  load.seconds = (now.tv_sec - load.start.tv_sec) +
+                 ((now.tv_nsec - load.start.tv_nsec) / 1000000000.0);
+  fio_stop();
+  (void)ignr;
+}
+
+static void load_start(void) {
+  fprintf(stderr,
+          "* %zu connections, pipelining %zu, for %zu seconds (%zu requests "
+          "in the mix)\n",
+          load.connections, load.pipeline, load.duration, load.mix_len);
+  clock_gettime(CLOCK_MONOTONIC, &load.start);
+  load.running = 1;
+  for (size_t i = 0; i < load.connections; ++i)
+    client_connect();
+  fio_run_every(load.duration * 1000, 1, load_stop, NULL, NULL);
+}
+
+/* the target is probed once before applying the load */
+static void probe_on_response(http_s *h) {
+  if (h->status_str == FIOBJ_INVALID) {
+    /* the connection is open, request the first path in the mix */
+    fiobj_free(h->path);
+    h->path = fiobj_dup(load.probe_path);
+    http_finish(h);
+    return;
+  }
+  FIOBJ key = fiobj_str_new("server", 6);
+  FIOBJ server = fiobj_hash_get(h->headers, key);
+  fiobj_free(key);
+  fprintf(stderr, "* target responded with %zu (server: %s)\n", h->status,
+          (server ? fiobj_obj2cstr(server).data : "unknown"));
+  load.running = 2; /* the probe succeeded */
+  fio_close(http_uuid(h));
+}
+
+static void probe_on_finish(http_settings_s *settings) {
+  if (load.running != 2) {
+    fprintf(stderr, "ERROR: couldn't reach the target.\n");
+    fio_stop();
+    return;
+  }
+  load_start();
+  (void)settings;
+}
+
+static void on_start(void *url) {
+  if (http_connect((char *)url, NULL, .on_response = probe_on_response,
+                   .on_finish = probe_on_finish) == -1) {
+    fprintf(stderr, "ERROR: couldn't connect to %s\n", (char *)url);
+    fio_stop();
+  }
+}
+
+/* polls the target's port until it accepts a connection (or time runs out) */
+static int wait_for_target(size_t seconds) {
+  struct addrinfo hints = {.ai_family = AF_UNSPEC,
+                           .ai_socktype = SOCK_STREAM},
+                  *addr;
+  if (getaddrinfo(load.host, load.port, &hints, &addr))
+    return -1;
+  int ret = -1;
+  for (size_t i = 0; ret && i <= seconds * 20; ++i) {
+    if (i)
+      nanosleep(&(struct timespec){.tv_nsec = 50000000}, NULL);
+    int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd == -1)
+      break;
+    ret = connect(fd, addr->ai_addr, addr->ai_addrlen);
+    close(fd);
+  }
+  freeaddrinfo(addr);
+  return ret;
+}
+
+static void load_report(void) {
+  if (!load.seconds)
+    return;
+  fprintf(stderr,
+          "* %zu responses in %.3fs: %.0f req/s, %.2f MB/s\n"
+          "* %zu errors, %zu non-2xx responses, %zu reconnections\n",
+          load.responses, load.seconds, load.responses / load.seconds,
+          (load.bytes / load.seconds) / (1024 * 1024), load.errors,
+          load.non_2xx, load.reconnects);
+  if (!load.responses)
+    return;
+  fprintf(stderr,
+          "* latency (us): mean %zu, p50 %llu, p90 %llu, p99 %llu, p99.9 "
+          "%llu, max %zu\n",
+          load.latency_sum / load.responses,
+          (unsigned long long)hist_percentile(50),
+          (unsigned long long)hist_percentile(90),
+          (unsigned long long)hist_percentile(99),
+          (unsigned long long)hist_percentile(99.9), load.latency_max);
+}
+
+/* *****************************************************************************
+The request mix
+***************************************************************************** */
+
+/* parses "/path*weight,/path" into the request mix */
+static void mix_init(const char *paths) {
+  size_t capa = 0;
+  const char *pos = paths;
+  while (*pos) {
+    const char *end = strchr(pos, ',');
+    if (!end)
+      end = pos + strlen(pos);
+    const char *star = memchr(pos, '*', end - pos);
+    size_t weight = (star ? strtoul(star + 1, NULL, 10) : 1);
+    size_t path_len = (star ? star : end) - pos;
+    if (!weight || weight > 1000 || !path_len) {
+      fprintf(stderr, "ERROR: invalid request mix entry: %.*s\n",
+              (int)(end - pos), pos);
+      exit(-1);
+    }
+    size_t len = path_len + strlen(load.host) + 36;
+    char *req = malloc(len);
+    FIO_ASSERT_ALLOC(req);
+    len = snprintf(req, len, "GET %.*s HTTP/1.1\r\nHost: %s\r\n\r\n",
+                   (int)path_len, pos, load.host);
+    if (load.mix_len + weight > capa) {
+      capa = (load.mix_len + weight) << 1;
+      load.mix = realloc(load.mix, capa * sizeof(*load.mix));
+      FIO_ASSERT_ALLOC(load.mix);
+    }
+    if (!load.probe_path)
+      load.probe_path = fiobj_str_new(pos, path_len);
+    for (size_t i = 0; i < weight; ++i)
+      load.mix[load.mix_len++] = (request_s){.data = req, .len = len};
+    pos = (*end ? end + 1 : end);
+  }
+}
+
+static void mix_free(void) {
+  for (size_t i = 0; i < load.mix_len; ++i) {
+    if (!i || load.mix[i].data != load.mix[i - 1].data)
+      free(load.mix[i].data);
+  }
+  free(load.mix);
+  fiobj_free(load.probe_path);
+}
+
+/* *****************************************************************************
+Main
+***************************************************************************** */
+
+int main(int argc, char const *argv[]) {
+  fio_cli_start(
+      argc, argv, 0, 0,
+      "A facil.io HTTP load generator, reporting throughput and latency "
+      "percentiles.\n"
+      "\nThe following arguments are supported:",
+      FIO_CLI_STRING("-url -u The target URL (the path is ignored)."),
+      FIO_CLI_STRING("-paths -r The request mix, i.e.: /plaintext*3,/json"),
+      FIO_CLI_INT("-connections -c The number of connections."),
+      FIO_CLI_INT("-pipeline -d The number of requests in flight per "
+                  "connection."),
+      FIO_CLI_INT("-duration -s The test's duration in seconds."),
+      FIO_CLI_INT("-threads -t The number of threads to use."),
+      FIO_CLI_INT("-wait -w Seconds to wait for the target to start "
+                  "listening."));
+  fio_cli_set_default("-u", "http://127.0.0.1:3000/");
+  fio_cli_set_default("-r", "/");
+  fio_cli_set_default("-c", "16");
+  fio_cli_set_default("-d", "1");
+  fio_cli_set_default("-s", "5");
+  fio_cli_set_default("-t", "1");
+
+  const char *url = fio_cli_get("-u");
+  load.url = fio_url_parse(url, strlen(url));
+  if (!load.url.host.len) {
+    fprintf(stderr, "ERROR: invalid URL: %s\n", url);
+    exit(-1);
+  }
+  load.host = fio_malloc(load.url.host.len + load.url.port.len + 2);
+  FIO_ASSERT_ALLOC(load.host);
+  memcpy(load.host, load.url.host.data, load.url.host.len);
+  load.host[load.url.host.len] = 0;
+  load.port = load.host + load.url.host.len + 1;
+  memcpy(load.port, load.url.port.data, load.url.port.len);
+  load.port[load.url.port.len] = 0;
+  if (!load.url.port.len)
+    load.port = "80";
+
+  load.connections = fio_cli_get_i("-c");
+  load.pipeline = fio_cli_get_i("-d");
+  load.duration = fio_cli_get_i("-s");
+  if (!load.connections || !load.duration || !load.pipeline ||
+      load.pipeline > LOAD_MAX_PIPELINE) {
+    fprintf(stderr, "ERROR: invalid connection / pipelining / duration.\n");
+    exit(-1);
+  }
+  if (fio_cli_get_i("-w") && wait_for_target(fio_cli_get_i("-w"))) {
+    fprintf(stderr, "ERROR: %s isn't accepting connections.\n", url);
+    exit(-1);
+  }
+  mix_init(fio_cli_get("-r"));
+
+  fio_state_callback_add(FIO_CALL_ON_START, on_start, (void *)url);
+  fio_start(.threads = fio_cli_get_i("-t"), .workers = 1);
+  load_report();
+
+  mix_free();
+  fio_free(load.host);
+  fio_cli_end();
+  return (load.responses ? 0 : -1);
+}
@@ -0,0 +1,432 @@
+/*
+A facil.io native WebSocket load generator.
+
+The load generator opens a pool of client connections (using
+`websocket_connect`) and drives the Websocket Shootout workloads against the
+target at a fixed rate:
+
+* echo messages (`-r` messages per second, spread over the pool), reporting
+  the round-trip latency percentiles.
+
+* broadcast messages (`-B` messages per second), reporting the fan-out time -
+  the time it took the broadcast to reach every connection in the pool.
+
+i.e.:
+
+    websocket_load -u ws://127.0.0.1:3000/ -c 256 -r 10000 -B 20 -s 10
+
+The target is expected to behave like the `websocket_shootout` example (every
+connection is subscribed to the broadcast channel). `-wait` polls the target's
+port until it accepts connections, for targets that are still starting up.
+`make bench/ws` runs the load generator against the bundled example over
+loopback.
+*/
+#include "http.h"
+
+#include "fio_cli.h"
+
+#include <netdb.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef LOAD_TICK_MS
+/** The scheduler's resolution, in milliseconds. */
+#define LOAD_TICK_MS 5
+#endif
+
+#ifndef LOAD_BROADCAST_SLOTS
+/** The number of broadcasts being tracked at any single time. */
+#define LOAD_BROADCAST_SLOTS 4096
+#endif
+
+/* log-linear histogram: 16 sub-buckets per power of 2 (~6% precision) */
+#define LOAD_HIST_SUB_BITS 4
+#define LOAD_HIST_BUCKETS ((64 - LOAD_HIST_SUB_BITS + 1) << LOAD_HIST_SUB_BITS)
+
+/* the messages' prefixes, as defined by the Websocket Shootout */
+#define ECHO_PREFIX "{\"type\":\"echo\",\"payload\":\""
+#define BROADCAST_PREFIX "{\"type\":\"broadcast\",\"payload\":\""
+
+/* *****************************************************************************
+State
+***************************************************************************** */
+
+typedef struct {
+  size_t count;
+  size_t sum;
+  size_t max;
+  size_t buckets[LOAD_HIST_BUCKETS];
+} hist_s;
+
+typedef struct {
+  uint64_t sent;   /* the time the broadcast was sent (0 == unused) */
+  size_t expected; /* the number of connections expected to receive it */
+  size_t received; /* the number of connections that received it */
+} broadcast_s;
+
+static struct {
+  /* settings */
+  const char *url;
+  size_t connections;
+  size_t echo_rate;
+  size_t broadcast_rate;
+  size_t duration;
+  size_t payload_len;
+  char *padding;
+  /* the connection pool */
+  intptr_t *pool;
+  size_t open;
+  size_t resolved;
+  /* state */
+  volatile uint8_t running;
+  uint64_t start;
+  double seconds;
+  size_t echo_sent;
+  size_t broadcast_sent;
+  size_t broadcast_id;
+  broadcast_s broadcasts[LOAD_BROADCAST_SLOTS];
+  /* statistics */
+  size_t failed;
+  size_t disconnects;
+  size_t send_errors;
+  size_t bytes;
+  size_t incomplete;
+  hist_s echo;
+  hist_s fanout;
+} load;
+
+/* *****************************************************************************
+Helpers
+***************************************************************************** */
+
+static uint64_t now_us(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return ((uint64_t)t.tv_sec * 1000000) + (t.tv_nsec / 1000);
+}
+
+static size_t hist_index(uint64_t us) {
+  if (us < (1 << LOAD_HIST_SUB_BITS))
+    return us;
+  size_t exp = 63 - __builtin_clzll(us);
+  size_t sub =
+      (us >> (exp - LOAD_HIST_SUB_BITS)) & ((1 << LOAD_HIST_SUB_BITS) - 1);
+  return ((exp - LOAD_HIST_SUB_BITS + 1) << LOAD_HIST_SUB_BITS) + sub;
+}
+
+/* the (upper) value represented by a histogram bucket */
+static uint64_t hist_value(size_t index) {
+  if (index < (1 << LOAD_HIST_SUB_BITS))
+    return index;
+  size_t exp = (index >> LOAD_HIST_SUB_BITS) + LOAD_HIST_SUB_BITS - 1;
+  uint64_t sub = index & ((1 << LOAD_HIST_SUB_BITS) - 1);
+  return ((((uint64_t)1 << LOAD_HIST_SUB_BITS) | sub)
+          << (exp - LOAD_HIST_SUB_BITS)) +
+         (((uint64_t)1 << (exp - LOAD_HIST_SUB_BITS)) - 1);
+}
+
+static uint64_t hist_percentile(hist_s *h, double pct) {
+  size_t target = (size_t)((h->count * pct) / 100);
+  if (!target)
+    target = 1;
+  size_t seen = 0;
+  for (size_t i = 0; i < LOAD_HIST_BUCKETS; ++i) {
+    seen += h->buckets[i];
+    if (seen >= target) {
+      uint64_t v = hist_value(i);
+      return (v < h->max ? v : h->max);
+    }
+  }
+  return h->max;
+}
+
+static void hist_add(hist_s *h, uint64_t us) {
+  fio_atomic_add(&h->count, 1);
+  fio_atomic_add(&h->sum, us);
+  fio_atomic_add(h->buckets + hist_index(us), 1);
+  size_t max = h->max;
+  while (us > max && !__sync_bool_compare_and_swap(&h->max, max, (size_t)us))
+    max = h->max;
+}
+
+static void hist_print(hist_s *h, const char *name) {
+  if (!h->count)
+    return;
+  fprintf(stderr,
+          "* %s (us): mean %zu, p50 %llu, p90 %llu, p99 %llu, p99.9 %llu, "
+          "max %zu\n",
+          name, h->sum / h->count, (unsigned long long)hist_percentile(h, 50),
+          (unsigned long long)hist_percentile(h, 90),
+          (unsigned long long)hist_percentile(h, 99),
+          (unsigned long long)hist_percentile(h, 99.9), h->max);
+}
+
+/* *****************************************************************************
+Receiving messages
+***************************************************************************** */
+
+static void on_broadcast_received(char *payload) {
+  char *pos = payload;
+  size_t id = strtoul(pos, &pos, 10);
+  uint64_t sent = strtoull(pos + 1, NULL, 10);
+  broadcast_s *b = load.broadcasts + (id % LOAD_BROADCAST_SLOTS);
+  if (b->sent != sent)
+    return; /* the slot was reused (the broadcast was incomplete) */
+  if (fio_atomic_add(&b->received, 1) == b->expected)
+    hist_add(&load.fanout, now_us() - sent);
+}
+
+static void on_message(ws_s *ws, fio_str_info_s msg, uint8_t is_text) {
+  fio_atomic_add(&load.bytes, msg.len);
+  if (!is_text)
+    return;
+  if (msg.len > sizeof(ECHO_PREFIX) &&
+      !memcmp(msg.data, ECHO_PREFIX, sizeof(ECHO_PREFIX) - 1)) {
+    uint64_t sent = strtoull(msg.data + sizeof(ECHO_PREFIX) - 1, NULL, 10);
+    hist_add(&load.echo, now_us() - sent);
+  } else if (msg.len > sizeof(BROADCAST_PREFIX) &&
+             !memcmp(msg.data, BROADCAST_PREFIX,
+                     sizeof(BROADCAST_PREFIX) - 1)) {
+    on_broadcast_received(msg.data + sizeof(BROADCAST_PREFIX) - 1);
+  }
+  /* `broadcastResult` acknowledgments are ignored */
+  (void)ws;
+}
+
+/* *****************************************************************************
+Sending messages
+***************************************************************************** */
+
+/* runs with the connection locked, the protocol object is the WebSocket */
+static void send_task(intptr_t uuid, fio_protocol_s *pr, void *is_broadcast) {
+  char buf[128];
+  int len;
+  const uint64_t t = now_us();
+  if (is_broadcast) {
+    size_t id = fio_atomic_add(&load.broadcast_id, 1);
+    broadcast_s *b = load.broadcasts + (id % LOAD_BROADCAST_SLOTS);
+    if (b->sent && b->received < b->expected)
+      fio_atomic_add(&load.incomplete, 1);
+    *b = (broadcast_s){.sent = t, .expected = load.open};
+    len = snprintf(buf, sizeof(buf), BROADCAST_PREFIX "%zu-%llu-", id,
+                   (unsigned long long)t);
+  } else {
+    len = snprintf(buf, sizeof(buf), ECHO_PREFIX "%llu-",
+                   (unsigned long long)t);
+  }
+  FIOBJ msg = fiobj_str_buf(len + load.payload_len + 2);
+  fiobj_str_write(msg, buf, len);
+  fiobj_str_write(msg, load.padding, load.payload_len);
+  fiobj_str_write(msg, "\"}", 2);
+  websocket_write_fiobj((ws_s *)pr, msg, 1);
+  (void)uuid;
+}
+
+static void send_fallback(intptr_t uuid, void *is_broadcast) {
+  fio_atomic_add(&load.send_errors, 1);
+  (void)uuid;
+  (void)is_broadcast;
+}
+
+static void send_message(size_t index, uint8_t is_broadcast) {
+  fio_defer_io_task(load.pool[index % load.open], .type = FIO_PR_LOCK_WRITE,
+                    .task = send_task, .fallback = send_fallback,
+                    .udata = (void *)(uintptr_t)is_broadcast);
+}
+
+/* sends the messages that are due since the last tick */
+static void load_tick(void *ignr) {
+  if (!load.running)
+    return;
+  const uint64_t elapsed = now_us() - load.start;
+  const size_t echo_due = (size_t)((load.echo_rate * elapsed) / 1000000);
+  const size_t broadcast_due =
+      (size_t)((load.broadcast_rate * elapsed) / 1000000);
+  while (load.echo_sent < echo_due) {
+    send_message(load.echo_sent, 0);
+    ++load.echo_sent;
+  }
+  while (load.broadcast_sent < broadcast_due) {
+    /* broadcasts are sent by different connections than most echoes */
+    send_message(load.open - 1 - (load.broadcast_sent % load.open), 1);
+    ++load.broadcast_sent;
+  }
+  (void)ignr;
+}
+
+/* *****************************************************************************
+Running the test
+***************************************************************************** */
+
+static void load_finish(void *ignr) {
+  fio_stop();
+  (void)ignr;
+}
+
+static void load_stop(void *ignr) {
+  load.running = 0;
+  load.seconds = (now_us() - load.start) / 1000000.0;
+  /* give the messages in flight a chance to arrive */
+  fio_run_every(250, 1, load_finish, NULL, NULL);
+  (void)ignr;
+}
+
+static void load_start(void) {
+  if (!load.open) {
+    fprintf(stderr, "ERROR: couldn't connect to %s\n", load.url);
+    fio_stop();
+    return;
+  }
+  fprintf(stderr,
+          "* %zu connections (%zu failed), %zu echo/s and %zu broadcast/s "
+          "for %zu seconds\n",
+          load.open, load.failed, load.echo_rate, load.broadcast_rate,
+          load.duration);
+  load.start = now_us();
+  load.running = 1;
+  fio_run_every(LOAD_TICK_MS, 0, load_tick, NULL, NULL);
+  fio_run_every(load.duration * 1000, 1, load_stop, NULL, NULL);
+}
+
+static void connection_resolved(void) {
+  if (fio_atomic_add(&load.resolved, 1) == load.connections)
+    load_start();
+}
+
+static void on_open(ws_s *ws) {
+  if (load.running) {
+    /* the pool is only filled before the test starts */
+    websocket_close(ws);
+    return;
+  }
+  load.pool[fio_atomic_add(&load.open, 1) - 1] = websocket_uuid(ws);
+  connection_resolved();
+}
+
+static void on_close(intptr_t uuid, void *udata) {
+  if (!uuid) {
+    fio_atomic_add(&load.failed, 1);
+    connection_resolved();
+  } else if (load.running) {
+    fio_atomic_add(&load.disconnects, 1);
+  }
+  (void)udata;
+}
+
+static void on_start(void *ignr) {
+  for (size_t i = 0; i < load.connections; ++i) {
+    if (websocket_connect(load.url, .on_open = on_open,
+                          .on_message = on_message, .on_close = on_close) < 0)
+      on_close(0, NULL);
+  }
+  (void)ignr;
+}
+
+/* polls the target's port until it accepts a connection (or time runs out) */
+static int wait_for_target(size_t seconds) {
+  fio_url_s url = fio_url_parse(load.url, strlen(load.url));
+  char host[256];
+  char port[16] = "80";
+  if (!url.host.len || url.host.len >= sizeof(host) ||
+      url.port.len >= sizeof(port))
+    return -1;
+  memcpy(host, url.host.data, url.host.len);
+  host[url.host.len] = 0;
+  if (url.port.len) {
+    memcpy(port, url.port.data, url.port.len);
+    port[url.port.len] = 0;
+  }
+  struct addrinfo hints = {.ai_family = AF_UNSPEC,
+                           .ai_socktype = SOCK_STREAM},
+                  *addr;
+  if (getaddrinfo(host, port, &hints, &addr))
+    return -1;
+  int ret = -1;
+  for (size_t i = 0; ret && i <= seconds * 20; ++i) {
+    if (i)
+      nanosleep(&(struct timespec){.tv_nsec = 50000000}, NULL);
+    int fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd == -1)
+      break;
+    ret = connect(fd, addr->ai_addr, addr->ai_addrlen);
+    close(fd);
+  }
+  freeaddrinfo(addr);
+  return ret;
+}
+
+static void load_report(void) {
+  if (!load.seconds)
+    return;
+  fprintf(stderr,
+          "* sent %zu echoes and %zu broadcasts in %.3fs, received %.2f MB/s\n"
+          "* %zu echoes answered, %zu broadcasts fully delivered (%zu "
+          "incomplete)\n"
+          "* %zu send errors, %zu disconnections\n",
+          load.echo_sent, load.broadcast_sent, load.seconds,
+          (load.bytes / load.seconds) / (1024 * 1024), load.echo.count,
+          load.fanout.count, load.incomplete, load.send_errors,
+          load.disconnects);
+  hist_print(&load.echo, "echo round-trip");
+  hist_print(&load.fanout, "broadcast fan-out");
+}
+
+/* *****************************************************************************
+Main
+***************************************************************************** */
+
+int main(int argc, char const *argv[]) {
+  fio_cli_start(
+      argc, argv, 0, 0,
+      "A facil.io WebSocket load generator, reporting echo round-trip and "
+      "broadcast fan-out latency percentiles.\n"
+      "\nThe following arguments are supported:",
+      FIO_CLI_STRING("-url -u The target WebSocket URL."),
+      FIO_CLI_INT("-connections -c The number of connections."),
+      FIO_CLI_INT("-rate -r The number of echo messages per second."),
+      FIO_CLI_INT("-broadcasts -B The number of broadcasts per second."),
+      FIO_CLI_INT("-length -l The padding added to each message's payload."),
+      FIO_CLI_INT("-duration -s The test's duration in seconds."),
+      FIO_CLI_INT("-threads -t The number of threads to use."),
+      FIO_CLI_INT("-wait -w Seconds to wait for the target to start "
+                  "listening."));
+  fio_cli_set_default("-u", "ws://127.0.0.1:3000/");
+  fio_cli_set_default("-c", "64");
+  fio_cli_set_default("-r", "1000");
+  fio_cli_set_default("-B", "10");
+  fio_cli_set_default("-l", "32");
+  fio_cli_set_default("-s", "5");
+  fio_cli_set_default("-t", "1");
+
+  load.url = fio_cli_get("-u");
+  load.connections = fio_cli_get_i("-c");
+  load.echo_rate = fio_cli_get_i("-r");
+  load.broadcast_rate = fio_cli_get_i("-B");
+  load.duration = fio_cli_get_i("-s");
+  load.payload_len = fio_cli_get_i("-l");
+  if (!load.connections || !load.duration ||
+      (!load.echo_rate && !load.broadcast_rate)) {
+    fprintf(stderr, "ERROR: invalid connection / rate / duration.\n");
+    exit(-1);
+  }
+  if (fio_cli_get_i("-w") && wait_for_target(fio_cli_get_i("-w"))) {
+    fprintf(stderr, "ERROR: %s isn't accepting connections.\n", load.url);
+    exit(-1);
+  }
+  load.pool = malloc(sizeof(*load.pool) * load.connections);
+  load.padding = malloc(load.payload_len + 1);
+  FIO_ASSERT_ALLOC(load.pool);
+  FIO_ASSERT_ALLOC(load.padding);
+  memset(load.padding, 'x', load.payload_len);
+
+  fio_state_callback_add(FIO_CALL_ON_START, on_start, NULL);
+  fio_start(.threads = fio_cli_get_i("-t"), .workers = 1);
+  load_report();
+
+  free(load.padding);
+  free(load.pool);
+  fio_cli_end();
+  return ((load.echo.count || load.fanout.count) ? 0 : -1);
+}
@@ -205,6 +205,7 @@ int main(int argc, char const *argv[]) {
                   "System dependent default."),
       FIO_CLI_PRINT_HEADER("Connectivity"),
       FIO_CLI_INT("-port -p The port number to listen to."),
+      FIO_CLI_STRING("-address -b The address to bind to."),
       FIO_CLI_PRINT_HEADER("HTTP settings"),
       "-public -www A public folder for serve an HTTP static file service.",
       FIO_CLI_BOOL("-log -v Turns logging on."), FIO_CLI_PRINT_HEADER("Misc"),
@@ -231,7 +232,7 @@ int main(int argc, char const *argv[]) {
   fio_cli_end();
 
   /*     ****  actual code ****     */
-  if (http_listen(port, NULL, .on_request = answer_http_request,
+  if (http_listen(port, fio_cli_get("-b"), .on_request = answer_http_request,
                   .on_upgrade = answer_http_upgrade, .log = print_log,
                   .public_folder = public_folder) == -1) {
     perror("Couldn't initiate Websocket Shootout service");
@@ -31,6 +31,7 @@ Feel free to copy, use and enjoy according to the license provided.
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <sys/wait.h>
 
@@ -80,6 +81,11 @@ Feel free to copy, use and enjoy according to the license provided.
 #define FIO_SLOWLORIS_LIMIT (1 << 10)
 #endif
 
+/* The number of subscriptions a single pub/sub delivery task handles */
+#ifndef FIO_PUBSUB_BATCH
+#define FIO_PUBSUB_BATCH 64
+#endif
+
 #if !defined(__clang__) && !defined(__GNUC__)
 #define __thread _Thread_value
 #endif
@@ -153,6 +159,10 @@ struct fio_packet_s {
   } data;
   uintptr_t offset;
   uintptr_t length;
+  /** the original length (for the connection's `pending_bytes` count). */
+  uintptr_t size;
+  /** a `header` packet, always followed by its data (see `fio_write2`). */
+  uint8_t is_header;
 };
 
 /** Connection data (fd_data) */
@@ -163,6 +173,8 @@ typedef struct {
   fio_packet_s **packet_last;
   /* Data sent so far */
   size_t sent;
+  /** The number of bytes in the pending packets (see `fio_pending_bytes`). */
+  size_t pending_bytes;
   /* fd protocol */
   fio_protocol_s *protocol;
   /* timer handler */
@@ -2592,6 +2604,11 @@ Internal socket flushing related functions
 #define BUFFER_FILE_READ_SIZE 49152
 #endif
 
+/* The maximum number of queued memory packets sent by a single `writev` */
+#ifndef FIO_WRITEV_MAX
+#define FIO_WRITEV_MAX 32
+#endif
+
 #if !defined(USE_SENDFILE) && !defined(USE_SENDFILE_LINUX) &&                  \
     !defined(USE_SENDFILE_BSD) && !defined(USE_SENDFILE_APPLE)
 #if defined(__linux__) /* linux sendfile works  */
@@ -2612,16 +2629,52 @@ static inline void fio_sock_packet_rotate_unsafe(uintptr_t fd) {
   fio_packet_s *packet = fd_data(fd).packet;
   fd_data(fd).packet = packet->next;
   fio_atomic_sub(&fd_data(fd).packet_count, 1);
+  fd_data(fd).pending_bytes -= packet->size;
   if (!packet->next) {
     fd_data(fd).packet_last = &fd_data(fd).packet;
     fd_data(fd).packet_count = 0;
+    fd_data(fd).pending_bytes = 0;
   } else if (&packet->next == fd_data(fd).packet_last) {
     fd_data(fd).packet_last = &fd_data(fd).packet;
   }
   fio_packet_free(packet);
 }
 
+static int fio_sock_write_buffer(int fd, fio_packet_s *packet);
+
+/* sends consecutive memory packets using a single system call */
+static int fio_sock_writev_buffers(int fd, fio_packet_s *packet) {
+  struct iovec iov[FIO_WRITEV_MAX];
+  int count = 0;
+  while (packet && count < FIO_WRITEV_MAX &&
+         packet->write_func == fio_sock_write_buffer) {
+    iov[count].iov_base = (uint8_t *)packet->data.buffer + packet->offset;
+    iov[count].iov_len = packet->length;
+    ++count;
+    packet = packet->next;
+  }
+  ssize_t written = writev(fd, iov, count);
+  if (written <= 0)
+    return (int)written;
+  size_t remaining = (size_t)written;
+  /* rotate the packets that were sent (including empty ones) */
+  while ((packet = fd_data(fd).packet) &&
+         packet->write_func == fio_sock_write_buffer) {
+    if (remaining < packet->length) {
+      packet->length -= remaining;
+      packet->offset += remaining;
+      break;
+    }
+    remaining -= packet->length;
+    fio_sock_packet_rotate_unsafe(fd);
+  }
+  return (int)written;
+}
+
 static int fio_sock_write_buffer(int fd, fio_packet_s *packet) {
+  if (packet->next && packet->next->write_func == fio_sock_write_buffer &&
+      fd_data(fd).rw_hooks == &FIO_DEFAULT_RW_HOOKS)
+    return fio_sock_writev_buffers(fd, packet);
   int written = fd_data(fd).rw_hooks->write(
       fd2uuid(fd), fd_data(fd).rw_udata,
       ((uint8_t *)packet->data.buffer + packet->offset), packet->length);
@@ -2799,6 +2852,7 @@ ssize_t fio_write2_fn(intptr_t uuid, fio_write_args_s options) {
   *packet = (fio_packet_s){
       .length = options.length,
       .offset = options.offset,
+      .size = options.length,
       .data.buffer = (void *)options.data.buffer,
   };
   if (options.is_fd) {
@@ -2812,6 +2866,22 @@ ssize_t fio_write2_fn(intptr_t uuid, fio_write_args_s options) {
     packet->write_func = fio_sock_write_buffer;
     packet->dealloc = (options.after.dealloc ? options.after.dealloc : free);
   }
+  /* the header (if any) is a memory packet queued together with the data */
+  fio_packet_s *first = packet;
+  if (options.header_len) {
+    first = fio_malloc(sizeof(*first) + options.header_len);
+    FIO_ASSERT_ALLOC(first);
+    *first = (fio_packet_s){
+        .next = packet,
+        .write_func = fio_sock_write_buffer,
+        .dealloc = FIO_DEALLOC_NOOP,
+        .data.buffer = (void *)(first + 1),
+        .length = options.header_len,
+        .size = options.header_len,
+        .is_header = 1,
+    };
+    memcpy(first + 1, options.header, options.header_len);
+  }
   /* add packet to outgoing list */
   uint8_t was_empty = 1;
   fio_lock(&uuid_data(uuid).sock_lock);
@@ -2821,19 +2891,24 @@ ssize_t fio_write2_fn(intptr_t uuid, fio_write_args_s options) {
   if (uuid_data(uuid).packet)
     was_empty = 0;
   if (options.urgent == 0) {
-    *uuid_data(uuid).packet_last = packet;
+    *uuid_data(uuid).packet_last = first;
     uuid_data(uuid).packet_last = &packet->next;
   } else {
     fio_packet_s **pos = &uuid_data(uuid).packet;
-    if (*pos)
+    if (*pos) {
+      /* never split a header from its data */
+      if ((*pos)->is_header)
+        pos = &(*pos)->next;
       pos = &(*pos)->next;
+    }
     packet->next = *pos;
-    *pos = packet;
+    *pos = first;
     if (!packet->next) {
       uuid_data(uuid).packet_last = &packet->next;
     }
   }
-  fio_atomic_add(&uuid_data(uuid).packet_count, 1);
+  fio_atomic_add(&uuid_data(uuid).packet_count, 1 + (first != packet));
+  uuid_data(uuid).pending_bytes += options.length + options.header_len;
   fio_unlock(&uuid_data(uuid).sock_lock);
 
   if (was_empty) {
@@ -2843,6 +2918,8 @@ ssize_t fio_write2_fn(intptr_t uuid, fio_write_args_s options) {
   return 0;
 locked_error:
   fio_unlock(&uuid_data(uuid).sock_lock);
+  if (first != packet)
+    fio_packet_free(first);
   fio_packet_free(packet);
   errno = EBADF;
   return -1;
@@ -2867,6 +2944,55 @@ size_t fio_pending(intptr_t uuid) {
   return uuid_data(uuid).packet_count;
 }
 
+/**
+ * Returns the number of bytes waiting in the socket's queue (the total length
+ * of the pending `fio_write` calls, including partially sent ones).
+ */
+size_t fio_pending_bytes(intptr_t uuid) {
+  if (!uuid_is_valid(uuid))
+    return 0;
+  return uuid_data(uuid).pending_bytes;
+}
+
+/**
+ * Drops the `fio_write` calls waiting in the socket's queue, except for the one
+ * being sent (which might have been partially sent), so data written
+ * afterwards follows a complete `fio_write` call.
+ *
+ * Returns the number of bytes dropped.
+ */
+size_t fio_drop_pending(intptr_t uuid) {
+  size_t dropped = 0;
+  uint16_t count = 0;
+  fio_packet_s *packet;
+  if (!uuid_is_valid(uuid))
+    return 0;
+  fio_lock(&uuid_data(uuid).sock_lock);
+  fio_packet_s **pos = &uuid_data(uuid).packet;
+  if (*pos) {
+    /* never split a header from its data */
+    if ((*pos)->is_header)
+      pos = &(*pos)->next;
+    pos = &(*pos)->next;
+  }
+  packet = *pos;
+  *pos = NULL;
+  uuid_data(uuid).packet_last = pos;
+  for (fio_packet_s *tmp = packet; tmp; tmp = tmp->next) {
+    dropped += tmp->size;
+    ++count;
+  }
+  fio_atomic_sub(&uuid_data(uuid).packet_count, count);
+  uuid_data(uuid).pending_bytes -= dropped;
+  fio_unlock(&uuid_data(uuid).sock_lock);
+  while (packet) {
+    fio_packet_s *tmp = packet;
+    packet = packet->next;
+    fio_packet_free(tmp);
+  }
+  return dropped;
+}
+
 /**
  * `fio_close` marks the connection for disconnection once all the data was
  * sent. The actual disconnection will be managed by the `fio_flush` function.
@@ -2907,6 +3033,7 @@ void fio_force_close(intptr_t uuid) {
   uuid_data(uuid).packet = NULL;
   uuid_data(uuid).packet_last = &uuid_data(uuid).packet;
   uuid_data(uuid).sent = 0;
+  uuid_data(uuid).pending_bytes = 0;
   fio_unlock(&uuid_data(uuid).sock_lock);
   while (packet) {
     fio_packet_s *tmp = packet;
@@ -3488,6 +3615,7 @@ Initialize the library
 ***************************************************************************** */
 
 static void fio_pubsub_on_fork(void);
+static void fio_shm_release_worker(pid_t pid);
 
 /* Called within a child process after it starts. */
 static void fio_on_fork(void) {
@@ -3803,19 +3931,22 @@ static void fio_worker_cleanup(void) {
   }
   fio_defer_push_task(fio_cycle_unwind, NULL, NULL);
   fio_defer_perform();
-  for (size_t i = 0; i <= fio_data->max_protocol_fd; ++i) {
-    if (fd_data(i).protocol || fd_data(i).open) {
-      fio_force_close(fd2uuid(i));
-    }
-  }
-  fio_timer_clear_all();
-  fio_defer_perform();
   if (!fio_data->is_worker) {
+    /* workers must read the shutdown message before the connection closes,
+     * otherwise they report a parent crash */
     fio_cluster_signal_children();
     fio_defer_perform();
+    while (fio_flush_all())
+      fio_throttle_thread(262143UL);
     while (wait(NULL) != -1)
       ;
   }
+  for (size_t i = 0; i <= fio_data->max_protocol_fd; ++i) {
+    if (fd_data(i).protocol || fd_data(i).open) {
+      fio_force_close(fd2uuid(i));
+    }
+  }
+  fio_timer_clear_all();
   fio_defer_perform();
   fio_state_callback_force(FIO_CALL_ON_FINISH);
   fio_defer_perform();
@@ -3842,6 +3973,8 @@ static void *fio_sentinel_worker_thread(void *arg) {
   } else if (child) {
     int status;
     waitpid(child, &status, 0);
+    /* release the shared memory the worker didn't (or couldn't) release */
+    fio_shm_release_worker(child);
 #if DEBUG
     if (fio_data->active) { /* !WIFEXITED(status) || WEXITSTATUS(status) */
       if (!WIFEXITED(status) || WEXITSTATUS(status)) {
@@ -5102,8 +5235,12 @@ typedef enum fio_cluster_message_type_e {
   FIO_CLUSTER_MSG_SHUTDOWN,
   FIO_CLUSTER_MSG_ERROR,
   FIO_CLUSTER_MSG_PING,
+  FIO_CLUSTER_MSG_SHM_SLOT,
 } fio_cluster_message_type_e;
 
+/** a message type flag, marking a shared memory descriptor payload. */
+#define FIO_CLUSTER_MSG_SHM 0x100
+
 typedef struct fio_collection_s fio_collection_s;
 
 #ifndef __clang__ /* clang might misbehave by assumming non-alignment */
@@ -5201,10 +5338,141 @@ struct fio_collection_s {
 #define COLLECTION_INIT                                                        \
   { .channels = FIO_SET_INIT, .lock = FIO_LOCK_INIT }
 
+/* *****************************************************************************
+Pattern index - a trie of the patterns' literal prefixes
+
+Glob patterns are indexed by their literal prefix (the text before the first
+wildcard), so publishing walks the trie once along the channel's name and only
+tests the patterns with a matching prefix. Patterns using a custom matching
+function can't be indexed and are always tested (they live at the root).
+***************************************************************************** */
+
+static int fio_glob_match(fio_str_info_s pat, fio_str_info_s ch);
+
+typedef struct fio_pattern_node_s fio_pattern_node_s;
+struct fio_pattern_node_s {
+  /** child nodes, sorted by their byte. */
+  fio_pattern_node_s **children;
+  /** the patterns whose literal prefix ends at this node. */
+  channel_s **patterns;
+  uint16_t children_count;
+  uint8_t byte;
+  size_t patterns_count;
+  size_t patterns_capa;
+};
+
+/* the length of a pattern's literal prefix (0 for custom matching functions) */
+static size_t fio_pattern_prefix_len(channel_s *ch) {
+  if (ch->match != fio_glob_match)
+    return 0;
+  size_t i = 0;
+  while (i < ch->name_len && ch->name[i] != '*' && ch->name[i] != '?' &&
+         ch->name[i] != '[' && ch->name[i] != '\\')
+    ++i;
+  return i;
+}
+
+/* finds the child node for `byte`, returns its position (or insertion point) */
+static size_t fio_pattern_child_pos(fio_pattern_node_s *node, uint8_t byte) {
+  size_t start = 0, end = node->children_count;
+  while (start < end) {
+    const size_t mid = (start + end) >> 1;
+    if (node->children[mid]->byte < byte)
+      start = mid + 1;
+    else
+      end = mid;
+  }
+  return start;
+}
+
+static fio_pattern_node_s *fio_pattern_child(fio_pattern_node_s *node,
+                                             uint8_t byte) {
+  const size_t pos = fio_pattern_child_pos(node, byte);
+  if (pos < node->children_count && node->children[pos]->byte == byte)
+    return node->children[pos];
+  return NULL;
+}
+
+/** Adds a pattern to the index (the collection must be locked). */
+static void fio_pattern_index_add(fio_pattern_node_s *node, channel_s *ch) {
+  const size_t len = fio_pattern_prefix_len(ch);
+  for (size_t i = 0; i < len; ++i) {
+    const uint8_t byte = (uint8_t)ch->name[i];
+    const size_t pos = fio_pattern_child_pos(node, byte);
+    if (pos < node->children_count && node->children[pos]->byte == byte) {
+      node = node->children[pos];
+      continue;
+    }
+    fio_pattern_node_s *child = calloc(1, sizeof(*child));
+    FIO_ASSERT_ALLOC(child);
+    child->byte = byte;
+    node->children = realloc(node->children, sizeof(*node->children) *
+                                                 (node->children_count + 1));
+    FIO_ASSERT_ALLOC(node->children);
+    memmove(node->children + pos + 1, node->children + pos,
+            sizeof(*node->children) * (node->children_count - pos));
+    node->children[pos] = child;
+    ++node->children_count;
+    node = child;
+  }
+  if (node->patterns_count == node->patterns_capa) {
+    node->patterns_capa = (node->patterns_capa ? node->patterns_capa << 1 : 2);
+    node->patterns = realloc(node->patterns,
+                             sizeof(*node->patterns) * node->patterns_capa);
+    FIO_ASSERT_ALLOC(node->patterns);
+  }
+  node->patterns[node->patterns_count++] = ch;
+}
+
+static void fio_pattern_node_free(fio_pattern_node_s *node) {
+  for (size_t i = 0; i < node->children_count; ++i) {
+    fio_pattern_node_free(node->children[i]);
+    free(node->children[i]);
+  }
+  free(node->children);
+  free(node->patterns);
+  *node = (fio_pattern_node_s){.byte = node->byte};
+}
+
+/* removes the pattern below `node`, returns 1 if `node` is no longer needed */
+static int fio_pattern_index_remove_at(fio_pattern_node_s *node, channel_s *ch,
+                                       size_t pos, size_t len) {
+  if (pos < len) {
+    const size_t i = fio_pattern_child_pos(node, (uint8_t)ch->name[pos]);
+    if (i == node->children_count ||
+        node->children[i]->byte != (uint8_t)ch->name[pos])
+      return 0;
+    if (fio_pattern_index_remove_at(node->children[i], ch, pos + 1, len)) {
+      free(node->children[i]);
+      --node->children_count;
+      memmove(node->children + i, node->children + i + 1,
+              sizeof(*node->children) * (node->children_count - i));
+    }
+  } else {
+    for (size_t i = 0; i < node->patterns_count; ++i) {
+      if (node->patterns[i] != ch)
+        continue;
+      node->patterns[i] = node->patterns[--node->patterns_count];
+      break;
+    }
+  }
+  if (node->children_count || node->patterns_count)
+    return 0;
+  fio_pattern_node_free(node);
+  return 1;
+}
+
+/** Removes a pattern from the index (the collection must be locked). */
+static void fio_pattern_index_remove(fio_pattern_node_s *root, channel_s *ch) {
+  fio_pattern_index_remove_at(root, ch, 0, fio_pattern_prefix_len(ch));
+}
+
 static struct {
   fio_collection_s filters;
   fio_collection_s pubsub;
   fio_collection_s patterns;
+  /** the pattern index (protected by the `patterns` lock). */
+  fio_pattern_node_s pattern_index;
   struct {
     fio_engine_set_s set;
     fio_lock_i lock;
@@ -5236,6 +5504,7 @@ typedef struct {
   uintptr_t ref; /* internal reference counter */
   int32_t filter;
   int8_t is_json;
+  struct fio_shm_block_s *shm; /* shared memory payload (if any) */
   size_t meta_len;
   fio_msg_metadata_s meta[];
 } fio_msg_internal_s;
@@ -5278,6 +5547,271 @@ static void fio_postoffice_meta_update(fio_msg_internal_s *m) {
   fio_postoffice_meta_copy_free(&t);
 }
 
+/* *****************************************************************************
+ * Shared memory arena - large payloads are written once for all processes
+ **************************************************************************** */
+
+/*
+ * When running more than one worker, payloads of (at least) FIO_PUBSUB_SHM_MIN
+ * bytes published to other processes are written to a shared memory ring,
+ * mapped before forking, and only a small descriptor is sent over the cluster
+ * sockets. When the ring is full, messages are copied as before.
+ *
+ * Set FIO_PUBSUB_SHM_SIZE to 0 to disable.
+ */
+#ifndef FIO_PUBSUB_SHM_SIZE
+#define FIO_PUBSUB_SHM_SIZE (1UL << 26)
+#endif
+#ifndef FIO_PUBSUB_SHM_MIN
+#define FIO_PUBSUB_SHM_MIN 4096
+#endif
+#if FIO_PUBSUB_SHM_SIZE > 0xFFFFFFFFUL
+#error FIO_PUBSUB_SHM_SIZE must fit in a 32 bit block size.
+#endif
+
+/*
+ * Each worker claims a slot (one of 64) in the arena. References held by a
+ * worker, or sent to a worker, are marked with the worker's slot, so the root
+ * can release them once the worker exits (they would otherwise block the ring
+ * from reclaiming the blocks after them). Workers without a slot copy.
+ */
+#define FIO_SHM_SLOTS 64
+
+typedef struct fio_shm_block_s {
+  /** block size, including this header */
+  uint32_t size;
+  /** one per message object and one per descriptor in flight */
+  uint32_t ref;
+  /** payload length */
+  uint64_t len;
+  /** slots of the workers holding a reference (sent to them by the root) */
+  uint64_t held;
+  /** slots of the workers with a descriptor in flight to the root */
+  uint64_t sent;
+} fio_shm_block_s;
+
+/*
+ * Blocks (and the ring's capacity) are aligned to the header's size, so the
+ * end of the ring always fits the header of the block padding it.
+ */
+#define FIO_SHM_ALIGN(len)                                                     \
+  (((len) + sizeof(fio_shm_block_s) - 1) & (~(sizeof(fio_shm_block_s) - 1)))
+
+typedef struct {
+  fio_lock_i lock;
+  /** offset of the next allocation */
+  size_t head;
+  /** offset of the oldest block still in use */
+  size_t tail;
+  /** bytes between tail and head */
+  size_t used;
+  size_t capa;
+  /** the pid of the worker using each slot (0 if free) */
+  pid_t slots[FIO_SHM_SLOTS];
+  uint64_t data[];
+} fio_shm_arena_s;
+
+static fio_shm_arena_s *fio_shm_arena;
+/** the worker's slot in the arena (-1 for the root or when unavailable) */
+static int fio_shm_slot = -1;
+
+/* maps the arena (called in the root process, before forking) */
+static void fio_shm_init(void *ignore) {
+  (void)ignore;
+  if (fio_shm_arena || !FIO_PUBSUB_SHM_SIZE || fio_data->workers <= 1)
+    return;
+  void *mem = mmap(NULL, FIO_PUBSUB_SHM_SIZE, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    FIO_LOG_WARNING("(pub/sub) shared memory arena unavailable, copying.");
+    return;
+  }
+  fio_shm_arena = mem;
+  fio_shm_arena->lock = FIO_LOCK_INIT;
+  fio_shm_arena->capa = (FIO_PUBSUB_SHM_SIZE - sizeof(*fio_shm_arena)) &
+                        (~(sizeof(fio_shm_block_s) - 1));
+}
+
+/* claims a slot for a new worker (called in the child, after forking) */
+static void fio_shm_on_fork(void *ignore) {
+  (void)ignore;
+  fio_shm_slot = -1;
+  if (!fio_shm_arena)
+    return;
+  fio_lock(&fio_shm_arena->lock);
+  for (int i = 0; i < FIO_SHM_SLOTS; ++i) {
+    if (!fio_shm_arena->slots[i]) {
+      fio_shm_arena->slots[i] = getpid();
+      fio_shm_slot = i;
+      break;
+    }
+  }
+  fio_unlock(&fio_shm_arena->lock);
+}
+
+/* reserves a block for `len` bytes (returns NULL when the ring is full) */
+static fio_shm_block_s *fio_shm_alloc(size_t len) {
+  fio_shm_arena_s *a = fio_shm_arena;
+  const size_t need = FIO_SHM_ALIGN(sizeof(fio_shm_block_s) + len + 1);
+  if (!a || need > (a->capa >> 2) || (fio_data->is_worker && fio_shm_slot < 0))
+    return NULL;
+  fio_shm_block_s *b = NULL;
+  fio_lock(&a->lock);
+  if (!a->used)
+    a->head = a->tail = 0;
+  if (a->used == a->capa)
+    goto finish;
+  if (a->head >= a->tail) {
+    if (a->capa - a->head < need) {
+      if (a->tail < need)
+        goto finish;
+      /* pad the end of the ring, it's released along with the tail */
+      b = (fio_shm_block_s *)((uint8_t *)a->data + a->head);
+      *b = (fio_shm_block_s){.size = (uint32_t)(a->capa - a->head)};
+      a->used += a->capa - a->head;
+      a->head = 0;
+    }
+  } else if (a->tail - a->head < need) {
+    goto finish;
+  }
+  b = (fio_shm_block_s *)((uint8_t *)a->data + a->head);
+  *b = (fio_shm_block_s){
+      .size = (uint32_t)need,
+      .ref = 1,
+      .len = len,
+      .held = (fio_data->is_worker ? ((uint64_t)1 << fio_shm_slot) : 0),
+  };
+  a->used += need;
+  a->head += need;
+  if (a->head == a->capa)
+    a->head = 0;
+finish:
+  fio_unlock(&a->lock);
+  return b;
+}
+
+/* reclaims released blocks at the ring's tail (the lock must be held) */
+static void fio_shm_reclaim(fio_shm_arena_s *a) {
+  while (a->used) {
+    fio_shm_block_s *t = (fio_shm_block_s *)((uint8_t *)a->data + a->tail);
+    if (t->ref)
+      break;
+    a->used -= t->size;
+    a->tail += t->size;
+    if (a->tail == a->capa)
+      a->tail = 0;
+  }
+}
+
+/**
+ * Releases a reference owned by the worker in `slot` (marked in `owner`), or
+ * by the root (`slot == -1`). A reference that was already released (by the
+ * root, for a worker that exited) is ignored. A non-zero `pid` must match the
+ * slot's worker.
+ */
+static void fio_shm_drop(fio_shm_block_s *b, uint64_t *owner, int slot,
+                         pid_t pid) {
+  fio_shm_arena_s *a = fio_shm_arena;
+  fio_lock(&a->lock);
+  if (slot >= 0) {
+    if ((pid && a->slots[slot] != pid) || !(*owner & ((uint64_t)1 << slot)))
+      goto finish;
+    *owner &= ~((uint64_t)1 << slot);
+  }
+  if (!--b->ref)
+    fio_shm_reclaim(a);
+finish:
+  fio_unlock(&a->lock);
+}
+
+/* releases the calling process's (message object) reference */
+static void fio_shm_free(fio_shm_block_s *b) {
+  fio_shm_drop(b, &b->held, (fio_data->is_worker ? fio_shm_slot : -1), 0);
+}
+
+/**
+ * Adds the reference of a descriptor sent to the root (by a worker) or to the
+ * worker in `slot` (by the root). Returns -1 if the worker can't hold it.
+ */
+static int fio_shm_send(fio_shm_block_s *b, int slot, pid_t pid) {
+  fio_shm_arena_s *a = fio_shm_arena;
+  int ret = -1;
+  fio_lock(&a->lock);
+  if (fio_data->is_worker) {
+    if (fio_shm_slot < 0 || (b->sent & ((uint64_t)1 << fio_shm_slot)))
+      goto finish;
+    b->sent |= ((uint64_t)1 << fio_shm_slot);
+  } else {
+    if (slot < 0 || a->slots[slot] != pid || (b->held & ((uint64_t)1 << slot)))
+      goto finish;
+    b->held |= ((uint64_t)1 << slot);
+  }
+  ++b->ref;
+  ret = 0;
+finish:
+  fio_unlock(&a->lock);
+  return ret;
+}
+
+/**
+ * Takes over the reference of a received descriptor (sent by the worker in
+ * `slot`, if received by the root). Returns -1 if the reference is gone.
+ */
+static int fio_shm_receive(fio_shm_block_s *b, int slot, pid_t pid) {
+  fio_shm_arena_s *a = fio_shm_arena;
+  int ret = -1;
+  fio_lock(&a->lock);
+  if (fio_data->is_worker) {
+    if (fio_shm_slot < 0 || !(b->held & ((uint64_t)1 << fio_shm_slot)))
+      goto finish;
+  } else {
+    if (slot < 0 || a->slots[slot] != pid || !(b->sent & ((uint64_t)1 << slot)))
+      goto finish;
+    b->sent &= ~((uint64_t)1 << slot);
+  }
+  ret = 0;
+finish:
+  fio_unlock(&a->lock);
+  return ret;
+}
+
+/**
+ * Releases all the references owned by an exited worker (or by all workers,
+ * if `pid` is 0) and frees their slots (called by the root).
+ */
+static void fio_shm_release_worker(pid_t pid) {
+  fio_shm_arena_s *a = fio_shm_arena;
+  if (!a)
+    return;
+  fio_lock(&a->lock);
+  for (int i = 0; i < FIO_SHM_SLOTS; ++i) {
+    if (!a->slots[i] || (pid && a->slots[i] != pid))
+      continue;
+    const uint64_t bit = (uint64_t)1 << i;
+    size_t pos = a->tail;
+    for (size_t left = a->used; left;) {
+      fio_shm_block_s *b = (fio_shm_block_s *)((uint8_t *)a->data + pos);
+      b->ref -= !!(b->held & bit) + !!(b->sent & bit);
+      b->held &= ~bit;
+      b->sent &= ~bit;
+      left -= b->size;
+      pos += b->size;
+      if (pos == a->capa)
+        pos = 0;
+    }
+    a->slots[i] = 0;
+  }
+  fio_shm_reclaim(a);
+  fio_unlock(&a->lock);
+}
+
+/* releases the references of all the workers once they're done (root) */
+static void fio_shm_on_finish(void *ignore) {
+  (void)ignore;
+  if (fio_parent_pid() == getpid())
+    fio_shm_release_worker(0);
+}
+
 static fio_msg_internal_s *
 fio_msg_internal_create(int32_t filter, uint32_t type, fio_str_info_s ch,
                         fio_str_info_s data, int8_t is_json, int8_t cpy) {
@@ -5339,6 +5873,8 @@ static inline void fio_msg_internal_free(fio_msg_internal_s *m) {
       m->meta[m->meta_len].on_finish(&tmp_msg, m->meta[m->meta_len].metadata);
     }
   }
+  if (m->shm)
+    fio_shm_free(m->shm);
   fio_free(m);
 }
 
@@ -5350,16 +5886,103 @@ static inline fio_msg_internal_s *fio_msg_internal_dup(fio_msg_internal_s *m) {
   return m;
 }
 
+/**
+ * Creates a message with the payload in the shared memory arena. The wire
+ * format carries a descriptor instead of the payload.
+ *
+ * Returns NULL if the arena is unavailable (or full).
+ */
+static fio_msg_internal_s *
+fio_msg_internal_create_shm(int32_t filter, uint32_t type, fio_str_info_s ch,
+                            fio_str_info_s data, int8_t is_json) {
+  fio_shm_block_s *b = fio_shm_alloc(data.len);
+  if (!b)
+    return NULL;
+  memcpy(b + 1, data.data, data.len);
+  ((char *)(b + 1))[data.len] = 0;
+  fio_msg_internal_s *m = fio_msg_internal_create(
+      filter, type | FIO_CLUSTER_MSG_SHM, ch,
+      (fio_str_info_s){.data = NULL, .len = 16}, is_json, 0);
+  memcpy(m->channel.data, ch.data, ch.len);
+  fio_u2str64(m->data.data, (uint64_t)((uintptr_t)b -
+                                       (uintptr_t)fio_shm_arena->data));
+  fio_u2str64(m->data.data + 8, (uint64_t)data.len);
+  m->shm = b;
+  m->data = (fio_str_info_s){.data = (char *)(b + 1), .len = data.len};
+  fio_postoffice_meta_update(m);
+  return m;
+}
+
+/** Creates a message for other processes, using the arena when possible. */
+static fio_msg_internal_s *
+fio_msg_internal_create2cluster(int32_t filter, uint32_t type,
+                                fio_str_info_s ch, fio_str_info_s data,
+                                int8_t is_json) {
+  fio_msg_internal_s *m = NULL;
+  if (data.len >= FIO_PUBSUB_SHM_MIN && fio_data->workers > 1)
+    m = fio_msg_internal_create_shm(filter, type, ch, data, is_json);
+  if (!m)
+    m = fio_msg_internal_create(filter, type, ch, data, is_json, 1);
+  return m;
+}
+
+/**
+ * Replaces a received descriptor with the payload it points to, taking over
+ * the descriptor's reference (sent by the worker in `slot`, if received by
+ * the root). Returns -1 on error.
+ */
+static int fio_msg_internal_shm_attach(fio_msg_internal_s *m, int slot,
+                                       pid_t pid) {
+  if (!fio_shm_arena || m->data.len != 16)
+    goto error;
+  uint64_t pos = fio_str2u64(m->data.data);
+  uint64_t len = fio_str2u64(m->data.data + 8);
+  if ((pos & 15) || pos >= fio_shm_arena->capa ||
+      len > fio_shm_arena->capa - pos - sizeof(fio_shm_block_s))
+    goto error;
+  fio_shm_block_s *b =
+      (fio_shm_block_s *)((uint8_t *)fio_shm_arena->data + pos);
+  if (b->len != len || fio_shm_receive(b, slot, pid))
+    goto error;
+  m->shm = b;
+  m->data = (fio_str_info_s){.data = (char *)(b + 1), .len = len};
+  return 0;
+error:
+  FIO_LOG_ERROR("(%d) (pub/sub) invalid shared memory descriptor.",
+                (int)getpid());
+  return -1;
+}
+
+/** the message's cluster wire format length (a descriptor replaces data) */
+static inline size_t fio_msg_internal_wire_len(fio_msg_internal_s *m) {
+  return 16 + m->channel.len + (m->shm ? 16 : m->data.len) + 2;
+}
+
 /** internal helper */
 
+/* the caller adds the reference of a descriptor in flight (fio_shm_send) */
 static inline ssize_t fio_msg_internal_send_dup(intptr_t uuid,
                                                 fio_msg_internal_s *m) {
   return fio_write2(uuid, .data.buffer = fio_msg_internal_dup(m),
                     .offset = (sizeof(*m) + (m->meta_len * sizeof(*m->meta))),
-                    .length = 16 + m->data.len + m->channel.len + 2,
+                    .length = fio_msg_internal_wire_len(m),
                     .after.dealloc = fio_msg_internal_free2);
 }
 
+/* sends a copy of a message, with the payload instead of a descriptor */
+static inline ssize_t fio_msg_internal_send_copy(intptr_t uuid,
+                                                 fio_msg_internal_s *m) {
+  const uint32_t type = fio_str2u32((uint8_t *)(m->meta + m->meta_len) + 8) &
+                        ~FIO_CLUSTER_MSG_SHM;
+  fio_msg_internal_s *cpy = fio_msg_internal_create(
+      m->filter, type, m->channel, m->data, m->is_json, 0);
+  memcpy(cpy->channel.data, m->channel.data, m->channel.len);
+  memcpy(cpy->data.data, m->data.data, m->data.len);
+  ssize_t ret = fio_msg_internal_send_dup(uuid, cpy);
+  fio_msg_internal_free(cpy);
+  return ret;
+}
+
 /**
  * A mock pub/sub callback for external subscriptions.
  */
@@ -5425,8 +6048,15 @@ static channel_s *fio_channel_match_dup_lock(fio_str_info_s name,
   };
   uint64_t hashed_name = FIO_HASH_FN(
       name.data, name.len, &fio_postoffice.pubsub, &fio_postoffice.pubsub);
-  channel_s *ch_p =
-      fio_filter_dup_lock_internal(&ch, hashed_name, &fio_postoffice.patterns);
+  fio_collection_s *c = &fio_postoffice.patterns;
+  fio_lock(&c->lock);
+  const size_t count = fio_ch_set_count(&c->channels);
+  channel_s *ch_p = fio_ch_set_insert(&c->channels, hashed_name, &ch);
+  if (fio_ch_set_count(&c->channels) != count)
+    fio_pattern_index_add(&fio_postoffice.pattern_index, ch_p);
+  fio_channel_dup(ch_p);
+  fio_lock(&ch_p->lock);
+  fio_unlock(&c->lock);
   if (fio_ls_embd_is_empty(&ch_p->subscriptions)) {
     fio_pubsub_on_channel_create(ch_p);
   }
@@ -5500,6 +6130,8 @@ void fio_unsubscribe(subscription_s *s) {
     fio_lock(&c->lock);
     /* test again within lock */
     if (fio_ls_embd_is_empty(&ch->subscriptions)) {
+      if (c == &fio_postoffice.patterns)
+        fio_pattern_index_remove(&fio_postoffice.pattern_index, ch);
       fio_ch_set_remove(&c->channels, hashed, ch, NULL);
       removed = (c != &fio_postoffice.filters);
     }
@@ -5707,14 +6339,16 @@ void fio_message_defer(fio_msg_s *msg_) {
   cl->marker = 1;
 }
 
-/* performs the actual callback */
-static void fio_perform_subscription_callback(void *s_, void *msg_) {
-  subscription_s *s = s_;
-  if (fio_trylock(&s->lock)) {
-    fio_defer_push_task(fio_perform_subscription_callback, s_, msg_);
-    return;
-  }
-  fio_msg_internal_s *msg = (fio_msg_internal_s *)msg_;
+/*
+ * Performs the actual callback, returns -1 if it should be performed later.
+ *
+ * On success, the subscription's reference is released, but the message's
+ * reference is left for the caller.
+ */
+static int fio_subscription_deliver(subscription_s *s,
+                                    fio_msg_internal_s *msg) {
+  if (fio_trylock(&s->lock))
+    return -1;
   fio_msg_client_s m = {
       .msg =
           {
@@ -5733,24 +6367,75 @@ static void fio_perform_subscription_callback(void *s_, void *msg_) {
     s->on_message(&m.msg);
   }
   fio_unlock(&s->lock);
-  if (m.marker) {
+  if (m.marker)
+    return -1;
+  fio_subscription_free(s);
+  return 0;
+}
+
+/* performs the actual callback (a single subscription) */
+static void fio_perform_subscription_callback(void *s_, void *msg_) {
+  if (fio_subscription_deliver(s_, msg_)) {
     fio_defer_push_task(fio_perform_subscription_callback, s_, msg_);
     return;
   }
-  fio_msg_internal_free(msg);
-  fio_subscription_free(s);
+  fio_msg_internal_free(msg_);
+}
+
+/** a number of subscriptions receiving the same message in a single task. */
+typedef struct {
+  fio_msg_internal_s *msg;
+  size_t count;
+  subscription_s *subscriptions[FIO_PUBSUB_BATCH];
+} fio_subscription_batch_s;
+
+/* performs the callbacks for a batch of subscriptions */
+static void fio_perform_subscription_batch(void *b_, void *ignr) {
+  fio_subscription_batch_s *b = b_;
+  size_t delivered = 0;
+  for (size_t i = 0; i < b->count; ++i) {
+    /* busy (or deferred) subscriptions are retried on their own */
+    if (fio_subscription_deliver(b->subscriptions[i], b->msg))
+      fio_defer_push_task(fio_perform_subscription_callback,
+                          b->subscriptions[i], b->msg);
+    else
+      ++delivered;
+  }
+  /* release the message references of the delivered subscriptions at once */
+  if (delivered) {
+    if (delivered > 1)
+      fio_atomic_sub(&b->msg->ref, delivered - 1);
+    fio_msg_internal_free(b->msg);
+  }
+  fio_free(b);
+  (void)ignr;
 }
 
 /** UNSAFE! publishes a message to a channel, managing the reference counts */
 static void fio_publish2channel(channel_s *ch, fio_msg_internal_s *msg) {
+  fio_subscription_batch_s *b = NULL;
   FIO_LS_EMBD_FOR(&ch->subscriptions, pos) {
     subscription_s *s = FIO_LS_EMBD_OBJ(subscription_s, node, pos);
     if (!s || s->on_message == fio_mock_on_message) {
       continue;
     }
+    if (!b) {
+      b = fio_malloc(sizeof(*b));
+      FIO_ASSERT_ALLOC(b);
+      b->msg = msg;
+      b->count = 0;
+    }
     fio_atomic_add(&s->ref, 1);
-    fio_atomic_add(&msg->ref, 1);
-    fio_defer_push_task(fio_perform_subscription_callback, s, msg);
+    b->subscriptions[b->count++] = s;
+    if (b->count == FIO_PUBSUB_BATCH) {
+      fio_atomic_add(&msg->ref, b->count);
+      fio_defer_push_task(fio_perform_subscription_batch, b, NULL);
+      b = NULL;
+    }
+  }
+  if (b) {
+    fio_atomic_add(&msg->ref, b->count);
+    fio_defer_push_task(fio_perform_subscription_batch, b, NULL);
   }
   fio_msg_internal_free(msg);
 }
@@ -5788,20 +6473,23 @@ static void fio_publish2process(fio_msg_internal_s *m) {
                           fio_msg_internal_dup(m));
   }
   if (m->filter == 0) {
-    /* pattern matching match */
+    /* pattern matching match, walking the index along the channel's name */
     fio_lock(&fio_postoffice.patterns.lock);
-    FIO_SET_FOR_LOOP(&fio_postoffice.patterns.channels, p) {
-      if (!p->hash) {
-        continue;
-      }
-
-      if (p->obj->match(
-              (fio_str_info_s){.data = p->obj->name, .len = p->obj->name_len},
-              m->channel)) {
-        fio_channel_dup(p->obj);
-        fio_defer_push_urgent(fio_publish2channel_task, p->obj,
-                              fio_msg_internal_dup(m));
+    fio_pattern_node_s *node = &fio_postoffice.pattern_index;
+    size_t pos = 0;
+    while (node) {
+      for (size_t i = 0; i < node->patterns_count; ++i) {
+        channel_s *p = node->patterns[i];
+        if (p->match((fio_str_info_s){.data = p->name, .len = p->name_len},
+                     m->channel)) {
+          fio_channel_dup(p);
+          fio_defer_push_urgent(fio_publish2channel_task, p,
+                                fio_msg_internal_dup(m));
+        }
       }
+      if (pos == m->channel.len)
+        break;
+      node = fio_pattern_child(node, (uint8_t)m->channel.data[pos++]);
     }
     fio_unlock(&fio_postoffice.patterns.lock);
   }
@@ -5815,6 +6503,17 @@ finish:
 
 #define CLUSTER_READ_BUFFER 16384
 
+/*
+ * Published messages are coalesced into batches of (up to) this size, written
+ * once per reactor cycle. Larger messages are sent on their own (set to 0 to
+ * disable batching).
+ */
+#ifndef FIO_CLUSTER_BATCH_SIZE
+#define FIO_CLUSTER_BATCH_SIZE 12288
+#endif
+/* the batch size in use (the tests also run with batching disabled) */
+static size_t fio_cluster_batch_size = FIO_CLUSTER_BATCH_SIZE;
+
 #define FIO_SET_NAME fio_sub_hash
 #define FIO_SET_OBJ_TYPE subscription_s *
 #define FIO_SET_KEY_TYPE fio_str_s
@@ -5842,13 +6541,24 @@ typedef struct cluster_pr_s {
   int32_t filter;
   uint32_t length;
   fio_lock_i lock;
+  /** messages waiting to be written (protected by the cluster_data lock). */
+  char *batch;
+  size_t batch_len;
+  /** the worker's shared memory slot and pid (root connections only). */
+  int32_t shm_slot;
+  pid_t shm_pid;
   uint8_t buffer[CLUSTER_READ_BUFFER];
 } cluster_pr_s;
 
 static struct cluster_data_s {
   intptr_t uuid;
+  /** the root's connections to the workers (`cluster_pr_s` objects). */
   fio_ls_s clients;
+  /** the worker's connection to the root. */
+  cluster_pr_s *pr;
   fio_lock_i lock;
+  /** a batch flushing task was scheduled. */
+  uint8_t batch_scheduled;
   char name[FIO_CLUSTER_NAME_LIMIT + 1];
 } cluster_data = {.clients = FIO_LS_INIT(cluster_data.clients),
                   .lock = FIO_LOCK_INIT};
@@ -5861,12 +6571,14 @@ static void fio_cluster_data_cleanup(int delete_file) {
     unlink(cluster_data.name);
   }
   while (fio_ls_any(&cluster_data.clients)) {
-    intptr_t uuid = (intptr_t)fio_ls_pop(&cluster_data.clients);
-    if (uuid > 0) {
-      fio_close(uuid);
+    cluster_pr_s *c = fio_ls_pop(&cluster_data.clients);
+    if (c && c->uuid > 0) {
+      fio_close(c->uuid);
     }
   }
   cluster_data.uuid = 0;
+  cluster_data.pr = NULL;
+  cluster_data.batch_scheduled = 0;
   cluster_data.lock = FIO_LOCK_INIT;
   cluster_data.clients = (fio_ls_s)FIO_LS_INIT(cluster_data.clients);
 }
@@ -5969,8 +6681,9 @@ static void fio_cluster_on_data(intptr_t uuid, fio_protocol_s *pr_) {
                            .len = c->exp_channel - 1},
           (fio_str_info_s){.data = ((char *)(c->msg + 1) + c->exp_channel + 1),
                            .len = c->exp_msg - 1},
-          (int8_t)(c->type == FIO_CLUSTER_MSG_JSON ||
-                   c->type == FIO_CLUSTER_MSG_ROOT_JSON),
+          (int8_t)((c->type & ~FIO_CLUSTER_MSG_SHM) == FIO_CLUSTER_MSG_JSON ||
+                   (c->type & ~FIO_CLUSTER_MSG_SHM) ==
+                       FIO_CLUSTER_MSG_ROOT_JSON),
           0);
       i += 16;
     }
@@ -6004,6 +6717,11 @@ static void fio_cluster_on_data(intptr_t uuid, fio_protocol_s *pr_) {
         c->exp_msg = 0;
       }
     }
+    if ((c->type & FIO_CLUSTER_MSG_SHM)) {
+      c->type &= ~FIO_CLUSTER_MSG_SHM;
+      if (fio_msg_internal_shm_attach(c->msg, c->shm_slot, c->shm_pid))
+        c->type = FIO_CLUSTER_MSG_ERROR;
+    }
     fio_postoffice_meta_update(c->msg);
     c->handler(c);
     fio_msg_internal_free(c->msg);
@@ -6025,13 +6743,16 @@ static void fio_cluster_ping(intptr_t uuid, fio_protocol_s *pr_) {
   (void)pr_;
 }
 
+/* implemented later, drops the connection's batch */
+static void fio_cluster_batch_discard(cluster_pr_s *c);
+
 static void fio_cluster_on_close(intptr_t uuid, fio_protocol_s *pr_) {
   cluster_pr_s *c = (cluster_pr_s *)pr_;
   if (!fio_data->is_worker) {
     /* a child was lost, respawning is handled elsewhere. */
     fio_lock(&cluster_data.lock);
     FIO_LS_FOR(&cluster_data.clients, pos) {
-      if (pos->obj == (void *)uuid) {
+      if (pos->obj == (void *)c) {
         fio_ls_remove(pos);
         break;
       }
@@ -6047,6 +6768,12 @@ static void fio_cluster_on_close(intptr_t uuid, fio_protocol_s *pr_) {
       kill(getpid(), SIGINT);
     }
   }
+  /* messages still waiting in the batch are lost with the connection */
+  fio_lock(&cluster_data.lock);
+  if (cluster_data.pr == c)
+    cluster_data.pr = NULL;
+  fio_cluster_batch_discard(c);
+  fio_unlock(&cluster_data.lock);
   if (c->msg)
     fio_msg_internal_free(c->msg);
   c->msg = NULL;
@@ -6076,9 +6803,96 @@ fio_cluster_protocol_alloc(intptr_t uuid,
   p->pubsub = (fio_sub_hash_s)FIO_SET_INIT;
   p->patterns = (fio_sub_hash_s)FIO_SET_INIT;
   p->lock = FIO_LOCK_INIT;
+  p->shm_slot = -1;
   return &p->protocol;
 }
 
+/* *****************************************************************************
+ * Batched writes (published messages are coalesced once per cycle)
+ **************************************************************************** */
+
+/* writes the connection's batch (the cluster_data lock must be held) */
+static void fio_cluster_batch_flush(cluster_pr_s *c) {
+  if (!c->batch)
+    return;
+  fio_write2(c->uuid, .data.buffer = c->batch, .length = c->batch_len,
+             .after.dealloc = fio_free);
+  c->batch = NULL;
+  c->batch_len = 0;
+}
+
+/* drops the connection's batch, releasing its descriptors' references */
+static void fio_cluster_batch_discard(cluster_pr_s *c) {
+  for (size_t pos = 0; pos + 16 <= c->batch_len;) {
+    uint8_t *wire = (uint8_t *)c->batch + pos;
+    const size_t ch_len = fio_str2u32(wire);
+    const size_t data_len = fio_str2u32(wire + 4);
+    if ((fio_str2u32(wire + 8) & FIO_CLUSTER_MSG_SHM)) {
+      fio_shm_block_s *b =
+          (fio_shm_block_s *)((uint8_t *)fio_shm_arena->data +
+                              fio_str2u64(wire + 16 + ch_len + 1));
+      if (fio_data->is_worker)
+        fio_shm_drop(b, &b->sent, fio_shm_slot, 0);
+      else if (c->shm_slot >= 0)
+        fio_shm_drop(b, &b->held, c->shm_slot, c->shm_pid);
+    }
+    pos += 16 + ch_len + data_len + 2;
+  }
+  if (c->batch)
+    fio_free(c->batch);
+  c->batch = NULL;
+  c->batch_len = 0;
+}
+
+/* writes all the connections' batches */
+static void fio_cluster_batch_flush_task(void *ignr1, void *ignr2) {
+  fio_lock(&cluster_data.lock);
+  cluster_data.batch_scheduled = 0;
+  if (cluster_data.pr)
+    fio_cluster_batch_flush(cluster_data.pr);
+  if (fio_is_master()) {
+    FIO_LS_FOR(&cluster_data.clients, pos) {
+      fio_cluster_batch_flush((cluster_pr_s *)pos->obj);
+    }
+  }
+  fio_unlock(&cluster_data.lock);
+  (void)ignr1;
+  (void)ignr2;
+}
+
+/* sends a message to a connection (the cluster_data lock must be held) */
+static void fio_cluster_send(cluster_pr_s *c, fio_msg_internal_s *m) {
+  uint8_t *wire = (uint8_t *)(m->meta + m->meta_len);
+  const size_t len = fio_msg_internal_wire_len(m);
+  const uint32_t type = fio_str2u32(wire + 8) & ~FIO_CLUSTER_MSG_SHM;
+  if (m->shm && fio_shm_send(m->shm, c->shm_slot, c->shm_pid)) {
+    /* the worker can't hold a reference (yet), send it the payload */
+    fio_cluster_batch_flush(c);
+    fio_msg_internal_send_copy(c->uuid, m);
+    return;
+  }
+  if (len > (fio_cluster_batch_size >> 2) ||
+      (type != FIO_CLUSTER_MSG_FORWARD && type != FIO_CLUSTER_MSG_JSON &&
+       type != FIO_CLUSTER_MSG_ROOT && type != FIO_CLUSTER_MSG_ROOT_JSON)) {
+    /* large messages and control messages are sent on their own (in order) */
+    fio_cluster_batch_flush(c);
+    fio_msg_internal_send_dup(c->uuid, m);
+    return;
+  }
+  if (c->batch_len + len > fio_cluster_batch_size)
+    fio_cluster_batch_flush(c);
+  if (!c->batch) {
+    c->batch = fio_malloc(fio_cluster_batch_size);
+    FIO_ASSERT_ALLOC(c->batch);
+  }
+  memcpy(c->batch + c->batch_len, wire, len);
+  c->batch_len += len;
+  if (!cluster_data.batch_scheduled) {
+    cluster_data.batch_scheduled = 1;
+    fio_defer_push_task(fio_cluster_batch_flush_task, NULL, NULL);
+  }
+}
+
 /* *****************************************************************************
  * Master (server) IPC Connections
  **************************************************************************** */
@@ -6087,10 +6901,9 @@ static void fio_cluster_server_sender(void *m_, intptr_t avoid_uuid) {
   fio_msg_internal_s *m = m_;
   fio_lock(&cluster_data.lock);
   FIO_LS_FOR(&cluster_data.clients, pos) {
-    if ((intptr_t)pos->obj != -1) {
-      if ((intptr_t)pos->obj != avoid_uuid) {
-        fio_msg_internal_send_dup((intptr_t)pos->obj, m);
-      }
+    cluster_pr_s *c = (cluster_pr_s *)pos->obj;
+    if (c->uuid != avoid_uuid) {
+      fio_cluster_send(c, m);
     }
   }
   fio_unlock(&cluster_data.lock);
@@ -6173,6 +6986,16 @@ static void fio_cluster_server_handler(struct cluster_pr_s *pr) {
     fio_publish2process(fio_msg_internal_dup(pr->msg));
     break;
 
+  case FIO_CLUSTER_MSG_SHM_SLOT:
+    /* the worker's shared memory slot and pid (see fio_shm_on_fork) */
+    if (pr->msg->data.len != 8)
+      break;
+    pr->shm_slot = (int32_t)fio_str2u32(pr->msg->data.data);
+    pr->shm_pid = (pid_t)fio_str2u32(pr->msg->data.data + 4);
+    if (pr->shm_slot >= FIO_SHM_SLOTS)
+      pr->shm_slot = -1;
+    break;
+
   case FIO_CLUSTER_MSG_SHUTDOWN: /* fallthrough */
   case FIO_CLUSTER_MSG_ERROR:    /* fallthrough */
   case FIO_CLUSTER_MSG_PING:     /* fallthrough */
@@ -6187,12 +7010,12 @@ static void fio_cluster_listen_accept(intptr_t uuid, fio_protocol_s *protocol) {
   /* prevent `accept` backlog in parent */
   intptr_t client;
   while ((client = fio_accept(uuid)) != -1) {
-    fio_attach(client,
-               fio_cluster_protocol_alloc(client, fio_cluster_server_handler,
-                                          fio_cluster_server_sender));
+    fio_protocol_s *pr = fio_cluster_protocol_alloc(
+        client, fio_cluster_server_handler, fio_cluster_server_sender);
     fio_lock(&cluster_data.lock);
-    fio_ls_push(&cluster_data.clients, (void *)client);
+    fio_ls_push(&cluster_data.clients, pr);
     fio_unlock(&cluster_data.lock);
+    fio_attach(client, pr);
   }
 }
 
@@ -6257,6 +7080,7 @@ static void fio_cluster_client_handler(struct cluster_pr_s *pr) {
   case FIO_CLUSTER_MSG_PUBSUB_UNSUB:  /* fallthrough */
   case FIO_CLUSTER_MSG_PATTERN_SUB:   /* fallthrough */
   case FIO_CLUSTER_MSG_PATTERN_UNSUB: /* fallthrough */
+  case FIO_CLUSTER_MSG_SHM_SLOT:      /* fallthrough */
 
   default:
     break;
@@ -6264,13 +7088,24 @@ static void fio_cluster_client_handler(struct cluster_pr_s *pr) {
 }
 static void fio_cluster_client_sender(void *m_, intptr_t ignr_) {
   fio_msg_internal_s *m = m_;
+  fio_lock(&cluster_data.lock);
+  if (cluster_data.pr) {
+    fio_cluster_send(cluster_data.pr, m);
+    fio_unlock(&cluster_data.lock);
+    fio_msg_internal_free(m);
+    return;
+  }
+  fio_unlock(&cluster_data.lock);
   if (!uuid_is_valid(cluster_data.uuid) && fio_data->active) {
     /* delay message delivery until we have a vaild uuid */
     fio_defer_push_task((void (*)(void *, void *))fio_cluster_client_sender, m_,
                         (void *)ignr_);
     return;
   }
-  fio_msg_internal_send_dup(cluster_data.uuid, m);
+  if (m->shm && fio_shm_send(m->shm, -1, 0))
+    fio_msg_internal_send_copy(cluster_data.uuid, m);
+  else
+    fio_msg_internal_send_dup(cluster_data.uuid, m);
   fio_msg_internal_free(m);
 }
 
@@ -6285,6 +7120,17 @@ static void fio_cluster_client_sender(void *m_, intptr_t ignr_) {
  * Should either call `facil_attach` or close the connection.
  */
 static void fio_cluster_on_connect(intptr_t uuid, void *udata) {
+  if (fio_shm_slot >= 0) {
+    /* tell the root which shared memory slot belongs to this worker */
+    uint8_t slot[8];
+    fio_u2str32(slot, (uint32_t)fio_shm_slot);
+    fio_u2str32(slot + 4, (uint32_t)getpid());
+    fio_msg_internal_s *m = fio_msg_internal_create(
+        0, FIO_CLUSTER_MSG_SHM_SLOT, (fio_str_info_s){.len = 0},
+        (fio_str_info_s){.data = (char *)slot, .len = 8}, 0, 1);
+    fio_msg_internal_send_dup(uuid, m);
+    fio_msg_internal_free(m);
+  }
   cluster_data.uuid = uuid;
 
   /* inform root about all existing channels */
@@ -6305,8 +7151,12 @@ static void fio_cluster_on_connect(intptr_t uuid, void *udata) {
   }
   fio_unlock(&fio_postoffice.patterns.lock);
 
-  fio_attach(uuid, fio_cluster_protocol_alloc(uuid, fio_cluster_client_handler,
-                                              fio_cluster_client_sender));
+  fio_protocol_s *pr = fio_cluster_protocol_alloc(
+      uuid, fio_cluster_client_handler, fio_cluster_client_sender);
+  fio_lock(&cluster_data.lock);
+  cluster_data.pr = (cluster_pr_s *)pr;
+  fio_unlock(&cluster_data.lock);
+  fio_attach(uuid, pr);
   (void)udata;
 }
 /**
@@ -6403,36 +7253,49 @@ static void fio_cluster_at_exit(void *ignore) {
   /* clear subscriptions of all types */
   while (fio_ch_set_count(&fio_postoffice.patterns.channels)) {
     channel_s *ch = fio_ch_set_last(&fio_postoffice.patterns.channels);
+    fio_channel_dup(ch); /* the last subscription removes (frees) it */
     while (fio_ls_embd_any(&ch->subscriptions)) {
       subscription_s *sub =
           FIO_LS_EMBD_OBJ(subscription_s, node, ch->subscriptions.next);
       fio_unsubscribe(sub);
     }
-    fio_ch_set_pop(&fio_postoffice.patterns.channels);
+    if (fio_ch_set_count(&fio_postoffice.patterns.channels) &&
+        fio_ch_set_last(&fio_postoffice.patterns.channels) == ch)
+      fio_ch_set_pop(&fio_postoffice.patterns.channels);
+    fio_channel_free(ch);
   }
 
   while (fio_ch_set_count(&fio_postoffice.pubsub.channels)) {
     channel_s *ch = fio_ch_set_last(&fio_postoffice.pubsub.channels);
+    fio_channel_dup(ch); /* the last subscription removes (frees) it */
     while (fio_ls_embd_any(&ch->subscriptions)) {
       subscription_s *sub =
           FIO_LS_EMBD_OBJ(subscription_s, node, ch->subscriptions.next);
       fio_unsubscribe(sub);
     }
-    fio_ch_set_pop(&fio_postoffice.pubsub.channels);
+    if (fio_ch_set_count(&fio_postoffice.pubsub.channels) &&
+        fio_ch_set_last(&fio_postoffice.pubsub.channels) == ch)
+      fio_ch_set_pop(&fio_postoffice.pubsub.channels);
+    fio_channel_free(ch);
   }
 
   while (fio_ch_set_count(&fio_postoffice.filters.channels)) {
     channel_s *ch = fio_ch_set_last(&fio_postoffice.filters.channels);
+    fio_channel_dup(ch); /* the last subscription removes (frees) it */
     while (fio_ls_embd_any(&ch->subscriptions)) {
       subscription_s *sub =
           FIO_LS_EMBD_OBJ(subscription_s, node, ch->subscriptions.next);
       fio_unsubscribe(sub);
     }
-    fio_ch_set_pop(&fio_postoffice.filters.channels);
+    if (fio_ch_set_count(&fio_postoffice.filters.channels) &&
+        fio_ch_set_last(&fio_postoffice.filters.channels) == ch)
+      fio_ch_set_pop(&fio_postoffice.filters.channels);
+    fio_channel_free(ch);
   }
   fio_ch_set_free(&fio_postoffice.filters.channels);
   fio_ch_set_free(&fio_postoffice.patterns.channels);
   fio_ch_set_free(&fio_postoffice.pubsub.channels);
+  fio_pattern_node_free(&fio_postoffice.pattern_index);
 
   /* clear engines */
   FIO_PUBSUB_DEFAULT = FIO_PUBSUB_CLUSTER;
@@ -6451,10 +7314,13 @@ static void fio_cluster_at_exit(void *ignore) {
 
 static void fio_pubsub_initialize(void) {
   fio_cluster_init();
+  fio_state_callback_add(FIO_CALL_PRE_START, fio_shm_init, NULL);
   fio_state_callback_add(FIO_CALL_PRE_START, fio_listen2cluster, NULL);
   fio_state_callback_add(FIO_CALL_IN_MASTER, fio_accept_after_fork, NULL);
+  fio_state_callback_add(FIO_CALL_IN_CHILD, fio_shm_on_fork, NULL);
   fio_state_callback_add(FIO_CALL_IN_CHILD, fio_connect2cluster, NULL);
   fio_state_callback_add(FIO_CALL_ON_FINISH, fio_cluster_cleanup, NULL);
+  fio_state_callback_add(FIO_CALL_ON_FINISH, fio_shm_on_finish, NULL);
   fio_state_callback_add(FIO_CALL_AT_EXIT, fio_cluster_at_exit, NULL);
 }
 
@@ -6470,6 +7336,8 @@ static void fio_pubsub_on_fork(void) {
   fio_postoffice.meta.lock = FIO_LOCK_INIT;
   cluster_data.lock = FIO_LOCK_INIT;
   cluster_data.uuid = 0;
+  cluster_data.pr = NULL;
+  cluster_data.batch_scheduled = 0;
   FIO_SET_FOR_LOOP(&fio_postoffice.filters.channels, pos) {
     if (!pos->hash)
       continue;
@@ -6542,10 +7410,10 @@ void fio_publish FIO_IGNORE_MACRO(fio_publish_args_s args) {
   switch ((uintptr_t)args.engine) {
   case 0UL: /* fallthrough (missing default) */
   case 1UL: // ((uintptr_t)FIO_PUBSUB_CLUSTER):
-    m = fio_msg_internal_create(
+    m = fio_msg_internal_create2cluster(
         args.filter,
         (args.is_json ? FIO_CLUSTER_MSG_JSON : FIO_CLUSTER_MSG_FORWARD),
-        args.channel, args.message, args.is_json, 1);
+        args.channel, args.message, args.is_json);
     fio_send2cluster(m);
     fio_publish2process(m);
     break;
@@ -6555,10 +7423,10 @@ void fio_publish FIO_IGNORE_MACRO(fio_publish_args_s args) {
     fio_publish2process(m);
     break;
   case 3UL: // ((uintptr_t)FIO_PUBSUB_SIBLINGS):
-    m = fio_msg_internal_create(
+    m = fio_msg_internal_create2cluster(
         args.filter,
         (args.is_json ? FIO_CLUSTER_MSG_JSON : FIO_CLUSTER_MSG_FORWARD),
-        args.channel, args.message, args.is_json, 1);
+        args.channel, args.message, args.is_json);
     fio_send2cluster(m);
     fio_msg_internal_free(m);
     m = NULL;
@@ -6688,6 +7556,7 @@ fio_match_fn FIO_MATCH_GLOB = fio_glob_match;
 #else /* FIO_PUBSUB_SUPPORT */
 
 static void fio_pubsub_on_fork(void) {}
+static void fio_shm_release_worker(pid_t pid) { (void)pid; }
 static void fio_cluster_init(void) {}
 static void fio_cluster_signal_children(void) {}
 
@@ -9253,7 +10122,7 @@ FIO_FUNC void fio_malloc_test(void) {
   }
   /* rotate block again */
   b = arena_last_used->block;
-  mem = fio_realloc(mem, 1);
+  mem = fio_malloc(1);
   do {
     mem2 = mem;
     mem = fio_malloc(1);
@@ -9536,6 +10405,121 @@ FIO_FUNC void fio_socket_test(void) {
   fprintf(stderr, "* passed.\n");
 }
 
+/* *****************************************************************************
+Testing the outgoing packet queue
+***************************************************************************** */
+
+FIO_FUNC void fio_write_queue_test(void) {
+  fprintf(stderr, "=== Testing facil.io outgoing packet queue\n");
+  int sv[2];
+  FIO_ASSERT(!socketpair(AF_UNIX, SOCK_STREAM, 0, sv),
+             "couldn't create a socket pair for testing");
+  fio_set_non_block(sv[0]);
+  fio_set_non_block(sv[1]);
+  int buffer_size = 4096;
+  setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &buffer_size, sizeof(buffer_size));
+  setsockopt(sv[1], SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+  intptr_t uuid = fio_fd2uuid(sv[0]);
+  fio_str_s expected = FIO_STR_INIT;
+  fio_str_s received = FIO_STR_INIT;
+  /* fill the kernel's buffer, so the packets stay in the queue */
+  {
+    char junk[1024];
+    ssize_t w;
+    memset(junk, '-', sizeof(junk));
+    while ((w = write(sv[0], junk, sizeof(junk))) > 0)
+      fio_str_write(&expected, junk, w);
+  }
+  /* an urgent packet never lands between a header and its data */
+  fio_write2(uuid, .data.buffer = "data", .length = 4, .header = "head:",
+             .header_len = 5, .after.dealloc = FIO_DEALLOC_NOOP);
+  FIO_ASSERT(fio_pending_bytes(uuid) == 9,
+             "pending_bytes should include the header");
+  fio_write2(uuid, .data.buffer = "urgent", .length = 6, .urgent = 1,
+             .after.dealloc = FIO_DEALLOC_NOOP);
+  fio_str_write(&expected, "head:dataurgent", 15);
+  /* more packets than a single `writev` call sends */
+  for (size_t i = 0; i < FIO_WRITEV_MAX * 3; ++i) {
+    char tmp[256];
+    memset(tmp, 'a' + (i % 26), sizeof(tmp));
+    int len = snprintf(tmp, sizeof(tmp), "packet %zu;", i);
+    tmp[len] = ' ';
+    fio_write(uuid, tmp, sizeof(tmp));
+    fio_str_write(&expected, tmp, sizeof(tmp));
+  }
+  /* the peer reads a little at a time, so the writes are partial */
+  size_t partial = 0;
+  for (size_t i = 0;
+       i < 100000 && fio_str_len(&received) < fio_str_len(&expected); ++i) {
+    char tmp[700];
+    ssize_t r = read(sv[1], tmp, (i & 1) ? 100 : sizeof(tmp));
+    if (r > 0)
+      fio_str_write(&received, tmp, r);
+    fio_flush(uuid);
+    int in_kernel = 0;
+    FIO_ASSERT(!ioctl(sv[1], FIONREAD, &in_kernel), "FIONREAD failed");
+    /* a partially sent packet is counted until it's done */
+    fio_packet_s *head = uuid_data(uuid).packet;
+    const size_t head_sent = (head ? head->size - head->length : 0);
+    partial += !!head_sent;
+    FIO_ASSERT(fio_str_len(&received) + in_kernel + fio_pending_bytes(uuid) -
+                       head_sent ==
+                   fio_str_len(&expected),
+               "pending_bytes error after a partial write (%zu + %d + %zu)",
+               fio_str_len(&received), in_kernel, fio_pending_bytes(uuid));
+  }
+  FIO_ASSERT(partial, "the test should have caused a partial write");
+  FIO_ASSERT(fio_str_len(&received) == fio_str_len(&expected) &&
+                 !memcmp(fio_str_data(&received), fio_str_data(&expected),
+                         fio_str_len(&expected)),
+             "outgoing packets were sent out of order");
+  FIO_ASSERT(!fio_pending(uuid) && !fio_pending_bytes(uuid),
+             "outgoing queue should be empty");
+  /* dropping the queue keeps the packet being sent (and a header's data) */
+  fio_str_resize(&expected, 0);
+  fio_str_resize(&received, 0);
+  {
+    char junk[1024];
+    ssize_t w;
+    memset(junk, '-', sizeof(junk));
+    while ((w = write(sv[0], junk, sizeof(junk))) > 0)
+      fio_str_write(&expected, junk, w);
+  }
+  fio_write2(uuid, .data.buffer = "data", .length = 4, .header = "head:",
+             .header_len = 5, .after.dealloc = FIO_DEALLOC_NOOP);
+  fio_write2(uuid, .data.buffer = "dropped", .length = 7,
+             .after.dealloc = FIO_DEALLOC_NOOP);
+  fio_write2(uuid, .data.buffer = "data", .length = 4, .header = "head:",
+             .header_len = 5, .after.dealloc = FIO_DEALLOC_NOOP);
+  FIO_ASSERT(fio_drop_pending(uuid) == 16 && fio_pending(uuid) == 2 &&
+                 fio_pending_bytes(uuid) == 9,
+             "fio_drop_pending error (%zu packets, %zu bytes left)",
+             fio_pending(uuid), fio_pending_bytes(uuid));
+  fio_write2(uuid, .data.buffer = "after", .length = 5,
+             .after.dealloc = FIO_DEALLOC_NOOP);
+  fio_str_write(&expected, "head:dataafter", 14);
+  for (size_t i = 0;
+       i < 100000 && fio_str_len(&received) < fio_str_len(&expected); ++i) {
+    char tmp[700];
+    ssize_t r = read(sv[1], tmp, sizeof(tmp));
+    if (r > 0)
+      fio_str_write(&received, tmp, r);
+    fio_flush(uuid);
+  }
+  FIO_ASSERT(fio_str_len(&received) == fio_str_len(&expected) &&
+                 !memcmp(fio_str_data(&received), fio_str_data(&expected),
+                         fio_str_len(&expected)),
+             "fio_drop_pending should keep the packet being sent");
+  FIO_ASSERT(!fio_pending(uuid) && !fio_pending_bytes(uuid),
+             "outgoing queue should be empty after fio_drop_pending");
+  fio_force_close(uuid);
+  close(sv[1]);
+  fio_str_free(&expected);
+  fio_str_free(&received);
+  fio_defer_perform();
+  fprintf(stderr, "* passed.\n");
+}
+
 /* *****************************************************************************
 Testing listening socket
 ***************************************************************************** */
@@ -10682,6 +11666,47 @@ FIO_FUNC void fio_pubsub_test_on_unsubscribe(void *udata1, void *udata2) {
   (void)udata2;
 }
 
+/* counts the messages that were freed (using their metadata) */
+static uintptr_t fio_pubsub_test_freed;
+
+/* defers the message twice, testing that it's still valid when retried */
+FIO_FUNC void fio_pubsub_test_on_message_defer(fio_msg_s *msg) {
+  FIO_ASSERT(msg->msg.len == 4 && !memcmp(msg->msg.data, "data", 4) &&
+                 !fio_pubsub_test_freed,
+             "deferred pub/sub message corrupted (or freed)");
+  if (fio_atomic_add((uintptr_t *)msg->udata2, 1) <= 2) {
+    fio_message_defer(msg);
+    return;
+  }
+  fio_atomic_add((uintptr_t *)msg->udata1, 1);
+}
+
+FIO_FUNC void fio_pubsub_test_on_finish(fio_msg_s *msg, void *metadata) {
+  fio_atomic_add(&fio_pubsub_test_freed, 1);
+  (void)msg;
+  (void)metadata;
+}
+FIO_FUNC fio_msg_metadata_s fio_pubsub_test_metadata(fio_str_info_s ch,
+                                                     fio_str_info_s msg,
+                                                     uint8_t is_json) {
+  fio_msg_metadata_s ret = {
+      .type_id = -42,
+      .on_finish = fio_pubsub_test_on_finish,
+      .metadata = (void *)1,
+  };
+  return ret;
+  (void)ch;
+  (void)msg;
+  (void)is_json;
+}
+
+FIO_FUNC int fio_pubsub_test_match_all(fio_str_info_s pattern,
+                                       fio_str_info_s channel) {
+  return 1;
+  (void)pattern;
+  (void)channel;
+}
+
 FIO_FUNC void fio_pubsub_test(void) {
   fprintf(stderr, "=== Testing pub/sub (partial)\n");
   fio_data->active = 1;
@@ -10731,6 +11756,78 @@ FIO_FUNC void fio_pubsub_test(void) {
   ++expect;
   fio_defer_perform();
   FIO_ASSERT(counter == expect, "unsubscribe wasn't called for named channel!");
+  {
+    const char *patterns[] = {"user.*", "user.1?", "us*",    "*",
+                              "user.12", "user.2*", "order.[0-9]"};
+    subscription_s *subs[8];
+    for (size_t i = 0; i < 7; ++i) {
+      subs[i] = fio_subscribe(
+          .channel = {0, strlen(patterns[i]), (char *)patterns[i]},
+          .match = FIO_MATCH_GLOB, .udata1 = &counter,
+          .on_message = fio_pubsub_test_on_message,
+          .on_unsubscribe = fio_pubsub_test_on_unsubscribe);
+    }
+    subs[7] = fio_subscribe(.channel = {0, 4, "user"},
+                            .match = fio_pubsub_test_match_all,
+                            .udata1 = &counter,
+                            .on_message = fio_pubsub_test_on_message,
+                            .on_unsubscribe = fio_pubsub_test_on_unsubscribe);
+    fio_publish(.channel = {0, 7, "user.12"});
+    expect += 6;
+    fio_defer_perform();
+    FIO_ASSERT(counter == expect, "pattern publishing failed (%zu != %zu)",
+               (size_t)counter, (size_t)expect);
+    fio_publish(.channel = {0, 7, "order.7"});
+    expect += 3;
+    fio_defer_perform();
+    FIO_ASSERT(counter == expect, "pattern publishing failed for order.7");
+    fio_publish(.channel = {0, 0, NULL});
+    expect += 1; /* only the custom match ("*" requires a character) */
+    fio_defer_perform();
+    FIO_ASSERT(counter == expect, "pattern publishing failed (empty name)");
+    for (size_t i = 0; i < 8; ++i)
+      fio_unsubscribe(subs[i]);
+    expect += 8;
+    fio_defer_perform();
+    FIO_ASSERT(counter == expect, "pattern unsubscribe count error");
+    FIO_ASSERT(!fio_postoffice.pattern_index.children_count &&
+                   !fio_postoffice.pattern_index.patterns_count,
+               "pattern index should be empty after unsubscribing");
+    fio_publish(.channel = {0, 7, "user.12"});
+    fio_defer_perform();
+    FIO_ASSERT(counter == expect, "unsubscribed patterns got a message");
+  }
+  {
+    /* more subscriptions than a single delivery task handles, one of them
+     * deferring the message (so it's retried on its own) */
+    subscription_s *subs[FIO_PUBSUB_BATCH * 2 + 3];
+    const size_t count = sizeof(subs) / sizeof(subs[0]);
+    uintptr_t deferred = 0;
+    for (size_t i = 0; i < count; ++i) {
+      subs[i] = fio_subscribe(
+          .channel = {0, 4, "many"}, .udata1 = &counter, .udata2 = &deferred,
+          .on_message = (i == FIO_PUBSUB_BATCH + 1
+                             ? fio_pubsub_test_on_message_defer
+                             : fio_pubsub_test_on_message),
+          .on_unsubscribe = fio_pubsub_test_on_unsubscribe);
+    }
+    fio_pubsub_test_freed = 0;
+    fio_message_metadata_callback_set(fio_pubsub_test_metadata, 1);
+    fio_publish(.channel = {0, 4, "many"}, .message = {0, 4, "data"});
+    expect += count;
+    fio_defer_perform();
+    FIO_ASSERT(counter == expect && deferred == 3,
+               "batched publishing failed (%zu != %zu, %zu retries)",
+               (size_t)counter, (size_t)expect, (size_t)deferred);
+    FIO_ASSERT(fio_pubsub_test_freed == 1,
+               "batched message should be freed once all were delivered");
+    fio_message_metadata_callback_set(fio_pubsub_test_metadata, 0);
+    for (size_t i = 0; i < count; ++i)
+      fio_unsubscribe(subs[i]);
+    expect += count;
+    fio_defer_perform();
+    FIO_ASSERT(counter == expect, "batched unsubscribe count error");
+  }
   fio_data->is_worker = 0;
   fio_data->active = 0;
   fio_data->workers = 0;
@@ -10739,8 +11836,381 @@ FIO_FUNC void fio_pubsub_test(void) {
   (void)fio_pubsub_test_on_unsubscribe;
   fprintf(stderr, "* passed.\n");
 }
+
+/* *****************************************************************************
+Cluster (multi-worker) pub/sub tests
+***************************************************************************** */
+
+#define FIO_CLUSTER_TEST_WORKERS 2
+#define FIO_CLUSTER_TEST_COUNT 64
+
+/* state shared by all the processes (mapped before forking) */
+typedef struct {
+  /** set by the root: 1 (batched) once all workers are connected, 2 (not) */
+  volatile uintptr_t phase;
+  /** messages received by the workers */
+  volatile uintptr_t received;
+  /** errors detected by the workers */
+  volatile uintptr_t errors;
+  /** workers that didn't receive the shutdown message */
+  volatile uintptr_t crashes;
+} fio_cluster_test_shared_s;
+
+/* per process state (copied by `fork`) */
+static struct {
+  fio_cluster_test_shared_s *shared;
+  pid_t pid[FIO_CLUSTER_TEST_WORKERS];
+  /** the next sequence number expected from each worker (delivered) */
+  size_t next[FIO_CLUSTER_TEST_WORKERS];
+  /** the next sequence number expected from each worker (read, root only) */
+  size_t wire[FIO_CLUSTER_TEST_WORKERS];
+  size_t received;
+  size_t errors;
+  size_t control;
+  size_t ticks;
+  uintptr_t published;
+} fio_cluster_test_data;
+
+static const fio_str_info_s fio_cluster_test_channel = {
+    .data = (char *)"fio_cluster_test", .len = 16};
+
+/* small messages are batched, others are larger than a quarter batch */
+FIO_FUNC size_t fio_cluster_test_msg_len(size_t seq) {
+  if ((seq & 15) == 9)
+    return FIO_PUBSUB_SHM_MIN + seq; /* shared memory descriptor */
+  if ((seq & 7) == 3)
+    return (FIO_CLUSTER_BATCH_SIZE >> 2) + 1 + seq;
+  return 24 + ((seq * 37) & 255);
+}
+
+/* returns the worker's slot for the message's (or channel's) pid */
+FIO_FUNC ssize_t fio_cluster_test_slot(char *pos, size_t *seq) {
+  pid_t pid = (pid_t)fio_atol(&pos);
+  if (seq) {
+    if (*pos != ':')
+      return -1;
+    ++pos;
+    *seq = (size_t)fio_atol(&pos);
+  }
+  for (size_t i = 0; i < FIO_CLUSTER_TEST_WORKERS; ++i) {
+    if (!fio_cluster_test_data.pid[i])
+      fio_cluster_test_data.pid[i] = pid;
+    if (fio_cluster_test_data.pid[i] == pid)
+      return (ssize_t)i;
+  }
+  return -1;
+}
+
+/* validates a message, returns the worker's slot (or -1) */
+FIO_FUNC ssize_t fio_cluster_test_validate(fio_str_info_s msg, size_t *seq) {
+  ssize_t slot = fio_cluster_test_slot(msg.data, seq);
+  if (slot < 0 || msg.len != fio_cluster_test_msg_len(*seq))
+    return -1;
+  const char fill = (char)('a' + (*seq % 26));
+  for (size_t i = msg.len - 1; msg.data[i] != ':'; --i) {
+    if (msg.data[i] != fill)
+      return -1;
+  }
+  return slot;
+}
+
+/* checks the order in which the root reads the messages (before delivery) */
+FIO_FUNC fio_msg_metadata_s fio_cluster_test_metadata(fio_str_info_s ch,
+                                                      fio_str_info_s msg,
+                                                      uint8_t is_json) {
+  size_t seq = 0;
+  ssize_t slot;
+  if (!fio_is_master() || !msg.len || ch.len != fio_cluster_test_channel.len ||
+      memcmp(ch.data, fio_cluster_test_channel.data, ch.len))
+    goto finish; /* (control messages have no data) */
+  slot = fio_cluster_test_validate(msg, &seq);
+  if (slot < 0 || seq != fio_cluster_test_data.wire[slot]++)
+    ++fio_cluster_test_data.errors;
+finish:
+  return (fio_msg_metadata_s){.type_id = 0};
+  (void)is_json;
+}
+
+/* control messages must arrive between the messages published around them */
+FIO_FUNC void fio_cluster_test_control(fio_str_info_s channel, size_t at) {
+  if (!fio_is_master() || channel.len <= fio_cluster_test_channel.len ||
+      memcmp(channel.data, fio_cluster_test_channel.data,
+             fio_cluster_test_channel.len))
+    return;
+  ssize_t slot = fio_cluster_test_slot(
+      channel.data + fio_cluster_test_channel.len + 1, NULL);
+  if (slot < 0 || !fio_cluster_test_data.wire[slot] ||
+      (fio_cluster_test_data.wire[slot] % FIO_CLUSTER_TEST_COUNT) != at)
+    ++fio_cluster_test_data.errors;
+  ++fio_cluster_test_data.control;
+}
+FIO_FUNC void fio_cluster_test_engine_sub(const fio_pubsub_engine_s *eng,
+                                          fio_str_info_s channel,
+                                          fio_match_fn match) {
+  fio_cluster_test_control(channel, FIO_CLUSTER_TEST_COUNT >> 1);
+  (void)eng;
+  (void)match;
+}
+FIO_FUNC void fio_cluster_test_engine_unsub(const fio_pubsub_engine_s *eng,
+                                            fio_str_info_s channel,
+                                            fio_match_fn match) {
+  fio_cluster_test_control(channel, 0);
+  (void)eng;
+  (void)match;
+}
+FIO_FUNC void fio_cluster_test_engine_pub(const fio_pubsub_engine_s *eng,
+                                          fio_str_info_s channel,
+                                          fio_str_info_s msg, uint8_t is_json) {
+  (void)eng;
+  (void)channel;
+  (void)msg;
+  (void)is_json;
+}
+
+FIO_FUNC void fio_cluster_test_on_message(fio_msg_s *msg) {
+  size_t seq = 0;
+  ssize_t slot = fio_cluster_test_validate(msg->msg, &seq);
+  uintptr_t error = (slot < 0 || seq != fio_cluster_test_data.next[slot]++);
+  fio_cluster_test_data.errors += error;
+  ++fio_cluster_test_data.received;
+  if (fio_is_master())
+    return;
+  fio_atomic_add(&fio_cluster_test_data.shared->received, 1);
+  if (error)
+    fio_atomic_add(&fio_cluster_test_data.shared->errors, 1);
+}
+
+/* publishes a message, the worker's pid and sequence number prefix the fill */
+FIO_FUNC void fio_cluster_test_publish(char *buf, size_t seq) {
+  const size_t len = fio_cluster_test_msg_len(seq);
+  size_t head = (size_t)snprintf(buf, 32, "%d:%zu:", (int)getpid(), seq);
+  memset(buf + head, 'a' + (seq % 26), len - head);
+  fio_publish(.channel = fio_cluster_test_channel,
+              .message = {.data = buf, .len = len});
+}
+
+/* the workers publish (subscribing half way), surrounding control messages */
+FIO_FUNC void fio_cluster_test_publish_all(size_t first) {
+  char *buf = fio_malloc(FIO_PUBSUB_SHM_MIN + (FIO_CLUSTER_BATCH_SIZE >> 2) +
+                         (FIO_CLUSTER_TEST_COUNT << 2));
+  FIO_ASSERT_ALLOC(buf);
+  char name[64];
+  fio_str_info_s ch = {
+      .data = name,
+      .len = (size_t)snprintf(name, 64, "%s:%d", fio_cluster_test_channel.data,
+                              (int)getpid()),
+  };
+  subscription_s *s = NULL;
+  for (size_t i = 0; i < FIO_CLUSTER_TEST_COUNT; ++i) {
+    if (i == (FIO_CLUSTER_TEST_COUNT >> 1))
+      s = fio_subscribe(.channel = ch, .on_message = fio_mock_on_message);
+    fio_cluster_test_publish(buf, first + i);
+  }
+  fio_unsubscribe(s);
+  fio_free(buf);
+}
+
+/* the root runs the phases, the workers publish once per phase */
+FIO_FUNC void fio_cluster_test_task(void *arg) {
+  fio_cluster_test_shared_s *shared = fio_cluster_test_data.shared;
+  if (fio_is_master()) {
+    const size_t expected =
+        shared->phase * FIO_CLUSTER_TEST_WORKERS * FIO_CLUSTER_TEST_COUNT;
+    size_t clients = 0;
+    fio_lock(&cluster_data.lock);
+    FIO_LS_FOR(&cluster_data.clients, pos) { ++clients; }
+    fio_unlock(&cluster_data.lock);
+    if (++fio_cluster_test_data.ticks >= 1000) {
+      fio_stop();
+    } else if (!shared->phase) {
+      shared->phase = (clients == FIO_CLUSTER_TEST_WORKERS);
+    } else if (fio_cluster_test_data.received == expected &&
+               shared->received == expected * FIO_CLUSTER_TEST_WORKERS) {
+      if (shared->phase == 2) {
+        fio_stop();
+      } else {
+        fio_cluster_batch_size = 0; /* messages are sent on their own */
+        shared->phase = 2;
+      }
+    }
+    return;
+  }
+  if (fio_cluster_test_data.published == shared->phase || !cluster_data.pr)
+    return;
+  fio_cluster_test_data.published = shared->phase;
+  if (shared->phase == 2)
+    fio_cluster_batch_size = 0;
+  fio_cluster_test_publish_all((shared->phase - 1) * FIO_CLUSTER_TEST_COUNT);
+  (void)arg;
+}
+
+/* a worker lost the connection to the root without a shutdown message */
+FIO_FUNC void fio_cluster_test_on_crash(void *arg) {
+  fio_atomic_add(&fio_cluster_test_data.shared->crashes, 1);
+  (void)arg;
+}
+
+/* references held by (or sent to) a worker are released when it exits */
+FIO_FUNC void fio_shm_test(void) {
+  fprintf(stderr, "=== Testing cluster shared memory references\n");
+  const uint16_t workers = fio_data->workers;
+  fio_data->workers = FIO_CLUSTER_TEST_WORKERS;
+  fio_shm_init(NULL);
+  fio_shm_arena_s *a = fio_shm_arena;
+  if (!a) {
+    fio_data->workers = workers;
+    fprintf(stderr, "* skipped (no shared memory arena).\n");
+    return;
+  }
+  const pid_t pid = getpid() + 1; /* a (fake) worker in slot 3 */
+  a->slots[3] = pid;
+  fio_shm_block_s *b1 = fio_shm_alloc(FIO_PUBSUB_SHM_MIN);
+  fio_shm_block_s *b2 = fio_shm_alloc(FIO_PUBSUB_SHM_MIN);
+  FIO_ASSERT(b1 && b2, "shared memory allocation failed");
+  FIO_ASSERT(!fio_shm_send(b1, 3, pid), "descriptor not sent to the worker");
+  FIO_ASSERT(fio_shm_send(b1, 3, pid), "descriptor sent to a worker twice");
+  FIO_ASSERT(fio_shm_send(b2, 3, pid + 1), "descriptor sent to a stale pid");
+  fio_shm_free(b2);
+  fio_shm_free(b1);
+  FIO_ASSERT(a->used, "block released while a worker holds it");
+  fio_shm_release_worker(pid);
+  FIO_ASSERT(!a->used && !a->slots[3],
+             "exited worker's references weren't released (%zu bytes)",
+             a->used);
+
+  /* descriptors dropped with a connection's batch (root and worker) */
+  cluster_pr_s c = {.uuid = -1, .shm_slot = 3, .shm_pid = pid};
+  char payload[FIO_PUBSUB_SHM_MIN];
+  memset(payload, 'x', sizeof(payload));
+  for (int worker = 0; worker < 2; ++worker) {
+    a->slots[3] = pid;
+    fio_data->is_worker = (uint8_t)worker;
+    fio_shm_slot = (worker ? 3 : -1);
+    fio_msg_internal_s *m = fio_msg_internal_create_shm(
+        0, FIO_CLUSTER_MSG_FORWARD, fio_cluster_test_channel,
+        (fio_str_info_s){.data = payload, .len = sizeof(payload)}, 0);
+    FIO_ASSERT(m, "shared memory message allocation failed");
+    fio_lock(&cluster_data.lock);
+    fio_cluster_send(&c, m);
+    FIO_ASSERT(c.batch_len, "shared memory descriptor wasn't batched");
+    fio_msg_internal_free(m);
+    FIO_ASSERT(a->used, "block released while its descriptor is batched");
+    fio_cluster_batch_discard(&c);
+    fio_unlock(&cluster_data.lock);
+    FIO_ASSERT(!a->used && !c.batch,
+               "discarded descriptor wasn't released (%zu bytes, worker: %d)",
+               a->used, worker);
+  }
+  /* a descriptor in flight to the root is released when the worker exits */
+  fio_shm_block_s *b = fio_shm_alloc(FIO_PUBSUB_SHM_MIN);
+  FIO_ASSERT(b && !fio_shm_send(b, -1, 0), "worker couldn't send descriptor");
+  fio_shm_free(b);
+  FIO_ASSERT(a->used, "block released while its descriptor is in flight");
+  fio_data->is_worker = 0;
+  fio_shm_slot = -1;
+  fio_shm_release_worker(pid);
+  FIO_ASSERT(!a->used, "in flight descriptor wasn't released");
+
+  /* the end of the ring always fits the header of a padding block */
+  {
+    const size_t hdr = sizeof(fio_shm_block_s);
+    const size_t big = (a->capa >> 3) & (~(hdr - 1));
+    fio_shm_block_s *blocks[16];
+    size_t count = 0;
+    while (a->capa - a->head >= (big << 1)) {
+      blocks[count] = fio_shm_alloc(big - hdr - 1);
+      FIO_ASSERT(blocks[count], "shared memory ring allocation failed");
+      ++count;
+    }
+    /* ask for a block that leaves only 16 bytes at the end of the ring */
+    blocks[count] = fio_shm_alloc(a->capa - a->head - 16 - hdr - 1);
+    FIO_ASSERT(blocks[count], "shared memory ring allocation failed");
+    ++count;
+    FIO_ASSERT(!a->head || a->capa - a->head >= hdr,
+               "shared memory ring end can't fit a header (%zu bytes)",
+               a->capa - a->head);
+    fio_shm_free(blocks[0]);
+    b = fio_shm_alloc(FIO_PUBSUB_SHM_MIN);
+    FIO_ASSERT(b == (fio_shm_block_s *)a->data,
+               "shared memory ring didn't wrap");
+    a->slots[3] = pid; /* walks the ring, including the padding */
+    fio_shm_release_worker(pid);
+    for (size_t i = 1; i < count; ++i)
+      fio_shm_free(blocks[i]);
+    FIO_ASSERT(a->used == b->size,
+               "shared memory ring padding wasn't released");
+    fio_shm_free(b);
+    FIO_ASSERT(!a->used, "shared memory ring wasn't released");
+  }
+  fio_data->workers = workers;
+  fio_defer_perform();
+  fprintf(stderr, "* passed.\n");
+}
+
+/* workers publish to each other, with and without batching */
+FIO_FUNC void fio_cluster_test(void) {
+  fprintf(stderr, "=== Testing cluster pub/sub (%d workers)\n",
+          FIO_CLUSTER_TEST_WORKERS);
+  const size_t expected = FIO_CLUSTER_TEST_WORKERS * FIO_CLUSTER_TEST_COUNT * 2;
+  fio_cluster_test_shared_s *shared =
+      mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  FIO_ASSERT(shared != MAP_FAILED, "couldn't map the cluster test state");
+  memset(shared, 0, sizeof(*shared));
+  fio_pubsub_engine_s engine = {
+      .subscribe = fio_cluster_test_engine_sub,
+      .unsubscribe = fio_cluster_test_engine_unsub,
+      .publish = fio_cluster_test_engine_pub,
+  };
+  memset(&fio_cluster_test_data, 0, sizeof(fio_cluster_test_data));
+  fio_cluster_test_data.shared = shared;
+  subscription_s *s = fio_subscribe(.channel = fio_cluster_test_channel,
+                                    .on_message = fio_cluster_test_on_message);
+  fio_pubsub_attach(&engine);
+  fio_message_metadata_callback_set(fio_cluster_test_metadata, 1);
+  fio_timer_clear_all();
+  fio_run_every(5, 0, fio_cluster_test_task, NULL, NULL);
+  fio_state_callback_add(FIO_CALL_ON_PARENT_CRUSH, fio_cluster_test_on_crash,
+                         NULL);
+  fio_start(.threads = 1, .workers = FIO_CLUSTER_TEST_WORKERS);
+  fio_state_callback_remove(FIO_CALL_ON_PARENT_CRUSH,
+                            fio_cluster_test_on_crash, NULL);
+  fio_timer_clear_all();
+  fio_message_metadata_callback_set(fio_cluster_test_metadata, 0);
+  fio_pubsub_detach(&engine);
+  fio_unsubscribe(s);
+  fio_defer_perform();
+  fio_cluster_batch_size = FIO_CLUSTER_BATCH_SIZE;
+  FIO_ASSERT(shared->phase == 2, "cluster test didn't run without batching");
+  if (fio_shm_arena) {
+    FIO_ASSERT(!fio_shm_arena->used,
+               "cluster shared memory wasn't released (%zu bytes)",
+               fio_shm_arena->used);
+    for (size_t i = 0; i < FIO_SHM_SLOTS; ++i)
+      FIO_ASSERT(!fio_shm_arena->slots[i], "shared memory slot %zu in use", i);
+  }
+  FIO_ASSERT(fio_cluster_test_data.received == expected &&
+                 shared->received == expected * FIO_CLUSTER_TEST_WORKERS,
+             "cluster messages were lost (%zu/%zu at root, %zu/%zu at workers)",
+             fio_cluster_test_data.received, expected,
+             (size_t)shared->received, expected * FIO_CLUSTER_TEST_WORKERS);
+  FIO_ASSERT(!fio_cluster_test_data.errors && !shared->errors,
+             "cluster messages corrupted or out of order (%zu root, %zu "
+             "workers)",
+             fio_cluster_test_data.errors, (size_t)shared->errors);
+  FIO_ASSERT(!shared->crashes,
+             "%zu workers detected a parent crash (no shutdown message)",
+             (size_t)shared->crashes);
+  FIO_ASSERT(fio_cluster_test_data.control == (FIO_CLUSTER_TEST_WORKERS << 2),
+             "cluster control messages were lost (%zu/%d)",
+             fio_cluster_test_data.control, FIO_CLUSTER_TEST_WORKERS << 2);
+  munmap(shared, sizeof(*shared));
+  fprintf(stderr, "* passed (batched and FIO_CLUSTER_BATCH_SIZE == 0).\n");
+}
 #else
 #define fio_pubsub_test()
+#define fio_shm_test()
+#define fio_cluster_test()
 #endif
 
 /* *****************************************************************************
@@ -11022,6 +12492,7 @@ void fio_test(void) {
   fio_timer_test();
   fio_poll_test();
   fio_socket_test();
+  fio_write_queue_test();
   fio_uuid_link_test();
   fio_cycle_test();
   fio_riskyhash_test();
@@ -11031,6 +12502,8 @@ void fio_test(void) {
   fio_base64_test();
   fio_test_random();
   fio_pubsub_test();
+  fio_shm_test();
+  fio_cluster_test();
   (void)fio_sentinel_task;
   (void)deferred_on_shutdown;
   (void)fio_poll;
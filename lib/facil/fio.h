@@ -1170,6 +1170,15 @@ typedef struct {
   uintptr_t length;
   /** Starting point offset from the buffer or file descriptor's beginning. */
   uintptr_t offset;
+  /**
+   * An optional header, copied and sent right before the data.
+   *
+   * No other write can be scheduled between the header and the data, so
+   * framing protocols can send a payload by reference, without copying it.
+   */
+  const void *header;
+  /** The length of the optional `header` (up to 255 bytes). */
+  uint8_t header_len;
   /** The packet will be sent as soon as possible. */
   unsigned urgent : 1;
   /**
@@ -1259,6 +1268,21 @@ inline FIO_FUNC ssize_t fio_sendfile(intptr_t uuid, intptr_t source_fd,
  */
 size_t fio_pending(intptr_t uuid);
 
+/**
+ * Returns the number of bytes waiting in the socket's queue (the total length
+ * of the pending `fio_write` calls, including partially sent ones).
+ */
+size_t fio_pending_bytes(intptr_t uuid);
+
+/**
+ * Drops the `fio_write` calls waiting in the socket's queue, except for the one
+ * being sent (which might have been partially sent), so data written
+ * afterwards follows a complete `fio_write` call.
+ *
+ * Returns the number of bytes dropped.
+ */
+size_t fio_drop_pending(intptr_t uuid);
+
 /**
  * `fio_flush` attempts to write any remaining data in the internal buffer to
  * the underlying file descriptor and closes the underlying file descriptor once
@@ -1761,9 +1785,10 @@ typedef struct {
    * and each pub/sub message (a message where filter == 0) will be tested
    * against that pattern.
    *
-   * Using pattern subscriptions extensively could become a performance concern,
-   * since channel names are tested against each distinct pattern rather than
-   * leveraging a hashmap for possible name matching.
+   * `FIO_MATCH_GLOB` patterns are indexed by their literal prefix (the text
+   * before the first wildcard), so a channel name is only tested against the
+   * patterns with a matching prefix. Patterns starting with a wildcard, or
+   * using a custom `match` function, are tested against every channel name.
    */
   fio_match_fn match;
   /**
@@ -923,6 +923,26 @@ fio_str_info_s fiobj_data_pread(FIOBJ io, intptr_t start_at, uintptr_t length) {
   }
 }
 
+/**
+ * Returns the file descriptor of a file backed Data Stream (or a slice), or -1.
+ */
+int fiobj_data_fd(FIOBJ io, size_t *offset) {
+  size_t pos = 0;
+  if (!io || !FIOBJ_TYPE_IS(io, FIOBJ_T_DATA)) {
+    errno = EFAULT;
+    return -1;
+  }
+  while (obj2io(io)->fd == -2) {
+    pos += obj2io(io)->capa;
+    io = obj2io(io)->source.parent;
+  }
+  if (obj2io(io)->fd < 0)
+    return -1;
+  if (offset)
+    *offset = pos;
+  return obj2io(io)->fd;
+}
+
 /* *****************************************************************************
 Writing API
 ***************************************************************************** */
@@ -1046,6 +1066,14 @@ void fiobj_data_test(void) {
     fprintf(stderr, "* `fiobj_data_read` operation overflow - FAILED!\n");
     exit(-1);
   }
+  {
+    size_t offset = 0;
+    if (fiobj_data_fd(sliceio, &offset) != fiobj_data_fd(fdio, NULL) ||
+        offset != 8 || fiobj_data_fd(strio, NULL) != -1) {
+      fprintf(stderr, "* `fiobj_data_fd` operation FAILED!\n");
+      exit(-1);
+    }
+  }
 
   if (fiobj_obj2cstr(strio).len != fiobj_obj2cstr(text).len ||
       fiobj_obj2cstr(fdio).len != fiobj_obj2cstr(text).len) {
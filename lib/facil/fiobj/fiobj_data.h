@@ -122,6 +122,19 @@ void fiobj_data_seek(FIOBJ io, intptr_t position);
  */
 fio_str_info_s fiobj_data_pread(FIOBJ io, intptr_t start_at, uintptr_t length);
 
+/**
+ * Returns the file descriptor of a file backed Data Stream (or a slice of a
+ * file backed Data Stream), or -1 if the data is stored in memory.
+ *
+ * If `offset` isn't NULL, it's set to the position of the stream's first byte
+ * within the file (slices start within their parent's file).
+ *
+ * This allows the data to be sent or copied without reading it to memory
+ * (i.e., using `fio_sendfile`). The file descriptor is owned by the Data Stream
+ * and MUST NOT be closed.
+ */
+int fiobj_data_fd(FIOBJ io, size_t *offset);
+
 /* *****************************************************************************
 Writing API
 ***************************************************************************** */
@@ -8,6 +8,10 @@ Feel free to copy, use and enjoy according to the license provided.
 #include <fio.h>
 
 #include <http1.h>
+#include <http_client.h>
+#include <http_compress.h>
+#include <http_log.h>
+#include <http_router.h>
 #include <http_internal.h>
 
 #include <ctype.h>
@@ -16,6 +20,8 @@ Feel free to copy, use and enjoy according to the license provided.
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
 #ifndef HAVE_TM_TM_ZONE
@@ -318,6 +324,70 @@ int http_set_cookie(http_s *h, http_cookie_args_s cookie) {
 #define http_set_cookie(http__req__, ...)                                      \
   http_set_cookie((http__req__), (http_cookie_args_s){__VA_ARGS__})
 
+/** sends the body as is (no compression). */
+static inline int http_send_body_uncompressed(http_s *r, void *data,
+                                              uintptr_t length) {
+  add_content_length(r, length);
+  // add_content_type(r);
+  add_date(r);
+  return ((http_vtable_s *)r->private_data.vtbl)
+      ->http_send_body(r, data, length);
+}
+
+/** sends the body as is (no compression), used by the response cache. */
+int http_send_body_uncompressed______internal(http_s *r, void *data,
+                                              uintptr_t length) {
+  return http_send_body_uncompressed(r, data, length);
+}
+
+/**
+ * Returns the content encoding for a (server side) response when compression
+ * is enabled for the connection and negotiated by the client, setting the Vary
+ * header (but not the Content-Encoding header).
+ */
+http_compress_e http_compress_response______internal(http_s *r) {
+  static uint64_t accept_enc_hash = 0;
+  if (!accept_enc_hash)
+    accept_enc_hash = fiobj_hash_string("accept-encoding", 15);
+  static uint64_t ce_hash = 0;
+  if (!ce_hash)
+    ce_hash = fiobj_hash_string("content-encoding", 16);
+  static uint64_t ct_hash = 0;
+  if (!ct_hash)
+    ct_hash = fiobj_hash_string("content-type", 12);
+  http_settings_s *settings = http_settings(r);
+  if (!settings->compress_threshold || settings->is_client ||
+      r->status == 206 ||
+      fiobj_hash_get2(r->private_data.out_headers, ce_hash) ||
+      !http_compress_mime(
+          fiobj_hash_get2(r->private_data.out_headers, ct_hash)))
+    return HTTP_COMPRESS_NONE;
+  set_header_add(r->private_data.out_headers, HTTP_HEADER_VARY,
+                 fiobj_dup(HTTP_HVALUE_ACCEPT_ENCODING));
+  return http_compress_negotiate(
+      fiobj_hash_get2(r->headers, accept_enc_hash),
+      HTTP_COMPRESS_BR | HTTP_COMPRESS_GZIP | HTTP_COMPRESS_DEFLATE);
+}
+
+/**
+ * Compresses a (server side) response body when compression is enabled for the
+ * connection and negotiated by the client, setting the response headers.
+ *
+ * Returns FIOBJ_INVALID if the response shouldn't be compressed.
+ */
+static FIOBJ http_compress_body(http_s *r, void *data, uintptr_t length) {
+  if (length < http_settings(r)->compress_threshold)
+    return FIOBJ_INVALID;
+  http_compress_e encoding = http_compress_response______internal(r);
+  if (!encoding)
+    return FIOBJ_INVALID;
+  FIOBJ compressed = http_compress2str(encoding, 0, data, length);
+  if (compressed)
+    http_set_header(r, HTTP_HEADER_CONTENT_ENCODING,
+                    http_compress_encoding(encoding));
+  return compressed;
+}
+
 /**
  * Sends the response headers and body.
  *
@@ -332,11 +402,20 @@ int http_send_body(http_s *r, void *data, uintptr_t length) {
     http_finish(r);
     return 0;
   }
-  add_content_length(r, length);
-  // add_content_type(r);
-  add_date(r);
-  return ((http_vtable_s *)r->private_data.vtbl)
-      ->http_send_body(r, data, length);
+  FIOBJ compressed = http_compress_body(r, data, length);
+  if (compressed) {
+    fio_str_info_s c = fiobj_obj2cstr(compressed);
+    data = c.data;
+    length = c.len;
+  }
+  http_settings_s *settings = http_settings(r);
+  if (settings && !settings->is_client && http_settings2cache(settings)) {
+    add_date(r);
+    http_cache_store(http_settings2cache(settings), r, data, length);
+  }
+  int ret = http_send_body_uncompressed(r, data, length);
+  fiobj_free(compressed);
+  return ret;
 }
 /**
  * Sends the response headers and the specified file (the response's body).
@@ -371,10 +450,577 @@ static inline int http_test_encoded_path(const char *mem, size_t len) {
   return 0;
 }
 
+/* *****************************************************************************
+Static File Cache
+***************************************************************************** */
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#define HTTP_STATIC_CACHE_INOTIFY 1
+#else
+#define HTTP_STATIC_CACHE_INOTIFY 0
+#endif
+
+/** A cached static file - the cache key is the file's name. */
+typedef struct {
+  fio_ls_embd_s node;  /* LRU list node (least recently used at the head) */
+  FIOBJ name;          /* the file name (cache key) */
+  FIOBJ etag;          /* pre-rendered ETag header value */
+  FIOBJ last_modified; /* pre-rendered Last-Modified header value */
+  FIOBJ mime;          /* Content-Type for the file name */
+  FIOBJ mime_gz;       /* Content-Type when serving a `.gz` sibling */
+  FIOBJ body;          /* the file's content (small files only) */
+  FIOBJ variants[2];   /* compressed content (gzip, br) */
+  uint64_t hash;       /* the file name's hash */
+  off_t size;          /* the file's size */
+  time_t checked_at;   /* last validation (for unwatched entries) */
+  int fd;              /* an open file descriptor (or -1) */
+  uint8_t missing;     /* a negative entry (the file doesn't exist) */
+  uint8_t watched;     /* inotify reports changes for this entry */
+  uint8_t compressible; /* content compresses well (see `http_compress_mime`) */
+  uint8_t pending;      /* compressed variants being computed */
+  uint8_t failed;       /* compressed variants that aren't worth it */
+} http_static_entry_s;
+
+#define FIO_FORCE_MALLOC_TMP 1 /* the cache has a long lifetime */
+#define FIO_SET_NAME http_static_set
+#define FIO_SET_OBJ_TYPE http_static_entry_s *
+#define FIO_SET_OBJ_COMPARE(o1, o2) fiobj_iseq((o1)->name, (o2)->name)
+#include <fio.h>
+
+#define FIO_FORCE_MALLOC_TMP 1 /* maps inotify watch descriptors to folders */
+#define FIO_SET_NAME http_static_dirs
+#define FIO_SET_OBJ_TYPE FIOBJ
+#define FIO_SET_OBJ_COMPARE(o1, o2) (1)
+#define FIO_SET_OBJ_COPY(dest, o) (dest) = fiobj_dup((o))
+#define FIO_SET_OBJ_DESTROY(o) fiobj_free((o))
+#include <fio.h>
+
+static struct {
+  http_static_set_s files;
+  http_static_dirs_s dirs;
+  fio_ls_embd_s lru;
+  fio_ls_embd_s missing; /* negative entries, limited separately */
+  size_t missing_count;
+  size_t memory;
+  size_t generation; /* incremented whenever an invalidation is processed */
+  intptr_t watcher;  /* the inotify uuid (or -1) */
+  fio_lock_i lock;
+} http_static_cache = {
+    .files = FIO_SET_INIT,
+    .dirs = FIO_SET_INIT,
+    .lru = FIO_LS_INIT(http_static_cache.lru),
+    .missing = FIO_LS_INIT(http_static_cache.missing),
+    .watcher = -1,
+    .lock = FIO_LOCK_INIT,
+};
+
+/** Content-Type for a file name, optionally ignoring a `.gz` extension. */
+static FIOBJ http_static_mime(fio_str_info_s s, uint8_t is_gz) {
+  uintptr_t pos;
+  if (is_gz) {
+    pos = s.len - 4;
+    while (pos && s.data[pos] != '.')
+      pos--;
+    pos++; /* assuming, but that's fine. */
+    return http_mimetype_find(s.data + pos, s.len - pos - 3);
+  }
+  pos = s.len - 1;
+  while (pos && s.data[pos] != '.')
+    pos--;
+  pos++; /* assuming, but that's fine. */
+  return http_mimetype_find(s.data + pos, s.len - pos);
+}
+
+static void http_static_entry_free(http_static_entry_s *e) {
+  if (e->fd != -1)
+    close(e->fd);
+  fiobj_free(e->name);
+  fiobj_free(e->etag);
+  fiobj_free(e->last_modified);
+  fiobj_free(e->mime);
+  fiobj_free(e->mime_gz);
+  fiobj_free(e->body);
+  fiobj_free(e->variants[0]);
+  fiobj_free(e->variants[1]);
+  free(e);
+}
+
+static inline size_t http_static_entry_memory(http_static_entry_s *e) {
+  return sizeof(*e) + fiobj_obj2cstr(e->name).len +
+         (e->body ? fiobj_obj2cstr(e->body).len : 0) +
+         (e->variants[0] ? fiobj_obj2cstr(e->variants[0]).len : 0) +
+         (e->variants[1] ? fiobj_obj2cstr(e->variants[1]).len : 0);
+}
+
+/** Appends an entry to its LRU list. Call within the lock. */
+static inline void http_static_entry_touch(http_static_entry_s *e) {
+  fio_ls_embd_push((e->missing ? &http_static_cache.missing
+                               : &http_static_cache.lru),
+                   &e->node);
+}
+
+/** Unlinks an entry from its LRU list. Call within the lock. */
+static inline void http_static_entry_unlink(http_static_entry_s *e) {
+  fio_ls_embd_remove(&e->node);
+  http_static_cache.memory -= http_static_entry_memory(e);
+  http_static_cache.missing_count -= e->missing;
+}
+
+/** Removes an entry from the cache. Call within the lock. */
+static void http_static_entry_remove(http_static_entry_s *e,
+                                     fio_ls_embd_s *graveyard) {
+  http_static_set_remove(&http_static_cache.files, e->hash, e, NULL);
+  http_static_entry_unlink(e);
+  fio_ls_embd_push(graveyard, &e->node);
+}
+
+/** Evicts the least recently used entries. Call within the lock. */
+static void http_static_cache_evict(http_static_entry_s *keep,
+                                    fio_ls_embd_s *graveyard) {
+  while (http_static_cache.missing_count > HTTP_STATIC_CACHE_MISSING_LIMIT) {
+    http_static_entry_s *lru = FIO_LS_EMBD_OBJ(http_static_entry_s, node,
+                                               http_static_cache.missing.next);
+    if (lru == keep)
+      break;
+    http_static_entry_remove(lru, graveyard);
+  }
+  while (http_static_set_count(&http_static_cache.files) -
+                 http_static_cache.missing_count >
+             HTTP_STATIC_CACHE_LIMIT ||
+         http_static_cache.memory > HTTP_STATIC_CACHE_MEMORY_LIMIT) {
+    http_static_entry_s *lru = FIO_LS_EMBD_OBJ(http_static_entry_s, node,
+                                               http_static_cache.lru.next);
+    if (lru == keep || !fio_ls_embd_any(&http_static_cache.lru))
+      break;
+    http_static_entry_remove(lru, graveyard);
+  }
+}
+
+/** Frees removed entries. Call outside of the lock (closes files). */
+static void http_static_graveyard_free(fio_ls_embd_s *graveyard) {
+  while (fio_ls_embd_any(graveyard)) {
+    http_static_entry_free(FIO_LS_EMBD_OBJ(http_static_entry_s, node,
+                                           fio_ls_embd_shift(graveyard)));
+  }
+}
+
+/** Empties the cache. Call within the lock. */
+static void http_static_cache_clear_unsafe(fio_ls_embd_s *graveyard) {
+  while (fio_ls_embd_any(&http_static_cache.lru)) {
+    fio_ls_embd_push(graveyard, fio_ls_embd_shift(&http_static_cache.lru));
+  }
+  while (fio_ls_embd_any(&http_static_cache.missing)) {
+    fio_ls_embd_push(graveyard, fio_ls_embd_shift(&http_static_cache.missing));
+  }
+  http_static_set_free(&http_static_cache.files);
+  http_static_cache.memory = 0;
+  http_static_cache.missing_count = 0;
+  ++http_static_cache.generation;
+}
+
+/**
+ * Clears the static file cache used by `http_sendfile2`, closing any cached
+ * file descriptors.
+ */
+void http_static_cache_clear(void) {
+  fio_ls_embd_s graveyard = FIO_LS_INIT(graveyard);
+  fio_lock(&http_static_cache.lock);
+  http_static_cache_clear_unsafe(&graveyard);
+  fio_unlock(&http_static_cache.lock);
+  http_static_graveyard_free(&graveyard);
+}
+
+#if HTTP_STATIC_CACHE_INOTIFY
+
+/** Invalidates cache entries as files change. */
+static void http_static_watcher_on_data(intptr_t uuid, fio_protocol_s *pr) {
+  char buffer[4096]
+      __attribute__((aligned(__alignof__(struct inotify_event))));
+  fio_ls_embd_s graveyard = FIO_LS_INIT(graveyard);
+  ssize_t len;
+  while ((len = read(fio_uuid2fd(uuid), buffer, sizeof(buffer))) > 0) {
+    fio_lock(&http_static_cache.lock);
+    ++http_static_cache.generation;
+    for (char *pos = buffer; pos < buffer + len;) {
+      struct inotify_event *ev = (struct inotify_event *)pos;
+      pos += sizeof(*ev) + ev->len;
+      if (ev->mask & (IN_Q_OVERFLOW | IN_IGNORED | IN_DELETE_SELF |
+                      IN_MOVE_SELF)) {
+        /* we can't tell what changed, start afresh */
+        http_static_cache_clear_unsafe(&graveyard);
+        if (ev->mask & IN_IGNORED)
+          http_static_dirs_remove(&http_static_cache.dirs,
+                                  (uint64_t)ev->wd + 1, FIOBJ_INVALID, NULL);
+        continue;
+      }
+      if (!ev->len)
+        continue;
+      FIOBJ dir = http_static_dirs_find(&http_static_cache.dirs,
+                                        (uint64_t)ev->wd + 1, FIOBJ_INVALID);
+      if (!dir)
+        continue;
+      http_static_entry_s tmp = {.name = fiobj_str_tmp()};
+      fiobj_str_concat(tmp.name, dir);
+      fiobj_str_write(tmp.name, ev->name, strlen(ev->name));
+      tmp.hash = fiobj_obj2hash(tmp.name);
+      http_static_entry_s *e =
+          http_static_set_find(&http_static_cache.files, tmp.hash, &tmp);
+      if (e)
+        http_static_entry_remove(e, &graveyard);
+    }
+    fio_unlock(&http_static_cache.lock);
+  }
+  http_static_graveyard_free(&graveyard);
+  (void)pr;
+}
+
+/** Without a watcher, cached entries can't be trusted. */
+static void http_static_watcher_on_close(intptr_t uuid, fio_protocol_s *pr) {
+  fio_ls_embd_s graveyard = FIO_LS_INIT(graveyard);
+  fio_lock(&http_static_cache.lock);
+  if (http_static_cache.watcher == uuid)
+    http_static_cache.watcher = -1;
+  http_static_cache_clear_unsafe(&graveyard);
+  http_static_dirs_free(&http_static_cache.dirs);
+  fio_unlock(&http_static_cache.lock);
+  http_static_graveyard_free(&graveyard);
+  (void)pr;
+}
+
+static void http_static_watcher_ping(intptr_t uuid, fio_protocol_s *pr) {
+  fio_touch(uuid);
+  (void)pr;
+}
+
+static fio_protocol_s HTTP_STATIC_WATCHER_PROTOCOL = {
+    .on_data = http_static_watcher_on_data,
+    .on_close = http_static_watcher_on_close,
+    .ping = http_static_watcher_ping,
+};
+
+/**
+ * Watches the file's folder for changes, returns 0 if changes will be reported.
+ *
+ * The inotify descriptor is attached to the reactor, so changes are only
+ * reported while facil.io is running.
+ */
+static int http_static_watch(fio_str_info_s name) {
+  if (!fio_is_running())
+    return -1;
+  intptr_t watcher;
+  fio_lock(&http_static_cache.lock);
+  watcher = http_static_cache.watcher;
+  if (watcher == -1) {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd == -1) {
+      fio_unlock(&http_static_cache.lock);
+      return -1;
+    }
+    watcher = http_static_cache.watcher = fio_fd2uuid(fd);
+    fio_attach(watcher, &HTTP_STATIC_WATCHER_PROTOCOL);
+  }
+  fio_unlock(&http_static_cache.lock);
+
+  size_t dir_len = name.len;
+  while (dir_len && name.data[dir_len - 1] != '/')
+    --dir_len;
+  FIOBJ dir = fiobj_str_new(name.data, dir_len);
+  int wd = inotify_add_watch(
+      fio_uuid2fd(watcher), (dir_len ? fiobj_obj2cstr(dir).data : "."),
+      IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE |
+          IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+  if (wd == -1) {
+    fiobj_free(dir);
+    return -1;
+  }
+  fio_lock(&http_static_cache.lock);
+  if (http_static_cache.watcher == watcher)
+    http_static_dirs_overwrite(&http_static_cache.dirs, (uint64_t)wd + 1, dir,
+                               NULL);
+  else
+    wd = -1;
+  fio_unlock(&http_static_cache.lock);
+  fiobj_free(dir);
+  return (wd == -1 ? -1 : 0);
+}
+
+#else
+
+static int http_static_watch(fio_str_info_s name) {
+  return -1;
+  (void)name;
+}
+
+#endif
+
+/** Collects a file's data (`stat`, headers, etc') into a new cache entry. */
+static http_static_entry_s *http_static_entry_new(FIOBJ filename,
+                                                  uint8_t load) {
+  struct stat file_data = {.st_size = 0};
+  fio_str_info_s s = fiobj_obj2cstr(filename);
+  http_static_entry_s *e = malloc(sizeof(*e));
+  FIO_ASSERT_ALLOC(e);
+  *e = (http_static_entry_s){
+      .name = fiobj_str_new(s.data, s.len),
+      .hash = fiobj_obj2hash(filename),
+      .checked_at = fio_last_tick().tv_sec,
+      .fd = -1,
+  };
+  if (stat(s.data, &file_data) || !S_ISREG(file_data.st_mode)) {
+    e->missing = 1;
+    return e;
+  }
+  e->size = file_data.st_size;
+  /* pre-render last-modified */
+  e->last_modified = fiobj_str_buf(32);
+  fiobj_str_resize(e->last_modified,
+                   http_time2str(fiobj_obj2cstr(e->last_modified).data,
+                                 file_data.st_mtime));
+  /* pre-render etag */
+  uint64_t etag = (uint64_t)file_data.st_size;
+  etag ^= (uint64_t)file_data.st_mtime;
+  etag = fiobj_hash_string(&etag, sizeof(uint64_t));
+  e->etag = fiobj_str_buf(32);
+  fiobj_str_resize(e->etag, fio_base64_encode(fiobj_obj2cstr(e->etag).data,
+                                              (void *)&etag, sizeof(uint64_t)));
+  /* pre-render content-type */
+  e->mime = http_static_mime(s, 0);
+  if (s.len > 4 && s.data[s.len - 3] == '.' && s.data[s.len - 2] == 'g' &&
+      s.data[s.len - 1] == 'z')
+    e->mime_gz = http_static_mime(s, 1);
+  e->compressible = (e->size <= HTTP_COMPRESS_STATIC_LIMIT &&
+                     http_compress_mime(e->mime));
+  if (!load)
+    return e;
+  /* keep the file open, or in memory for small files */
+  e->fd = open(s.data, O_RDONLY);
+  if (e->fd == -1 || e->size > HTTP_STATIC_CACHE_BODY_LIMIT)
+    return e;
+  FIOBJ body = fiobj_str_buf(e->size);
+  fio_str_info_s b = fiobj_obj2cstr(body);
+  ssize_t r = 0;
+  while (r < e->size) {
+    ssize_t tmp = pread(e->fd, b.data + r, e->size - r, r);
+    if (tmp <= 0)
+      break;
+    r += tmp;
+  }
+  if (r == e->size) {
+    fiobj_str_resize(body, r);
+    e->body = body;
+    close(e->fd);
+    e->fd = -1;
+  } else {
+    fiobj_free(body);
+  }
+  return e;
+}
+
+/**
+ * A snapshot of a cached file's data, so the headers, the size and the body
+ * all describe the same version of the file.
+ *
+ * The headers must be freed (or consumed), the rest is freed using
+ * `http_static_file_release`.
+ */
+typedef struct {
+  FIOBJ etag;
+  FIOBJ last_modified;
+  /** the file's content (small files), or FIOBJ_INVALID */
+  FIOBJ body;
+  FIOBJ mime;
+  FIOBJ mime_gz;
+  off_t size;
+  /** an open file descriptor (larger files), or -1 */
+  int fd;
+  uint8_t compressible;
+} http_static_file_s;
+
+static inline int http_static_snapshot(http_static_entry_s *e,
+                                       http_static_file_s *dest) {
+  if (e->missing)
+    return -1;
+  *dest = (http_static_file_s){
+      .etag = fiobj_dup(e->etag),
+      .last_modified = fiobj_dup(e->last_modified),
+      .body = fiobj_dup(e->body),
+      .mime = fiobj_dup(e->mime),
+      .mime_gz = fiobj_dup(e->mime_gz),
+      .size = e->size,
+      .fd = (e->body || e->fd == -1 ? -1 : dup(e->fd)),
+      .compressible = e->compressible,
+  };
+  return 0;
+}
+
+/** Frees the snapshot's body, Content-Type and file descriptor. */
+static inline void http_static_file_release(http_static_file_s *f) {
+  fiobj_free(f->body);
+  fiobj_free(f->mime);
+  fiobj_free(f->mime_gz);
+  if (f->fd != -1)
+    close(f->fd);
+  f->body = f->mime = f->mime_gz = FIOBJ_INVALID;
+  f->fd = -1;
+}
+
+/** Returns -1 if the file is missing, otherwise fills in the file's data. */
+static int http_static_file_get(FIOBJ filename, http_static_file_s *dest) {
+  http_static_entry_s tmp = {.name = filename,
+                             .hash = fiobj_obj2hash(filename)};
+  http_static_entry_s *e;
+  fio_ls_embd_s graveyard = FIO_LS_INIT(graveyard);
+  size_t generation;
+  uint8_t watched;
+  int ret;
+  if (!HTTP_STATIC_CACHE_LIMIT) {
+    e = http_static_entry_new(filename, 0);
+    ret = http_static_snapshot(e, dest);
+    http_static_entry_free(e);
+    return ret;
+  }
+  fio_lock(&http_static_cache.lock);
+  e = http_static_set_find(&http_static_cache.files, tmp.hash, &tmp);
+  if (e && !e->watched &&
+      e->checked_at + HTTP_STATIC_CACHE_VALIDATE <= fio_last_tick().tv_sec) {
+    /* unwatched entries are refreshed periodically */
+    http_static_entry_remove(e, &graveyard);
+    e = NULL;
+  }
+  if (e) {
+    /* cache hit */
+    fio_ls_embd_remove(&e->node);
+    http_static_entry_touch(e);
+    ret = http_static_snapshot(e, dest);
+    fio_unlock(&http_static_cache.lock);
+    return ret;
+  }
+  generation = http_static_cache.generation;
+  fio_unlock(&http_static_cache.lock);
+  http_static_graveyard_free(&graveyard);
+
+  /* cache miss - watch before reading, so no change goes unreported */
+  watched = !http_static_watch(fiobj_obj2cstr(filename));
+  e = http_static_entry_new(filename, 1);
+
+  fio_lock(&http_static_cache.lock);
+  /* changes might have been reported while we were reading the file */
+  e->watched = (watched && generation == http_static_cache.generation);
+  {
+    http_static_entry_s *old = NULL;
+    http_static_set_overwrite(&http_static_cache.files, e->hash, e, &old);
+    if (old) {
+      http_static_entry_unlink(old);
+      fio_ls_embd_push(&graveyard, &old->node);
+    }
+  }
+  http_static_entry_touch(e);
+  http_static_cache.memory += http_static_entry_memory(e);
+  http_static_cache.missing_count += e->missing;
+  http_static_cache_evict(e, &graveyard);
+  ret = http_static_snapshot(e, dest);
+  fio_unlock(&http_static_cache.lock);
+  http_static_graveyard_free(&graveyard);
+  return ret;
+}
+
+/**
+ * Returns a compressed variant of a cached file (or FIOBJ_INVALID) and the
+ * file's Content-Type.
+ *
+ * Variants are compressed once (using the static compression settings) and
+ * cached alongside the file. While a variant is being compressed, concurrent
+ * requests are served uncompressed.
+ */
+static FIOBJ http_static_file_variant(FIOBJ filename, http_compress_e encoding,
+                                      FIOBJ *mime) {
+  http_static_entry_s tmp = {.name = filename,
+                             .hash = fiobj_obj2hash(filename)};
+  http_static_entry_s *e;
+  fio_ls_embd_s graveyard = FIO_LS_INIT(graveyard);
+  const size_t index = (encoding == HTTP_COMPRESS_BR);
+  FIOBJ variant = FIOBJ_INVALID, etag, body;
+  int fd = -1;
+  *mime = FIOBJ_INVALID;
+  if (!HTTP_STATIC_CACHE_LIMIT ||
+      (encoding != HTTP_COMPRESS_BR && encoding != HTTP_COMPRESS_GZIP))
+    return FIOBJ_INVALID;
+  fio_lock(&http_static_cache.lock);
+  e = http_static_set_find(&http_static_cache.files, tmp.hash, &tmp);
+  if (!e || e->missing || !e->compressible ||
+      ((e->pending | e->failed) & encoding)) {
+    fio_unlock(&http_static_cache.lock);
+    return FIOBJ_INVALID;
+  }
+  if (e->variants[index]) {
+    variant = fiobj_dup(e->variants[index]);
+    *mime = fiobj_dup(e->mime);
+    fio_unlock(&http_static_cache.lock);
+    return variant;
+  }
+  /* compress the file outside of the lock */
+  e->pending |= encoding;
+  etag = fiobj_dup(e->etag);
+  body = fiobj_dup(e->body);
+  if (!body && e->fd != -1)
+    fd = dup(e->fd);
+  fio_unlock(&http_static_cache.lock);
+
+  if (!body && fd != -1) {
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size <= HTTP_COMPRESS_STATIC_LIMIT) {
+      body = fiobj_str_buf(st.st_size);
+      fio_str_info_s b = fiobj_obj2cstr(body);
+      ssize_t r = 0;
+      while (r < st.st_size) {
+        ssize_t t = pread(fd, b.data + r, st.st_size - r, r);
+        if (t <= 0)
+          break;
+        r += t;
+      }
+      fiobj_str_resize(body, r);
+      if (r != st.st_size) {
+        fiobj_free(body);
+        body = FIOBJ_INVALID;
+      }
+    }
+  }
+  if (fd != -1)
+    close(fd);
+  if (body) {
+    fio_str_info_s b = fiobj_obj2cstr(body);
+    variant = http_compress2str(encoding, 1, b.data, b.len);
+    fiobj_free(body);
+  }
+
+  fio_lock(&http_static_cache.lock);
+  e = http_static_set_find(&http_static_cache.files, tmp.hash, &tmp);
+  if (e && fiobj_iseq(e->etag, etag)) {
+    /* the file didn't change while we were compressing it */
+    e->pending &= ~encoding;
+    if (variant) {
+      e->variants[index] = fiobj_dup(variant);
+      http_static_cache.memory += fiobj_obj2cstr(variant).len;
+      *mime = fiobj_dup(e->mime);
+      http_static_cache_evict(e, &graveyard);
+    } else {
+      e->failed |= encoding;
+    }
+  } else {
+    fiobj_free(variant);
+    variant = FIOBJ_INVALID;
+  }
+  fio_unlock(&http_static_cache.lock);
+  http_static_graveyard_free(&graveyard);
+  fiobj_free(etag);
+  return variant;
+}
+
 /**
  * Sends the response headers and the specified file (the response's body).
  *
- * Returns -1 eton error and 0 on success.
+ * Returns -1 on error and 0 on success.
  *
  * AFTER THIS FUNCTION IS CALLED, THE `http_s` OBJECT IS NO LONGER VALID.
  */
@@ -382,7 +1028,7 @@ int http_sendfile2(http_s *h, const char *prefix, size_t prefix_len,
                    const char *encoded, size_t encoded_len) {
   if (HTTP_INVALID_HANDLE(h))
     return -1;
-  struct stat file_data = {.st_size = 0};
+  http_static_file_s file_data = {.size = 0, .fd = -1};
   static uint64_t accept_enc_hash = 0;
   if (!accept_enc_hash)
     accept_enc_hash = fiobj_hash_string("accept-encoding", 15);
@@ -441,8 +1087,7 @@ int http_sendfile2(http_s *h, const char *prefix, size_t prefix_len,
         s.data[s.len - 1] != 'z') {
       fiobj_str_write(filename, ".gz", 3);
       s = fiobj_obj2cstr(filename);
-      if (!stat(s.data, &file_data) &&
-          (S_ISREG(file_data.st_mode) || S_ISLNK(file_data.st_mode))) {
+      if (!http_static_file_get(filename, &file_data)) {
         is_gz = 1;
         goto found_file;
       }
@@ -450,27 +1095,44 @@ int http_sendfile2(http_s *h, const char *prefix, size_t prefix_len,
     }
   }
 no_gzip_support:
-  if (stat(s.data, &file_data) ||
-      !(S_ISREG(file_data.st_mode) || S_ISLNK(file_data.st_mode)))
+  if (http_static_file_get(filename, &file_data))
     return -1;
 found_file:
-  /* set last-modified */
-  {
-    FIOBJ tmp = fiobj_str_buf(32);
-    fiobj_str_resize(
-        tmp, http_time2str(fiobj_obj2cstr(tmp).data, file_data.st_mtime));
-    http_set_header(h, HTTP_HEADER_LAST_MODIFIED, tmp);
-  }
+  /* set last-modified (pre-rendered by the static file cache) */
+  http_set_header(h, HTTP_HEADER_LAST_MODIFIED, file_data.last_modified);
   /* set cache-control */
   http_set_header(h, HTTP_HEADER_CACHE_CONTROL, fiobj_dup(HTTP_HVALUE_MAX_AGE));
-  /* set & test etag */
-  uint64_t etag = (uint64_t)file_data.st_size;
-  etag ^= (uint64_t)file_data.st_mtime;
-  etag = fiobj_hash_string(&etag, sizeof(uint64_t));
-  FIOBJ etag_str = fiobj_str_buf(32);
-  fiobj_str_resize(etag_str,
-                   fio_base64_encode(fiobj_obj2cstr(etag_str).data,
-                                     (void *)&etag, sizeof(uint64_t)));
+  /* set & test etag (pre-rendered by the static file cache) */
+  FIOBJ etag_str = file_data.etag;
+  /* compressed variants (compressed once and cached) */
+  int64_t length = file_data.size;
+  FIOBJ variant = FIOBJ_INVALID, variant_mime = FIOBJ_INVALID;
+  if (is_gz) {
+    http_set_header(h, HTTP_HEADER_VARY,
+                    fiobj_dup(HTTP_HVALUE_ACCEPT_ENCODING));
+  } else if (file_data.compressible && http_settings(h)->compress_threshold &&
+             !http_settings(h)->is_client &&
+             (uintptr_t)length >= http_settings(h)->compress_threshold &&
+             !fiobj_hash_get2(h->headers, range_hash)) {
+    http_set_header(h, HTTP_HEADER_VARY,
+                    fiobj_dup(HTTP_HVALUE_ACCEPT_ENCODING));
+    http_compress_e encoding = http_compress_negotiate(
+        fiobj_hash_get2(h->headers, accept_enc_hash),
+        HTTP_COMPRESS_BR | HTTP_COMPRESS_GZIP);
+    if (encoding)
+      variant = http_static_file_variant(filename, encoding, &variant_mime);
+    if (variant) {
+      length = fiobj_obj2cstr(variant).len;
+      http_set_header(h, HTTP_HEADER_CONTENT_ENCODING,
+                      http_compress_encoding(encoding));
+      /* each representation requires a unique etag */
+      etag_str = fiobj_str_buf(32);
+      fiobj_str_concat(etag_str, file_data.etag);
+      fiobj_str_write(etag_str, (encoding == HTTP_COMPRESS_BR ? "-br" : "-gz"),
+                      3);
+      fiobj_free(file_data.etag);
+    }
+  }
   /* set */
   http_set_header(h, HTTP_HEADER_ETAG, etag_str);
   /* test */
@@ -480,6 +1142,9 @@ found_file:
       none_match_hash = fiobj_hash_string("if-none-match", 13);
     FIOBJ tmp2 = fiobj_hash_get2(h->headers, none_match_hash);
     if (tmp2 && fiobj_iseq(tmp2, etag_str)) {
+      fiobj_free(variant);
+      fiobj_free(variant_mime);
+      http_static_file_release(&file_data);
       h->status = 304;
       http_finish(h);
       return 0;
@@ -487,7 +1152,6 @@ found_file:
   }
   /* handle range requests */
   int64_t offset = 0;
-  int64_t length = file_data.st_size;
   {
     static uint64_t ifrange_hash = 0;
     if (!ifrange_hash)
@@ -505,31 +1169,35 @@ found_file:
         if (!range.data || memcmp("bytes=", range.data, 6))
           goto open_file;
         char *pos = range.data + 6;
-        int64_t start_at = 0, end_at = 0;
-        start_at = fio_atol(&pos);
-        if (start_at >= file_data.st_size)
-          goto open_file;
-        if (start_at >= 0) {
-          pos++;
-          end_at = fio_atol(&pos);
-          if (end_at <= 0)
-            goto open_file;
-        }
+        int64_t start_at, end_at = file_data.size - 1;
         /* we ignore multimple ranges, only responding with the first range. */
-        if (start_at < 0) {
-          if (0 - start_at < file_data.st_size) {
-            offset = file_data.st_size - start_at;
-            length = 0 - start_at;
-          }
-        } else if (end_at) {
-          offset = start_at;
-          length = end_at - start_at + 1;
-          if (length + start_at > file_data.st_size || length <= 0)
-            length = length - start_at;
+        if (*pos == '-') {
+          /* suffix range (the last N bytes) */
+          ++pos;
+          if (*pos < '0' || *pos > '9')
+            goto open_file;
+          start_at = file_data.size - fio_atol(&pos);
+          if (start_at < 0)
+            start_at = 0;
         } else {
-          offset = start_at;
-          length = length - start_at;
+          if (*pos < '0' || *pos > '9')
+            goto open_file;
+          start_at = fio_atol(&pos);
+          if (*pos != '-')
+            goto open_file;
+          ++pos;
+          if (*pos >= '0' && *pos <= '9') {
+            end_at = fio_atol(&pos);
+            if (end_at < start_at)
+              goto open_file; /* invalid ranges are ignored */
+            if (end_at >= file_data.size)
+              end_at = file_data.size - 1;
+          }
         }
+        if (start_at >= file_data.size)
+          goto range_not_satisfiable;
+        offset = start_at;
+        length = end_at - start_at + 1;
         h->status = 206;
 
         {
@@ -537,7 +1205,7 @@ found_file:
           fiobj_str_printf(cranges, "bytes %lu-%lu/%lu",
                            (unsigned long)start_at,
                            (unsigned long)(start_at + length - 1),
-                           (unsigned long)file_data.st_size);
+                           (unsigned long)file_data.size);
           http_set_header(h, HTTP_HEADER_CONTENT_RANGE, cranges);
         }
         http_set_header(h, HTTP_HEADER_ACCEPT_RANGES,
@@ -552,6 +1220,9 @@ found_file:
     if (!strncasecmp("options", s.data, 7)) {
       http_set_header2(h, (fio_str_info_s){.data = (char *)"allow", .len = 5},
                        (fio_str_info_s){.data = (char *)"GET, HEAD", .len = 9});
+      fiobj_free(variant);
+      fiobj_free(variant_mime);
+      http_static_file_release(&file_data);
       h->status = 200;
       http_finish(h);
       return 0;
@@ -563,45 +1234,73 @@ found_file:
     break;
   case 4:
     if (!strncasecmp("head", s.data, 4)) {
+      fiobj_free(variant);
+      http_static_file_release(&file_data);
+      if (variant_mime)
+        http_set_header(h, HTTP_HEADER_CONTENT_TYPE, variant_mime);
       http_set_header(h, HTTP_HEADER_CONTENT_LENGTH, fiobj_num_new(length));
       http_finish(h);
       return 0;
     }
     break;
   }
+  fiobj_free(variant);
+  fiobj_free(variant_mime);
+  http_static_file_release(&file_data);
   http_send_error(h, 403);
   return 0;
+range_not_satisfiable:
+  fiobj_free(variant);
+  fiobj_free(variant_mime);
+  http_static_file_release(&file_data);
+  {
+    FIOBJ cranges = fiobj_str_buf(1);
+    fiobj_str_printf(cranges, "bytes */%lu", (unsigned long)file_data.size);
+    http_set_header(h, HTTP_HEADER_CONTENT_RANGE, cranges);
+  }
+  h->status = 416;
+  http_finish(h);
+  return 0;
 open_file:
-  s = fiobj_obj2cstr(filename);
-  file = open(s.data, O_RDONLY);
-  if (file == -1) {
-    FIO_LOG_ERROR("(HTTP) couldn't open file %s!\n", s.data);
-    perror("     ");
-    http_send_error(h, 500);
+  if (variant) {
+    /* compressed variants are served from memory */
+    http_static_file_release(&file_data);
+    if (variant_mime)
+      http_set_header(h, HTTP_HEADER_CONTENT_TYPE, variant_mime);
+    add_content_type(h);
+    http_send_body_uncompressed(h, fiobj_obj2cstr(variant).data, length);
+    fiobj_free(variant);
     return 0;
   }
+  if (is_gz)
+    http_set_header(h, HTTP_HEADER_CONTENT_ENCODING,
+                    fiobj_dup(HTTP_HVALUE_GZIP));
   {
-    FIOBJ tmp = 0;
-    uintptr_t pos = 0;
-    if (is_gz) {
-      http_set_header(h, HTTP_HEADER_CONTENT_ENCODING,
-                      fiobj_dup(HTTP_HVALUE_GZIP));
-
-      pos = s.len - 4;
-      while (pos && s.data[pos] != '.')
-        pos--;
-      pos++; /* assuming, but that's fine. */
-      tmp = http_mimetype_find(s.data + pos, s.len - pos - 3);
-
-    } else {
-      pos = s.len - 1;
-      while (pos && s.data[pos] != '.')
-        pos--;
-      pos++; /* assuming, but that's fine. */
-      tmp = http_mimetype_find(s.data + pos, s.len - pos);
+    FIOBJ mime = (is_gz ? file_data.mime_gz : file_data.mime);
+    if (mime)
+      http_set_header(h, HTTP_HEADER_CONTENT_TYPE, fiobj_dup(mime));
+  }
+  if (file_data.body) {
+    /* small files are served from memory (the range is within the body) */
+    add_content_type(h);
+    http_send_body_uncompressed(
+        h, fiobj_obj2cstr(file_data.body).data + offset, length);
+    http_static_file_release(&file_data);
+    return 0;
+  }
+  file = file_data.fd;
+  file_data.fd = -1;
+  http_static_file_release(&file_data);
+  if (file == -1) {
+    /* not kept open by the cache */
+    s = fiobj_obj2cstr(filename);
+    file = open(s.data, O_RDONLY);
+    if (file == -1) {
+      FIO_LOG_ERROR("(HTTP) couldn't open file %s!\n", s.data);
+      perror("     ");
+      http_send_error(h, 500);
+      return 0;
     }
-    if (tmp)
-      http_set_header(h, HTTP_HEADER_CONTENT_TYPE, tmp);
   }
   http_sendfile(h, file, length, offset);
   return 0;
@@ -657,6 +1356,52 @@ void http_finish(http_s *r) {
   add_date(r);
   ((http_vtable_s *)r->private_data.vtbl)->http_finish(r);
 }
+
+/**
+ * Streams a chunk of the response body, sending the response headers first (if
+ * they weren't sent yet).
+ *
+ * Returns -1 on error, 0 on success and 1 when the client should be throttled.
+ */
+int http_stream_write(http_s *h, void *data, uintptr_t length) {
+  if (HTTP_INVALID_HANDLE(h))
+    return -1;
+  http_vtable_s *vtbl = (http_vtable_s *)h->private_data.vtbl;
+  if (!vtbl->http_stream)
+    return -1;
+  add_date(h);
+  if (vtbl->http_stream(h, data, length))
+    return -1;
+  return fio_pending(http2protocol(h)->uuid) > HTTP_STREAM_PENDING_LIMIT;
+}
+
+/**
+ * Calls `on_ready` (once) after the connection's outgoing queue was drained.
+ *
+ * Returns -1 on error and 0 on success.
+ */
+int http_stream_on_ready(http_s *h, void (*on_ready)(http_s *h)) {
+  if (HTTP_INVALID_HANDLE(h) || !on_ready)
+    return -1;
+  http_vtable_s *vtbl = (http_vtable_s *)h->private_data.vtbl;
+  if (!vtbl->http_stream_on_ready)
+    return -1;
+  return vtbl->http_stream_on_ready(h, on_ready);
+}
+
+/**
+ * Completes a streamed response, sending the (optional) `trailers`.
+ *
+ * Returns -1 on error and 0 on success.
+ */
+int http_stream_finish(http_s *h, FIOBJ trailers) {
+  if (HTTP_INVALID_HANDLE(h))
+    return -1;
+  http_vtable_s *vtbl = (http_vtable_s *)h->private_data.vtbl;
+  if (!vtbl->http_stream_finish)
+    return -1;
+  return vtbl->http_stream_finish(h, trailers);
+}
 /**
  * Pushes a data response when supported (HTTP/2 only).
  *
@@ -787,6 +1532,33 @@ void http_resume(http_pause_handle_s *http, void (*task)(http_s *h),
                     .fallback = http_resume_fallback_wrapper);
 }
 
+/**
+ * Returns the connection's uuid, which remains a safe reference to the
+ * connection after the `http_s` handle becomes invalid.
+ */
+intptr_t http_uuid(http_s *h) {
+  if (!h || !h->private_data.flag)
+    return -1;
+  return http2protocol(h)->uuid;
+}
+
+/* resume reading the body within the connection's lock */
+static void http_body_resume_task(intptr_t uuid, fio_protocol_s *pr,
+                                  void *ignr) {
+  http1_body_resume(pr);
+  (void)uuid;
+  (void)ignr;
+}
+
+/**
+ * Resumes reading a request body after an `on_body_chunk` callback returned a
+ * positive value.
+ */
+void http_body_resume(intptr_t uuid) {
+  fio_defer_io_task(uuid, .type = FIO_PR_LOCK_TASK,
+                    .task = http_body_resume_task);
+}
+
 /**
  * Hijacks the socket away from the HTTP protocol and away from facil.io.
  */
@@ -808,7 +1580,7 @@ static void http_on_upgrade_fallback(http_s *h, char *p, size_t i) {
 }
 static void http_on_response_fallback(http_s *h) { http_send_error(h, 400); }
 
-static http_settings_s *http_settings_new(http_settings_s arg_settings) {
+http_settings_s *http_settings_new(http_settings_s arg_settings) {
   /* TODO: improve locality by unifying malloc to a single call */
   if (!arg_settings.on_request)
     arg_settings.on_request = http_on_request_fallback;
@@ -825,8 +1597,20 @@ static http_settings_s *http_settings_new(http_settings_s arg_settings) {
     arg_settings.ws_max_msg_size = 262144; /** defaults to ~250KB */
   if (!arg_settings.ws_timeout)
     arg_settings.ws_timeout = 40; /* defaults to 40 seconds */
+  if (!arg_settings.ws_compress_window || arg_settings.ws_compress_window > 15)
+    arg_settings.ws_compress_window = 15;
+  if (arg_settings.ws_compress_window < 9)
+    arg_settings.ws_compress_window = 9;
   if (!arg_settings.max_header_size)
     arg_settings.max_header_size = 32 * 1024; /* defaults to 32Kib seconds */
+  if (!arg_settings.pipeline_depth)
+    arg_settings.pipeline_depth = 8;
+  if (!arg_settings.pipeline_throttle)
+    arg_settings.pipeline_throttle = 4;
+  if (arg_settings.router)
+    http_router_freeze(arg_settings.router);
+  if (arg_settings.slow_request)
+    arg_settings.timing = 1;
   if (arg_settings.max_clients <= 0 ||
       (size_t)(arg_settings.max_clients + HTTP_BUSY_UNLESS_HAS_FDS) >
           fio_capa()) {
@@ -835,8 +1619,10 @@ static http_settings_s *http_settings_new(http_settings_s arg_settings) {
       arg_settings.max_clients -= HTTP_BUSY_UNLESS_HAS_FDS;
   }
 
-  http_settings_s *settings = malloc(sizeof(*settings) + sizeof(void *));
+  http_settings_s *settings = malloc(sizeof(*settings) + 2 * sizeof(void *));
   *settings = arg_settings;
+  ((void **)(settings + 1))[0] = NULL;
+  http_settings2cache(settings) = NULL;
 
   if (settings->public_folder) {
     settings->public_folder_length = strlen(settings->public_folder);
@@ -862,7 +1648,8 @@ static http_settings_s *http_settings_new(http_settings_s arg_settings) {
   return settings;
 }
 
-static void http_settings_free(http_settings_s *s) {
+void http_settings_free(http_settings_s *s) {
+  http_cache_free(http_settings2cache(s));
   free((void *)s->public_folder);
   free(s);
 }
@@ -923,6 +1710,12 @@ intptr_t http_listen(const char *port, const char *binding,
 
   http_settings_s *settings = http_settings_new(arg_settings);
   settings->is_client = 0;
+  if (settings->cache_size) {
+    /* created before `fio_start` forks, so the workers share the cache */
+    http_settings2cache(settings) =
+        http_cache_new(settings->cache_size, settings->cache_vary,
+                       settings->compress_threshold > 0);
+  }
   if (settings->tls) {
     fio_tls_alpn_add(settings->tls, "http/1.1", http_on_server_protocol_http1,
                      NULL, NULL);
@@ -1247,24 +2040,82 @@ static void http_sse_on_message__direct(http_sse_s *sse, fio_str_info_s channel,
   (void)udata;
   (void)channel;
 }
+
+/** Direct messages are written using the (shared) pre-encoded event. */
+static void http_sse_on_message__broadcast(fio_msg_s *msg) {
+  http_sse_internal_s *sse = msg->udata1;
+  fio_protocol_s *pr = fio_protocol_try_lock(sse->uuid, FIO_PR_LOCK_WRITE);
+  if (!pr) {
+    if (errno == EBADF)
+      return;
+    fio_message_defer(msg);
+    return;
+  }
+  FIOBJ event = (FIOBJ)fio_message_metadata(msg, HTTP_SSE_OPTIMIZE_PUBSUB);
+  if (event)
+    (sse->vtable->http_sse_write)(&sse->sse, fiobj_dup(event));
+  else
+    http_sse_write(&sse->sse, .data = msg->msg);
+  fio_protocol_unlock(pr, FIO_PR_LOCK_WRITE);
+}
+
 /** An optional callback for when a subscription is fully canceled. */
 static void http_sse_on_unsubscribe(void *sse_, void *args_) {
   http_sse_internal_s *sse = sse_;
   struct http_sse_subscribe_args *args = args_;
   if (args->on_unsubscribe)
     args->on_unsubscribe(args->udata);
+  if (args->on_message == http_sse_on_message__direct)
+    http_sse_optimize4broadcasts(0);
   fio_free(args);
   http_sse_try_free(sse);
 }
 
-/** This macro allows easy access to the `http_sse_subscribe` function. */
-#undef http_sse_subscribe
-/**
- * Subscribes to a channel. See {struct http_sse_subscribe_args} for possible
- * arguments.
- *
- * Returns a subscription ID on success and 0 on failure.
- *
+/* *****************************************************************************
+SSE Broadcast Optimization
+***************************************************************************** */
+
+static void http_sse_optimize_free(fio_msg_s *msg, void *metadata) {
+  fiobj_free((FIOBJ)metadata);
+  (void)msg;
+}
+
+/* encodes the message as an SSE event, once per message */
+static fio_msg_metadata_s http_sse_optimize(fio_str_info_s ch,
+                                            fio_str_info_s msg,
+                                            uint8_t is_json) {
+  FIOBJ out = fiobj_str_buf(msg.len + 16);
+  http_sse_copy2str(out, (char *)"data: ", 6, msg);
+  fiobj_str_write(out, "\r\n", 2);
+  return (fio_msg_metadata_s){
+      .type_id = HTTP_SSE_OPTIMIZE_PUBSUB,
+      .on_finish = http_sse_optimize_free,
+      .metadata = (void *)out,
+  };
+  (void)ch;
+  (void)is_json;
+}
+
+/** Enables (or disables) SSE broadcast optimizations. */
+void http_sse_optimize4broadcasts(int enable) {
+  static intptr_t counter = 0;
+  if (enable) {
+    if (fio_atomic_add(&counter, 1) == 1)
+      fio_message_metadata_callback_set(http_sse_optimize, 1);
+  } else {
+    if (fio_atomic_sub(&counter, 1) == 0)
+      fio_message_metadata_callback_set(http_sse_optimize, 0);
+  }
+}
+
+/** This macro allows easy access to the `http_sse_subscribe` function. */
+#undef http_sse_subscribe
+/**
+ * Subscribes to a channel. See {struct http_sse_subscribe_args} for possible
+ * arguments.
+ *
+ * Returns a subscription ID on success and 0 on failure.
+ *
  * All subscriptions are automatically revoked once the connection is closed.
  *
  * If the connections subscribes to the same channel more than once, messages
@@ -1277,15 +2128,19 @@ uintptr_t http_sse_subscribe(http_sse_s *sse_,
   http_sse_internal_s *sse = FIO_LS_EMBD_OBJ(http_sse_internal_s, sse, sse_);
   if (sse->uuid == -1)
     return 0;
-  if (!args.on_message)
+  void (*handler)(fio_msg_s *) = http_sse_on_message;
+  if (!args.on_message) {
     args.on_message = http_sse_on_message__direct;
+    handler = http_sse_on_message__broadcast;
+    http_sse_optimize4broadcasts(1);
+  }
   struct http_sse_subscribe_args *udata = fio_malloc(sizeof(*udata));
   FIO_ASSERT_ALLOC(udata);
   *udata = args;
 
   fio_atomic_add(&sse->ref, 1);
   subscription_s *sub =
-      fio_subscribe(.channel = args.channel, .on_message = http_sse_on_message,
+      fio_subscribe(.channel = args.channel, .on_message = handler,
                     .on_unsubscribe = http_sse_on_unsubscribe, .udata1 = sse,
                     .udata2 = udata, .match = args.match);
   if (!sub)
@@ -1570,6 +2425,209 @@ void http_parse_cookies(http_s *h, uint8_t is_url_encoded) {
   }
 }
 
+/* *****************************************************************************
+Lazy (allocation free) query and cookie access
+***************************************************************************** */
+
+typedef int (*http_param_task_fn)(fio_str_info_s name, fio_str_info_s value,
+                                  void *udata);
+
+/* calls `task` for each `sep` separated "name=value" pair in `s` */
+static size_t http_params_scan(fio_str_info_s s, char sep,
+                               http_param_task_fn task, void *udata) {
+  size_t count = 0;
+  char *end = s.data + s.len;
+  char *pos = s.data;
+  while (pos < end) {
+    if (sep == ';' && *pos == ' ') {
+      ++pos;
+      continue;
+    }
+    char *cut = memchr(pos, sep, end - pos);
+    if (!cut)
+      cut = end;
+    if (cut > pos) {
+      char *eq = memchr(pos, '=', cut - pos);
+      fio_str_info_s name = {.data = pos, .len = (eq ? eq : cut) - pos};
+      fio_str_info_s value = {.data = (eq ? eq + 1 : cut),
+                              .len = (eq ? cut - (eq + 1) : 0)};
+      ++count;
+      if (task(name, value, udata) == -1)
+        break;
+    }
+    pos = cut + 1;
+    /* protecting against some ...less informed... clients */
+    if (sep == '&' && pos + 4 <= end && pos[0] == 'a' && pos[1] == 'm' &&
+        pos[2] == 'p' && pos[3] == ';')
+      pos += 4;
+  }
+  return count;
+}
+
+/* compares a raw (possibly URL encoded) name with a decoded name */
+static int http_param_name_eq(fio_str_info_s raw, const char *name,
+                              size_t len, uint8_t encoded) {
+  if (!encoded)
+    return raw.len == len && !memcmp(raw.data, name, len);
+  size_t i = 0;
+  const char *pos = raw.data;
+  const char *end = raw.data + raw.len;
+  while (pos < end) {
+    uint8_t c = (uint8_t)*pos;
+    if (c == '+') {
+      c = ' ';
+      ++pos;
+    } else if (c == '%' && end - pos >= 3 &&
+               !hex2byte(&c, (const uint8_t *)pos + 1)) {
+      pos += 3;
+    } else {
+      ++pos;
+    }
+    if (i == len || (uint8_t)name[i] != c)
+      return 0;
+    ++i;
+  }
+  return i == len;
+}
+
+typedef struct {
+  const char *name;
+  size_t len;
+  uint8_t encoded;
+  fio_str_info_s value;
+} http_param_find_s;
+
+static int http_param_find_task(fio_str_info_s name, fio_str_info_s value,
+                                void *find_) {
+  http_param_find_s *find = find_;
+  if (!http_param_name_eq(name, find->name, find->len, find->encoded))
+    return 0;
+  find->value = value;
+  return -1;
+}
+
+/**
+ * Returns the raw (URL encoded) value of a query parameter, scanning the query
+ * without parsing it.
+ */
+fio_str_info_s http_query_get(http_s *h, const char *name, size_t name_len) {
+  http_param_find_s find = {.name = name, .len = name_len, .encoded = 1};
+  if (h && h->query)
+    http_params_scan(fiobj_obj2cstr(h->query), '&', http_param_find_task,
+                     &find);
+  return find.value;
+}
+
+/** Calls `task` for each query parameter (raw name and value). */
+size_t http_query_each(http_s *h,
+                       int (*task)(fio_str_info_s name, fio_str_info_s value,
+                                   void *udata),
+                       void *udata) {
+  if (!h || !h->query)
+    return 0;
+  return http_params_scan(fiobj_obj2cstr(h->query), '&', task, udata);
+}
+
+typedef struct {
+  http_param_task_fn task;
+  void *udata;
+  size_t count;
+  uint8_t stop;
+} http_cookie_each_s;
+
+static int http_cookie_each_task(fio_str_info_s name, fio_str_info_s value,
+                                 void *e_) {
+  http_cookie_each_s *e = e_;
+  ++e->count;
+  if (e->task(name, value, e->udata) == -1) {
+    e->stop = 1;
+    return -1;
+  }
+  return 0;
+}
+
+/* scans a single Cookie / Set-Cookie header value */
+static void http_cookie_scan(FIOBJ str, uint8_t is_set_cookie,
+                             http_cookie_each_s *e) {
+  if (!FIOBJ_TYPE_IS(str, FIOBJ_T_STRING))
+    return;
+  fio_str_info_s s = fiobj_obj2cstr(str);
+  if (is_set_cookie) {
+    /* only the first pair is the cookie, the rest are attributes */
+    char *cut = memchr(s.data, ';', s.len);
+    if (cut)
+      s.len = cut - s.data;
+  }
+  http_params_scan(s, ';', http_cookie_each_task, e);
+}
+
+/** Calls `task` for each cookie (raw name and value). */
+size_t http_cookie_each(http_s *h,
+                        int (*task)(fio_str_info_s name, fio_str_info_s value,
+                                    void *udata),
+                        void *udata) {
+  if (!h || !h->headers)
+    return 0;
+  http_cookie_each_s e = {.task = task, .udata = udata};
+  FIOBJ headers[2] = {
+      fiobj_hash_get2(h->headers, fiobj_obj2hash(HTTP_HEADER_COOKIE)),
+      fiobj_hash_get2(h->headers, fiobj_obj2hash(HTTP_HEADER_SET_COOKIE)),
+  };
+  for (size_t i = 0; i < 2 && !e.stop; ++i) {
+    FIOBJ c = headers[i];
+    if (!c)
+      continue;
+    if (FIOBJ_TYPE_IS(c, FIOBJ_T_ARRAY)) {
+      /* Array of Strings */
+      size_t count = fiobj_ary_count(c);
+      for (size_t j = 0; j < count && !e.stop; ++j) {
+        http_cookie_scan(fiobj_ary_index(c, (int64_t)j), i, &e);
+      }
+    } else {
+      /* single string */
+      http_cookie_scan(c, i, &e);
+    }
+  }
+  return e.count;
+}
+
+/**
+ * Returns the raw value of a cookie, scanning the Cookie (and Set-Cookie)
+ * headers without parsing them.
+ */
+fio_str_info_s http_cookie_get(http_s *h, const char *name, size_t name_len) {
+  http_param_find_s find = {.name = name, .len = name_len};
+  http_cookie_each(h, http_param_find_task, &find);
+  return find.value;
+}
+
+/** URL decodes a raw value into a buffer with room for `capa` bytes. */
+ssize_t http_decode_param(char *dest, size_t capa, fio_str_info_s raw) {
+  if (!capa)
+    return -1;
+  char *pos = dest;
+  char *const limit = dest + capa - 1; /* room for the NUL terminator */
+  const char *src = raw.data;
+  const char *const end = raw.data + raw.len;
+  while (src < end) {
+    if (pos == limit)
+      return -1;
+    if (*src == '+') {
+      *(pos++) = ' ';
+      ++src;
+    } else if (*src == '%') {
+      if (end - src < 3 || hex2byte((uint8_t *)pos, (const uint8_t *)src + 1))
+        return -1;
+      ++pos;
+      src += 3;
+    } else {
+      *(pos++) = *(src++);
+    }
+  }
+  *pos = 0;
+  return pos - dest;
+}
+
 /**
  * Adds a named parameter to the hash, resolving nesting references.
  *
@@ -1796,16 +2854,84 @@ typedef struct {
   size_t partial_offset;
   size_t partial_length;
   FIOBJ partial_name;
+  http_multipart_settings_s *stream;
+  /* `http_multipart_each` */
+  int (*each)(http_s *h, http_multipart_part_s *part, void *udata);
+  void *each_udata;
+  http_multipart_part_s part;
+  size_t base;
+  int fd;
+  int count;
+  uint8_t stop;
 } http_fio_mime_s;
 
 #define http_mime_parser2fio(parser) ((http_fio_mime_s *)(parser))
 
+/** Sets the part's name, filename and MIME type (`http_multipart_each`). */
+static void http_mime_each_meta(http_mime_parser_s *parser, void *name,
+                                size_t name_len, void *filename,
+                                size_t filename_len, void *mimetype,
+                                size_t mimetype_len) {
+  http_multipart_part_s *part = &http_mime_parser2fio(parser)->part;
+  part->name = (fio_str_info_s){.data = name, .len = name_len};
+  part->filename = (fio_str_info_s){.data = filename, .len = filename_len};
+  part->mime_type = (fio_str_info_s){.data = mimetype_len ? mimetype : NULL,
+                                     .len = mimetype_len};
+}
+
+/** Calls the `http_multipart_each` task with the part's location. */
+static void http_mime_each_emit(http_mime_parser_s *parser) {
+  http_fio_mime_s *p = http_mime_parser2fio(parser);
+  if (p->stop)
+    return;
+  ++p->count;
+  p->part.fd = p->fd;
+  p->part.offset = p->base + p->part.pos;
+  if (p->each(p->h, &p->part, p->each_udata) == -1)
+    p->stop = 1;
+}
+
+/** Routes a part's start to the streaming (`http_multipart_s`) callbacks. */
+static void http_mime_stream_start(http_mime_parser_s *parser, void *name,
+                                   size_t name_len, void *filename,
+                                   size_t filename_len, void *mimetype,
+                                   size_t mimetype_len) {
+  http_multipart_settings_s *s = http_mime_parser2fio(parser)->stream;
+  s->on_part_start(
+      (http_multipart_s *)parser,
+      (fio_str_info_s){.data = name, .len = name_len},
+      (fio_str_info_s){.data = filename, .len = filename_len},
+      (fio_str_info_s){.data = mimetype_len ? mimetype : NULL,
+                       .len = mimetype_len});
+}
+
 /** Called when all the data is available at once. */
 static void http_mime_parser_on_data(http_mime_parser_s *parser, void *name,
                                      size_t name_len, void *filename,
                                      size_t filename_len, void *mimetype,
                                      size_t mimetype_len, void *value,
                                      size_t value_len) {
+  if (http_mime_parser2fio(parser)->each) {
+    http_mime_each_meta(parser, name, name_len, filename, filename_len,
+                        mimetype, mimetype_len);
+    http_mime_parser2fio(parser)->part.pos =
+        http_mime_parser2fio(parser)->pos +
+        ((uintptr_t)value -
+         (uintptr_t)http_mime_parser2fio(parser)->buffer.data);
+    http_mime_parser2fio(parser)->part.length = value_len;
+    http_mime_each_emit(parser);
+    return;
+  }
+  if (http_mime_parser2fio(parser)->stream) {
+    http_mime_stream_start(parser, name, name_len, filename, filename_len,
+                           mimetype, mimetype_len);
+    if (value_len)
+      http_mime_parser2fio(parser)->stream->on_part_data(
+          (http_multipart_s *)parser, value, value_len);
+    http_mime_parser2fio(parser)->stream->on_part_end(
+        (http_multipart_s *)parser);
+    return;
+  }
   if (!filename_len) {
     http_add2hash(http_mime_parser2fio(parser)->h->params, name, name_len,
                   value, value_len, 0);
@@ -1835,6 +2961,25 @@ static void http_mime_parser_on_data(http_mime_parser_s *parser, void *name,
 static void http_mime_parser_on_partial_start(
     http_mime_parser_s *parser, void *name, size_t name_len, void *filename,
     size_t filename_len, void *mimetype, size_t mimetype_len) {
+  if (http_mime_parser2fio(parser)->each) {
+    /* the part's headers won't survive the next read, keep a copy */
+    FIOBJ meta = fiobj_str_buf(name_len + filename_len + mimetype_len);
+    fiobj_str_write(meta, name, name_len);
+    fiobj_str_write(meta, filename, filename_len);
+    fiobj_str_write(meta, mimetype, mimetype_len);
+    fiobj_free(http_mime_parser2fio(parser)->partial_name);
+    http_mime_parser2fio(parser)->partial_name = meta;
+    http_mime_each_meta(parser, name, name_len, filename, filename_len,
+                        mimetype, mimetype_len);
+    http_mime_parser2fio(parser)->partial_offset = 0;
+    http_mime_parser2fio(parser)->partial_length = 0;
+    return;
+  }
+  if (http_mime_parser2fio(parser)->stream) {
+    http_mime_stream_start(parser, name, name_len, filename, filename_len,
+                           mimetype, mimetype_len);
+    return;
+  }
   http_mime_parser2fio(parser)->partial_length = 0;
   http_mime_parser2fio(parser)->partial_offset = 0;
   http_mime_parser2fio(parser)->partial_name = fiobj_str_new(name, name_len);
@@ -1861,6 +3006,11 @@ static void http_mime_parser_on_partial_start(
 /** Called when partial data is available. */
 static void http_mime_parser_on_partial_data(http_mime_parser_s *parser,
                                              void *value, size_t value_len) {
+  if (http_mime_parser2fio(parser)->stream) {
+    http_mime_parser2fio(parser)->stream->on_part_data(
+        (http_multipart_s *)parser, value, value_len);
+    return;
+  }
   if (!http_mime_parser2fio(parser)->partial_offset)
     http_mime_parser2fio(parser)->partial_offset =
         http_mime_parser2fio(parser)->pos +
@@ -1872,6 +3022,27 @@ static void http_mime_parser_on_partial_data(http_mime_parser_s *parser,
 
 /** Called when the partial data is complete. */
 static void http_mime_parser_on_partial_end(http_mime_parser_s *parser) {
+  if (http_mime_parser2fio(parser)->each) {
+    http_fio_mime_s *p = http_mime_parser2fio(parser);
+    char *meta = fiobj_obj2cstr(p->partial_name).data;
+    p->part.name.data = meta;
+    if (p->part.filename.data)
+      p->part.filename.data = meta + p->part.name.len;
+    if (p->part.mime_type.data)
+      p->part.mime_type.data = meta + p->part.name.len + p->part.filename.len;
+    p->part.pos = p->partial_length ? p->partial_offset : 0;
+    p->part.length = p->partial_length;
+    http_mime_each_emit(parser);
+    fiobj_free(p->partial_name);
+    p->partial_name = FIOBJ_INVALID;
+    p->partial_offset = 0;
+    return;
+  }
+  if (http_mime_parser2fio(parser)->stream) {
+    http_mime_parser2fio(parser)->stream->on_part_end(
+        (http_multipart_s *)parser);
+    return;
+  }
 
   fio_str_info_s tmp =
       fiobj_obj2cstr(http_mime_parser2fio(parser)->partial_name);
@@ -1970,6 +3141,200 @@ int http_parse_body(http_s *h) {
   return 0;
 }
 
+/**
+ * Calls `task` for each part of a `multipart/form-data` body, reporting where
+ * the part's data is located rather than copying it.
+ */
+int http_multipart_each(http_s *h,
+                        int (*task)(http_s *h, http_multipart_part_s *part,
+                                    void *udata),
+                        void *udata) {
+  static uint64_t content_type_hash;
+  if (HTTP_INVALID_HANDLE(h) || !h->body || !task)
+    return -1;
+  if (!content_type_hash)
+    content_type_hash = fiobj_hash_string("content-type", 12);
+  fio_str_info_s content_type =
+      fiobj_obj2cstr(fiobj_hash_get2(h->headers, content_type_hash));
+  http_fio_mime_s p = {.h = h, .each = task, .each_udata = udata};
+  if (http_mime_parser_init(&p.p, content_type.data, content_type.len))
+    return -1;
+  const size_t length = fiobj_data_len(h->body);
+  p.fd = fiobj_data_fd(h->body, &p.base);
+  if (p.fd == -1) {
+    /* the body is in memory, parse it in one pass */
+    p.base = 0;
+    p.buffer = fiobj_data_pread(h->body, 0, length);
+    http_mime_parse(&p.p, p.buffer.data, p.buffer.len);
+  } else {
+    /* use a private buffer, so `task` is free to read from the body */
+    char *buf = fio_malloc(HTTP_MULTIPART_EACH_BUFFER);
+    FIO_ASSERT_ALLOC(buf);
+    while (p.pos < length && !p.p.done && !p.p.error && !p.stop) {
+      size_t to_read = length - p.pos;
+      if (to_read > HTTP_MULTIPART_EACH_BUFFER)
+        to_read = HTTP_MULTIPART_EACH_BUFFER;
+      ssize_t r = pread(p.fd, buf, to_read, p.base + p.pos);
+      if (r <= 0)
+        break;
+      p.buffer = (fio_str_info_s){.data = buf, .len = (size_t)r};
+      size_t cons = http_mime_parse(&p.p, buf, (size_t)r);
+      if (!cons)
+        break; /* part headers larger than the buffer */
+      p.pos += cons;
+    }
+    fio_free(buf);
+  }
+  fiobj_free(p.partial_name);
+  if (p.p.error || (!p.p.done && !p.stop))
+    return -1;
+  return p.count;
+}
+
+/* *****************************************************************************
+Incremental (streaming) multipart/form-data parsing
+***************************************************************************** */
+
+struct http_multipart_s {
+  http_fio_mime_s p; /* must be first, parser callbacks cast the pointer */
+  http_multipart_settings_s settings;
+  FIOBJ content_type; /* the parser's boundary points to this String */
+  FIOBJ buffer;       /* unconsumed data (incomplete headers / boundaries) */
+};
+
+static void http_multipart_noop_start(http_multipart_s *m, fio_str_info_s name,
+                                      fio_str_info_s filename,
+                                      fio_str_info_s mime_type) {
+  (void)m;
+  (void)name;
+  (void)filename;
+  (void)mime_type;
+}
+static void http_multipart_noop_data(http_multipart_s *m, char *data,
+                                     size_t length) {
+  (void)m;
+  (void)data;
+  (void)length;
+}
+static void http_multipart_noop_end(http_multipart_s *m) { (void)m; }
+
+/**
+ * Returns TRUE if the parser can safely process the buffer, which requires the
+ * part's headers to be complete (unless the parser is within a part's data).
+ */
+static int http_multipart_ready(http_multipart_s *m, char *data, size_t len) {
+  if (m->p.p.in_obj)
+    return 1;
+  const size_t boundary = 4 + m->p.p.boundary_len;
+  if (len < boundary)
+    return 0;
+  if (data[boundary - 2] == '-' && data[boundary - 1] == '-')
+    return 1; /* the closing boundary */
+  char *end = data + len;
+  char *pos = data + boundary - 2;
+  while ((pos = memchr(pos, '\n', (size_t)(end - pos)))) {
+    ++pos;
+    if (pos < end && pos[0] == '\r')
+      ++pos;
+    if (pos < end && pos[0] == '\n')
+      return (end - pos) > 4;
+  }
+  return 0;
+}
+
+/**
+ * Creates an incremental `multipart/form-data` parser for the request's body.
+ */
+http_multipart_s *http_multipart_new FIO_IGNORE_MACRO(
+    http_s *h, http_multipart_settings_s settings) {
+  static uint64_t content_type_hash;
+  if (HTTP_INVALID_HANDLE(h))
+    return NULL;
+  if (!content_type_hash)
+    content_type_hash = fiobj_hash_string("content-type", 12);
+  FIOBJ ct = fiobj_hash_get2(h->headers, content_type_hash);
+  if (!ct)
+    return NULL;
+  http_multipart_s *m = fio_malloc(sizeof(*m));
+  FIO_ASSERT_ALLOC(m);
+  *m = (http_multipart_s){
+      .p.h = h,
+      .settings = settings,
+      .content_type = fiobj_dup(ct),
+  };
+  fio_str_info_s content_type = fiobj_obj2cstr(m->content_type);
+  if (http_mime_parser_init(&m->p.p, content_type.data, content_type.len)) {
+    fiobj_free(m->content_type);
+    fio_free(m);
+    return NULL;
+  }
+  if (!m->settings.on_part_start)
+    m->settings.on_part_start = http_multipart_noop_start;
+  if (!m->settings.on_part_data)
+    m->settings.on_part_data = http_multipart_noop_data;
+  if (!m->settings.on_part_end)
+    m->settings.on_part_end = http_multipart_noop_end;
+  m->p.stream = &m->settings;
+  return m;
+}
+
+/** Consumes a chunk of the body. */
+int http_multipart_consume(http_multipart_s *m, char *data, size_t length) {
+  if (!m || m->p.p.error)
+    return -1;
+  if (m->p.p.done)
+    return 1;
+  fio_str_info_s buf = {.data = data, .len = length};
+  if (m->buffer) {
+    /* complete the leftovers from the previous round */
+    fiobj_str_write(m->buffer, data, length);
+    buf = fiobj_obj2cstr(m->buffer);
+  }
+  size_t pos = 0;
+  while (pos < buf.len && !m->p.p.done && !m->p.p.error &&
+         http_multipart_ready(m, buf.data + pos, buf.len - pos)) {
+    size_t consumed = http_mime_parse(&m->p.p, buf.data + pos, buf.len - pos);
+    if (!consumed)
+      break;
+    pos += consumed;
+  }
+  if (m->p.p.error)
+    return -1;
+  if (m->p.p.done) {
+    fiobj_free(m->buffer);
+    m->buffer = FIOBJ_INVALID;
+    return 1;
+  }
+  if (buf.len - pos > HTTP_MAX_HEADER_LENGTH) {
+    /* part headers should never be this long */
+    m->p.p.error = 1;
+    return -1;
+  }
+  if (m->buffer) {
+    if (pos) {
+      memmove(buf.data, buf.data + pos, buf.len - pos);
+      fiobj_str_resize(m->buffer, buf.len - pos);
+    }
+  } else if (pos < buf.len) {
+    m->buffer = fiobj_str_new(buf.data + pos, buf.len - pos);
+  }
+  return 0;
+}
+
+/** Returns the `udata` associated with the parser. */
+void *http_multipart_udata(http_multipart_s *m) {
+  return m ? m->settings.udata : NULL;
+}
+
+/** Frees the parser (the `udata` is left untouched). */
+void http_multipart_free(http_multipart_s *m) {
+  if (!m)
+    return;
+  fiobj_free(m->buffer);
+  fiobj_free(m->content_type);
+  fio_free(m);
+}
+
 /* *****************************************************************************
 HTTP Helper functions that could be used globally
 ***************************************************************************** */
@@ -2023,65 +3388,6 @@ FIOBJ http_req2str(http_s *h) {
   return w.dest;
 }
 
-void http_write_log(http_s *h) {
-  FIOBJ l = fiobj_str_buf(128);
-
-  intptr_t bytes_sent = fiobj_obj2num(fiobj_hash_get2(
-      h->private_data.out_headers, fiobj_obj2hash(HTTP_HEADER_CONTENT_LENGTH)));
-
-  struct timespec start, end;
-  clock_gettime(CLOCK_REALTIME, &end);
-  start = h->received_at;
-
-  {
-    // TODO Guess IP address from headers (forwarded) where possible
-    fio_str_info_s peer = fio_peer_addr(http2protocol(h)->uuid);
-    fiobj_str_write(l, peer.data, peer.len);
-  }
-  fio_str_info_s buff = fiobj_obj2cstr(l);
-
-  if (buff.len == 0) {
-    memcpy(buff.data, "[unknown]", 9);
-    buff.len = 9;
-  }
-  memcpy(buff.data + buff.len, " - - [", 6);
-  buff.len += 6;
-  fiobj_str_resize(l, buff.len);
-  {
-    FIOBJ date;
-    fio_lock(&date_lock);
-    date = fiobj_dup(current_date);
-    fio_unlock(&date_lock);
-    fiobj_str_join(l, current_date);
-    fiobj_free(date);
-  }
-  fiobj_str_write(l, "] \"", 3);
-  fiobj_str_join(l, h->method);
-  fiobj_str_write(l, " ", 1);
-  fiobj_str_join(l, h->path);
-  fiobj_str_write(l, " ", 1);
-  fiobj_str_join(l, h->version);
-  fiobj_str_write(l, "\" ", 2);
-  if (bytes_sent > 0) {
-    fiobj_str_write_i(l, h->status);
-    fiobj_str_write(l, " ", 1);
-    fiobj_str_write_i(l, bytes_sent);
-    fiobj_str_write(l, "b ", 2);
-  } else {
-    fiobj_str_join(l, fiobj_num_tmp(h->status));
-    fiobj_str_write(l, " -- ", 4);
-  }
-
-  bytes_sent = ((end.tv_sec - start.tv_sec) * 1000) +
-               ((end.tv_nsec - start.tv_nsec) / 1000000);
-  fiobj_str_write_i(l, bytes_sent);
-  fiobj_str_write(l, "ms\r\n", 4);
-
-  buff = fiobj_obj2cstr(l);
-  fwrite(buff.data, 1, buff.len, stderr);
-  fiobj_free(l);
-}
-
 /**
 A faster (yet less localized) alternative to `gmtime_r`.
 
@@ -2466,6 +3772,8 @@ ssize_t http_decode_path_unsafe(char *dest, const char *url_data) {
 Lookup Tables / functions
 ***************************************************************************** */
 
+#include <http_mime_table.h>
+
 #define FIO_FORCE_MALLOC_TMP 1 /* use malloc for the mime registry */
 #define FIO_SET_NAME fio_mime_set
 #define FIO_SET_OBJ_TYPE FIOBJ
@@ -2475,32 +3783,67 @@ Lookup Tables / functions
 
 #include <fio.h>
 
+/* runtime registrations, layered on top of the (static) default MIME table */
 static fio_mime_set_s fio_http_mime_types = FIO_SET_INIT;
+/* the default MIME types' String objects, created on first use */
+static FIOBJ http_mime_table_objects[HTTP_MIME_TABLE_TYPES];
+static fio_lock_i http_mime_table_lock = FIO_LOCK_INIT;
+/* set by `http_mimetype_clear`, disables the default MIME table */
+static uint8_t http_mime_table_disabled;
 
 #define LONGEST_FILE_EXTENSION_LENGTH 15
 
+/* returns the default MIME type at `slot` (a String, not a copy) */
+static FIOBJ http_mime_table_type(int slot) {
+  uint16_t type = http_mime_table[slot].type;
+  FIOBJ o = http_mime_table_objects[type];
+  if (o)
+    return o;
+  fio_lock(&http_mime_table_lock);
+  o = http_mime_table_objects[type];
+  if (!o) {
+    o = fiobj_str_new(http_mime_table_types[type].data,
+                      http_mime_table_types[type].len);
+    http_mime_table_objects[type] = o;
+  }
+  fio_unlock(&http_mime_table_lock);
+  return o;
+}
+
 /** Registers a Mime-Type to be associated with the file extension. */
 void http_mimetype_register(char *file_ext, size_t file_ext_len,
                             FIOBJ mime_type_str) {
   uintptr_t hash = FIO_HASH_FN(file_ext, file_ext_len, 0, 0);
+  int slot = http_mime_table_disabled
+                 ? -1
+                 : http_mime_table_find(file_ext, file_ext_len);
   if (mime_type_str == FIOBJ_INVALID) {
-    fio_mime_set_remove(&fio_http_mime_types, hash, FIOBJ_INVALID, NULL);
+    if (slot == -1) {
+      fio_mime_set_remove(&fio_http_mime_types, hash, FIOBJ_INVALID, NULL);
+    } else {
+      /* a `null` entry hides the default MIME type */
+      fio_mime_set_overwrite(&fio_http_mime_types, hash, fiobj_null(), NULL);
+    }
   } else {
     FIOBJ old = FIOBJ_INVALID;
     fio_mime_set_overwrite(&fio_http_mime_types, hash, mime_type_str, &old);
-    if (old != FIOBJ_INVALID) {
+    if (old == FIOBJ_INVALID && slot != -1)
+      old = fiobj_dup(http_mime_table_type(slot));
+    if (old != FIOBJ_INVALID && !FIOBJ_TYPE_IS(old, FIOBJ_T_NULL)) {
       FIO_LOG_WARNING("mime-type collision: %.*s was %s, now %s",
                       (int)file_ext_len, file_ext, fiobj_obj2cstr(old).data,
                       fiobj_obj2cstr(mime_type_str).data);
-      fiobj_free(old);
     }
+    fiobj_free(old);
     fiobj_free(mime_type_str); /* move ownership to the registry */
   }
 }
 
 /** Registers a Mime-Type to be associated with the file extension. */
 void http_mimetype_stats(void) {
-  FIO_LOG_DEBUG("HTTP MIME hash storage count/capa: %zu / %zu",
+  FIO_LOG_DEBUG("HTTP MIME default table count: %zu, registered count/capa: "
+                "%zu / %zu",
+                (size_t)(http_mime_table_disabled ? 0 : HTTP_MIME_TABLE_SIZE),
                 fio_mime_set_count(&fio_http_mime_types),
                 fio_mime_set_capa(&fio_http_mime_types));
 }
@@ -2510,9 +3853,19 @@ void http_mimetype_stats(void) {
  *  Remember to call `fiobj_free`.
  */
 FIOBJ http_mimetype_find(char *file_ext, size_t file_ext_len) {
-  uintptr_t hash = FIO_HASH_FN(file_ext, file_ext_len, 0, 0);
-  return fiobj_dup(
-      fio_mime_set_find(&fio_http_mime_types, hash, FIOBJ_INVALID));
+  if (fio_mime_set_count(&fio_http_mime_types)) {
+    uintptr_t hash = FIO_HASH_FN(file_ext, file_ext_len, 0, 0);
+    FIOBJ found = fio_mime_set_find(&fio_http_mime_types, hash, FIOBJ_INVALID);
+    if (found)
+      return FIOBJ_TYPE_IS(found, FIOBJ_T_NULL) ? FIOBJ_INVALID
+                                                : fiobj_dup(found);
+  }
+  if (http_mime_table_disabled || !file_ext)
+    return FIOBJ_INVALID;
+  int slot = http_mime_table_find(file_ext, file_ext_len);
+  if (slot == -1)
+    return FIOBJ_INVALID;
+  return fiobj_dup(http_mime_table_type(slot));
 }
 
 /**
@@ -2556,6 +3909,11 @@ finish:
 /** Clears the Mime-Type registry (it will be empty afterthis call). */
 void http_mimetype_clear(void) {
   fio_mime_set_free(&fio_http_mime_types);
+  http_mime_table_disabled = 1;
+  for (size_t i = 0; i < HTTP_MIME_TABLE_TYPES; ++i) {
+    fiobj_free(http_mime_table_objects[i]);
+    http_mime_table_objects[i] = FIOBJ_INVALID;
+  }
   fiobj_free(current_date);
   current_date = FIOBJ_INVALID;
   last_date_added = 0;
@@ -2684,11 +4042,1178 @@ fio_str_info_s http_status2str(uintptr_t status) {
 #undef HTTP_SET_STATUS_STR
 
 #if DEBUG
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+static void http_multipart_test_start(http_multipart_s *m, fio_str_info_s name,
+                                      fio_str_info_s filename,
+                                      fio_str_info_s mime_type) {
+  FIOBJ out = (FIOBJ)http_multipart_udata(m);
+  fiobj_str_write(out, "[", 1);
+  fiobj_str_write(out, name.data, name.len);
+  fiobj_str_write(out, "|", 1);
+  fiobj_str_write(out, filename.data, filename.len);
+  fiobj_str_write(out, "|", 1);
+  fiobj_str_write(out, mime_type.data, mime_type.len);
+  fiobj_str_write(out, "]", 1);
+}
+static void http_multipart_test_data(http_multipart_s *m, char *data,
+                                     size_t length) {
+  fiobj_str_write((FIOBJ)http_multipart_udata(m), data, length);
+}
+static void http_multipart_test_end(http_multipart_s *m) {
+  fiobj_str_write((FIOBJ)http_multipart_udata(m), "$", 1);
+}
+
+static int http_multipart_test_each(http_s *h, http_multipart_part_s *part,
+                                    void *udata) {
+  FIOBJ out = (FIOBJ)udata;
+  fiobj_str_write(out, "[", 1);
+  fiobj_str_write(out, part->name.data, part->name.len);
+  fiobj_str_write(out, "|", 1);
+  fiobj_str_write(out, part->filename.data, part->filename.len);
+  fiobj_str_write(out, "|", 1);
+  fiobj_str_write(out, part->mime_type.data, part->mime_type.len);
+  fiobj_str_write(out, "]", 1);
+  if (part->fd == -1) {
+    fio_str_info_s data = fiobj_data_pread(h->body, part->pos, part->length);
+    fiobj_str_write(out, data.data, data.len);
+  } else {
+    size_t pos = fiobj_obj2cstr(out).len;
+    fiobj_str_capa_assert(out, pos + part->length + 1);
+    char *dest = fiobj_obj2cstr(out).data + pos;
+    FIO_ASSERT(pread(part->fd, dest, part->length, part->offset) ==
+                   (ssize_t)part->length,
+               "multipart part couldn't be read from the body's file");
+    fiobj_str_resize(out, pos + part->length);
+  }
+  fiobj_str_write(out, "$", 1);
+  return 0;
+}
+
+static void http_router_test_handler(http_s *h, http_route_s *route) {
+  FIOBJ out = (FIOBJ)h->udata;
+  fiobj_str_write(out, (char *)route->udata, strlen((char *)route->udata));
+  for (size_t i = 0; i < route->count; ++i) {
+    fio_str_info_s val = http_route_param(h, route, route->names[i].data);
+    fiobj_str_write(out, " ", 1);
+    fiobj_str_write(out, route->names[i].data, route->names[i].len);
+    fiobj_str_write(out, "=", 1);
+    fiobj_str_write(out, val.data, val.len);
+  }
+}
+
+static int http_cache_test_send(http_s *h, void *data, uintptr_t length) {
+  fiobj_str_write((FIOBJ)h->udata, data, length);
+  return 0;
+}
+static void http_cache_test_finish(http_s *h) {
+  fiobj_str_write((FIOBJ)h->udata, "304", 3);
+}
+static void http_static_test_finish(http_s *h) { (void)h; }
+
+/* requests a range of a static file, returns the status code */
+static size_t http_static_range_test(const char *name, const char *range,
+                                     FIOBJ out, FIOBJ content_range) {
+  static http_vtable_s vtable = {.http_send_body = http_cache_test_send,
+                                 .http_finish = http_static_test_finish};
+  http_s h;
+  http_s_new(&h, NULL, &vtable);
+  h.udata = (void *)out;
+  h.method = fiobj_str_new("GET", 3);
+  FIOBJ key = fiobj_str_new("range", 5);
+  fiobj_hash_set(h.headers, key, fiobj_str_new(range, strlen(range)));
+  fiobj_free(key);
+  fiobj_str_resize(out, 0);
+  fiobj_str_resize(content_range, 0);
+  FIO_ASSERT(!http_sendfile2(&h, "/tmp", 4, name + 4, strlen(name + 4)),
+             "http_sendfile2 failed for range %s", range);
+  FIOBJ tmp = fiobj_hash_get2(h.private_data.out_headers,
+                              fiobj_obj2hash(HTTP_HEADER_CONTENT_RANGE));
+  if (tmp)
+    fiobj_str_concat(content_range, tmp);
+  size_t status = h.status;
+  http_s_destroy(&h, 0);
+  return status;
+}
+
+static int http_param_test_task(fio_str_info_s name, fio_str_info_s value,
+                                void *udata) {
+  FIOBJ out = (FIOBJ)udata;
+  fiobj_str_write(out, name.data, name.len);
+  fiobj_str_write(out, ":", 1);
+  fiobj_str_write(out, value.data, value.len);
+  fiobj_str_write(out, ",", 1);
+  return 0;
+}
+
+/* an HTTP/1.1 server connection over a socket pair (no running reactor) */
+static intptr_t http_test_uuid = -1;
+/* the test callbacks record events here */
+static FIOBJ http_test_log;
+/* a marker for the `udata` set by test callbacks */
+static int http_test_marker;
+
+/* attaches an HTTP/1.1 connection to one end of a socket pair, returning the
+ * other end */
+static int http_test_open(http_settings_s *settings) {
+  int sv[2];
+  FIO_ASSERT(!socketpair(AF_UNIX, SOCK_STREAM, 0, sv),
+             "couldn't create a socket pair for HTTP testing");
+  fio_set_non_block(sv[0]);
+  fio_set_non_block(sv[1]);
+  http_test_uuid = fio_fd2uuid(sv[0]);
+  FIO_ASSERT(http1_new(http_test_uuid, settings, NULL, 0),
+             "couldn't attach an HTTP/1.1 test connection");
+  http_test_log = fiobj_ary_new();
+  return sv[1];
+}
+
+/* performs the pending tasks (events and writes) without a running reactor */
+static void http_test_cycle(void) {
+  for (size_t i = 0; i < 8; ++i) {
+    /* the reactor would report a drained queue */
+    fio_force_event(http_test_uuid, FIO_EVENT_ON_READY);
+    fio_defer_perform();
+    fio_flush_all();
+  }
+}
+
+/* the peer writes raw data, which the connection then reads */
+static void http_test_send(int peer, const char *data) {
+  FIO_ASSERT(write(peer, data, strlen(data)) == (ssize_t)strlen(data),
+             "HTTP test peer couldn't write");
+  /* the reactor isn't running, so the data event is forced */
+  fio_force_event(http_test_uuid, FIO_EVENT_ON_DATA);
+  http_test_cycle();
+}
+
+/* the peer reads the data sent so far, returns -1 if the connection closed */
+static int http_test_read(int peer, FIOBJ dest) {
+  http_test_cycle();
+  for (;;) {
+    char tmp[4096];
+    ssize_t r = read(peer, tmp, sizeof(tmp));
+    if (r <= 0)
+      return (r ? 0 : -1);
+    fiobj_str_write(dest, tmp, r);
+  }
+}
+
+/* the connection might have been closed by the test */
+static void http_test_close(int peer) {
+  fio_force_close(http_test_uuid);
+  http_test_cycle();
+  close(peer);
+  fiobj_free(http_test_log);
+  http_test_uuid = -1;
+}
+
+/* records an event (by order of arrival) */
+static void http_test_record(const char *event, size_t len) {
+  fiobj_ary_push(http_test_log, fiobj_str_new(event, len));
+}
+
+/* the log's events, joined by `|` */
+static FIOBJ http_test_events(void) {
+  FIOBJ ret = fiobj_str_buf(64);
+  for (size_t i = 0; i < (size_t)fiobj_ary_count(http_test_log); ++i) {
+    if (i)
+      fiobj_str_write(ret, "|", 1);
+    fiobj_str_concat(ret, fiobj_ary_index(http_test_log, i));
+  }
+  return ret;
+}
+
+static int http_body_chunk_test(http_s *h, char *data, size_t length) {
+  if (!data) {
+    http_test_record("NULL", 4);
+    return 0;
+  }
+  http_test_record(data, length);
+  /* state set by `on_body_chunk` is available to `on_request` */
+  h->udata = &http_test_marker;
+  return 0;
+}
+
+static void http_body_chunk_test_request(http_s *h) {
+  if (h->udata != &http_test_marker || h->body)
+    http_test_record("request error", 13);
+  else
+    http_test_record("request", 7);
+  http_send_body(h, "ok", 2);
+}
+
+/* responds with the path, recording the number of packets already queued */
+static void http_pipeline_test_request(http_s *h) {
+  char tmp[32];
+  fio_str_info_s path = fiobj_obj2cstr(h->path);
+  int len = snprintf(tmp, sizeof(tmp), "%s:%zu", path.data,
+                     fio_pending(http_uuid(h)));
+  http_test_record(tmp, len);
+  http_send_body(h, path.data, path.len);
+}
+
+/* streams a response in two chunks, with a trailer */
+static void http_stream_test_request(http_s *h) {
+  if (fiobj_obj2cstr(h->path).data[1] == 'l')
+    http_set_header(h, HTTP_HEADER_CONTENT_LENGTH, fiobj_num_new(12));
+  FIOBJ trailers = fiobj_hash_new();
+  FIOBJ key = fiobj_str_new("x-total", 7);
+  fiobj_hash_set(trailers, key, fiobj_num_new(12));
+  fiobj_free(key);
+  if (http_stream_write(h, "Hello", 5) || http_stream_write(h, "World!!", 7) ||
+      http_stream_finish(h, trailers))
+    http_test_record("stream error", 12);
+  fiobj_free(trailers);
+}
+
+#if HAVE_ZLIB
+/* streams a compressible response */
+static void http_stream_test_compressed(http_s *h) {
+  http_set_header(h, HTTP_HEADER_CONTENT_TYPE,
+                  fiobj_str_new("text/plain", 10));
+  if (http_stream_write(h, "Hello ", 6) || http_stream_write(h, "World", 5) ||
+      http_stream_finish(h, FIOBJ_INVALID))
+    http_test_record("stream error", 12);
+}
+#endif
+
+/* continues the stream once the client caught up, then finishes it */
+static void http_stream_test_ready(http_s *h) {
+  http_test_record("ready", 5);
+  if (fio_pending(http_uuid(h)) > HTTP_STREAM_PENDING_LIMIT ||
+      http_stream_write(h, "done", 4) || http_stream_finish(h, FIOBJ_INVALID))
+    http_test_record("ready error", 11);
+}
+
+/* streams until the client falls behind */
+static void http_stream_test_backpressure(http_s *h) {
+  static char chunk[4096];
+  memset(chunk, 'x', sizeof(chunk));
+  int ret = 0;
+  for (size_t i = 0; !ret && i < 1024; ++i)
+    ret = http_stream_write(h, chunk, sizeof(chunk));
+  if (ret != 1 || http_stream_on_ready(h, http_stream_test_ready))
+    http_test_record("backpressure error", 18);
+  else
+    http_test_record("backpressure", 12);
+}
+
 void http_tests(void) {
   fprintf(stderr, "=== Testing HTTP helpers\n");
   FIOBJ html_mime = http_mimetype_find("html", 4);
   FIO_ASSERT(html_mime,
              "HTML mime-type not found! Mime-Type registry invalid!\n");
   fiobj_free(html_mime);
+  for (size_t i = 0; i < HTTP_MIME_TABLE_SIZE; ++i) {
+    FIOBJ mime = http_mimetype_find((char *)http_mime_table[i].ext,
+                                    http_mime_table[i].len);
+    FIO_ASSERT(mime && !strcmp(fiobj_obj2cstr(mime).data,
+                               http_mime_table_types[http_mime_table[i].type]
+                                   .data),
+               "default MIME table error for %s", http_mime_table[i].ext);
+    fiobj_free(mime);
+  }
+  FIO_ASSERT(!http_mimetype_find("htmx", 4),
+             "MIME table shouldn't find unknown extensions");
+  http_mimetype_register("htmx", 4, fiobj_str_new("text/x-test", 11));
+  html_mime = http_mimetype_find("htmx", 4);
+  FIO_ASSERT(html_mime && !strcmp(fiobj_obj2cstr(html_mime).data,
+                                  "text/x-test"),
+             "registered MIME types should be found");
+  fiobj_free(html_mime);
+  http_mimetype_register("htmx", 4, FIOBJ_INVALID);
+  FIO_ASSERT(!http_mimetype_find("htmx", 4),
+             "unregistered MIME types shouldn't be found");
+
+  fprintf(stderr, "=== Testing HTTP static file cache\n");
+  {
+    char name[] = "/tmp/fio_http_test_XXXXXX";
+    int fd = mkstemp(name);
+    FIO_ASSERT(fd != -1, "couldn't create temporary file for testing");
+    FIO_ASSERT(write(fd, "Hello World", 11) == 11,
+               "couldn't write to temporary file");
+    close(fd);
+    FIOBJ filename = fiobj_str_new(name, strlen(name));
+    http_static_file_s f1, f2;
+    FIO_ASSERT(!http_static_file_get(filename, &f1),
+               "static file cache couldn't find file");
+    FIO_ASSERT(!http_static_file_get(filename, &f2),
+               "static file cache couldn't find file (2nd time)");
+    FIO_ASSERT(f1.size == 11 && f2.size == 11,
+               "static file cache size error");
+    FIO_ASSERT(fiobj_iseq(f1.etag, f2.etag) &&
+                   fiobj_iseq(f1.last_modified, f2.last_modified),
+               "static file cache header error");
+    if (HTTP_STATIC_CACHE_LIMIT) {
+      FIO_ASSERT(f2.fd == -1 && f2.body &&
+                     !memcmp(fiobj_obj2cstr(f2.body).data, "Hello World", 11),
+                 "static file cache should keep small files in memory");
+    }
+    fiobj_free(f1.etag);
+    fiobj_free(f1.last_modified);
+    fiobj_free(f2.etag);
+    fiobj_free(f2.last_modified);
+    http_static_file_release(&f1);
+    http_static_file_release(&f2);
+    /* missing files are limited separately, they don't evict cached files */
+    if (HTTP_STATIC_CACHE_LIMIT) {
+      for (size_t i = 0;
+           i < HTTP_STATIC_CACHE_LIMIT + HTTP_STATIC_CACHE_MISSING_LIMIT; ++i) {
+        FIOBJ missing = fiobj_str_buf(64);
+        fiobj_str_printf(missing, "%s.missing.%zu", name, i);
+        FIO_ASSERT(http_static_file_get(missing, &f1),
+                   "static file cache should report missing files");
+        fiobj_free(missing);
+      }
+      http_static_entry_s tmp = {.name = filename,
+                                 .hash = fiobj_obj2hash(filename)};
+      FIO_ASSERT(http_static_set_find(&http_static_cache.files, tmp.hash,
+                                      &tmp) &&
+                     http_static_cache.missing_count ==
+                         HTTP_STATIC_CACHE_MISSING_LIMIT,
+                 "missing files should be limited separately (%zu)",
+                 http_static_cache.missing_count);
+    }
+    /* ranges are clamped to the (cached) file's size */
+    {
+      static const struct {
+        const char *range;
+        size_t status;
+        const char *body;
+        const char *content_range;
+      } ranges[] = {
+          {"bytes=0-300", 206, "Hello World", "bytes 0-10/11"},
+          {"bytes=6-", 206, "World", "bytes 6-10/11"},
+          {"bytes=-5", 206, "World", "bytes 6-10/11"},
+          {"bytes=-300", 206, "Hello World", "bytes 0-10/11"},
+          {"bytes=2-4", 206, "llo", "bytes 2-4/11"},
+          {"bytes=11-20", 416, "", "bytes */11"},
+          {"bytes=300-", 416, "", "bytes */11"},
+          {"bytes=4-2", 200, "Hello World", ""},
+          {"lines=1-2", 200, "Hello World", ""},
+      };
+      FIOBJ out = fiobj_str_buf(0), cr = fiobj_str_buf(0);
+      for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); ++i) {
+        size_t status = http_static_range_test(name, ranges[i].range, out, cr);
+        FIO_ASSERT(status == ranges[i].status &&
+                       !strcmp(fiobj_obj2cstr(out).data, ranges[i].body) &&
+                       !strcmp(fiobj_obj2cstr(cr).data,
+                               ranges[i].content_range),
+                   "static file range error (%s): %zu %s (%s)",
+                   ranges[i].range, status, fiobj_obj2cstr(out).data,
+                   fiobj_obj2cstr(cr).data);
+      }
+      fiobj_free(out);
+      fiobj_free(cr);
+    }
+    unlink(name);
+    http_static_cache_clear();
+    FIO_ASSERT(http_static_file_get(filename, &f1),
+               "static file cache should report missing files");
+    http_static_cache_clear();
+    fiobj_free(filename);
+  }
+
+  fprintf(stderr, "=== Testing HTTP compression\n");
+  {
+    const uint8_t all =
+        (HTTP_COMPRESS_BR | HTTP_COMPRESS_GZIP | HTTP_COMPRESS_DEFLATE);
+    FIOBJ ae = fiobj_str_new("gzip;q=0, deflate", 17);
+#if HAVE_ZLIB
+    FIO_ASSERT(http_compress_negotiate(ae, all) == HTTP_COMPRESS_DEFLATE,
+               "compression negotiation should respect q=0");
+#else
+    FIO_ASSERT(http_compress_negotiate(ae, all) == HTTP_COMPRESS_NONE,
+               "compression negotiation should ignore unsupported encodings");
+#endif
+    fiobj_free(ae);
+    ae = fiobj_str_new("identity", 8);
+    FIO_ASSERT(http_compress_negotiate(ae, all) == HTTP_COMPRESS_NONE,
+               "compression negotiation error (identity)");
+    fiobj_free(ae);
+    ae = fiobj_str_new("gzip, br", 8);
+    FIO_ASSERT(http_compress_negotiate(ae, HTTP_COMPRESS_DEFLATE) ==
+                   HTTP_COMPRESS_NONE,
+               "compression negotiation should respect allowed encodings");
+    fiobj_free(ae);
+    FIOBJ mime = fiobj_str_new("application/json; charset=utf-8", 31);
+    FIO_ASSERT(http_compress_mime(mime), "JSON should be compressible");
+    fiobj_free(mime);
+    mime = fiobj_str_new("image/png", 9);
+    FIO_ASSERT(!http_compress_mime(mime), "PNG shouldn't be compressible");
+    fiobj_free(mime);
+    char data[4096];
+    for (size_t i = 0; i < sizeof(data); ++i)
+      data[i] = "Hello World! "[i % 13];
+    for (int i = 0; i < 3; ++i) {
+      const http_compress_e enc[] = {HTTP_COMPRESS_DEFLATE, HTTP_COMPRESS_GZIP,
+                                     HTTP_COMPRESS_BR};
+      http_compress_s *c = http_compress_new(enc[i], 0, 0);
+      if (!c)
+        continue; /* unsupported */
+      FIOBJ out = fiobj_str_buf(0);
+      FIO_ASSERT(!http_compress_write(c, out, data, 2048, HTTP_COMPRESS_FLUSH),
+                 "streaming compression (flush) failed");
+      FIO_ASSERT(!http_compress_write(c, out, data + 2048, 2048,
+                                      HTTP_COMPRESS_FINISH),
+                 "streaming compression (finish) failed");
+      FIO_ASSERT(fiobj_obj2cstr(out).len &&
+                     fiobj_obj2cstr(out).len < sizeof(data),
+                 "compression didn't reduce the data size");
+      http_compress_free(c);
+      fiobj_free(out);
+    }
+  }
+
+  fprintf(stderr, "=== Testing HTTP streaming multipart parser\n");
+  {
+    http_s h;
+    http_s_new(&h, NULL, NULL);
+    h.method = fiobj_str_new("POST", 4);
+    FIOBJ ct = fiobj_str_new("content-type", 12);
+    fiobj_hash_set(h.headers, ct,
+                   fiobj_str_new("multipart/form-data; boundary=XyZ", 33));
+    fiobj_free(ct);
+    FIOBJ file = fiobj_str_buf(0);
+    for (size_t i = 0; i < 3000; ++i)
+      fiobj_str_write(file, &"ab\r\n-c-\r"[i % 8], 1);
+    FIOBJ body = fiobj_str_buf(0);
+    fiobj_str_write(body,
+                    "--XyZ\r\ncontent-disposition: form-data; "
+                    "name=\"a\"\r\n\r\nhello\r\n--XyZ\r\n"
+                    "content-disposition: form-data; "
+                    "name=\"f\"; filename=\"x.txt\"\r\ncontent-type: "
+                    "text/plain\r\n\r\n",
+                    153);
+    fiobj_str_join(body, file);
+    fiobj_str_write(body, "\r\n--XyZ--\r\n", 11);
+    FIOBJ expected = fiobj_str_buf(0);
+    fiobj_str_write(expected, "[a||]hello$[f|x.txt|text/plain]", 31);
+    fiobj_str_join(expected, file);
+    fiobj_str_write(expected, "$", 1);
+    fio_str_info_s b = fiobj_obj2cstr(body);
+    const size_t chunks[] = {1, 7, 64, 4096, 0};
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); ++i) {
+      const size_t step = chunks[i] ? chunks[i] : b.len;
+      FIOBJ out = fiobj_str_buf(0);
+      http_multipart_s *m =
+          http_multipart_new(&h, .on_part_start = http_multipart_test_start,
+                             .on_part_data = http_multipart_test_data,
+                             .on_part_end = http_multipart_test_end,
+                             .udata = (void *)out);
+      FIO_ASSERT(m, "multipart parser initialization failed");
+      int ret = 0;
+      for (size_t pos = 0; pos < b.len && !ret; pos += step) {
+        ret = http_multipart_consume(
+            m, b.data + pos, (b.len - pos < step ? b.len - pos : step));
+      }
+      FIO_ASSERT(ret == 1, "multipart parser didn't finish (%d, step %zu)",
+                 ret, step);
+      FIO_ASSERT(fiobj_iseq(out, expected),
+                 "multipart parser data error (step %zu):\n%s", step,
+                 fiobj_obj2cstr(out).data);
+      http_multipart_free(m);
+      fiobj_free(out);
+    }
+    fiobj_free(expected);
+    fiobj_free(body);
+    fiobj_free(file);
+    http_s_destroy(&h, 0);
+  }
+
+  fprintf(stderr, "=== Testing HTTP multipart part locations\n");
+  {
+    http_s h;
+    http_s_new(&h, NULL, NULL);
+    h.method = fiobj_str_new("POST", 4);
+    FIOBJ ct = fiobj_str_new("content-type", 12);
+    fiobj_hash_set(h.headers, ct,
+                   fiobj_str_new("multipart/form-data; boundary=XyZ", 33));
+    fiobj_free(ct);
+    /* larger than the read buffer, so the file part is streamed */
+    FIOBJ file = fiobj_str_buf(0);
+    for (size_t i = 0; i < HTTP_MULTIPART_EACH_BUFFER + 3000; ++i)
+      fiobj_str_write(file, &"ab\r\n-c-\r"[i % 8], 1);
+    FIOBJ expected = fiobj_str_buf(0);
+    fiobj_str_write(expected, "[a||]hello$[f|x.txt|text/plain]", 31);
+    fiobj_str_join(expected, file);
+    fiobj_str_write(expected, "$[b||]$", 7);
+    for (int on_disk = 0; on_disk < 2; ++on_disk) {
+      h.body = on_disk ? fiobj_data_newtmpfile() : fiobj_data_newstr();
+      if (on_disk)
+        fiobj_data_write(h.body, "preamble", 8);
+      fiobj_data_write(h.body,
+                       "--XyZ\r\ncontent-disposition: form-data; "
+                       "name=\"a\"\r\n\r\nhello\r\n--XyZ\r\ncontent-"
+                       "disposition: form-data; name=\"f\"; "
+                       "filename=\"x.txt\"\r\ncontent-type: text/plain\r\n\r\n",
+                       153);
+      fio_str_info_s tmp = fiobj_obj2cstr(file);
+      fiobj_data_write(h.body, tmp.data, tmp.len);
+      fiobj_data_write(h.body,
+                       "\r\n--XyZ\r\ncontent-disposition: form-data; "
+                       "name=\"b\"\r\n\r\n\r\n--XyZ--\r\n",
+                       64);
+      if (on_disk) {
+        /* a slice, so the parts' offsets are relative to the file */
+        FIOBJ slice = fiobj_data_slice(h.body, 8, fiobj_data_len(h.body) - 8);
+        fiobj_free(h.body);
+        h.body = slice;
+      }
+      FIOBJ out = fiobj_str_buf(0);
+      int count =
+          http_multipart_each(&h, http_multipart_test_each, (void *)out);
+      FIO_ASSERT(count == 3, "http_multipart_each part count error (%d)",
+                 count);
+      FIO_ASSERT(fiobj_iseq(out, expected),
+                 "http_multipart_each data error (%s)",
+                 (on_disk ? "file" : "memory"));
+      FIO_ASSERT(!h.params, "http_multipart_each shouldn't set params");
+      fiobj_free(out);
+      fiobj_free(h.body);
+      h.body = FIOBJ_INVALID;
+    }
+    fiobj_free(expected);
+    fiobj_free(file);
+    http_s_destroy(&h, 0);
+  }
+
+  fprintf(stderr, "=== Testing HTTP router\n");
+  {
+    struct {
+      const char *method;
+      const char *pattern;
+    } routes[] = {
+        {"GET", "/"},
+        {"GET", "/users"},
+        {"GET", "/users/new"},
+        {"GET", "/users/:id"},
+        {"POST", "/users/:id"},
+        {"GET", "/users/:id/posts/:post"},
+        {"GET", "/a/b/c"},
+        {"GET", "/a/b/c/d"},
+        {NULL, "/files/*path"},
+        {"GET", "/users/:id/*rest"},
+    };
+    struct {
+      const char *method;
+      const char *path;
+      const char *expected; /* NULL when the route shouldn't match */
+    } tests[] = {
+        {"GET", "/", "GET /"},
+        {"GET", "/users/", "GET /users"},
+        {"HEAD", "/users", "GET /users"},
+        {"GET", "/users/new", "GET /users/new"},
+        {"GET", "/users/42", "GET /users/:id id=42"},
+        {"POST", "/users/42", "POST /users/:id id=42"},
+        {"GET", "/users/42/posts/7", "GET /users/:id/posts/:post id=42 post=7"},
+        {"GET", "/users/42/other/x",
+         "GET /users/:id/*rest id=42 rest=other/x"},
+        {"GET", "/a/b/c", "GET /a/b/c"},
+        {"GET", "/a/b/c/d", "GET /a/b/c/d"},
+        {"GET", "/a/b", NULL},
+        {"DELETE", "/files/x/y.txt", "(null) /files/*path path=x/y.txt"},
+        {"GET", "/files/", "(null) /files/*path path="},
+        {"GET", "/nothing", NULL},
+    };
+    http_router_s *router = http_router_new();
+    char names[sizeof(routes) / sizeof(routes[0])][64];
+    for (size_t i = 0; i < sizeof(routes) / sizeof(routes[0]); ++i) {
+      snprintf(names[i], 64, "%s %s",
+               (routes[i].method ? routes[i].method : "(null)"),
+               routes[i].pattern);
+      FIO_ASSERT(!http_router_add(router, routes[i].method, routes[i].pattern,
+                                  http_router_test_handler, names[i]),
+                 "http_router_add failed for %s", names[i]);
+    }
+    FIO_ASSERT(http_router_add(router, "GET", "/users/:id",
+                               http_router_test_handler, NULL) == -1,
+               "http_router_add should refuse duplicate routes");
+    FIO_ASSERT(!http_router_freeze(router), "http_router_freeze failed");
+    FIO_ASSERT(http_router_add(router, "GET", "/late",
+                               http_router_test_handler, NULL) == -1,
+               "http_router_add should fail once the router is frozen");
+    for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); ++i) {
+      http_s h;
+      http_s_new(&h, NULL, NULL);
+      h.method = fiobj_str_new(tests[i].method, strlen(tests[i].method));
+      h.path = fiobj_str_new(tests[i].path, strlen(tests[i].path));
+      FIOBJ out = fiobj_str_buf(0);
+      h.udata = (void *)out;
+      int ret = http_router_route(router, &h);
+      if (tests[i].expected) {
+        FIO_ASSERT(!ret && fiobj_obj2cstr(out).len &&
+                       !strcmp(fiobj_obj2cstr(out).data, tests[i].expected),
+                   "router error for %s %s:\n\texpected: %s\n\tgot: %s",
+                   tests[i].method, tests[i].path, tests[i].expected,
+                   fiobj_obj2cstr(out).data);
+      } else {
+        FIO_ASSERT(ret == -1 && !fiobj_obj2cstr(out).len,
+                   "router shouldn't match %s %s", tests[i].method,
+                   tests[i].path);
+      }
+      fiobj_free(out);
+      http_s_destroy(&h, 0);
+    }
+    http_router_free(router);
+  }
+
+  fprintf(stderr, "=== Testing HTTP access log\n");
+  {
+    char name[] = "/tmp/fio_http_log_test_XXXXXX";
+    int fd = mkstemp(name);
+    FIO_ASSERT(fd != -1, "couldn't create temporary log file");
+    FIO_ASSERT(!http_log_open(.target = name), "http_log_open failed");
+    http_log_write("hello", 5);
+    http_log_write("world\n", 6);
+    http_log_flush();
+    char buf[32];
+    ssize_t r = pread(fd, buf, 32, 0);
+    FIO_ASSERT(r == 12 && !memcmp(buf, "hello\nworld\n", 12),
+               "access log content error (%zd bytes)", r);
+    char line[1000];
+    memset(line, 'x', 999);
+    line[999] = '\n';
+    size_t dropped = http_log_dropped();
+    size_t accepted = 0;
+    for (size_t i = 0; i < (HTTP_LOG_BUFFER_SIZE / 1000) + 4; ++i) {
+      size_t before = http_log_dropped();
+      http_log_write(line, 1000);
+      accepted += (before == http_log_dropped());
+    }
+    FIO_ASSERT(accepted == HTTP_LOG_BUFFER_SIZE / 1000 &&
+                   http_log_dropped() == dropped + 4,
+               "access log should drop lines when full (%zu accepted)",
+               accepted);
+    http_log_flush();
+    struct stat st;
+    FIO_ASSERT(!fstat(fd, &st) && (size_t)st.st_size == 12 + accepted * 1000,
+               "access log flush error (%zu bytes)", (size_t)st.st_size);
+    http_log_write(line, 1000);
+    FIO_ASSERT(http_log_dropped() == dropped + 4,
+               "access log should accept lines after a flush");
+    FIO_ASSERT(!http_log_open(.target = NULL), "http_log_open failed");
+    FIO_ASSERT(!fstat(fd, &st) && (size_t)st.st_size == 1012 + accepted * 1000,
+               "access log should be flushed when replaced");
+    close(fd);
+    unlink(name);
+  }
+
+  fprintf(stderr, "=== Testing HTTP lazy query and cookie access\n");
+  {
+    http_s h;
+    http_s_new(&h, NULL, NULL);
+    const char *query = "a=1&amp;b%20c=x+y%21&flag&&d=&a=2";
+    h.query = fiobj_str_new(query, strlen(query));
+    FIOBJ cookie = fiobj_str_new("sid=abc; theme=dark", 19);
+    fiobj_hash_set(h.headers, HTTP_HEADER_COOKIE, cookie);
+    FIOBJ set_cookie = fiobj_str_new("lang=en; Path=/; HttpOnly", 25);
+    fiobj_hash_set(h.headers, HTTP_HEADER_SET_COOKIE, set_cookie);
+
+    fio_str_info_s val = http_query_get(&h, "a", 1);
+    FIO_ASSERT(val.len == 1 && val.data[0] == '1', "http_query_get error");
+    val = http_query_get(&h, "b c", 3);
+    char buf[16];
+    FIO_ASSERT(val.len == 6 && http_decode_param(buf, sizeof(buf), val) == 4 &&
+                   !strcmp(buf, "x y!"),
+               "http_query_get / http_decode_param error (encoded)");
+    FIO_ASSERT(http_decode_param(buf, 4, val) == -1,
+               "http_decode_param should fail when the buffer is too small");
+    FIO_ASSERT(http_decode_param(buf, sizeof(buf),
+                                 (fio_str_info_s){.data = "a%2", .len = 3}) ==
+                   -1,
+               "http_decode_param should fail on a truncated escape");
+    val = http_query_get(&h, "flag", 4);
+    FIO_ASSERT(val.data && !val.len, "http_query_get error (no value)");
+    FIO_ASSERT(!http_query_get(&h, "missing", 7).data,
+               "http_query_get should return NULL for missing parameters");
+    FIOBJ out = fiobj_str_buf(0);
+    FIO_ASSERT(http_query_each(&h, http_param_test_task, (void *)out) == 5 &&
+                   !strcmp(fiobj_obj2cstr(out).data,
+                           "a:1,b%20c:x+y%21,flag:,d:,a:2,"),
+               "http_query_each error: %s", fiobj_obj2cstr(out).data);
+
+    val = http_cookie_get(&h, "theme", 5);
+    FIO_ASSERT(val.len == 4 && !memcmp(val.data, "dark", 4),
+               "http_cookie_get error");
+    val = http_cookie_get(&h, "lang", 4);
+    FIO_ASSERT(val.len == 2 && !memcmp(val.data, "en", 2),
+               "http_cookie_get error (Set-Cookie)");
+    FIO_ASSERT(!http_cookie_get(&h, "Path", 4).data,
+               "http_cookie_get shouldn't return Set-Cookie attributes");
+    fiobj_str_resize(out, 0);
+    FIO_ASSERT(http_cookie_each(&h, http_param_test_task, (void *)out) == 3 &&
+                   !strcmp(fiobj_obj2cstr(out).data,
+                           "sid:abc,theme:dark,lang:en,"),
+               "http_cookie_each error: %s", fiobj_obj2cstr(out).data);
+    fiobj_free(out);
+    http_s_destroy(&h, 0);
+  }
+
+  fprintf(stderr, "=== Testing HTTP response cache\n");
+  {
+    static http_vtable_s vtable = {.http_send_body = http_cache_test_send,
+                                   .http_finish = http_cache_test_finish};
+    http_cache_s *c = http_cache_new(
+        (sizeof(uint64_t) * 8 + HTTP_CACHE_ENTRY_SIZE) * 4, "x-lang", 0);
+    FIO_ASSERT(c, "http_cache_new failed");
+    FIOBJ out = fiobj_str_buf(0);
+    FIOBJ etag = fiobj_str_new("\"v1\"", 4);
+    const char *paths[] = {"/a", "/b", "/a", "/c", "/d", "/e", "/f", "/a"};
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); ++i) {
+      http_s h;
+      http_s_new(&h, NULL, &vtable);
+      h.udata = (void *)out;
+      h.method = fiobj_str_new("GET", 3);
+      h.path = fiobj_str_new(paths[i], 2);
+      fiobj_str_resize(out, 0);
+      if (http_cache_serve(c, &h)) {
+        h.status = 200;
+        http_set_header(&h, HTTP_HEADER_CACHE_CONTROL,
+                        fiobj_str_new("max-age=60", 10));
+        http_set_header(&h, HTTP_HEADER_ETAG, fiobj_dup(etag));
+        http_cache_store(c, &h, (void *)paths[i], 2);
+      } else {
+        FIO_ASSERT(!strcmp(fiobj_obj2cstr(out).data, paths[i]),
+                   "cached response body error");
+        FIO_ASSERT(fiobj_hash_get2(h.private_data.out_headers,
+                                   fiobj_obj2hash(HTTP_HEADER_ETAG)),
+                   "cached response headers missing");
+      }
+      http_s_destroy(&h, 0);
+    }
+    size_t hits, misses;
+    http_cache_stats(c, &hits, &misses);
+    /* "/a" is referenced, so it outlives "/b", "/c", "/d" and "/e" */
+    FIO_ASSERT(hits == 2 && misses == 6,
+               "response cache hit / miss count error (%zu / %zu)", hits,
+               misses);
+    /* conditional requests, bypassing the cache and vary headers */
+    FIOBJ names[3] = {fiobj_str_new("if-none-match", 13),
+                      fiobj_dup(HTTP_HEADER_CACHE_CONTROL),
+                      fiobj_str_new("x-lang", 6)};
+    FIOBJ values[3] = {fiobj_dup(etag), fiobj_str_new("no-cache", 8),
+                       fiobj_str_new("fr", 2)};
+    for (size_t i = 0; i < 3; ++i) {
+      http_s h;
+      http_s_new(&h, NULL, &vtable);
+      h.udata = (void *)out;
+      h.method = fiobj_str_new("GET", 3);
+      h.path = fiobj_str_new("/a", 2);
+      fiobj_hash_set(h.headers, names[i], values[i]);
+      fiobj_free(names[i]);
+      fiobj_str_resize(out, 0);
+      int ret = http_cache_serve(c, &h);
+      if (!i) {
+        FIO_ASSERT(!ret && !strcmp(fiobj_obj2cstr(out).data, "304"),
+                   "response cache should honor If-None-Match");
+      } else {
+        FIO_ASSERT(ret, "response cache should be bypassed (%s)",
+                   i == 1 ? "no-cache" : "vary");
+      }
+      http_s_destroy(&h, 0);
+    }
+    /* name based virtual hosts don't share responses */
+    const char *hosts[] = {"a.example", "b.example", "A.Example"};
+    for (size_t i = 0; i < 3; ++i) {
+      http_s h;
+      http_s_new(&h, NULL, &vtable);
+      h.udata = (void *)out;
+      h.method = fiobj_str_new("GET", 3);
+      h.path = fiobj_str_new("/h", 2);
+      fiobj_hash_set(h.headers, HTTP_HEADER_HOST, fiobj_str_new(hosts[i], 9));
+      fiobj_str_resize(out, 0);
+      int ret = http_cache_serve(c, &h);
+      if (i == 2) {
+        FIO_ASSERT(!ret && !strcmp(fiobj_obj2cstr(out).data, hosts[0]),
+                   "response cache hosts should be case insensitive");
+      } else {
+        FIO_ASSERT(ret, "response cache shared a response between hosts");
+        h.status = 200;
+        http_set_header(&h, HTTP_HEADER_CACHE_CONTROL,
+                        fiobj_str_new("max-age=60", 10));
+        http_cache_store(c, &h, (void *)hosts[i], 9);
+      }
+      http_s_destroy(&h, 0);
+    }
+    /* a writer that died while holding the lock doesn't block the others */
+    {
+      pid_t dead = fork();
+      FIO_ASSERT(dead != -1, "fork failed");
+      if (!dead) {
+        http_cache_test_abandon(c);
+        _exit(0);
+      }
+      waitpid(dead, NULL, 0);
+      for (size_t i = 0; i < 2; ++i) {
+        http_s h;
+        http_s_new(&h, NULL, &vtable);
+        h.udata = (void *)out;
+        h.method = fiobj_str_new("GET", 3);
+        h.path = fiobj_str_new("/r", 2);
+        fiobj_str_resize(out, 0);
+        if (!i) {
+          h.status = 200;
+          http_set_header(&h, HTTP_HEADER_CACHE_CONTROL,
+                          fiobj_str_new("max-age=60", 10));
+          http_cache_store(c, &h, (void *)"/r", 2);
+        } else {
+          FIO_ASSERT(!http_cache_serve(c, &h) &&
+                         !strcmp(fiobj_obj2cstr(out).data, "/r"),
+                     "response cache lock wasn't recovered");
+        }
+        http_s_destroy(&h, 0);
+      }
+    }
+    fiobj_free(etag);
+    fiobj_free(out);
+    http_cache_free(c);
+  }
+  fprintf(stderr, "=== Testing HTTP request timing\n");
+  {
+    /* 90 fast handlers (~100us) and 10 slow ones (~10ms), flush unknown */
+    for (size_t i = 0; i < 100; ++i) {
+      uint64_t phases[HTTP_TIMING_PHASES] = {
+          [HTTP_TIMING_HEADERS] = 3,
+          [HTTP_TIMING_BODY] = 0,
+          [HTTP_TIMING_HANDLER] = (i < 90 ? 100 : 10000),
+          [HTTP_TIMING_FLUSH] = UINT64_MAX,
+          [HTTP_TIMING_TOTAL] = (i < 90 ? 103 : 10003),
+      };
+      http_timing_record("GET /test/timing", phases);
+    }
+    FIOBJ report = http_timing_report();
+    FIOBJ key = fiobj_str_new("GET /test/timing", 16);
+    FIOBJ entry = fiobj_hash_get(report, key);
+    fiobj_free(key);
+    FIO_ASSERT(entry && FIOBJ_TYPE_IS(entry, FIOBJ_T_HASH),
+               "timing report should include the label");
+    key = fiobj_str_new("flush", 5);
+    FIO_ASSERT(!fiobj_hash_get(entry, key),
+               "unknown phases shouldn't be recorded");
+    fiobj_free(key);
+    key = fiobj_str_new("handler", 7);
+    FIOBJ handler = fiobj_hash_get(entry, key);
+    fiobj_free(key);
+    FIO_ASSERT(handler, "timing report should include the handler phase");
+    const struct {
+      const char *name;
+      intptr_t expected;
+    } fields[] = {{"count", 100}, {"mean", 1090}, {"p50", 127},
+                  {"p90", 127},   {"p99", 10000}, {"max", 10000}};
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); ++i) {
+      key = fiobj_str_new(fields[i].name, strlen(fields[i].name));
+      FIOBJ val = fiobj_hash_get(handler, key);
+      fiobj_free(key);
+      FIO_ASSERT(val && fiobj_obj2num(val) == fields[i].expected,
+                 "timing report %s should be %ld (%ld)", fields[i].name,
+                 (long)fields[i].expected, (long)fiobj_obj2num(val));
+    }
+    fiobj_free(report);
+    http_timing_reset();
+    report = http_timing_report();
+    key = fiobj_str_new("GET /test/timing", 16);
+    FIO_ASSERT(!fiobj_hash_count(fiobj_hash_get(report, key)),
+               "http_timing_reset should clear the histograms");
+    fiobj_free(key);
+    fiobj_free(report);
+  }
+  fprintf(stderr, "=== Testing HTTP SSE broadcast encoding\n");
+  {
+    fio_msg_metadata_s meta = http_sse_optimize(
+        (fio_str_info_s){.data = (char *)"ch", .len = 2},
+        (fio_str_info_s){.data = (char *)"a\r\nb\nc", .len = 6}, 0);
+    FIO_ASSERT(meta.type_id == HTTP_SSE_OPTIMIZE_PUBSUB && meta.metadata &&
+                   !strcmp(fiobj_obj2cstr((FIOBJ)meta.metadata).data,
+                           "data: a\r\ndata: b\r\ndata: c\r\n\r\n"),
+               "SSE broadcast event encoding error");
+    meta.on_finish(NULL, meta.metadata);
+  }
+  fprintf(stderr, "=== Testing HTTP/1.1 request body streaming\n");
+  {
+    static const struct {
+      /* the request is sent in parts */
+      const char *parts[3];
+      /* the recorded events */
+      const char *events;
+      /* the start of the response */
+      const char *response;
+    } cases[] = {
+        /* chunks are delivered as they arrive */
+        {{"POST / HTTP/1.1\r\nHost: a\r\nContent-Length: 10\r\n\r\n01234",
+          "567", "89"},
+         "01234|567|89|request",
+         "HTTP/1.1 200"},
+        {{"POST / HTTP/1.1\r\nHost: a\r\nTransfer-Encoding: chunked\r\n\r\n"
+          "3\r\nabc\r\n",
+          "2\r\nde\r\n0\r\n\r\n"},
+         "abc|de|request",
+         "HTTP/1.1 200"},
+        /* a body that exceeds the limit is rejected before it's delivered */
+        {{"POST / HTTP/1.1\r\nHost: a\r\nContent-Length: 30\r\n\r\n01234"},
+         "",
+         "HTTP/1.1 413"},
+        /* a chunked body that exceeds the limit is released (NULL) */
+        {{"POST / HTTP/1.1\r\nHost: a\r\nTransfer-Encoding: chunked\r\n\r\n"
+          "f\r\n0123456789abcde\r\n",
+          "a\r\n0123456789\r\n0\r\n\r\n"},
+         "0123456789abcde|NULL",
+         "HTTP/1.1 413"},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+      http_settings_s *settings = http_settings_new((http_settings_s){
+          .on_request = http_body_chunk_test_request,
+          .on_body_chunk = http_body_chunk_test,
+          .max_body_size = 20,
+      });
+      int peer = http_test_open(settings);
+      FIOBJ response = fiobj_str_buf(0);
+      for (size_t j = 0; j < 3 && cases[i].parts[j]; ++j)
+        http_test_send(peer, cases[i].parts[j]);
+      http_test_read(peer, response);
+      FIOBJ events = http_test_events();
+      FIO_ASSERT(!strcmp(fiobj_obj2cstr(events).data, cases[i].events),
+                 "on_body_chunk error (%zu): %s", i,
+                 fiobj_obj2cstr(events).data);
+      FIO_ASSERT(!strncmp(fiobj_obj2cstr(response).data, cases[i].response,
+                          strlen(cases[i].response)),
+                 "on_body_chunk response error (%zu): %s", i,
+                 fiobj_obj2cstr(response).data);
+      fiobj_free(events);
+      fiobj_free(response);
+      http_test_close(peer);
+      http_settings_free(settings);
+    }
+  }
+  fprintf(stderr, "=== Testing HTTP/1.1 pipelining\n");
+  {
+    http_settings_s *settings =
+        http_settings_new((http_settings_s){
+            .on_request = http_pipeline_test_request, .pipeline_depth = 2});
+    int peer = http_test_open(settings);
+    FIOBJ response = fiobj_str_buf(0);
+    /* the client isn't reading, so the responses stay in the queue */
+    int buffer_size = 4096;
+    setsockopt(fio_uuid2fd(http_test_uuid), SOL_SOCKET, SO_SNDBUF, &buffer_size,
+               sizeof(buffer_size));
+    setsockopt(peer, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    char *blocker = malloc(1 << 16);
+    FIO_ASSERT_ALLOC(blocker);
+    memset(blocker, 'x', 1 << 16);
+    fio_write(http_test_uuid, blocker, 1 << 16);
+    free(blocker);
+    http_test_send(peer, "GET /1 HTTP/1.1\r\nHost: a\r\n\r\n"
+                         "GET /2 HTTP/1.1\r\nHost: a\r\n\r\n"
+                         "GET /3 HTTP/1.1\r\nHost: a\r\n\r\n"
+                         "GET /4 HTTP/1.1\r\nHost: a\r\n\r\n"
+                         "GET /5 HTTP/1.1\r\nHost: a\r\n\r\n");
+    /* two requests are handled per read event (the rest wait for the next
+     * event) and their responses are coalesced into a single packet */
+    FIOBJ events = http_test_events();
+    FIO_ASSERT(!strcmp(fiobj_obj2cstr(events).data,
+                       "/1:1|/2:1|/3:2|/4:2|/5:3"),
+               "HTTP pipelining error: %s", fiobj_obj2cstr(events).data);
+    fiobj_free(events);
+    for (size_t i = 0; i < 4096; ++i) {
+      fio_str_info_s r = fiobj_obj2cstr(response);
+      if (r.len > 2 && r.data[r.len - 1] == '5' && r.data[r.len - 2] == '/')
+        break;
+      http_test_read(peer, response);
+    }
+    /* the responses are sent in order */
+    fio_str_info_s r = fiobj_obj2cstr(response);
+    char *pos = strstr(r.data, "HTTP/1.1");
+    FIO_ASSERT(pos && pos == r.data + (1 << 16),
+               "pipelined responses should follow the queued data");
+    for (size_t i = 1; i <= 5; ++i) {
+      char expected[8];
+      snprintf(expected, sizeof(expected), "\r\n\r\n/%zu", i);
+      pos = strstr(pos, expected);
+      FIO_ASSERT(pos && !strncmp(pos, "\r\n\r\n", 4) &&
+                     (!pos[6] || !strncmp(pos + 6, "HTTP/1.1 200", 12)),
+                 "pipelined response %zu missing or out of order: %s", i,
+                 r.data);
+      pos += 6;
+    }
+    fiobj_free(response);
+    http_test_close(peer);
+    http_settings_free(settings);
+  }
+  fprintf(stderr, "=== Testing HTTP/1.1 response streaming\n");
+  {
+    static const struct {
+      const char *request;
+      /* the response body, after the headers */
+      const char *body;
+      /* the connection closes after HTTP/1.0 streams */
+      uint8_t closed;
+    } cases[] = {
+        {"GET / HTTP/1.1\r\nHost: a\r\n\r\n",
+         "5\r\nHello\r\n7\r\nWorld!!\r\n0\r\nx-total:12\r\n\r\n", 0},
+        /* a Content-Length disables the chunked encoding (and trailers) */
+        {"GET /l HTTP/1.1\r\nHost: a\r\n\r\n", "HelloWorld!!", 0},
+        {"GET / HTTP/1.0\r\nHost: a\r\n\r\n", "HelloWorld!!", 1},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+      http_settings_s *settings = http_settings_new(
+          (http_settings_s){.on_request = http_stream_test_request});
+      int peer = http_test_open(settings);
+      FIOBJ response = fiobj_str_buf(0);
+      http_test_send(peer, cases[i].request);
+      int closed = http_test_read(peer, response);
+      fio_str_info_s r = fiobj_obj2cstr(response);
+      char *body = strstr(r.data, "\r\n\r\n");
+      FIO_ASSERT(body && !strcmp(body + 4, cases[i].body) &&
+                     !fiobj_ary_count(http_test_log),
+                 "HTTP stream error (%zu): %s", i, r.data);
+      FIO_ASSERT(!!strstr(r.data, "transfer-encoding:chunked") == !i,
+                 "HTTP stream encoding error (%zu): %s", i, r.data);
+      FIO_ASSERT((closed == -1) == cases[i].closed,
+                 "HTTP/1.0 streams should close the connection (%zu)", i);
+      fiobj_free(response);
+      http_test_close(peer);
+      http_settings_free(settings);
+    }
+#if HAVE_ZLIB
+    /* streams are compressed (and flushed) chunk by chunk */
+    {
+      http_settings_s *settings =
+          http_settings_new((http_settings_s){
+              .on_request = http_stream_test_compressed,
+              .compress_threshold = 1});
+      int peer = http_test_open(settings);
+      FIOBJ response = fiobj_str_buf(0);
+      http_test_send(peer, "GET / HTTP/1.1\r\nHost: a\r\n"
+                           "Accept-Encoding: gzip\r\n\r\n");
+      http_test_read(peer, response);
+      fio_str_info_s r = fiobj_obj2cstr(response);
+      char *pos = strstr(r.data, "\r\n\r\n");
+      FIO_ASSERT(pos && strstr(r.data, "content-encoding:gzip") &&
+                     strstr(r.data, "transfer-encoding:chunked"),
+                 "HTTP streams should be compressed: %s", r.data);
+      FIOBJ compressed = fiobj_str_buf(0);
+      size_t chunks = 0;
+      for (pos += 4;;) {
+        char *end;
+        size_t len = strtoul(pos, &end, 16);
+        FIO_ASSERT(end[0] == '\r' && end[1] == '\n' &&
+                       end + 4 + len <= r.data + r.len,
+                   "compressed HTTP stream chunk error");
+        pos = end + 2;
+        if (!len)
+          break;
+        fiobj_str_write(compressed, pos, len);
+        pos += len + 2;
+        ++chunks;
+      }
+      char out[64];
+      z_stream z;
+      memset(&z, 0, sizeof(z));
+      FIO_ASSERT(inflateInit2(&z, 15 + 16) == Z_OK,
+                 "couldn't initialize the test's decompression");
+      z.next_in = (Bytef *)fiobj_obj2cstr(compressed).data;
+      z.avail_in = (uInt)fiobj_obj2cstr(compressed).len;
+      z.next_out = (Bytef *)out;
+      z.avail_out = sizeof(out);
+      int zr = inflate(&z, Z_FINISH);
+      FIO_ASSERT(zr == Z_STREAM_END && z.total_out == 11 &&
+                     !memcmp(out, "Hello World", 11) && chunks == 3 &&
+                     pos + 2 == r.data + r.len,
+                 "compressed HTTP stream error (%d, %zu chunks)", zr, chunks);
+      inflateEnd(&z);
+      fiobj_free(compressed);
+      fiobj_free(response);
+      http_test_close(peer);
+      http_settings_free(settings);
+    }
+#endif
+    /* a client that falls behind reports backpressure, the stream continues
+     * once the client caught up */
+    http_settings_s *settings = http_settings_new(
+        (http_settings_s){.on_request = http_stream_test_backpressure});
+    int peer = http_test_open(settings);
+    int buffer_size = 4096;
+    setsockopt(fio_uuid2fd(http_test_uuid), SOL_SOCKET, SO_SNDBUF, &buffer_size,
+               sizeof(buffer_size));
+    setsockopt(peer, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    http_test_send(peer, "GET / HTTP/1.1\r\nHost: a\r\n\r\n");
+    FIOBJ events = http_test_events();
+    FIO_ASSERT(!strcmp(fiobj_obj2cstr(events).data, "backpressure"),
+               "HTTP stream backpressure error: %s",
+               fiobj_obj2cstr(events).data);
+    fiobj_free(events);
+    FIOBJ response = fiobj_str_buf(0);
+    for (size_t i = 0; i < 4096; ++i) {
+      fio_str_info_s r = fiobj_obj2cstr(response);
+      if (r.len >= 7 && !memcmp(r.data + r.len - 7, "\r\n0\r\n\r\n", 7))
+        break;
+      http_test_read(peer, response);
+    }
+    events = http_test_events();
+    fio_str_info_s r = fiobj_obj2cstr(response);
+    FIO_ASSERT(!strcmp(fiobj_obj2cstr(events).data, "backpressure|ready") &&
+                   r.len > 13 &&
+                   !memcmp(r.data + r.len - 14, "4\r\ndone\r\n0\r\n\r\n", 14),
+               "HTTP stream on_ready error: %s", fiobj_obj2cstr(events).data);
+    fiobj_free(events);
+    fiobj_free(response);
+    http_test_close(peer);
+    http_settings_free(settings);
+  }
+#if HAVE_ZLIB
+  fprintf(stderr, "=== Testing WebSocket permessage-deflate negotiation\n");
+  {
+    const struct {
+      const char *offer;
+      uint8_t window;
+      uint8_t no_context;
+      const char *response;
+    } cases[] = {
+        {"permessage-deflate; client_max_window_bits", 15, 0,
+         "permessage-deflate"},
+        {"x-webkit-deflate-frame, permessage-deflate", 10, 0,
+         "permessage-deflate; server_max_window_bits=10"},
+        {"permessage-deflate; server_max_window_bits=12", 15, 1,
+         "permessage-deflate; server_no_context_takeover; "
+         "server_max_window_bits=12"},
+        {"permessage-deflate; server_max_window_bits=15", 15, 0,
+         "permessage-deflate; server_max_window_bits=15"},
+        {"permessage-deflate; server_max_window_bits=8", 15, 0, NULL},
+        {"permessage-deflate; foo", 15, 0, NULL},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+      http_settings_s settings = {.ws_compress = 1,
+                                  .ws_compress_window = cases[i].window,
+                                  .ws_compress_no_context =
+                                      cases[i].no_context};
+      http_s h;
+      http_s_new(&h, NULL, NULL);
+      h.method = fiobj_str_new("GET", 3);
+      FIOBJ name = fiobj_str_new("sec-websocket-extensions", 24);
+      fiobj_hash_set(h.headers, name,
+                     fiobj_str_new(cases[i].offer, strlen(cases[i].offer)));
+      uint8_t config = websocket_deflate_negotiate(&h, &settings);
+      FIOBJ response = fiobj_hash_get(h.private_data.out_headers, name);
+      fiobj_free(name);
+      if (!cases[i].response) {
+        FIO_ASSERT(!config && !response,
+                   "permessage-deflate offer should be declined: %s",
+                   cases[i].offer);
+      } else {
+        FIO_ASSERT(config && response &&
+                       !strcmp(fiobj_obj2cstr(response).data,
+                               cases[i].response),
+                   "permessage-deflate negotiation error: %s",
+                   cases[i].offer);
+      }
+      http_s_destroy(&h, 0);
+    }
+  }
+#endif
+  websocket_tests();
+  http_client_tests();
 }
 #endif
@@ -42,6 +42,70 @@ Compile Time Settings
 #define HTTP_MAX_HEADER_LENGTH 8192
 #endif
 
+#ifndef HTTP_STREAM_PENDING_LIMIT
+/**
+ * `http_stream_write` reports backpressure once more than this number of
+ * packets are waiting in the connection's outgoing queue.
+ */
+#define HTTP_STREAM_PENDING_LIMIT 16
+#endif
+
+#ifndef HTTP_STATIC_CACHE_LIMIT
+/**
+ * The maximum number of files cached by `http_sendfile2` (per process).
+ *
+ * The static file cache keeps cached files open and pre-renders their headers.
+ * Set to 0 to disable the cache.
+ */
+#define HTTP_STATIC_CACHE_LIMIT 512
+#endif
+
+#ifndef HTTP_STATIC_CACHE_MISSING_LIMIT
+/**
+ * The maximum number of missing files remembered by the static file cache (per
+ * process).
+ *
+ * Missing files are remembered separately, so requests for files that don't
+ * exist can't evict the files cached under `HTTP_STATIC_CACHE_LIMIT`.
+ */
+#define HTTP_STATIC_CACHE_MISSING_LIMIT 64
+#endif
+
+#ifndef HTTP_STATIC_CACHE_BODY_LIMIT
+/** Files up to this size are cached in memory rather than kept open. */
+#define HTTP_STATIC_CACHE_BODY_LIMIT 16384
+#endif
+
+#ifndef HTTP_STATIC_CACHE_MEMORY_LIMIT
+/** The maximum number of bytes the static file cache may use (per process). */
+#define HTTP_STATIC_CACHE_MEMORY_LIMIT (1024 * 1024 * 16)
+#endif
+
+#ifndef HTTP_STATIC_CACHE_VALIDATE
+/**
+ * Cached files are invalidated using `inotify` (on Linux, while the reactor is
+ * running). Otherwise, cached files are validated once every
+ * `HTTP_STATIC_CACHE_VALIDATE` seconds.
+ */
+#define HTTP_STATIC_CACHE_VALIDATE 1
+#endif
+
+#ifndef HTTP_CACHE_ENTRY_SIZE
+/**
+ * The size of each response cache entry (see `cache_size`), limiting the size
+ * of cached responses (the key, headers and body).
+ */
+#define HTTP_CACHE_ENTRY_SIZE 16384
+#endif
+
+#ifndef HTTP_MULTIPART_EACH_BUFFER
+/**
+ * The read buffer used by `http_multipart_each` for bodies stored in a
+ * temporary file. Each part's headers must fit in the buffer.
+ */
+#define HTTP_MULTIPART_EACH_BUFFER 65536
+#endif
+
 #ifndef FIO_HTTP_EXACT_LOGGING
 /**
  * By default, facil.io logs the HTTP request cycle using a fuzzy starting point
@@ -61,6 +125,9 @@ Compile Time Settings
 /** the `http_listen settings, see details in the struct definition. */
 typedef struct http_settings_s http_settings_s;
 
+/** a request router, see `http_router.h` for details. */
+typedef struct http_router_s http_router_s;
+
 /* *****************************************************************************
 The Request / Response type and functions
 ***************************************************************************** */
@@ -216,6 +283,9 @@ int http_sendfile(http_s *h, int fd, uintptr_t length, uintptr_t offset);
  * The `encoded` string will be URL decoded while the `local` string will used
  * as is.
  *
+ * File data (open file descriptors, small files and pre-rendered headers) is
+ * cached, see `HTTP_STATIC_CACHE_LIMIT`.
+ *
  * Returns 0 on success. A success value WILL CONSUME the `http_s` handle (it
  * will become invalid).
  *
@@ -224,6 +294,15 @@ int http_sendfile(http_s *h, int fd, uintptr_t length, uintptr_t offset);
 int http_sendfile2(http_s *h, const char *prefix, size_t prefix_len,
                    const char *encoded, size_t encoded_len);
 
+/**
+ * Clears the static file cache used by `http_sendfile2`, closing any cached
+ * file descriptors.
+ *
+ * The cache is invalidated automatically when files change, this is only
+ * required when the automatic invalidation is unavailable.
+ */
+void http_static_cache_clear(void);
+
 /**
  * Sends an HTTP error response.
  *
@@ -243,6 +322,58 @@ int http_send_error(http_s *h, size_t error_code);
  */
 void http_finish(http_s *h);
 
+/**
+ * Streams a chunk of the response body, sending the response headers first (if
+ * they weren't sent yet). The `http_s` handle remains valid until the stream
+ * is completed using `http_stream_finish` (or `http_finish`).
+ *
+ * HTTP/1.1 responses use `Transfer-Encoding: chunked`, unless a Content-Length
+ * header was set. HTTP/1.0 responses are streamed as is and the connection
+ * closes once the stream is complete. Streams are compressed when
+ * `compress_threshold` is set (and no Content-Length header was set).
+ *
+ * The stream can be continued after `on_request` returns, using `http_pause`
+ * and `http_resume` tasks (`http_resume` tasks should keep writing or finish
+ * the stream). Until the stream is complete, no pipelined requests are
+ * handled.
+ *
+ * Returns -1 on error and 0 on success.
+ *
+ * Returns 1 if the data was queued but the client isn't reading fast enough
+ * (see `HTTP_STREAM_PENDING_LIMIT`). The data isn't lost, but the caller should
+ * stop writing and use `http_stream_on_ready` to continue the stream once the
+ * client caught up (nothing is called otherwise).
+ */
+int http_stream_write(http_s *h, void *data, uintptr_t length);
+
+/**
+ * Calls `on_ready` (once) after the connection's outgoing queue was drained, so
+ * a stream can continue after `http_stream_write` returned 1.
+ *
+ * `on_ready` is called as a connection task, so it never runs concurrently
+ * with `on_request` or `http_resume` tasks, and it should keep writing or
+ * finish the stream. If the queue was already drained, `on_ready` is called
+ * as soon as the current task returns.
+ *
+ * If the connection is lost first, `on_ready` isn't called and the `http_s`
+ * handle is freed with the connection.
+ *
+ * Returns -1 on error (i.e., the stream wasn't started) and 0 on success.
+ */
+int http_stream_on_ready(http_s *h, void (*on_ready)(http_s *h));
+
+/**
+ * Completes a streamed response, sending the (optional) `trailers` (a Hash of
+ * header names and values) when the `chunked` encoding is used.
+ *
+ * The `trailers` Hash isn't freed.
+ *
+ * Returns -1 on error and 0 on success.
+ *
+ * AFTER THIS FUNCTION IS CALLED, THE `http_s` OBJECT IS NO LONGER VALID.
+ */
+int http_stream_finish(http_s *h, FIOBJ trailers);
+
 /**
  * Pushes a data response when supported (HTTP/2 only).
  *
@@ -310,6 +441,23 @@ void *http_paused_udata_get(http_pause_handle_s *http);
  */
 void *http_paused_udata_set(http_pause_handle_s *http, void *udata);
 
+/**
+ * Returns the connection's uuid, which remains a safe reference to the
+ * connection after the `http_s` handle becomes invalid.
+ *
+ * Returns -1 on error.
+ */
+intptr_t http_uuid(http_s *h);
+
+/**
+ * Resumes reading a request body after an `on_body_chunk` callback returned a
+ * positive value (see `http_settings_s`).
+ *
+ * This function is thread safe and it's safe to call it after the connection
+ * was closed.
+ */
+void http_body_resume(intptr_t uuid);
+
 /* *****************************************************************************
 HTTP Connections - Listening / Connecting / Hijacking
 ***************************************************************************** */
@@ -318,6 +466,14 @@ HTTP Connections - Listening / Connecting / Hijacking
 struct http_settings_s {
   /** Callback for normal HTTP requests. */
   void (*on_request)(http_s *request);
+  /**
+   * (optional) SERVER ONLY: routes requests to handlers by method and path
+   * (see `http_router.h`). Requests that don't match any route are passed to
+   * `on_request`.
+   *
+   * The router is frozen by `http_listen` and must outlive the HTTP service.
+   */
+  http_router_s *router;
   /**
    * Callback for Upgrade and EventSource (SSE) requests.
    *
@@ -326,6 +482,30 @@ struct http_settings_s {
   void (*on_upgrade)(http_s *request, char *requested_protocol, size_t len);
   /** CLIENT REQUIRED: a callback for the HTTP response. */
   void (*on_response)(http_s *response);
+  /**
+   * (optional) SERVER ONLY: streams the request body instead of buffering it.
+   *
+   * When set, the body is never stored in `h->body`. Instead, this callback is
+   * called for every chunk of the body as it arrives (the request's headers are
+   * already available) and `on_request` is called once the body is complete.
+   * The `h->udata` field can be used to store any per-request state.
+   *
+   * The callback should return 0 to continue reading.
+   *
+   * A positive return value pauses reading (backpressure) until
+   * `http_body_resume` is called. Data already received might still be
+   * delivered before reading stops.
+   *
+   * A negative return value rejects the request (the connection is closed
+   * after an error response, unless a response was already sent).
+   *
+   * If the request fails before the body is complete (connection lost, body
+   * too large, etc'), the callback is called once more with `data == NULL`, so
+   * any resources stored in `h->udata` can be released.
+   *
+   * See `http_multipart_new` for incremental `multipart/form-data` parsing.
+   */
+  int (*on_body_chunk)(http_s *h, char *data, size_t length);
   /** (optional) the callback to be performed when the HTTP service closes. */
   void (*on_finish)(struct http_settings_s *settings);
   /** Opaque user data. Facil.io will ignore this field, but you can use it. */
@@ -334,7 +514,8 @@ struct http_settings_s {
    * A public folder for file transfers - allows to circumvent any application
    * layer logic and simply serve static files.
    *
-   * Supports automatic `gz` pre-compressed alternatives.
+   * Supports automatic `gz` pre-compressed alternatives and on-the-fly
+   * compression (see `compress_threshold`).
    */
   const char *public_folder;
   /**
@@ -357,6 +538,63 @@ struct http_settings_s {
    * Defaults to ~ 50Mb.
    */
   size_t max_body_size;
+  /**
+   * Enables response compression for responses of at least this many bytes.
+   *
+   * Compressible responses (text, JSON, JavaScript, XML, etc') sent using
+   * `http_send_body` are compressed on-the-fly (br, gzip or deflate, as
+   * negotiated using the `Accept-Encoding` request header).
+   *
+   * Static files served by `http_sendfile2` (or the `public_folder`) are
+   * compressed only once, the compressed variants are cached by the static
+   * file cache (see `HTTP_STATIC_CACHE_LIMIT`).
+   *
+   * Streamed responses (see `http_stream_write`) are compressed regardless of
+   * their size, unless a Content-Length header was set. Each chunk is flushed,
+   * so the client can use it right away.
+   *
+   * Requires zlib (gzip, deflate) and / or Brotli (br) support.
+   *
+   * Defaults to 0 (compression disabled).
+   */
+  size_t compress_threshold;
+  /**
+   * SERVER ONLY: the size (in bytes) of a shared memory response cache for
+   * `GET` requests. Defaults to 0 (no cache).
+   *
+   * The cache is shared by all the worker processes (when `http_listen` is
+   * called before `fio_start`). Cache hits are sent without calling
+   * `on_request` (or the `router`).
+   *
+   * Only responses sent using `http_send_body` with a `200` status, a
+   * `Cache-Control` header with a `max-age` (or `s-maxage`) and no `Set-Cookie`
+   * header are cached, for the duration of the `max-age` (`no-store`,
+   * `no-cache` and `private` responses aren't cached). Responses larger than
+   * `HTTP_CACHE_ENTRY_SIZE` (including their headers) aren't cached.
+   *
+   * Requests with an `Authorization` header bypass the cache, as do requests
+   * with a `Cache-Control: no-cache` header. Cached responses include an `Age`
+   * header and honor the `If-None-Match` request header (when the response has
+   * an `ETag`).
+   */
+  size_t cache_size;
+  /**
+   * (optional) A comma separated list of request headers that the cached
+   * responses depend on (i.e., "accept-language, x-api-version").
+   *
+   * The cache key is made up of the host, the path, the query and these
+   * headers. When `compress_threshold` is set, `accept-encoding` is added
+   * automatically.
+   */
+  const char *cache_vary;
+  /**
+   * SERVER ONLY: requests that take at least this long (in milliseconds, from
+   * parsing the request line until the response was written to the socket) are
+   * logged as warnings, with a breakdown of the request's phases.
+   *
+   * Setting `slow_request` sets `timing`. Defaults to 0 (disabled).
+   */
+  size_t slow_request;
   /**
    * The maximum number of clients that are allowed to connect concurrently.
    *
@@ -383,6 +621,19 @@ struct http_settings_s {
    * connections. Defaults to ~250KB.
    */
   size_t ws_max_msg_size;
+  /**
+   * The maximum number of pipelined HTTP/1.1 requests handled per read event,
+   * before other connections get a chance to be served. Defaults to 8.
+   *
+   * Responses to pipelined requests handled within the same read event are
+   * coalesced into a single write (see `HTTP1_WRITE_BUFFER`).
+   */
+  uint16_t pipeline_depth;
+  /**
+   * Reading from an HTTP/1.1 client is throttled while more than this number
+   * of packets are waiting in the connection's outgoing queue. Defaults to 4.
+   */
+  uint16_t pipeline_throttle;
   /**
    * An HTTP/1.x connection timeout.
    *
@@ -399,8 +650,37 @@ struct http_settings_s {
    * fails). Pongs are ignored.
    */
   uint8_t ws_timeout;
+  /**
+   * SERVER ONLY: set to TRUE to negotiate the `permessage-deflate` WebSocket
+   * extension (RFC 7692) with clients that offer it. Messages of at least
+   * `WEBSOCKET_DEFLATE_MIN` bytes are compressed.
+   *
+   * Requires zlib (`HAVE_ZLIB`), otherwise the extension is never negotiated.
+   */
+  uint8_t ws_compress;
+  /**
+   * The server's `permessage-deflate` window size, in bits (9-15).
+   *
+   * Smaller windows use less memory per connection. Defaults to 15 (32Kb).
+   */
+  uint8_t ws_compress_window;
+  /**
+   * Set to TRUE to compress each message on its own
+   * (`server_no_context_takeover`).
+   *
+   * The compression state is then shared by all the connections instead of
+   * kept per connection (~256Kb with the default window), at the expense of
+   * the compression ratio.
+   */
+  uint8_t ws_compress_no_context;
   /** Logging flag - set to TRUE to log HTTP requests. */
   uint8_t log;
+  /**
+   * SERVER ONLY: set to TRUE to measure the phases of each request (header
+   * parsing, body, handler and flushing the response to the socket) and collect
+   * them in per route histograms (see `http_timing.h`).
+   */
+  uint8_t timing;
   /** a read only flag set automatically to indicate the protocol's mode. */
   uint8_t is_client;
 };
@@ -496,6 +776,26 @@ Websocket Upgrade (Server and Client connection establishment)
  */
 typedef struct ws_s ws_s;
 
+/**
+ * Slow consumer policies for a WebSocket's pub/sub messages (see `max_queued`
+ * in {websocket_settings_s}).
+ */
+typedef enum {
+  /** Hold messages back until the client catches up, dropping the oldest. */
+  WEBSOCKET_SLOW_DROP_OLDEST = 0,
+  /**
+   * Hold back only the latest message published to each channel (sent in the
+   * order the held back messages were published).
+   */
+  WEBSOCKET_SLOW_COALESCE,
+  /**
+   * Close the connection: the queued data is dropped and a Close frame (see
+   * `close_code`) follows the frame being sent, which the client has
+   * `WEBSOCKET_SLOW_CLOSE_TIMEOUT` milliseconds to read.
+   */
+  WEBSOCKET_SLOW_DISCONNECT,
+} websocket_slow_policy_e;
+
 /**
  * This struct is used for the named arguments in the `http_upgrade2ws`
  * function and macro.
@@ -510,6 +810,23 @@ typedef struct {
    * can be copied).
    */
   void (*on_message)(ws_s *ws, fio_str_info_s msg, uint8_t is_text);
+  /**
+   * The (optional) on_message_chunk callback replaces `on_message`, streaming
+   * incoming messages instead of collecting them.
+   *
+   * Each call delivers the next (unmasked) part of a message. `first` marks the
+   * message's first chunk and `last` marks its final chunk. Frames that don't
+   * fit the connection's buffer are delivered as their data arrives, so a
+   * connection's memory use doesn't grow with the message size and the
+   * `ws_max_msg_size` limit isn't applied to these frames.
+   *
+   * Compressed (`permessage-deflate`) messages are collected and delivered in
+   * a single chunk.
+   *
+   * As with `on_message`, the data is only valid until the callback returns.
+   */
+  void (*on_message_chunk)(ws_s *ws, fio_str_info_s chunk, uint8_t first,
+                           uint8_t last, uint8_t is_text);
   /**
    * The (optional) on_open callback will be called once the websocket
    * connection is established and before is is registered with `facil`, so no
@@ -541,6 +858,33 @@ typedef struct {
    * `websocket_udata_set` function.
    */
   void (*on_close)(intptr_t uuid, void *udata);
+  /**
+   * Limits the number of bytes waiting to be sent to a slow client, for the
+   * connection's pub/sub messages (see `websocket_subscribe`).
+   *
+   * Once the connection's outgoing queue would exceed `max_queued` bytes,
+   * `slow_policy` is applied to the pub/sub messages, whether they're forwarded
+   * to the client or handled by an `on_message` callback. Messages that are
+   * held back are limited to `max_queued` bytes as well and are forwarded (or
+   * handled) once the queue was drained, so a slow client might cost up to
+   * twice `max_queued` bytes.
+   *
+   * Default: 0 (no limit).
+   */
+  size_t max_queued;
+  /** The policy applied when `max_queued` is exceeded. */
+  websocket_slow_policy_e slow_policy;
+  /**
+   * The close code sent by `WEBSOCKET_SLOW_DISCONNECT`.
+   *
+   * Default: 1008 (policy violation).
+   */
+  uint16_t close_code;
+  /**
+   * Called whenever `max_queued` is exceeded (before the policy is applied),
+   * with the number of bytes queued for the client (including the new message).
+   */
+  void (*on_slow)(ws_s *ws, fio_str_info_s channel, size_t queued);
   /** Opaque user data. */
   void *udata;
 } websocket_settings_s;
@@ -704,6 +1048,30 @@ uintptr_t http_sse_subscribe(http_sse_s *sse,
  */
 void http_sse_unsubscribe(http_sse_s *sse, uintptr_t subscription);
 
+/** The pub/sub metadata type ID of pre-encoded SSE events. */
+#define HTTP_SSE_OPTIMIZE_PUBSUB (-40)
+
+/**
+ * Enables (or disables) SSE broadcast optimizations.
+ *
+ * When enabled, every pub/sub message is encoded as an SSE event (`data`
+ * fields only) once, before it's delivered, and the encoded event is shared
+ * (by reference) by all the SSE connections subscribed without an
+ * `on_message` callback.
+ *
+ * This is performed automatically by the `http_sse_subscribe` function (for
+ * subscriptions without an `on_message` callback).
+ *
+ * Note: to disable the optimization it should be disabled the same amount of
+ * times it was enabled (the enablement is reference counted).
+ *
+ * The optimized data is a FIOBJ String containing the pre-encoded event, i.e.:
+ *
+ *     FIOBJ event = (FIOBJ)fio_message_metadata(msg, HTTP_SSE_OPTIMIZE_PUBSUB);
+ *     fiobj_send_free(http_sse2uuid(sse), fiobj_dup(event));
+ */
+void http_sse_optimize4broadcasts(int enable);
+
 /**
  * Named arguments for the {http_sse_write} function.
  *
@@ -775,6 +1143,97 @@ HTTP GET and POST parsing helpers
  */
 int http_parse_body(http_s *h);
 
+/** An opaque incremental `multipart/form-data` parser. */
+typedef struct http_multipart_s http_multipart_s;
+
+/** The callbacks for the incremental `multipart/form-data` parser. */
+typedef struct {
+  /**
+   * Called when a new part (form field or file) begins.
+   *
+   * `filename.data` is NULL for normal form fields.
+   */
+  void (*on_part_start)(http_multipart_s *m, fio_str_info_s name,
+                        fio_str_info_s filename, fio_str_info_s mime_type);
+  /** Called (possibly more than once) with the part's data. */
+  void (*on_part_data)(http_multipart_s *m, char *data, size_t length);
+  /** Called when the part's data is complete. */
+  void (*on_part_end)(http_multipart_s *m);
+  /** Opaque user data. */
+  void *udata;
+} http_multipart_settings_s;
+
+/**
+ * Creates an incremental `multipart/form-data` parser for the request's body,
+ * usually from within the `on_body_chunk` callback.
+ *
+ * Data is fed to the parser using `http_multipart_consume`, so files can be
+ * streamed to their destination without buffering the whole request.
+ *
+ * Returns NULL if the request's Content-Type isn't `multipart/form-data`.
+ */
+http_multipart_s *http_multipart_new(http_s *h,
+                                     http_multipart_settings_s settings);
+#define http_multipart_new(h, ...)                                             \
+  http_multipart_new((h), (http_multipart_settings_s){__VA_ARGS__})
+
+/**
+ * Consumes a chunk of the body. Incomplete part headers are buffered until the
+ * rest of the data arrives.
+ *
+ * Returns -1 on a parsing error, 1 once the final boundary was parsed and 0
+ * when more data is expected.
+ */
+int http_multipart_consume(http_multipart_s *m, char *data, size_t length);
+
+/** Returns the `udata` associated with the parser. */
+void *http_multipart_udata(http_multipart_s *m);
+
+/** Frees the parser (the `udata` is left untouched). */
+void http_multipart_free(http_multipart_s *m);
+
+/** A `multipart/form-data` part, located within the request's body. */
+typedef struct {
+  /** The form field's name. */
+  fio_str_info_s name;
+  /** The uploaded file's name (`data` is NULL for normal form fields). */
+  fio_str_info_s filename;
+  /** The part's Content-Type (`data` is NULL if missing). */
+  fio_str_info_s mime_type;
+  /**
+   * The file descriptor holding the body (owned by the request, don't close),
+   * or -1 if the body is stored in memory.
+   */
+  int fd;
+  /** The data's offset within `fd` (i.e., for `fio_sendfile` or `pread`). */
+  size_t offset;
+  /** The data's position within the body (see `fiobj_data_pread`). */
+  size_t pos;
+  /** The data's length. */
+  size_t length;
+} http_multipart_part_s;
+
+/**
+ * Calls `task` for each part of a `multipart/form-data` body, without copying
+ * the parts or adding them to the `params` Hash.
+ *
+ * Large uploads are stored in a temporary file, so file parts can be moved
+ * (`copy_file_range`), sent (`fio_sendfile`) or hashed right where they are,
+ * using the part's `fd` and `offset`. Small values are read only when needed:
+ *
+ *     fio_str_info_s v = fiobj_data_pread(h->body, part->pos, part->length);
+ *
+ * The part's strings are only valid during the `task`. Return -1 from `task`
+ * to stop the iteration.
+ *
+ * Returns the number of parts or -1 on error (i.e., the body isn't
+ * `multipart/form-data` or is malformed).
+ */
+int http_multipart_each(http_s *h,
+                        int (*task)(http_s *h, http_multipart_part_s *part,
+                                    void *udata),
+                        void *udata);
+
 /**
  * Parses the query part of an HTTP request/response. Uses `http_add2hash`.
  *
@@ -786,6 +1245,62 @@ void http_parse_query(http_s *h);
 /** Parses any Cookie / Set-Cookie headers, using the `http_add2hash` scheme. */
 void http_parse_cookies(http_s *h, uint8_t is_url_encoded);
 
+/**
+ * Returns the raw (URL encoded) value of a query parameter, scanning `h->query`
+ * on demand (nothing is allocated and `h->params` isn't used).
+ *
+ * `name` is compared with the decoded parameter names. A parameter without a
+ * value (i.e., "?flag") returns an empty value.
+ *
+ * Returns `{.data = NULL}` if the parameter wasn't found.
+ *
+ * Use `http_decode_param` to decode the value.
+ */
+fio_str_info_s http_query_get(http_s *h, const char *name, size_t name_len);
+
+/**
+ * Calls `task` for each query parameter with the raw (URL encoded) name and
+ * value, without allocating memory.
+ *
+ * If `task` returns -1, the loop is broken.
+ *
+ * Returns the number of parameters processed.
+ */
+size_t http_query_each(http_s *h,
+                       int (*task)(fio_str_info_s name, fio_str_info_s value,
+                                   void *udata),
+                       void *udata);
+
+/**
+ * Returns the raw value of a cookie, scanning the Cookie (and Set-Cookie)
+ * headers on demand (nothing is allocated and `h->cookies` isn't used).
+ *
+ * Returns `{.data = NULL}` if the cookie wasn't found.
+ */
+fio_str_info_s http_cookie_get(http_s *h, const char *name, size_t name_len);
+
+/**
+ * Calls `task` for each cookie with the raw name and value, without allocating
+ * memory.
+ *
+ * If `task` returns -1, the loop is broken.
+ *
+ * Returns the number of cookies processed.
+ */
+size_t http_cookie_each(http_s *h,
+                        int (*task)(fio_str_info_s name, fio_str_info_s value,
+                                    void *udata),
+                        void *udata);
+
+/**
+ * URL decodes a raw value (i.e., from `http_query_get`) into `dest`, which has
+ * room for `capa` bytes (including the NUL terminator).
+ *
+ * Returns the decoded length or -1 on error (invalid encoding or insufficient
+ * room).
+ */
+ssize_t http_decode_param(char *dest, size_t capa, fio_str_info_s raw);
+
 /**
  * Adds a named parameter to the hash, converting a string to an object and
  * resolving nesting references and URL decoding if required.
@@ -833,7 +1348,12 @@ HTTP Status Strings and Mime-Type helpers
 /** Returns a human readable string related to the HTTP status number. */
 fio_str_info_s http_status2str(uintptr_t status);
 
-/** Registers a Mime-Type to be associated with the file extension. */
+/**
+ * Registers a Mime-Type to be associated with the file extension.
+ *
+ * Registered Mime-Types take precedence over the default (compiled) Mime-Type
+ * table. Use `FIOBJ_INVALID` to remove a file extension.
+ */
 void http_mimetype_register(char *file_ext, size_t file_ext_len,
                             FIOBJ mime_type_str);
 
@@ -875,6 +1395,7 @@ extern FIOBJ HTTP_HEADER_LAST_MODIFIED;
 extern FIOBJ HTTP_HEADER_ORIGIN;
 extern FIOBJ HTTP_HEADER_SET_COOKIE;
 extern FIOBJ HTTP_HEADER_UPGRADE;
+extern FIOBJ HTTP_HEADER_VARY;
 
 /* *****************************************************************************
 HTTP General Helper functions that could be used globally
@@ -887,7 +1408,10 @@ HTTP General Helper functions that could be used globally
 FIOBJ http_req2str(http_s *h);
 
 /**
- * Writes a log line to `stderr` about the request / response object.
+ * Writes a log line about the request / response object to the access log
+ * (`stderr` by default, see `http_log_open` in `http_log.h`).
+ *
+ * The line is buffered and written in batches, off the request's thread.
  *
  * This function is called automatically if the `.log` setting is enabled.
  */
@@ -28,6 +28,19 @@ typedef struct http1pr_s {
   uint8_t close;
   uint8_t is_client;
   uint8_t stop;
+  uint8_t streaming;
+  uint8_t stream_out;
+  /* compresses a streamed response body (or NULL) */
+  http_compress_s *stream_compress;
+  /* called once a stream's client caught up (see `http_stream_on_ready`) */
+  void (*stream_on_ready)(http_s *h);
+  http_s *stream_h;
+  uint8_t batch;
+  uint8_t timing_count;
+  fio_lock_i timing_lock;
+  FIOBJ out;
+  /* the timing of responses waiting for the socket to flush */
+  http_timing_s timing[HTTP_TIMING_PENDING];
   uint8_t buf[];
 } http1pr_s;
 
@@ -42,10 +55,71 @@ Internal Helpers
 
 inline static void h1_reset(http1pr_s *p) { p->header_size = 0; }
 
+/* sends any responses that were coalesced while handling pipelined requests */
+inline static void http1_flush(http1pr_s *p) {
+  if (!p->out)
+    return;
+  fiobj_send_free(p->p.uuid, p->out);
+  p->out = FIOBJ_INVALID;
+}
+
+/* sends (or coalesces) a packet, taking ownership of the String */
+static void http1_write(http1pr_s *p, FIOBJ packet) {
+  if (!p->batch) {
+    fiobj_send_free(p->p.uuid, packet);
+    return;
+  }
+  if (p->out) {
+    const size_t len = fiobj_obj2cstr(packet).len;
+    if (fiobj_obj2cstr(p->out).len + len <= HTTP1_WRITE_BUFFER) {
+      fiobj_str_write(p->out, fiobj_obj2cstr(packet).data, len);
+      fiobj_free(packet);
+      return;
+    }
+    http1_flush(p);
+  }
+  p->out = packet;
+}
+
 #define http1_pr2handle(pr) (((http1pr_s *)(pr))->request)
 #define handle2pr(h) ((http1pr_s *)h->private_data.flag)
 
+/* the response is about to be queued, its timing is recorded once flushed */
+static void http1_timing_queued(http1pr_s *p) {
+  if (!p->p.timing.start)
+    return;
+  p->p.timing.queued = http_timing_now();
+  fio_lock(&p->timing_lock);
+  if (p->timing_count == HTTP_TIMING_PENDING) {
+    /* too many pipelined responses, record the oldest without flushing */
+    http_timing_finish______internal(p->timing, 0, p->p.uuid, p->p.settings);
+    memmove(p->timing, p->timing + 1,
+            sizeof(*p->timing) * (HTTP_TIMING_PENDING - 1));
+    --p->timing_count;
+  }
+  p->timing[p->timing_count++] = p->p.timing;
+  fio_unlock(&p->timing_lock);
+  p->p.timing = (http_timing_s){.start = 0};
+}
+
+/* records the timing of the queued responses (`flushed` is 0 if unknown) */
+static void http1_timing_flushed(http1pr_s *p, uint64_t flushed) {
+  fio_lock(&p->timing_lock);
+  for (size_t i = 0; i < p->timing_count; ++i)
+    http_timing_finish______internal(p->timing + i, flushed, p->p.uuid,
+                                     p->p.settings);
+  p->timing_count = 0;
+  fio_unlock(&p->timing_lock);
+}
+
+/* records the timing of the queued responses, if they were written */
+inline static void http1_timing_test_flushed(http1pr_s *p) {
+  if (p->timing_count && !p->out && !fio_pending(p->p.uuid))
+    http1_timing_flushed(p, http_timing_now());
+}
+
 static fio_str_info_s http1pr_status2str(uintptr_t status);
+static void http1_on_close(intptr_t uuid, fio_protocol_s *protocol);
 
 /* cleanup an HTTP/1.1 handler object */
 static inline void http1_after_finish(http_s *h) {
@@ -57,8 +131,11 @@ static inline void http1_after_finish(http_s *h) {
   } else {
     http_s_clear(h, p->p.settings->log);
   }
-  if (p->close)
+  http1_timing_test_flushed(p);
+  if (p->close) {
+    http1_flush(p);
     fio_close(p->p.uuid);
+  }
 }
 
 /* *****************************************************************************
@@ -182,7 +259,8 @@ static int http1_send_body(http_s *h, void *data, uintptr_t length) {
     return -1;
   }
   fiobj_str_write(packet, data, length);
-  fiobj_send_free((handle2pr(h)->p.uuid), packet);
+  http1_timing_queued(handle2pr(h));
+  http1_write(handle2pr(h), packet);
   http1_after_finish(h);
   return 0;
 }
@@ -203,28 +281,196 @@ static int http1_sendfile(http_s *h, int fd, uintptr_t length,
     intptr_t i = pread(fd, s.data + s.len, length, offset);
     if (i < 0) {
       close(fd);
-      fiobj_send_free((handle2pr(h)->p.uuid), packet);
+      http1_write(handle2pr(h), packet);
+      http1_flush(handle2pr(h));
       fio_close((handle2pr(h)->p.uuid));
       return -1;
     }
     close(fd);
     fiobj_str_resize(packet, s.len + i);
-    fiobj_send_free((handle2pr(h)->p.uuid), packet);
+    http1_timing_queued(handle2pr(h));
+    http1_write(handle2pr(h), packet);
     http1_after_finish(h);
     return 0;
   }
-  fiobj_send_free((handle2pr(h)->p.uuid), packet);
+  http1_timing_queued(handle2pr(h));
+  http1_write(handle2pr(h), packet);
+  http1_flush(handle2pr(h));
   fio_sendfile((handle2pr(h)->p.uuid), fd, offset, length);
   http1_after_finish(h);
   return 0;
 }
 
+/* `stream_out` values, the response body's streaming encoding */
+#define HTTP1_STREAM_CHUNKED 1
+#define HTTP1_STREAM_IDENTITY 2
+
+/* writes a body chunk using the stream's encoding */
+static void http1_stream_frame(http1pr_s *p, FIOBJ packet, void *data,
+                               uintptr_t length) {
+  if (!length)
+    return; /* an empty chunk would terminate the stream */
+  if (p->stream_out == HTTP1_STREAM_CHUNKED) {
+    /* chunk size line (hex, no prefix) */
+    char tmp[20];
+    size_t pos = sizeof(tmp) - 2;
+    tmp[pos] = '\r';
+    tmp[pos + 1] = '\n';
+    for (uintptr_t n = length; n; n >>= 4)
+      tmp[--pos] = "0123456789ABCDEF"[n & 15];
+    fiobj_str_write(packet, tmp + pos, sizeof(tmp) - pos);
+    fiobj_str_write(packet, data, length);
+    fiobj_str_write(packet, "\r\n", 2);
+  } else {
+    fiobj_str_write(packet, data, length);
+  }
+}
+
+/** Should send existing headers and data and prepare for streaming */
+static int http1_stream(http_s *h, void *data, uintptr_t length) {
+  http1pr_s *p = handle2pr(h);
+  FIOBJ packet;
+  if (p->is_client)
+    return -1;
+  if (!p->stream_out) {
+    static uint64_t cl_hash;
+    if (!cl_hash)
+      cl_hash = fiobj_hash_string("content-length", 14);
+    fio_str_info_s v = fiobj_obj2cstr(h->version);
+    if (fiobj_hash_get2(h->private_data.out_headers, cl_hash)) {
+      p->stream_out = HTTP1_STREAM_IDENTITY;
+    } else {
+      /* the length is unknown, so the stream can be compressed */
+      http_compress_e encoding = http_compress_response______internal(h);
+      if (encoding && (p->stream_compress = http_compress_new(encoding, 0, 0)))
+        http_set_header(h, HTTP_HEADER_CONTENT_ENCODING,
+                        http_compress_encoding(encoding));
+      if (v.len > 7 && v.data[5] == '1' && v.data[6] == '.' &&
+          v.data[7] == '1') {
+        http_set_header2(
+            h, (fio_str_info_s){.data = "transfer-encoding", .len = 17},
+            (fio_str_info_s){.data = "chunked", .len = 7});
+        p->stream_out = HTTP1_STREAM_CHUNKED;
+      } else {
+        /* HTTP/1.0 - the end of the stream is marked by closing the
+         * connection */
+        http_set_header(h, HTTP_HEADER_CONNECTION,
+                        fiobj_dup(HTTP_HVALUE_CLOSE));
+        p->stream_out = HTTP1_STREAM_IDENTITY;
+      }
+    }
+    packet = headers2str(h, length + 32);
+    if (!packet) {
+      p->stream_out = 0;
+      http_compress_free(p->stream_compress);
+      p->stream_compress = NULL;
+      return -1;
+    }
+    /* prevent `on_request` from finishing the response and block pipelining */
+    p->stop |= 1;
+  } else {
+    packet = fiobj_str_buf(length + 32);
+  }
+  if (length && p->stream_compress) {
+    /* each chunk is flushed, so the client can use it right away */
+    FIOBJ compressed = fiobj_str_buf((length >> 1) + 32);
+    if (http_compress_write(p->stream_compress, compressed, data, length,
+                            HTTP_COMPRESS_FLUSH)) {
+      fiobj_free(compressed);
+      fiobj_free(packet);
+      return -1;
+    }
+    fio_str_info_s c = fiobj_obj2cstr(compressed);
+    http1_stream_frame(p, packet, c.data, c.len);
+    fiobj_free(compressed);
+  } else {
+    http1_stream_frame(p, packet, data, length);
+  }
+  if (fiobj_obj2cstr(packet).len)
+    http1_write(p, packet);
+  else
+    fiobj_free(packet);
+  return 0;
+}
+
+/** Completes a streamed response (trailers are NOT freed). */
+static int http1_stream_finish(http_s *h, FIOBJ trailers) {
+  http1pr_s *p = handle2pr(h);
+  if (!p->stream_out)
+    return -1;
+  http1_timing_queued(p);
+  if (p->stream_compress) {
+    /* the end of the compressed data */
+    FIOBJ tail = fiobj_str_buf(32);
+    FIOBJ packet = fiobj_str_buf(64);
+    http_compress_write(p->stream_compress, tail, NULL, 0,
+                        HTTP_COMPRESS_FINISH);
+    fio_str_info_s t = fiobj_obj2cstr(tail);
+    http1_stream_frame(p, packet, t.data, t.len);
+    fiobj_free(tail);
+    http_compress_free(p->stream_compress);
+    p->stream_compress = NULL;
+    if (fiobj_obj2cstr(packet).len)
+      http1_write(p, packet);
+    else
+      fiobj_free(packet);
+  }
+  if (p->stream_out == HTTP1_STREAM_CHUNKED) {
+    struct header_writer_s w = {.dest = fiobj_str_buf(5)};
+    fiobj_str_write(w.dest, "0\r\n", 3);
+    if (trailers && FIOBJ_TYPE_IS(trailers, FIOBJ_T_HASH))
+      fiobj_each1(trailers, 0, write_header, &w);
+    fiobj_str_write(w.dest, "\r\n", 2);
+    http1_write(p, w.dest);
+  }
+  p->stream_out = 0;
+  p->stream_on_ready = NULL;
+  http1_after_finish(h);
+  /* resume handling pipelined requests */
+  if (!p->stop)
+    fio_force_event(p->p.uuid, FIO_EVENT_ON_DATA);
+  return 0;
+}
+
+/* calls the stream's `on_ready` callback, within the connection's task lock */
+static void http1_stream_ready_task(intptr_t uuid, fio_protocol_s *pr,
+                                    void *ignr) {
+  if (pr->on_close != http1_on_close)
+    return; /* the connection was hijacked */
+  http1pr_s *p = (http1pr_s *)pr;
+  /* wait for the next `on_ready` event if the client fell behind again */
+  if (!p->stream_on_ready || !p->stream_out ||
+      fio_pending(uuid) > HTTP_STREAM_PENDING_LIMIT)
+    return;
+  void (*on_ready)(http_s *h) = p->stream_on_ready;
+  p->stream_on_ready = NULL;
+  on_ready(p->stream_h);
+  (void)ignr;
+}
+
+/** Calls `on_ready` once the client caught up with the stream. */
+static int http1_stream_on_ready(http_s *h, void (*on_ready)(http_s *h)) {
+  http1pr_s *p = handle2pr(h);
+  if (!p->stream_out)
+    return -1;
+  p->stream_h = h;
+  p->stream_on_ready = on_ready;
+  /* the queue might have been drained already */
+  fio_force_event(p->p.uuid, FIO_EVENT_ON_READY);
+  return 0;
+}
+
 /** Should send existing headers or complete streaming */
 static void htt1p_finish(http_s *h) {
+  if (handle2pr(h)->stream_out) {
+    http1_stream_finish(h, FIOBJ_INVALID);
+    return;
+  }
   FIOBJ packet = headers2str(h, 0);
-  if (packet)
-    fiobj_send_free((handle2pr(h)->p.uuid), packet);
-  else {
+  if (packet) {
+    http1_timing_queued(handle2pr(h));
+    http1_write(handle2pr(h), packet);
+  } else {
     // fprintf(stderr, "WARNING: invalid call to `htt1p_finish`\n");
   }
   http1_after_finish(h);
@@ -279,6 +525,7 @@ static intptr_t http1_hijack(http_s *h, fio_str_info_s *leftover) {
   }
 
   handle2pr(h)->stop = 3;
+  http1_flush(handle2pr(h));
   intptr_t uuid = handle2pr(h)->p.uuid;
   fio_attach(uuid, NULL);
   return uuid;
@@ -298,7 +545,7 @@ static void http1_websocket_client_on_upgrade(http_s *h, char *proto,
   http_finish(h);
   p->stop = 1;
   websocket_attach(uuid, set, args, p->parser.state.next,
-                   p->buf_len - (intptr_t)(p->parser.state.next - p->buf));
+                   p->buf_len - (intptr_t)(p->parser.state.next - p->buf), 0);
   fio_free(args);
   (void)proto;
   (void)len;
@@ -356,10 +603,13 @@ static int http1_http2websocket_server(http_s *h, websocket_settings_s *args) {
   http1pr_s *pr = handle2pr(h);
   const intptr_t uuid = handle2pr(h)->p.uuid;
   http_settings_s *set = handle2pr(h)->p.settings;
+  const uint8_t deflate = websocket_deflate_negotiate(h, set);
   http_finish(h);
   pr->stop = 1;
+  http1_flush(pr);
   websocket_attach(uuid, set, args, pr->parser.state.next,
-                   pr->buf_len - (intptr_t)(pr->parser.state.next - pr->buf));
+                   pr->buf_len - (intptr_t)(pr->parser.state.next - pr->buf),
+                   deflate);
   return 0;
 bad_request:
   http_send_error(h, 400);
@@ -471,6 +721,7 @@ static int http1_upgrade2sse(http_s *h, http_sse_s *sse) {
                   fiobj_str_new("identity", 8));
   handle2pr(h)->stop = 1;
   htt1p_finish(h); /* avoid the enforced content length in http_finish */
+  http1_flush(handle2pr(h));
 
   /* switch protocol to SSE */
   http1_sse_fio_protocol_s *sse_pr = fio_malloc(sizeof(*sse_pr));
@@ -529,7 +780,10 @@ Virtual Table Decleration
 struct http_vtable_s HTTP1_VTABLE = {
     .http_send_body = http1_send_body,
     .http_sendfile = http1_sendfile,
+    .http_stream = http1_stream,
     .http_finish = htt1p_finish,
+    .http_stream_finish = http1_stream_finish,
+    .http_stream_on_ready = http1_stream_on_ready,
     .http_push_data = http1_push_data,
     .http_push_file = http1_push_file,
     .http_on_pause = http1_on_pause,
@@ -550,6 +804,18 @@ Parser Callbacks
 /** called when a request was received. */
 static int http1_on_request(http1_parser_s *parser) {
   http1pr_s *p = parser2http(parser);
+  /* the body is complete, there's nothing left to pause */
+  p->streaming = 0;
+  p->stop &= ~8;
+  if (p->p.timing.start) {
+    p->p.timing.dispatch = http_timing_now();
+    if (!p->p.timing.headers)
+      p->p.timing.headers = p->p.timing.dispatch;
+    if (p->p.settings->slow_request) {
+      p->p.timing.method = fiobj_dup(p->request.method);
+      p->p.timing.path = fiobj_dup(p->request.path);
+    }
+  }
   http_on_request_handler______internal(&http1_pr2handle(p), p->p.settings);
   if (p->request.method && !p->stop)
     http_finish(&p->request);
@@ -609,6 +875,14 @@ static int http1_on_version(http1_parser_s *parser, char *version, size_t len) {
 #else
   http1_pr2handle(parser2http(parser)).received_at = fio_last_tick();
 #endif
+  if (parser2http(parser)->p.settings->timing &&
+      !parser2http(parser)->is_client) {
+    http1pr_s *p = parser2http(parser);
+    /* a previous request might have been upgraded or hijacked */
+    fiobj_free(p->p.timing.method);
+    fiobj_free(p->p.timing.path);
+    p->p.timing = (http_timing_s){.start = http_timing_now()};
+  }
   return 0;
 }
 /** called when a header is parsed. */
@@ -620,6 +894,7 @@ static int http1_on_header(http1_parser_s *parser, char *name, size_t name_len,
     FIO_LOG_ERROR("(http1 parse ordering error) missing HashMap for header "
                   "%s: %s",
                   name, data);
+    http1_flush(parser2http(parser));
     http_send_error2(500, parser2http(parser)->p.uuid,
                      parser2http(parser)->p.settings);
     return -1;
@@ -646,11 +921,35 @@ static int http1_on_body_chunk(http1_parser_s *parser, char *data,
                                size_t data_len) {
   if (parser->state.content_length >
           (ssize_t)parser2http(parser)->p.settings->max_body_size ||
-      parser->state.read >
+      parser->state.read + (ssize_t)data_len >
           (ssize_t)parser2http(parser)->p.settings->max_body_size) {
+    if (parser2http(parser)->streaming) {
+      parser2http(parser)->streaming = 0;
+      parser2http(parser)->p.settings->on_body_chunk(
+          &http1_pr2handle(parser2http(parser)), NULL, 0);
+    }
     http_send_error(&http1_pr2handle(parser2http(parser)), 413);
     return -1; /* test every time, in case of chunked data */
   }
+  if (parser2http(parser)->p.settings->on_body_chunk &&
+      !parser2http(parser)->is_client) {
+    /* stream the body to the application */
+    http1pr_s *p = parser2http(parser);
+    if (!p->streaming)
+      p->request.udata = p->p.settings->udata;
+    p->streaming = 1;
+    int ret = p->p.settings->on_body_chunk(&p->request, data, data_len);
+    if (ret > 0) {
+      /* backpressure: `http1_on_data` suspends reading until resumed */
+      p->stop |= 8;
+    } else if (ret < 0) {
+      p->streaming = 0;
+      if (!HTTP_INVALID_HANDLE(&p->request))
+        http_send_error(&p->request, 400);
+      return -1;
+    }
+    return 0;
+  }
   if (!parser->state.read) {
     if (parser->state.content_length > 0 &&
         parser->state.content_length <= HTTP_MAX_HEADER_LENGTH) {
@@ -668,6 +967,7 @@ static int http1_on_error(http1_parser_s *parser) {
   if (parser2http(parser)->close)
     return -1;
   FIO_LOG_DEBUG("HTTP parser error.");
+  http1_flush(parser2http(parser));
   fio_close(parser2http(parser)->p.uuid);
   return -1;
 }
@@ -677,19 +977,27 @@ Connection Callbacks
 ***************************************************************************** */
 
 static inline void http1_consume_data(intptr_t uuid, http1pr_s *p) {
-  if (fio_pending(uuid) > 4) {
+  if (fio_pending(uuid) > p->p.settings->pipeline_throttle) {
     goto throttle;
   }
   ssize_t i = 0;
   size_t org_len = p->buf_len;
-  int pipeline_limit = 8;
+  int pipeline_limit = p->p.settings->pipeline_depth;
   if (!p->buf_len)
     return;
+  /* coalesce the responses to all the requests parsed in this pass */
+  p->batch = 1;
   do {
     i = http1_parse(&p->parser, p->buf + (org_len - p->buf_len), p->buf_len);
     p->buf_len -= i;
     --pipeline_limit;
+    if (p->p.timing.start && !p->p.timing.headers &&
+        (p->parser.state.reserved & HTTP1_P_FLAG_HEADER_COMPLETE))
+      p->p.timing.headers = http_timing_now(); /* waiting for the body */
   } while (i && p->buf_len && pipeline_limit && !p->stop);
+  p->batch = 0;
+  http1_flush(p);
+  http1_timing_test_flushed(p);
 
   if (p->buf_len && org_len != p->buf_len) {
     memmove(p->buf, p->buf + (org_len - p->buf_len), p->buf_len);
@@ -749,6 +1057,12 @@ static void http1_on_ready(intptr_t uuid, fio_protocol_s *protocol) {
     p->stop ^= 4; /* flip back the bit, so it's zero */
     fio_force_event(uuid, FIO_EVENT_ON_DATA);
   }
+  /* the queued responses were written to the socket */
+  http1_timing_test_flushed(p);
+  /* continue a stream that was waiting for the client */
+  if (p->stream_on_ready)
+    fio_defer_io_task(uuid, .type = FIO_PR_LOCK_TASK,
+                      .task = http1_stream_ready_task);
   (void)protocol;
 }
 
@@ -815,12 +1129,34 @@ fio_protocol_s *http1_new(uintptr_t uuid, http_settings_s *settings,
 /** Manually destroys the HTTP1 protocol object. */
 void http1_destroy(fio_protocol_s *pr) {
   http1pr_s *p = (http1pr_s *)pr;
+  fiobj_free(p->out);
+  http_compress_free(p->stream_compress);
+  http1_timing_flushed(p, 0);
+  fiobj_free(p->p.timing.method);
+  fiobj_free(p->p.timing.path);
+  if (p->streaming) {
+    /* let the application release any streaming state */
+    p->streaming = 0;
+    p->p.settings->on_body_chunk(&http1_pr2handle(p), NULL, 0);
+  }
   http1_pr2handle(p).status = 0;
   http_s_destroy(&http1_pr2handle(p), 0);
   fio_free(p);
   // FIO_LOG_DEBUG("Deallocated HTTP/1.1 protocol at. %p", (void *)p);
 }
 
+/** Resumes reading a request body that was paused by `on_body_chunk`. */
+void http1_body_resume(fio_protocol_s *pr) {
+  if (pr->on_close != http1_on_close)
+    return; /* the connection was upgraded (or isn't an HTTP/1.x connection) */
+  http1pr_s *p = (http1pr_s *)pr;
+  if (!(p->stop & 8))
+    return;
+  p->stop ^= 8;
+  if (!p->stop)
+    fio_force_event(p->p.uuid, FIO_EVENT_ON_DATA);
+}
+
 /* *****************************************************************************
 Protocol Data
 ***************************************************************************** */
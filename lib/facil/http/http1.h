@@ -15,6 +15,14 @@ License: MIT
 #define HTTP1_READ_BUFFER (8 * 1024) /* ~8kb */
 #endif
 
+#ifndef HTTP1_WRITE_BUFFER
+/**
+ * Responses to pipelined requests are coalesced into a single write of up to
+ * this many bytes (larger responses are sent on their own).
+ */
+#define HTTP1_WRITE_BUFFER (64 * 1024) /* ~64kb */
+#endif
+
 /** Creates an HTTP1 protocol object and handles any unread data in the buffer
  * (if any). */
 fio_protocol_s *http1_new(uintptr_t uuid, http_settings_s *settings,
@@ -23,6 +31,13 @@ fio_protocol_s *http1_new(uintptr_t uuid, http_settings_s *settings,
 /** Manually destroys the HTTP1 protocol object. */
 void http1_destroy(fio_protocol_s *);
 
+/**
+ * Resumes reading a request body that was paused by `on_body_chunk`.
+ *
+ * Must be called within the connection's lock (see `http_body_resume`).
+ */
+void http1_body_resume(fio_protocol_s *pr);
+
 /** returns the HTTP/1.1 protocol's VTable. */
 void *http1_vtable(void);
 
@@ -0,0 +1,611 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#include <http_internal.h>
+
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* *****************************************************************************
+Shared Memory Response Cache
+
+The cache is a single memory mapped (shared, anonymous) region, created before
+the worker processes are forked, so all the workers share the same responses.
+
+The region starts with a header, followed by an open addressing index (linear
+probing, entry numbers + 1) and fixed size entries.
+
+Readers never lock. Each entry is protected by a sequence counter (odd while
+the entry is being written), readers copy the entry and test the sequence
+afterwards. Writers (cache misses) are serialized by a spinlock stored in the
+shared region, holding the writer's pid, so a worker that died while writing
+doesn't block the others (the next writer takes over and discards the entry
+that was being written).
+
+Entries are evicted using the CLOCK algorithm (cache hits set the entry's
+reference bit).
+***************************************************************************** */
+
+#ifndef HTTP_CACHE_KEY_LIMIT
+/** The maximum length of a cache key (host, path, query and vary headers). */
+#define HTTP_CACHE_KEY_LIMIT 2048
+#endif
+
+typedef struct {
+  volatile pid_t owner;   /* the writer's pid (0 when unlocked) */
+  uint32_t hand;          /* the CLOCK hand */
+  uint32_t count;         /* number of entries */
+  uint32_t index_mask;    /* index capacity - 1 */
+  uint32_t entry_size;    /* the size of each entry (including the header) */
+  volatile size_t hits;   /* statistics */
+  volatile size_t misses; /* statistics */
+} http_cache_head_s;
+
+typedef struct {
+  volatile uint64_t seq; /* odd while the entry is being written */
+  uint64_t hash;         /* 0 == empty */
+  int64_t created;       /* for the `age` header */
+  int64_t expires;       /* the entry is stale after this time */
+  uint32_t key_len;      /* the key is stored first */
+  uint32_t head_len;     /* followed by the headers ("name\0value\0"...) */
+  uint32_t body_len;     /* followed by the body */
+  volatile uint8_t referenced; /* the CLOCK reference bit */
+} http_cache_entry_s;
+
+struct http_cache_s {
+  http_cache_head_s *head;
+  size_t mem_len;
+  size_t vary_count;
+  FIOBJ vary[];
+};
+
+#define HTTP_CACHE_INDEX(c) ((volatile uint32_t *)((c)->head + 1))
+#define HTTP_CACHE_ENTRY(c, i)                                                 \
+  ((http_cache_entry_s *)((uintptr_t)(HTTP_CACHE_INDEX(c) +                    \
+                                      (c)->head->index_mask + 1) +             \
+                          ((size_t)(i) * (c)->head->entry_size)))
+#define HTTP_CACHE_ENTRY_DATA(e) ((char *)((e) + 1))
+
+/* *****************************************************************************
+Creating / Destroying the cache
+***************************************************************************** */
+
+/** Creates a shared memory response cache (see `cache_size`). */
+http_cache_s *http_cache_new(size_t size, const char *vary,
+                             uint8_t vary_encoding) {
+  size_t vary_count = vary_encoding;
+  for (const char *pos = vary; pos && *pos; ++pos)
+    vary_count += (*pos == ',');
+  if (vary && *vary)
+    ++vary_count;
+  const size_t entry_size = sizeof(http_cache_entry_s) + HTTP_CACHE_ENTRY_SIZE;
+  size_t count = size / entry_size;
+  if (count < 2 || count > (1UL << 24)) {
+    FIO_LOG_ERROR("HTTP response cache size (%zu) out of range", size);
+    return NULL;
+  }
+  size_t index_len = 4;
+  while (index_len < (count << 1))
+    index_len <<= 1;
+  size_t mem_len = sizeof(http_cache_head_s) + (index_len * sizeof(uint32_t)) +
+                   (count * entry_size);
+  void *mem = mmap(NULL, mem_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (mem == MAP_FAILED) {
+    FIO_LOG_ERROR("couldn't map HTTP response cache memory: %s",
+                  strerror(errno));
+    return NULL;
+  }
+  http_cache_s *c = malloc(sizeof(*c) + (vary_count * sizeof(FIOBJ)));
+  FIO_ASSERT_ALLOC(c);
+  *c = (http_cache_s){.head = mem, .mem_len = mem_len};
+  *c->head = (http_cache_head_s){
+      .count = (uint32_t)count,
+      .index_mask = (uint32_t)(index_len - 1),
+      .entry_size = (uint32_t)entry_size,
+  };
+  /* collect the (lower case, trimmed) vary header names */
+  while (vary && *vary) {
+    while (*vary == ' ' || *vary == ',')
+      ++vary;
+    const char *end = vary;
+    while (*end && *end != ',')
+      ++end;
+    size_t len = end - vary;
+    while (len && vary[len - 1] == ' ')
+      --len;
+    if (len) {
+      FIOBJ name = fiobj_str_new(vary, len);
+      fio_str_info_s s = fiobj_obj2cstr(name);
+      for (size_t i = 0; i < s.len; ++i)
+        s.data[i] = tolower(s.data[i]);
+      c->vary[c->vary_count++] = name;
+    }
+    vary = end;
+  }
+  if (vary_encoding) {
+    /* compressed responses vary by the accepted encoding */
+    c->vary[c->vary_count++] = fiobj_dup(HTTP_HVALUE_ACCEPT_ENCODING);
+  }
+  for (size_t i = 0; i < c->vary_count; ++i)
+    fiobj_obj2hash(c->vary[i]);
+  return c;
+}
+
+/** Frees the (process's) cache object, unmapping the shared memory. */
+void http_cache_free(http_cache_s *c) {
+  if (!c)
+    return;
+  for (size_t i = 0; i < c->vary_count; ++i)
+    fiobj_free(c->vary[i]);
+  munmap(c->head, c->mem_len);
+  free(c);
+}
+
+/* *****************************************************************************
+Cache keys and Cache-Control
+***************************************************************************** */
+
+/* writes the request's cache key to `dest`, returns 0 if it doesn't fit */
+static size_t http_cache_key(http_cache_s *c, http_s *h, char *dest) {
+  size_t len = 0;
+#define HTTP_CACHE_KEY_ADD(data_, len_)                                        \
+  do {                                                                         \
+    if (len + (len_) + 1 > HTTP_CACHE_KEY_LIMIT)                               \
+      return 0;                                                                \
+    memcpy(dest + len, (data_), (len_));                                       \
+    len += (len_);                                                             \
+    dest[len++] = 0;                                                           \
+  } while (0)
+  /* name based virtual hosts share the cache, so the key starts with the
+   * (case insensitive) host */
+  FIOBJ host = fiobj_hash_get2(h->headers, fiobj_obj2hash(HTTP_HEADER_HOST));
+  if (FIOBJ_TYPE_IS(host, FIOBJ_T_ARRAY))
+    return 0;
+  fio_str_info_s s =
+      host ? fiobj_obj2cstr(host) : (fio_str_info_s){.data = (char *)""};
+  HTTP_CACHE_KEY_ADD(s.data, s.len);
+  for (size_t i = 0; i < s.len; ++i)
+    dest[i] = tolower(dest[i]);
+  s = fiobj_obj2cstr(h->path);
+  HTTP_CACHE_KEY_ADD(s.data, s.len);
+  s = (fio_str_info_s){.data = (char *)""};
+  if (h->query)
+    s = fiobj_obj2cstr(h->query);
+  HTTP_CACHE_KEY_ADD(s.data, s.len);
+  for (size_t i = 0; i < c->vary_count; ++i) {
+    FIOBJ val = fiobj_hash_get2(h->headers, fiobj_obj2hash(c->vary[i]));
+    if (FIOBJ_TYPE_IS(val, FIOBJ_T_ARRAY))
+      val = fiobj_ary_index(val, -1);
+    s = val ? fiobj_obj2cstr(val) : (fio_str_info_s){.data = (char *)""};
+    HTTP_CACHE_KEY_ADD(s.data, s.len);
+  }
+#undef HTTP_CACHE_KEY_ADD
+  return len;
+}
+
+/* tests for a (case insensitive) token in a comma separated header value */
+static int http_cache_has_token(FIOBJ header, const char *token, size_t len) {
+  if (!header)
+    return 0;
+  if (FIOBJ_TYPE_IS(header, FIOBJ_T_ARRAY)) {
+    size_t count = fiobj_ary_count(header);
+    for (size_t i = 0; i < count; ++i) {
+      if (http_cache_has_token(fiobj_ary_index(header, i), token, len))
+        return 1;
+    }
+    return 0;
+  }
+  fio_str_info_s s = fiobj_obj2cstr(header);
+  for (size_t i = 0; i + len <= s.len; ++i) {
+    if ((i && s.data[i - 1] != ',' && s.data[i - 1] != ' ') ||
+        strncasecmp(s.data + i, token, len))
+      continue;
+    if (i + len == s.len || s.data[i + len] == ',' ||
+        s.data[i + len] == ' ' || s.data[i + len] == '=' ||
+        s.data[i + len] == ';')
+      return 1;
+  }
+  return 0;
+}
+
+/* returns the shared cache lifetime of a response, 0 if it can't be cached */
+static int64_t http_cache_lifetime(FIOBJ cache_control) {
+  if (!cache_control || FIOBJ_TYPE_IS(cache_control, FIOBJ_T_ARRAY) ||
+      http_cache_has_token(cache_control, "no-store", 8) ||
+      http_cache_has_token(cache_control, "no-cache", 8) ||
+      http_cache_has_token(cache_control, "private", 7))
+    return 0;
+  fio_str_info_s s = fiobj_obj2cstr(cache_control);
+  int64_t max_age = 0;
+  for (size_t i = 0; i < s.len; ++i) {
+    if (i && s.data[i - 1] != ',' && s.data[i - 1] != ' ')
+      continue;
+    if (i + 8 <= s.len && !strncasecmp(s.data + i, "max-age=", 8)) {
+      char *pos = s.data + i + 8;
+      if (!max_age) /* `s-maxage` takes precedence */
+        max_age = fio_atol(&pos);
+    } else if (i + 9 <= s.len && !strncasecmp(s.data + i, "s-maxage=", 9)) {
+      char *pos = s.data + i + 9;
+      max_age = fio_atol(&pos);
+      break;
+    }
+  }
+  return max_age > 0 ? max_age : 0;
+}
+
+/* tests if the request may use (or fill) the cache */
+static int http_cache_request_allowed(http_s *h, uint8_t storing) {
+  static uint64_t auth_hash = 0;
+  if (!auth_hash)
+    auth_hash = fiobj_hash_string("authorization", 13);
+  fio_str_info_s method = fiobj_obj2cstr(h->method);
+  if (method.len != 3 || memcmp(method.data, "GET", 3) ||
+      fiobj_hash_get2(h->headers, auth_hash))
+    return 0;
+  FIOBJ cc = fiobj_hash_get2(h->headers,
+                             fiobj_obj2hash(HTTP_HEADER_CACHE_CONTROL));
+  if (storing)
+    return !http_cache_has_token(cc, "no-store", 8);
+  return !http_cache_has_token(cc, "no-cache", 8) &&
+         !http_cache_has_token(cc, "no-store", 8);
+}
+
+/* *****************************************************************************
+The index
+***************************************************************************** */
+
+/* finds the index position holding the entry, -1 if missing (writers only) */
+static int64_t http_cache_index_find(http_cache_s *c, uint64_t hash,
+                                     uint32_t entry) {
+  volatile uint32_t *index = HTTP_CACHE_INDEX(c);
+  for (uint32_t i = 0, pos = hash & c->head->index_mask;
+       i <= c->head->index_mask; ++i, pos = (pos + 1) & c->head->index_mask) {
+    if (!index[pos])
+      return -1;
+    if (index[pos] == entry + 1)
+      return pos;
+  }
+  return -1;
+}
+
+/* removes an index position, shifting the following positions back */
+static void http_cache_index_remove(http_cache_s *c, uint32_t pos) {
+  volatile uint32_t *index = HTTP_CACHE_INDEX(c);
+  const uint32_t mask = c->head->index_mask;
+  uint32_t next = (pos + 1) & mask;
+  while (index[next]) {
+    uint32_t home =
+        HTTP_CACHE_ENTRY(c, index[next] - 1)->hash & mask; /* desired pos */
+    /* move `next` back if `pos` lies cyclically in [home, next) */
+    if (((next - home) & mask) >= ((next - pos) & mask)) {
+      index[pos] = index[next];
+      pos = next;
+    }
+    next = (next + 1) & mask;
+  }
+  index[pos] = 0;
+}
+
+static void http_cache_index_add(http_cache_s *c, uint64_t hash,
+                                 uint32_t entry) {
+  volatile uint32_t *index = HTTP_CACHE_INDEX(c);
+  uint32_t pos = hash & c->head->index_mask;
+  while (index[pos])
+    pos = (pos + 1) & c->head->index_mask;
+  index[pos] = entry + 1;
+}
+
+/* *****************************************************************************
+Cache lookup
+***************************************************************************** */
+
+/* sets a cached response's headers */
+static void http_cache_set_headers(http_s *h, char *pos, char *end) {
+  while (pos < end) {
+    size_t name_len = strlen(pos);
+    char *value = pos + name_len + 1;
+    size_t value_len = strlen(value);
+    http_set_header2(h, (fio_str_info_s){.data = pos, .len = name_len},
+                     (fio_str_info_s){.data = value, .len = value_len});
+    pos = value + value_len + 1;
+  }
+}
+
+/* tests the `if-none-match` request header against the response's ETag */
+static int http_cache_not_modified(http_s *h) {
+  static uint64_t inm_hash = 0;
+  if (!inm_hash)
+    inm_hash = fiobj_hash_string("if-none-match", 13);
+  FIOBJ inm = fiobj_hash_get2(h->headers, inm_hash);
+  FIOBJ etag = fiobj_hash_get2(h->private_data.out_headers,
+                               fiobj_obj2hash(HTTP_HEADER_ETAG));
+  if (!inm || !etag || FIOBJ_TYPE_IS(etag, FIOBJ_T_ARRAY))
+    return 0;
+  fio_str_info_s tag = fiobj_obj2cstr(etag);
+  return http_cache_has_token(inm, tag.data, tag.len) ||
+         http_cache_has_token(inm, "*", 1);
+}
+
+/**
+ * Sends the cached response for the request, if any.
+ *
+ * Returns 0 if the response was sent and -1 otherwise.
+ */
+int http_cache_serve(http_cache_s *c, http_s *h) {
+  if (!c || !http_cache_request_allowed(h, 0))
+    return -1;
+  char key[HTTP_CACHE_KEY_LIMIT];
+  size_t key_len = http_cache_key(c, h, key);
+  if (!key_len)
+    return -1;
+  uint64_t hash = FIO_HASH_FN(key, key_len, 0, 0);
+  hash += !hash;
+  const int64_t now = fio_last_tick().tv_sec;
+  volatile uint32_t *index = HTTP_CACHE_INDEX(c);
+  const uint32_t mask = c->head->index_mask;
+  uint32_t pos = hash & mask;
+  for (uint32_t i = 0; i <= mask; ++i, pos = (pos + 1) & mask) {
+    uint32_t entry_num = index[pos];
+    if (!entry_num || entry_num > c->head->count)
+      break;
+    http_cache_entry_s *e = HTTP_CACHE_ENTRY(c, entry_num - 1);
+    uint64_t seq = e->seq;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if ((seq & 1) || e->hash != hash || e->key_len != key_len ||
+        e->expires <= now)
+      continue;
+    const size_t head_len = e->head_len;
+    const size_t body_len = e->body_len;
+    const int64_t created = e->created;
+    if (key_len + head_len + body_len + sizeof(*e) > c->head->entry_size)
+      continue; /* torn read */
+    char *data = fio_malloc(head_len + body_len + 1);
+    FIO_ASSERT_ALLOC(data);
+    int match = !memcmp(HTTP_CACHE_ENTRY_DATA(e), key, key_len);
+    memcpy(data, HTTP_CACHE_ENTRY_DATA(e) + key_len, head_len + body_len);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (!match || e->seq != seq) {
+      fio_free(data);
+      continue;
+    }
+    e->referenced = 1;
+    fio_atomic_add(&c->head->hits, 1);
+    /* send the response */
+    h->status = 200;
+    http_cache_set_headers(h, data, data + head_len);
+    char age[24];
+    http_set_header2(h, (fio_str_info_s){.data = (char *)"age", .len = 3},
+                     (fio_str_info_s){.data = age,
+                                      .len = fio_ltoa(age,
+                                                      now > created
+                                                          ? now - created
+                                                          : 0,
+                                                      10)});
+    if (http_cache_not_modified(h)) {
+      h->status = 304;
+      http_finish(h);
+    } else {
+      http_send_body_uncompressed______internal(h, data + head_len, body_len);
+    }
+    fio_free(data);
+    return 0;
+  }
+  fio_atomic_add(&c->head->misses, 1);
+  return -1;
+}
+
+/* *****************************************************************************
+Storing responses
+***************************************************************************** */
+
+typedef struct {
+  char *pos;
+  char *end;
+  FIOBJ name;
+} http_cache_writer_s;
+
+/* serializes a response header, returns -1 if the response can't be cached */
+static int http_cache_write_header(FIOBJ o, void *w_) {
+  http_cache_writer_s *w = w_;
+  if (fiobj_hash_key_in_loop())
+    w->name = fiobj_hash_key_in_loop();
+  if (FIOBJ_TYPE_IS(o, FIOBJ_T_ARRAY)) {
+    FIOBJ name = w->name;
+    fiobj_each1(o, 0, http_cache_write_header, w);
+    w->name = name;
+    return w->pos ? 0 : -1;
+  }
+  fio_str_info_s name = fiobj_obj2cstr(w->name);
+  /* skip hop-by-hop headers and headers set when the response is sent */
+  switch (name.len) {
+  case 3:
+    if (!memcmp(name.data, "age", 3))
+      return 0;
+    break;
+  case 10:
+    if (!memcmp(name.data, "connection", 10) ||
+        !memcmp(name.data, "keep-alive", 10))
+      return 0;
+    if (!memcmp(name.data, "set-cookie", 10))
+      goto abort;
+    break;
+  case 14:
+    if (!memcmp(name.data, "content-length", 14))
+      return 0;
+    break;
+  case 17:
+    if (!memcmp(name.data, "transfer-encoding", 17))
+      return 0;
+    break;
+  }
+  fio_str_info_s value = fiobj_obj2cstr(o);
+  if (!w->pos || (size_t)(w->end - w->pos) < name.len + value.len + 2 ||
+      memchr(value.data, 0, value.len))
+    goto abort;
+  memcpy(w->pos, name.data, name.len);
+  w->pos += name.len;
+  *(w->pos++) = 0;
+  memcpy(w->pos, value.data, value.len);
+  w->pos += value.len;
+  *(w->pos++) = 0;
+  return 0;
+abort:
+  w->pos = NULL;
+  return -1;
+}
+
+/* *****************************************************************************
+The writers' lock
+***************************************************************************** */
+
+/* discards entries left half written by a writer that died (writers only) */
+static void http_cache_recover(http_cache_s *c, pid_t dead) {
+  for (uint32_t num = 0; num < c->head->count; ++num) {
+    http_cache_entry_s *e = HTTP_CACHE_ENTRY(c, num);
+    if (!(e->seq & 1))
+      continue;
+    if (e->hash) {
+      int64_t pos = http_cache_index_find(c, e->hash, num);
+      if (pos >= 0)
+        http_cache_index_remove(c, (uint32_t)pos);
+      e->hash = 0;
+    }
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    e->seq += 1;
+  }
+  FIO_LOG_WARNING("(%d) HTTP response cache writer (%d) died, lock recovered",
+                  (int)getpid(), (int)dead);
+}
+
+/* locks the cache for writing, taking over the lock of a dead writer */
+static void http_cache_lock(http_cache_s *c) {
+  const pid_t self = getpid();
+  for (size_t i = 1;; ++i) {
+    pid_t owner = c->head->owner;
+    if (!owner && __sync_bool_compare_and_swap(&c->head->owner, 0, self))
+      return;
+    if (owner && !(i & 127) && kill(owner, 0) && errno == ESRCH &&
+        __sync_bool_compare_and_swap(&c->head->owner, owner, self)) {
+      http_cache_recover(c, owner);
+      return;
+    }
+    fio_reschedule_thread();
+  }
+}
+
+static void http_cache_unlock(http_cache_s *c) {
+  __atomic_store_n(&c->head->owner, 0, __ATOMIC_RELEASE);
+}
+
+/* selects an entry for a new response (writers only) */
+static uint32_t http_cache_evict(http_cache_s *c, int64_t now) {
+  http_cache_head_s *head = c->head;
+  for (uint32_t i = 0; i < (head->count << 1); ++i) {
+    uint32_t pos = head->hand;
+    head->hand = (pos + 1 == head->count) ? 0 : pos + 1;
+    http_cache_entry_s *e = HTTP_CACHE_ENTRY(c, pos);
+    if (!e->hash || e->expires <= now || !e->referenced)
+      return pos;
+    e->referenced = 0;
+  }
+  return head->hand;
+}
+
+/**
+ * Stores a response (sent using `http_send_body`) if both the request and the
+ * response allow it.
+ */
+void http_cache_store(http_cache_s *c, http_s *h, void *body, size_t len) {
+  if (!c || h->status != 200 || !http_cache_request_allowed(h, 1))
+    return;
+  int64_t lifetime = http_cache_lifetime(fiobj_hash_get2(
+      h->private_data.out_headers, fiobj_obj2hash(HTTP_HEADER_CACHE_CONTROL)));
+  if (!lifetime)
+    return;
+  char key[HTTP_CACHE_KEY_LIMIT];
+  size_t key_len = http_cache_key(c, h, key);
+  const size_t capa = c->head->entry_size - sizeof(http_cache_entry_s);
+  if (!key_len || key_len + len > capa)
+    return;
+  /* serialize the headers before taking the lock */
+  char *headers = fio_malloc(capa - key_len - len + 1);
+  FIO_ASSERT_ALLOC(headers);
+  http_cache_writer_s w = {.pos = headers,
+                           .end = headers + (capa - key_len - len)};
+  fiobj_each1(h->private_data.out_headers, 0, http_cache_write_header, &w);
+  if (!w.pos) {
+    fio_free(headers);
+    return;
+  }
+  const size_t head_len = w.pos - headers;
+  uint64_t hash = FIO_HASH_FN(key, key_len, 0, 0);
+  hash += !hash;
+  const int64_t now = fio_last_tick().tv_sec;
+
+  http_cache_lock(c);
+  /* replace an existing entry for the same key, or evict one */
+  uint32_t num = c->head->count;
+  volatile uint32_t *index = HTTP_CACHE_INDEX(c);
+  for (uint32_t i = 0, pos = hash & c->head->index_mask;
+       i <= c->head->index_mask && index[pos];
+       ++i, pos = (pos + 1) & c->head->index_mask) {
+    http_cache_entry_s *e = HTTP_CACHE_ENTRY(c, index[pos] - 1);
+    if (e->hash == hash && e->key_len == key_len &&
+        !memcmp(HTTP_CACHE_ENTRY_DATA(e), key, key_len)) {
+      num = index[pos] - 1;
+      break;
+    }
+  }
+  uint8_t indexed = (num != c->head->count);
+  if (!indexed) {
+    num = http_cache_evict(c, now);
+    http_cache_entry_s *old = HTTP_CACHE_ENTRY(c, num);
+    if (old->hash) {
+      int64_t pos = http_cache_index_find(c, old->hash, num);
+      if (pos >= 0)
+        http_cache_index_remove(c, (uint32_t)pos);
+    }
+  }
+  http_cache_entry_s *e = HTTP_CACHE_ENTRY(c, num);
+  e->seq += 1; /* odd - readers will ignore the entry */
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  e->hash = hash;
+  e->created = now;
+  e->expires = now + lifetime;
+  e->key_len = (uint32_t)key_len;
+  e->head_len = (uint32_t)head_len;
+  e->body_len = (uint32_t)len;
+  e->referenced = 0;
+  memcpy(HTTP_CACHE_ENTRY_DATA(e), key, key_len);
+  memcpy(HTTP_CACHE_ENTRY_DATA(e) + key_len, headers, head_len);
+  memcpy(HTTP_CACHE_ENTRY_DATA(e) + key_len + head_len, body, len);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  e->seq += 1;
+  if (!indexed)
+    http_cache_index_add(c, hash, num);
+  http_cache_unlock(c);
+  fio_free(headers);
+}
+
+#if DEBUG
+/** Testing: starts writing the first entry and never finishes (or unlocks). */
+void http_cache_test_abandon(http_cache_s *c) {
+  http_cache_lock(c);
+  HTTP_CACHE_ENTRY(c, 0)->seq += 1;
+}
+#endif
+
+/** Returns the number of cache hits and misses (all processes). */
+void http_cache_stats(http_cache_s *c, size_t *hits, size_t *misses) {
+  *hits = c ? c->head->hits : 0;
+  *misses = c ? c->head->misses : 0;
+}
@@ -0,0 +1,783 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#include <fio.h>
+
+#include <fio_tls.h>
+#include <http1.h>
+#include <http_client.h>
+#include <http_internal.h>
+
+#include <ctype.h>
+#include <string.h>
+#include <strings.h>
+
+/* *****************************************************************************
+Client Pool Types
+***************************************************************************** */
+
+typedef struct http_client_origin_s http_client_origin_s;
+
+/* a request, waiting in the origin's queue or in flight on a connection */
+typedef struct {
+  fio_ls_embd_s node;
+  FIOBJ packet;
+  void (*on_response)(http_s *h);
+  void (*on_fail)(void *udata);
+  void *udata;
+  uint8_t retry;      /* GET requests can be retried once */
+  uint8_t idempotent; /* idempotent requests can be pipelined */
+} http_client_req_s;
+
+/* a pooled connection */
+typedef struct {
+  fio_ls_embd_s node;     /* in the origin's connection list */
+  fio_ls_embd_s requests; /* requests in flight, in the order they were sent */
+  http_client_origin_s *origin;
+  http_settings_s *settings;
+  intptr_t uuid;
+  size_t in_flight;
+  size_t unsafe;   /* non-idempotent requests in flight */
+  uint8_t closing; /* the server is closing the connection */
+} http_client_conn_s;
+
+/* an origin's connection pool */
+struct http_client_origin_s {
+  fio_ls_embd_s node;        /* in the pool registry */
+  fio_ls_embd_s queue;       /* requests waiting for a connection */
+  fio_ls_embd_s connections; /* connected connections */
+  char *host;
+  char *port;
+  void *tls;
+  size_t queued;
+  size_t count;      /* connections, including connections in progress */
+  size_t connecting; /* connections in progress */
+  size_t max_connections;
+  size_t pipeline;
+  uint8_t timeout;
+  size_t key_len;
+  char key[];
+};
+
+static fio_ls_embd_s http_client_origins = FIO_LS_INIT(http_client_origins);
+static fio_lock_i http_client_lock = FIO_LOCK_INIT;
+static uint8_t http_client_stopping;
+static uint8_t http_client_initialized;
+
+static void http_client_connect(http_client_origin_s *o);
+
+/* *****************************************************************************
+Requests
+***************************************************************************** */
+
+static void http_client_req_free(http_client_req_s *r) {
+  fiobj_free(r->packet);
+  fio_free(r);
+}
+
+/* calls `on_fail` for (and frees) all the requests in the list */
+static void http_client_fail_list(fio_ls_embd_s *list) {
+  fio_ls_embd_s *node;
+  while ((node = fio_ls_embd_shift(list))) {
+    http_client_req_s *r = FIO_LS_EMBD_OBJ(http_client_req_s, node, node);
+    if (r->on_fail)
+      r->on_fail(r->udata);
+    http_client_req_free(r);
+  }
+}
+
+static int http_client_write_header(FIOBJ o, void *dest_) {
+  FIOBJ dest = (FIOBJ)dest_;
+  FIOBJ name = fiobj_hash_key_in_loop();
+  if (FIOBJ_TYPE_IS(o, FIOBJ_T_ARRAY)) {
+    fiobj_each1(o, 0, http_client_write_header, dest_);
+    return 0;
+  }
+  fio_str_info_s n = fiobj_obj2cstr(name);
+  fio_str_info_s v = fiobj_obj2cstr(o);
+  if (!n.len || !v.data)
+    return 0;
+  fiobj_str_write(dest, n.data, n.len);
+  fiobj_str_write(dest, ":", 1);
+  fiobj_str_write(dest, v.data, v.len);
+  fiobj_str_write(dest, "\r\n", 2);
+  return 0;
+}
+
+/* idempotent methods (RFC 7231, section 4.2.2) */
+static uint8_t http_client_is_idempotent(const char *method) {
+  static const char *const list[] = {"GET",    "HEAD",    "PUT",
+                                     "DELETE", "OPTIONS", "TRACE"};
+  for (size_t i = 0; i < sizeof(list) / sizeof(list[0]); ++i)
+    if (!strcmp(method, list[i]))
+      return 1;
+  return 0;
+}
+
+/* serializes the request, so it can be (re)sent without an `http_s` handle */
+static FIOBJ http_client_packet(fio_url_s *u, const char *method,
+                                FIOBJ headers, const void *body,
+                                size_t body_len) {
+  FIOBJ p = fiobj_str_buf(256 + body_len);
+  fiobj_str_write(p, method, strlen(method));
+  fiobj_str_write(p, " ", 1);
+  if (u->path.data) {
+    /* the path and the query, excluding the target (fragment) */
+    const char *end = u->query.data ? u->query.data + u->query.len
+                                    : u->path.data + u->path.len;
+    fiobj_str_write(p, u->path.data, end - u->path.data);
+  } else {
+    fiobj_str_write(p, "/", 1);
+  }
+  fiobj_str_write(p, " HTTP/1.1\r\nhost:", 16);
+  fiobj_str_write(p, u->host.data, u->host.len);
+  if (u->port.data) {
+    fiobj_str_write(p, ":", 1);
+    fiobj_str_write(p, u->port.data, u->port.len);
+  }
+  fiobj_str_write(p, "\r\n", 2);
+  if (headers && FIOBJ_TYPE_IS(headers, FIOBJ_T_HASH))
+    fiobj_each1(headers, 0, http_client_write_header, (void *)p);
+  if (body_len || strcmp(method, "GET")) {
+    fiobj_str_write(p, "content-length:", 15);
+    fiobj_str_write_i(p, body_len);
+    fiobj_str_write(p, "\r\n", 2);
+  }
+  fiobj_str_write(p, "\r\n", 2);
+  if (body_len)
+    fiobj_str_write(p, body, body_len);
+  return p;
+}
+
+/* *****************************************************************************
+Dispatching requests (called with the lock held)
+***************************************************************************** */
+
+/* sends waiting requests, returning the number of connections to open */
+static size_t http_client_dispatch_unsafe(http_client_origin_s *o) {
+  size_t open = 0;
+  while (o->queued) {
+    http_client_req_s *r =
+        FIO_LS_EMBD_OBJ(http_client_req_s, node, o->queue.next);
+    /* find the least busy connection */
+    http_client_conn_s *best = NULL;
+    FIO_LS_EMBD_FOR(&o->connections, pos) {
+      http_client_conn_s *c = FIO_LS_EMBD_OBJ(http_client_conn_s, node, pos);
+      if (c->closing)
+        continue;
+      /* only idempotent requests are pipelined (a lost connection would leave
+       * other requests in an unknown state), never behind an unsafe request */
+      if (c->in_flight && (!r->idempotent || c->unsafe))
+        continue;
+      if (!best || c->in_flight < best->in_flight)
+        best = c;
+      if (!best->in_flight)
+        break;
+    }
+    if (!best || best->in_flight) {
+      /* prefer a new connection over pipelining */
+      if (!http_client_stopping && o->count < o->max_connections &&
+          o->connecting < o->queued) {
+        ++o->count;
+        ++o->connecting;
+        ++open;
+        continue;
+      }
+      if (o->connecting >= o->queued || !best ||
+          best->in_flight >= o->pipeline)
+        break;
+    }
+    fio_ls_embd_push(&best->requests, fio_ls_embd_shift(&o->queue));
+    --o->queued;
+    ++best->in_flight;
+    best->unsafe += !r->idempotent;
+    /* writing while locked keeps the responses in the same order as the list */
+    fiobj_send_free(best->uuid, fiobj_dup(r->packet));
+  }
+  return open;
+}
+
+static void http_client_dispatch(http_client_origin_s *o) {
+  fio_lock(&http_client_lock);
+  size_t open = http_client_dispatch_unsafe(o);
+  fio_unlock(&http_client_lock);
+  while (open--)
+    http_client_connect(o);
+}
+
+/* *****************************************************************************
+Connection callbacks
+***************************************************************************** */
+
+/* tests the Connection header's (comma separated) tokens for "close" */
+static int http_client_is_closing(FIOBJ value) {
+  if (FIOBJ_TYPE_IS(value, FIOBJ_T_ARRAY)) {
+    for (size_t i = 0; i < fiobj_ary_count(value); ++i)
+      if (http_client_is_closing(fiobj_ary_index(value, (int64_t)i)))
+        return 1;
+    return 0;
+  }
+  fio_str_info_s t = fiobj_obj2cstr(value);
+  while (t.len) {
+    size_t len = 0;
+    while (len < t.len && t.data[len] != ',' && t.data[len] != ' ' &&
+           t.data[len] != '\t')
+      ++len;
+    if (len == 5 && !strncasecmp(t.data, "close", 5))
+      return 1;
+    if (len < t.len)
+      ++len; /* skip the separator */
+    t.data += len;
+    t.len -= len;
+  }
+  return 0;
+}
+
+static void http_client_on_response(http_s *h) {
+  http_client_conn_s *c = h->udata;
+  static uint64_t connection_hash;
+  if (!connection_hash)
+    connection_hash = fiobj_hash_string("connection", 10);
+  fio_lock(&http_client_lock);
+  fio_ls_embd_s *node = fio_ls_embd_shift(&c->requests);
+  http_client_req_s *r = NULL;
+  if (node) {
+    r = FIO_LS_EMBD_OBJ(http_client_req_s, node, node);
+    --c->in_flight;
+    c->unsafe -= !r->idempotent;
+  }
+  FIOBJ tmp = fiobj_hash_get2(h->headers, connection_hash);
+  if (tmp && http_client_is_closing(tmp))
+    c->closing = 1;
+  fio_unlock(&http_client_lock);
+  if (!r) {
+    FIO_LOG_DEBUG("(http client) unexpected response, closing connection.");
+    fio_close(c->uuid);
+    return;
+  }
+  h->udata = r->udata;
+  if (r->on_response)
+    r->on_response(h);
+  http_client_req_free(r);
+  http_client_dispatch(c->origin);
+}
+
+static void http_client_on_upgrade(http_s *h, char *proto, size_t len) {
+  /* pooled connections aren't upgraded, this is just a response */
+  http_client_on_response(h);
+  (void)proto;
+  (void)len;
+}
+
+static void http_client_conn_free(http_client_conn_s *c) {
+  http_settings_free(c->settings);
+  fio_free(c);
+}
+
+static void http_client_on_close(intptr_t uuid, fio_protocol_s *pr) {
+  http_settings_s *set = ((http_fio_protocol_s *)pr)->settings;
+  http_client_conn_s *c = set->udata;
+  http_client_origin_s *o = c->origin;
+  /* call the HTTP/1.1 protocol's `on_close` */
+  ((void (**)(intptr_t, fio_protocol_s *))(set + 1))[0](uuid, pr);
+
+  fio_ls_embd_s failed = FIO_LS_INIT(failed);
+  fio_ls_embd_s *node;
+  fio_lock(&http_client_lock);
+  fio_ls_embd_remove(&c->node);
+  --o->count;
+  /* retry idempotent requests (in order), fail the rest */
+  while ((node = fio_ls_embd_pop(&c->requests))) {
+    http_client_req_s *r = FIO_LS_EMBD_OBJ(http_client_req_s, node, node);
+    if (r->retry && !http_client_stopping) {
+      r->retry = 0;
+      fio_ls_embd_unshift(&o->queue, node);
+      ++o->queued;
+    } else {
+      fio_ls_embd_unshift(&failed, node);
+    }
+  }
+  if (http_client_stopping) {
+    /* nothing left to retry with */
+    while ((node = fio_ls_embd_shift(&o->queue)))
+      fio_ls_embd_push(&failed, node);
+    o->queued = 0;
+  }
+  size_t open = http_client_dispatch_unsafe(o);
+  fio_unlock(&http_client_lock);
+  http_client_fail_list(&failed);
+  while (open--)
+    http_client_connect(o);
+  http_client_conn_free(c);
+}
+
+static void http_client_on_fail(intptr_t uuid, void *c_) {
+  http_client_conn_s *c = c_;
+  http_client_origin_s *o = c->origin;
+  fio_ls_embd_s failed = FIO_LS_INIT(failed);
+  fio_ls_embd_s *node;
+  fio_lock(&http_client_lock);
+  --o->count;
+  --o->connecting;
+  if (!o->count) {
+    /* the origin is unreachable */
+    while ((node = fio_ls_embd_shift(&o->queue)))
+      fio_ls_embd_push(&failed, node);
+    o->queued = 0;
+  }
+  size_t open = http_client_dispatch_unsafe(o);
+  fio_unlock(&http_client_lock);
+  FIO_LOG_DEBUG("(http client) couldn't connect to %s:%s", o->host, o->port);
+  http_client_fail_list(&failed);
+  while (open--)
+    http_client_connect(o);
+  http_client_conn_free(c);
+  (void)uuid;
+}
+
+static void http_client_on_connect(intptr_t uuid, void *c_) {
+  http_client_conn_s *c = c_;
+  http_client_origin_s *o = c->origin;
+  fio_timeout_set(uuid, c->settings->timeout);
+  fio_protocol_s *pr = http1_new(uuid, c->settings, NULL, 0);
+  if (!pr) {
+    fio_close(uuid);
+    http_client_on_fail(uuid, c);
+    return;
+  }
+  { /* store the original on_close at the end of the struct, we wrap it. */
+    void (**original)(intptr_t, fio_protocol_s *) =
+        (void (**)(intptr_t, fio_protocol_s *))(c->settings + 1);
+    *original = pr->on_close;
+    pr->on_close = http_client_on_close;
+  }
+  fio_lock(&http_client_lock);
+  c->uuid = uuid;
+  --o->connecting;
+  fio_ls_embd_push(&o->connections, &c->node);
+  size_t open = http_client_dispatch_unsafe(o);
+  fio_unlock(&http_client_lock);
+  while (open--)
+    http_client_connect(o);
+}
+
+/* opens a connection (already counted by `http_client_dispatch_unsafe`) */
+static void http_client_connect(http_client_origin_s *o) {
+  http_client_conn_s *c = fio_malloc(sizeof(*c));
+  FIO_ASSERT_ALLOC(c);
+  *c = (http_client_conn_s){
+      .requests = FIO_LS_INIT(c->requests),
+      .node = FIO_LS_INIT(c->node),
+      .origin = o,
+      .uuid = -1,
+  };
+  c->settings = http_settings_new((http_settings_s){
+      .on_response = http_client_on_response,
+      .on_upgrade = http_client_on_upgrade,
+      .udata = c,
+      .timeout = o->timeout,
+  });
+  c->settings->is_client = 1;
+  fio_connect(.address = o->host, .port = o->port, .tls = o->tls,
+              .on_connect = http_client_on_connect,
+              .on_fail = http_client_on_fail, .udata = c,
+              .timeout = o->timeout);
+}
+
+/* *****************************************************************************
+Origins
+***************************************************************************** */
+
+static void http_client_on_shutdown(void *ignr) {
+  fio_ls_embd_s failed = FIO_LS_INIT(failed);
+  fio_ls_embd_s *node;
+  fio_lock(&http_client_lock);
+  http_client_stopping = 1;
+  FIO_LS_EMBD_FOR(&http_client_origins, pos) {
+    http_client_origin_s *o = FIO_LS_EMBD_OBJ(http_client_origin_s, node, pos);
+    while ((node = fio_ls_embd_shift(&o->queue)))
+      fio_ls_embd_push(&failed, node);
+    o->queued = 0;
+  }
+  fio_unlock(&http_client_lock);
+  http_client_fail_list(&failed);
+  (void)ignr;
+}
+
+static void http_client_in_child(void *ignr) {
+  http_client_lock = FIO_LOCK_INIT;
+  http_client_stopping = 0;
+  (void)ignr;
+}
+
+static void http_client_at_exit(void *ignr) {
+  fio_ls_embd_s *node;
+  while ((node = fio_ls_embd_shift(&http_client_origins))) {
+    http_client_origin_s *o = FIO_LS_EMBD_OBJ(http_client_origin_s, node, node);
+    fio_ls_embd_s *r;
+    while ((r = fio_ls_embd_shift(&o->queue)))
+      http_client_req_free(FIO_LS_EMBD_OBJ(http_client_req_s, node, r));
+    if (o->tls)
+      fio_tls_destroy(o->tls);
+    fio_free(o->host);
+    fio_free(o);
+  }
+  (void)ignr;
+}
+
+/* writes the normalized origin (scheme://host:port) to `key` */
+static size_t http_client_origin_key(char *key, size_t capa, fio_url_s *u,
+                                     uint8_t *is_secure) {
+  *is_secure = 0;
+  if (u->scheme.data) {
+    if (u->scheme.len == 5 && !strncasecmp(u->scheme.data, "https", 5))
+      *is_secure = 1;
+    else if (u->scheme.len != 4 || strncasecmp(u->scheme.data, "http", 4))
+      return 0;
+  }
+  if (!u->host.len)
+    return 0;
+  fio_str_info_s port = u->port;
+  if (!port.data)
+    port = *is_secure ? (fio_str_info_s){.data = "443", .len = 3}
+                      : (fio_str_info_s){.data = "80", .len = 2};
+  if (u->host.len + port.len + 10 > capa)
+    return 0;
+  size_t len = 0;
+  memcpy(key, (*is_secure ? "https://" : "http://"), 7 + *is_secure);
+  len += 7 + *is_secure;
+  for (size_t i = 0; i < u->host.len; ++i)
+    key[len++] = (char)tolower((unsigned char)u->host.data[i]);
+  key[len++] = ':';
+  memcpy(key + len, port.data, port.len);
+  len += port.len;
+  key[len] = 0;
+  return len;
+}
+
+/* finds or creates an origin (called with the lock held) */
+static http_client_origin_s *
+http_client_origin_unsafe(fio_url_s *u, http_client_settings_s *settings) {
+  char key[512];
+  uint8_t is_secure;
+  size_t key_len = http_client_origin_key(key, sizeof(key), u, &is_secure);
+  if (!key_len)
+    return NULL;
+  FIO_LS_EMBD_FOR(&http_client_origins, pos) {
+    http_client_origin_s *o = FIO_LS_EMBD_OBJ(http_client_origin_s, node, pos);
+    if (o->key_len == key_len && !memcmp(o->key, key, key_len))
+      return o;
+  }
+  if (is_secure && (!settings || !settings->tls)) {
+    FIO_LOG_ERROR("(http client) %s requires a TLS object (http_client_setup).",
+                  key);
+    return NULL;
+  }
+  if (!http_client_initialized) {
+    http_client_initialized = 1;
+    fio_state_callback_add(FIO_CALL_ON_SHUTDOWN, http_client_on_shutdown,
+                           NULL);
+    fio_state_callback_add(FIO_CALL_IN_CHILD, http_client_in_child, NULL);
+    fio_state_callback_add(FIO_CALL_AT_EXIT, http_client_at_exit, NULL);
+  }
+  http_client_origin_s *o = fio_malloc(sizeof(*o) + key_len + 1);
+  FIO_ASSERT_ALLOC(o);
+  *o = (http_client_origin_s){
+      .queue = FIO_LS_INIT(o->queue),
+      .connections = FIO_LS_INIT(o->connections),
+      .max_connections = HTTP_CLIENT_MAX_CONNECTIONS,
+      .pipeline = HTTP_CLIENT_PIPELINE_DEPTH,
+      .timeout = HTTP_CLIENT_TIMEOUT,
+      .key_len = key_len,
+  };
+  memcpy(o->key, key, key_len + 1);
+  if (settings) {
+    if (settings->max_connections)
+      o->max_connections = settings->max_connections;
+    if (settings->pipeline)
+      o->pipeline = settings->pipeline;
+    if (settings->timeout)
+      o->timeout = settings->timeout;
+    if (settings->tls) {
+      fio_tls_dup(settings->tls);
+      o->tls = settings->tls;
+    }
+  }
+  /* "scheme://host:port" => "host\0port" */
+  const size_t scheme_len = 7 + is_secure;
+  o->host = fio_malloc(key_len - scheme_len + 1);
+  FIO_ASSERT_ALLOC(o->host);
+  memcpy(o->host, key + scheme_len, key_len - scheme_len + 1);
+  o->port = strrchr(o->host, ':');
+  *(o->port++) = 0;
+  fio_ls_embd_push(&http_client_origins, &o->node);
+  return o;
+}
+
+/* *****************************************************************************
+Public API
+***************************************************************************** */
+
+/**
+ * Sets the connection pool settings for an origin.
+ */
+int http_client_setup FIO_IGNORE_MACRO(const char *origin,
+                                       http_client_settings_s settings) {
+  if (!origin)
+    return -1;
+  fio_url_s u = fio_url_parse(origin, strlen(origin));
+  fio_lock(&http_client_lock);
+  http_client_origin_s *o = http_client_origin_unsafe(&u, &settings);
+  if (o) {
+    /* the origin might have existed before */
+    if (settings.max_connections)
+      o->max_connections = settings.max_connections;
+    if (settings.pipeline)
+      o->pipeline = settings.pipeline;
+    if (settings.timeout)
+      o->timeout = settings.timeout;
+  }
+  fio_unlock(&http_client_lock);
+  return o ? 0 : -1;
+}
+
+/**
+ * Sends an HTTP/1.1 request using a pool of keep-alive connections to the
+ * URL's origin.
+ */
+int http_client_request FIO_IGNORE_MACRO(const char *url,
+                                         http_client_request_args_s args) {
+  if (!url || !args.on_response)
+    return -1;
+  fio_url_s u = fio_url_parse(url, strlen(url));
+  if (!args.method)
+    args.method = "GET";
+  if (!strcmp(args.method, "HEAD"))
+    return -1; /* the parser can't tell that the response has no body */
+  http_client_req_s *r = fio_malloc(sizeof(*r));
+  FIO_ASSERT_ALLOC(r);
+  *r = (http_client_req_s){
+      .node = FIO_LS_INIT(r->node),
+      .on_response = args.on_response,
+      .on_fail = args.on_fail,
+      .udata = args.udata,
+      .retry = !strcmp(args.method, "GET"),
+      .idempotent = http_client_is_idempotent(args.method),
+  };
+
+  fio_lock(&http_client_lock);
+  http_client_origin_s *o =
+      (http_client_stopping ? NULL : http_client_origin_unsafe(&u, NULL));
+  if (!o) {
+    fio_unlock(&http_client_lock);
+    fio_free(r);
+    return -1;
+  }
+  fio_unlock(&http_client_lock);
+
+  r->packet =
+      http_client_packet(&u, args.method, args.headers, args.body,
+                         args.body_len);
+  fio_lock(&http_client_lock);
+  fio_ls_embd_push(&o->queue, &r->node);
+  ++o->queued;
+  size_t open = http_client_dispatch_unsafe(o);
+  fio_unlock(&http_client_lock);
+  while (open--)
+    http_client_connect(o);
+  return 0;
+}
+
+/* *****************************************************************************
+Testing
+***************************************************************************** */
+#if DEBUG
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static http_client_origin_s *http_client_test_origin;
+/* client events (responses and failures) */
+static FIOBJ http_client_test_log;
+/* server events (the request and the client's in flight count) */
+static FIOBJ http_client_test_server;
+static intptr_t http_client_test_uuid;
+static size_t http_client_test_drops;
+static char http_client_test_url[64];
+static char http_client_test_closed_url[64];
+
+/* finds a free local port (a closed port, unless something binds it) */
+static int http_client_test_port(void) {
+  struct sockaddr_in addr = {.sin_family = AF_INET,
+                             .sin_addr.s_addr = htonl(INADDR_LOOPBACK)};
+  socklen_t len = sizeof(addr);
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  FIO_ASSERT(fd != -1 && !bind(fd, (struct sockaddr *)&addr, sizeof(addr)) &&
+                 !getsockname(fd, (struct sockaddr *)&addr, &len),
+             "couldn't find a free port for HTTP client testing");
+  close(fd);
+  return ntohs(addr.sin_port);
+}
+
+static void http_client_test_on_request(http_s *h) {
+  fio_str_info_s path = fiobj_obj2cstr(h->path);
+  intptr_t uuid = http2protocol(h)->uuid;
+  if (!strcmp(path.data, "/drop2") ||
+      (!strcmp(path.data, "/drop") && !http_client_test_drops++)) {
+    /* the connection is lost before the response is sent */
+    fio_force_close(uuid);
+    http_finish(h);
+    return;
+  }
+  if (!strcmp(path.data, "/1"))
+    http_client_test_uuid = uuid;
+  else if (strcmp(path.data, "/drop"))
+    FIO_ASSERT(uuid == http_client_test_uuid,
+               "HTTP client should reuse the connection for %s", path.data);
+  /* the client's view of the connection when the request arrived */
+  http_client_conn_s *c = FIO_LS_EMBD_OBJ(
+      http_client_conn_s, node, http_client_test_origin->connections.next);
+  char tmp[64];
+  int len = snprintf(tmp, sizeof(tmp), "%s:%zu", path.data, c->in_flight);
+  fiobj_ary_push(http_client_test_server, fiobj_str_new(tmp, len));
+  http_send_body(h, path.data + 1, path.len - 1);
+}
+
+static void http_client_test_on_response(http_s *h);
+
+static void http_client_test_on_fail(void *udata) {
+  char tmp[64];
+  int len = snprintf(tmp, sizeof(tmp), "fail:%s", (char *)udata);
+  fiobj_ary_push(http_client_test_log, fiobj_str_new(tmp, len));
+  if (!strcmp(udata, "closed")) {
+    fio_stop();
+    return;
+  }
+  /* the non-idempotent request wasn't retried, try an unreachable origin */
+  http_client_request(http_client_test_closed_url,
+                      .on_response = http_client_test_on_response,
+                      .on_fail = http_client_test_on_fail, .udata = "closed");
+}
+
+static void http_client_test_on_response(http_s *h) {
+  fio_str_info_s body = fiobj_obj2cstr(h->body);
+  fiobj_ary_push(http_client_test_log, fiobj_str_new(body.data, body.len));
+  char url[80];
+  if (body.len == 1 && body.data[0] == '4') {
+    /* the connection is lost once, the GET request is retried */
+    snprintf(url, sizeof(url), "%s/drop", http_client_test_url);
+    http_client_request(url, .on_response = http_client_test_on_response,
+                        .on_fail = http_client_test_on_fail, .udata = "drop");
+  } else if (body.len == 4 && !memcmp(body.data, "drop", 4)) {
+    snprintf(url, sizeof(url), "%s/drop2", http_client_test_url);
+    http_client_request(url, .method = "POST",
+                        .on_response = http_client_test_on_response,
+                        .on_fail = http_client_test_on_fail, .udata = "drop2");
+  }
+}
+
+static void http_client_test_start(void *ignr) {
+  static const char *const requests[][2] = {
+      {"GET", "/1"}, {"POST", "/2"}, {"GET", "/3"}, {"GET", "/4"}};
+  for (size_t i = 0; i < 4; ++i) {
+    char url[80];
+    snprintf(url, sizeof(url), "%s%s", http_client_test_url, requests[i][1]);
+    FIO_ASSERT(!http_client_request(url, .method = requests[i][0],
+                                    .on_response = http_client_test_on_response,
+                                    .on_fail = http_client_test_on_fail,
+                                    .udata = "pool"),
+               "http_client_request failed");
+  }
+  (void)ignr;
+}
+
+static void http_client_test_timeout(void *ignr) {
+  fiobj_ary_push(http_client_test_log, fiobj_str_new("timeout", 7));
+  fio_stop();
+  (void)ignr;
+}
+
+/* joins the recorded events, i.e. "a|b|c" */
+static FIOBJ http_client_test_join(FIOBJ ary) {
+  FIOBJ s = fiobj_str_buf(128);
+  for (size_t i = 0; i < fiobj_ary_count(ary); ++i) {
+    if (i)
+      fiobj_str_write(s, "|", 1);
+    fiobj_str_concat(s, fiobj_ary_index(ary, (int64_t)i));
+  }
+  return s;
+}
+
+void http_client_tests(void) {
+  fprintf(stderr, "=== Testing the HTTP client pool\n");
+  {
+    fprintf(stderr, "* Connection header parsing.\n");
+    static const struct {
+      const char *value;
+      int closing;
+    } cases[] = {
+        {"close", 1},      {"Close", 1},
+        {"keep-alive, CLOSE", 1}, {" close ,TE", 1},
+        {"keep-alive", 0}, {"closed", 0},
+        {"clos", 0},       {"upgrade,chunked", 0},
+        {"", 0},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+      FIOBJ v = fiobj_str_new(cases[i].value, strlen(cases[i].value));
+      FIO_ASSERT(http_client_is_closing(v) == cases[i].closing,
+                 "Connection header \"%s\" parsing error", cases[i].value);
+      fiobj_free(v);
+    }
+    FIOBJ ary = fiobj_ary_new();
+    fiobj_ary_push(ary, fiobj_str_new("keep-alive", 10));
+    fiobj_ary_push(ary, fiobj_str_new("Close", 5));
+    FIO_ASSERT(http_client_is_closing(ary),
+               "Connection header (array) parsing error");
+    fiobj_free(ary);
+  }
+  {
+    fprintf(stderr, "* Connection reuse, pipelining and failures.\n");
+    char port[16];
+    snprintf(port, sizeof(port), "%d", http_client_test_port());
+    snprintf(http_client_test_url, sizeof(http_client_test_url),
+             "http://127.0.0.1:%s", port);
+    snprintf(http_client_test_closed_url, sizeof(http_client_test_closed_url),
+             "http://127.0.0.1:%d/", http_client_test_port());
+    FIO_ASSERT(http_listen(port, "127.0.0.1",
+                           .on_request = http_client_test_on_request) != -1,
+               "HTTP client test server couldn't listen");
+    /* a single connection makes the pipelining deterministic */
+    FIO_ASSERT(!http_client_setup(http_client_test_url, .max_connections = 1,
+                                  .pipeline = 2),
+               "http_client_setup failed");
+    http_client_test_origin = FIO_LS_EMBD_OBJ(http_client_origin_s, node,
+                                              http_client_origins.prev);
+    http_client_test_log = fiobj_ary_new();
+    http_client_test_server = fiobj_ary_new();
+    fio_run_every(1, 1, http_client_test_start, NULL, NULL);
+    fio_run_every(5000, 1, http_client_test_timeout, NULL, NULL);
+    fio_start(.threads = 1, .workers = 1);
+    FIOBJ client = http_client_test_join(http_client_test_log);
+    FIOBJ server = http_client_test_join(http_client_test_server);
+    /* the POST waits for an idle connection and nothing is pipelined behind
+     * it, only the lost GET request is retried */
+    FIO_ASSERT(!strcmp(fiobj_obj2cstr(server).data, "/1:1|/2:1|/3:2|/4:2|"
+                                                    "/drop:1"),
+               "HTTP client pipelining error: %s", fiobj_obj2cstr(server).data);
+    FIO_ASSERT(!strcmp(fiobj_obj2cstr(client).data,
+                       "1|2|3|4|drop|fail:drop2|fail:closed"),
+               "HTTP client responses / failures error: %s",
+               fiobj_obj2cstr(client).data);
+    fiobj_free(client);
+    fiobj_free(server);
+    fiobj_free(http_client_test_log);
+    fiobj_free(http_client_test_server);
+    /* the pool stopped with the reactor */
+    http_client_stopping = 0;
+  }
+  fprintf(stderr, "* passed.\n");
+}
+#endif
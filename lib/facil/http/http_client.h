@@ -0,0 +1,112 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#ifndef H_HTTP_CLIENT_H
+#define H_HTTP_CLIENT_H
+
+#include <http.h>
+
+/* *****************************************************************************
+Compile Time Settings
+***************************************************************************** */
+
+#ifndef HTTP_CLIENT_MAX_CONNECTIONS
+/** The default maximum number of connections per origin (per process). */
+#define HTTP_CLIENT_MAX_CONNECTIONS 8
+#endif
+
+#ifndef HTTP_CLIENT_PIPELINE_DEPTH
+/** The default maximum number of requests in flight per connection. */
+#define HTTP_CLIENT_PIPELINE_DEPTH 4
+#endif
+
+#ifndef HTTP_CLIENT_TIMEOUT
+/** The default timeout (in seconds) for pooled (idle) connections. */
+#define HTTP_CLIENT_TIMEOUT 30
+#endif
+
+/* *****************************************************************************
+Pooled HTTP Client
+***************************************************************************** */
+
+/** Connection pool settings for an origin, used by `http_client_setup`. */
+typedef struct {
+  /** Maximum number of connections to the origin. */
+  size_t max_connections;
+  /** Maximum number of requests in flight per connection (1 disables
+   * pipelining). */
+  size_t pipeline;
+  /** Connection timeout (in seconds), idle connections are closed. */
+  uint8_t timeout;
+  /** A TLS context, required for "https" origins. */
+  void *tls;
+} http_client_settings_s;
+
+/**
+ * Sets the connection pool settings for an origin (i.e.,
+ * "https://example.com").
+ *
+ * Should be called before any requests are made to the origin. Origins that
+ * weren't set up use the default settings.
+ *
+ * Returns -1 on error and 0 on success.
+ */
+int http_client_setup(const char *origin, http_client_settings_s settings);
+#define http_client_setup(origin, ...)                                         \
+  http_client_setup((origin), (http_client_settings_s){__VA_ARGS__})
+
+/** Request arguments for `http_client_request`. */
+typedef struct {
+  /** The request method, defaults to "GET" ("HEAD" isn't supported). */
+  const char *method;
+  /** An (optional) Hash of request headers (the Hash isn't freed). */
+  FIOBJ headers;
+  /** The (optional) request body. */
+  const void *body;
+  /** The request body's length. */
+  size_t body_len;
+  /**
+   * Called with the response. `h->udata` is set to the request's `udata`.
+   *
+   * The handle is only valid until the callback returns.
+   */
+  void (*on_response)(http_s *h);
+  /** Called instead of `on_response` if the request failed. */
+  void (*on_fail)(void *udata);
+  /** Opaque user data. */
+  void *udata;
+} http_client_request_args_s;
+
+/**
+ * Sends an HTTP/1.1 request using a pool of keep-alive connections to the
+ * URL's origin.
+ *
+ * Requests are sent using an idle connection, a new connection (up to the
+ * origin's `max_connections`) or are pipelined on an existing connection (up to
+ * the origin's `pipeline` depth). Otherwise, requests wait for a connection.
+ *
+ * Only idempotent requests (i.e., GET, PUT or DELETE) are pipelined and never
+ * behind a non-idempotent request (i.e., POST), which waits for an idle
+ * connection.
+ *
+ * GET requests are retried once if the connection is lost before the response
+ * arrives.
+ *
+ * Pools are per process and run in the facil.io reactor, so requests should be
+ * made from within the reactor's worker processes (i.e., after `fio_start`).
+ *
+ * Returns -1 on error (`on_fail` isn't called) and 0 on success (either
+ * `on_response` or `on_fail` will be called).
+ */
+int http_client_request(const char *url, http_client_request_args_s args);
+#define http_client_request(url, ...)                                          \
+  http_client_request((url), (http_client_request_args_s){__VA_ARGS__})
+
+#if DEBUG
+void http_client_tests(void);
+#endif
+
+#endif /* H_HTTP_CLIENT_H */
@@ -0,0 +1,351 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#include <fio.h>
+
+#include <http_compress.h>
+#include <http_internal.h>
+
+#include <ctype.h>
+#include <string.h>
+
+#ifndef HAVE_ZLIB
+#define HAVE_ZLIB 0
+#endif
+#ifndef HAVE_BROTLI
+#define HAVE_BROTLI 0
+#endif
+
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+#if HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+/** the encodings this build supports */
+#define HTTP_COMPRESS_SUPPORTED                                                \
+  ((HAVE_ZLIB ? (HTTP_COMPRESS_DEFLATE | HTTP_COMPRESS_GZIP) : 0) |            \
+   (HAVE_BROTLI ? HTTP_COMPRESS_BR : 0))
+
+/* *****************************************************************************
+Negotiation
+***************************************************************************** */
+
+/** tests for a `q=0` weight (an explicit refusal) */
+static inline int http_compress_refused(const char *pos, const char *end) {
+  while (pos < end && *pos != ',') {
+    if ((pos[0] == 'q' || pos[0] == 'Q') && pos + 1 < end && pos[1] == '=') {
+      pos += 2;
+      if (pos == end || *pos != '0')
+        return 0;
+      for (++pos; pos < end && *pos != ',' && *pos != ';'; ++pos) {
+        if (*pos != '.' && *pos != '0' && *pos != ' ')
+          return 0;
+      }
+      return 1;
+    }
+    ++pos;
+  }
+  return 0;
+}
+
+/**
+ * Returns the preferred content encoding supported by both the client (the
+ * `Accept-Encoding` header value) and facil.io, limited to the `allowed`
+ * encodings (a bitwise OR of `http_compress_e` values).
+ */
+http_compress_e http_compress_negotiate(FIOBJ accept_encoding,
+                                        uint8_t allowed) {
+  if (!accept_encoding)
+    return HTTP_COMPRESS_NONE;
+  if (FIOBJ_TYPE_IS(accept_encoding, FIOBJ_T_ARRAY))
+    accept_encoding = fiobj_ary_index(accept_encoding, -1);
+  fio_str_info_s s = fiobj_obj2cstr(accept_encoding);
+  uint8_t accepted = 0, refused = 0;
+  const char *pos = s.data;
+  const char *end = s.data + s.len;
+  while (pos < end) {
+    while (pos < end && (*pos == ' ' || *pos == ',' || *pos == '\t'))
+      ++pos;
+    const char *name = pos;
+    while (pos < end && *pos != ',' && *pos != ';' && *pos != ' ')
+      ++pos;
+    size_t len = pos - name;
+    uint8_t flag = 0;
+    if (len == 2 && !strncasecmp(name, "br", 2))
+      flag = HTTP_COMPRESS_BR;
+    else if (len == 4 && !strncasecmp(name, "gzip", 4))
+      flag = HTTP_COMPRESS_GZIP;
+    else if (len == 6 && !strncasecmp(name, "x-gzip", 6))
+      flag = HTTP_COMPRESS_GZIP;
+    else if (len == 7 && !strncasecmp(name, "deflate", 7))
+      flag = HTTP_COMPRESS_DEFLATE;
+    else if (len == 1 && name[0] == '*')
+      flag = (HTTP_COMPRESS_BR | HTTP_COMPRESS_GZIP | HTTP_COMPRESS_DEFLATE);
+    if (http_compress_refused(pos, end)) {
+      if (flag != (HTTP_COMPRESS_BR | HTTP_COMPRESS_GZIP |
+                   HTTP_COMPRESS_DEFLATE))
+        refused |= flag;
+    } else {
+      accepted |= flag;
+    }
+    while (pos < end && *pos != ',')
+      ++pos;
+  }
+  accepted &= ~refused;
+  accepted &= allowed;
+  accepted &= HTTP_COMPRESS_SUPPORTED;
+  if (accepted & HTTP_COMPRESS_BR)
+    return HTTP_COMPRESS_BR;
+  if (accepted & HTTP_COMPRESS_GZIP)
+    return HTTP_COMPRESS_GZIP;
+  if (accepted & HTTP_COMPRESS_DEFLATE)
+    return HTTP_COMPRESS_DEFLATE;
+  return HTTP_COMPRESS_NONE;
+}
+
+/** Returns TRUE (1) if the specified Content-Type compresses well. */
+int http_compress_mime(FIOBJ content_type) {
+  if (!content_type)
+    return 0;
+  fio_str_info_s s = fiobj_obj2cstr(content_type);
+  if (s.len >= 5 && !strncasecmp(s.data, "text/", 5))
+    return 1;
+  if (s.len >= 12 && !strncasecmp(s.data, "application/", 12)) {
+    s.data += 12;
+    s.len -= 12;
+    if ((s.len >= 4 && !strncasecmp(s.data, "json", 4)) ||
+        (s.len >= 10 && !strncasecmp(s.data, "javascript", 10)) ||
+        (s.len >= 3 && !strncasecmp(s.data, "xml", 3)) ||
+        (s.len >= 4 && !strncasecmp(s.data, "wasm", 4)) ||
+        (s.len >= 10 && !strncasecmp(s.data, "x-font-ttf", 10)) ||
+        (s.len >= 17 && !strncasecmp(s.data, "vnd.ms-fontobject", 17)))
+      return 1;
+  }
+  if (s.len >= 13 && !strncasecmp(s.data, "image/svg+xml", 13))
+    return 1;
+  /* structured syntax suffixes (`+xml`, `+json`) */
+  for (size_t i = 0; i + 4 < s.len && s.data[i] != ';'; ++i) {
+    if (s.data[i] == '+' && (!strncasecmp(s.data + i + 1, "xml", 3) ||
+                             !strncasecmp(s.data + i + 1, "json", 4)))
+      return 1;
+  }
+  return 0;
+}
+
+/** Returns the `Content-Encoding` header value (remember to `fiobj_free`). */
+FIOBJ http_compress_encoding(http_compress_e encoding) {
+  switch (encoding) {
+  case HTTP_COMPRESS_BR:
+    return fiobj_dup(HTTP_HVALUE_BR);
+  case HTTP_COMPRESS_GZIP:
+    return fiobj_dup(HTTP_HVALUE_GZIP);
+  case HTTP_COMPRESS_DEFLATE:
+    return fiobj_dup(HTTP_HVALUE_DEFLATE);
+  case HTTP_COMPRESS_NONE:
+    break;
+  }
+  return FIOBJ_INVALID;
+}
+
+/* *****************************************************************************
+Streaming Compression
+***************************************************************************** */
+
+struct http_compress_s {
+  http_compress_e encoding;
+  union {
+#if HAVE_ZLIB
+    z_stream zlib;
+#endif
+#if HAVE_BROTLI
+    BrotliEncoderState *br;
+#endif
+    void *ignr_;
+  } state;
+};
+
+/**
+ * Returns a new compression context (or NULL on error / no support).
+ *
+ * When `is_static` is set, the (slower) static file compression levels are
+ * used, see `HTTP_COMPRESS_STATIC_GZIP_LEVEL`.
+ */
+http_compress_s *http_compress_new(http_compress_e encoding, uint8_t is_static,
+                                   size_t size_hint) {
+  http_compress_s *c = NULL;
+  switch (encoding) {
+  case HTTP_COMPRESS_DEFLATE: /* fallthrough */
+  case HTTP_COMPRESS_GZIP:
+#if HAVE_ZLIB
+    c = fio_malloc(sizeof(*c));
+    FIO_ASSERT_ALLOC(c);
+    *c = (http_compress_s){.encoding = encoding};
+    /* HTTP's deflate is the zlib format, gzip adds 16 to the window bits */
+    if (deflateInit2(&c->state.zlib,
+                     (is_static ? HTTP_COMPRESS_STATIC_GZIP_LEVEL
+                                : HTTP_COMPRESS_GZIP_LEVEL),
+                     Z_DEFLATED,
+                     (encoding == HTTP_COMPRESS_GZIP ? (15 + 16) : 15), 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      fio_free(c);
+      return NULL;
+    }
+#endif
+    break;
+  case HTTP_COMPRESS_BR:
+#if HAVE_BROTLI
+    c = fio_malloc(sizeof(*c));
+    FIO_ASSERT_ALLOC(c);
+    *c = (http_compress_s){.encoding = encoding};
+    c->state.br = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+    if (!c->state.br) {
+      fio_free(c);
+      return NULL;
+    }
+    BrotliEncoderSetParameter(c->state.br, BROTLI_PARAM_QUALITY,
+                              (is_static ? HTTP_COMPRESS_STATIC_BR_QUALITY
+                                         : HTTP_COMPRESS_BR_QUALITY));
+    if (size_hint)
+      BrotliEncoderSetParameter(c->state.br, BROTLI_PARAM_SIZE_HINT,
+                                (uint32_t)(size_hint > (1UL << 30)
+                                               ? (1UL << 30)
+                                               : size_hint));
+#endif
+    break;
+  case HTTP_COMPRESS_NONE:
+    break;
+  }
+  return c;
+  (void)is_static;
+  (void)size_hint;
+}
+
+/**
+ * Compresses `len` bytes, appending the compressed data to the `dest` String.
+ *
+ * Returns -1 on error and 0 on success.
+ */
+int http_compress_write(http_compress_s *c, FIOBJ dest, const void *data,
+                        size_t len, http_compress_flush_e flush) {
+  if (!c || !FIOBJ_TYPE_IS(dest, FIOBJ_T_STRING))
+    return -1;
+  switch (c->encoding) {
+  case HTTP_COMPRESS_DEFLATE: /* fallthrough */
+  case HTTP_COMPRESS_GZIP:
+#if HAVE_ZLIB
+  {
+    fio_str_info_s out = fiobj_obj2cstr(dest);
+    const int mode = (flush == HTTP_COMPRESS_FINISH
+                          ? Z_FINISH
+                          : (flush == HTTP_COMPRESS_FLUSH ? Z_SYNC_FLUSH
+                                                          : Z_NO_FLUSH));
+    c->state.zlib.next_in = (Bytef *)data;
+    c->state.zlib.avail_in = (uInt)len;
+    for (;;) {
+      size_t capa = fiobj_str_capa_assert(
+          dest, out.len + deflateBound(&c->state.zlib, len) + 32);
+      out = fiobj_obj2cstr(dest);
+      c->state.zlib.next_out = (Bytef *)out.data + out.len;
+      c->state.zlib.avail_out = (uInt)(capa - out.len);
+      int r = deflate(&c->state.zlib, mode);
+      out.len = capa - c->state.zlib.avail_out;
+      fiobj_str_resize(dest, out.len);
+      if (r == Z_STREAM_END)
+        break;
+      if (r != Z_OK && r != Z_BUF_ERROR)
+        return -1;
+      if (c->state.zlib.avail_out && !c->state.zlib.avail_in)
+        break;
+    }
+    return 0;
+  }
+#endif
+  break;
+  case HTTP_COMPRESS_BR:
+#if HAVE_BROTLI
+  {
+    fio_str_info_s out = fiobj_obj2cstr(dest);
+    const BrotliEncoderOperation op =
+        (flush == HTTP_COMPRESS_FINISH
+             ? BROTLI_OPERATION_FINISH
+             : (flush == HTTP_COMPRESS_FLUSH ? BROTLI_OPERATION_FLUSH
+                                             : BROTLI_OPERATION_PROCESS));
+    const uint8_t *next_in = data;
+    size_t avail_in = len;
+    for (;;) {
+      size_t capa =
+          fiobj_str_capa_assert(dest, out.len + (avail_in >> 1) + 1024);
+      out = fiobj_obj2cstr(dest);
+      uint8_t *next_out = (uint8_t *)out.data + out.len;
+      size_t avail_out = capa - out.len;
+      if (!BrotliEncoderCompressStream(c->state.br, op, &avail_in, &next_in,
+                                       &avail_out, &next_out, NULL))
+        return -1;
+      out.len = capa - avail_out;
+      fiobj_str_resize(dest, out.len);
+      if (avail_in || BrotliEncoderHasMoreOutput(c->state.br))
+        continue;
+      if (op == BROTLI_OPERATION_FINISH &&
+          !BrotliEncoderIsFinished(c->state.br))
+        continue;
+      break;
+    }
+    return 0;
+  }
+#endif
+  break;
+  case HTTP_COMPRESS_NONE:
+    break;
+  }
+  return -1;
+  (void)data;
+  (void)len;
+  (void)flush;
+}
+
+/** Frees a compression context. */
+void http_compress_free(http_compress_s *c) {
+  if (!c)
+    return;
+  switch (c->encoding) {
+  case HTTP_COMPRESS_DEFLATE: /* fallthrough */
+  case HTTP_COMPRESS_GZIP:
+#if HAVE_ZLIB
+    deflateEnd(&c->state.zlib);
+#endif
+    break;
+  case HTTP_COMPRESS_BR:
+#if HAVE_BROTLI
+    BrotliEncoderDestroyInstance(c->state.br);
+#endif
+    break;
+  case HTTP_COMPRESS_NONE:
+    break;
+  }
+  fio_free(c);
+}
+
+/**
+ * Compresses `data` in one go, returning a new String (or FIOBJ_INVALID).
+ *
+ * FIOBJ_INVALID is also returned when compression doesn't reduce the size.
+ */
+FIOBJ http_compress2str(http_compress_e encoding, uint8_t is_static,
+                        const void *data, size_t len) {
+  http_compress_s *c = http_compress_new(encoding, is_static, len);
+  if (!c)
+    return FIOBJ_INVALID;
+  FIOBJ dest = fiobj_str_buf((len >> 1) + 64);
+  if (http_compress_write(c, dest, data, len, HTTP_COMPRESS_FINISH) ||
+      fiobj_obj2cstr(dest).len >= len) {
+    fiobj_free(dest);
+    dest = FIOBJ_INVALID;
+  }
+  http_compress_free(c);
+  return dest;
+}
@@ -0,0 +1,108 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#ifndef H_HTTP_COMPRESS_H
+#define H_HTTP_COMPRESS_H
+
+#include <http.h>
+
+/* *****************************************************************************
+Compile Time Settings
+***************************************************************************** */
+
+#ifndef HTTP_COMPRESS_GZIP_LEVEL
+/** The zlib compression level for dynamic (on-the-fly) gzip / deflate. */
+#define HTTP_COMPRESS_GZIP_LEVEL 6
+#endif
+
+#ifndef HTTP_COMPRESS_BR_QUALITY
+/** The Brotli quality for dynamic (on-the-fly) compression. */
+#define HTTP_COMPRESS_BR_QUALITY 4
+#endif
+
+#ifndef HTTP_COMPRESS_STATIC_GZIP_LEVEL
+/** The zlib compression level for cached static file variants. */
+#define HTTP_COMPRESS_STATIC_GZIP_LEVEL 9
+#endif
+
+#ifndef HTTP_COMPRESS_STATIC_BR_QUALITY
+/** The Brotli quality for cached static file variants. */
+#define HTTP_COMPRESS_STATIC_BR_QUALITY 11
+#endif
+
+#ifndef HTTP_COMPRESS_STATIC_LIMIT
+/** Static files larger than this are never compressed (they're sent as is). */
+#define HTTP_COMPRESS_STATIC_LIMIT (1024 * 1024 * 2)
+#endif
+
+/* *****************************************************************************
+Response Compression
+***************************************************************************** */
+
+/** Supported content encodings (bit flags, ordered by preference). */
+typedef enum {
+  HTTP_COMPRESS_NONE = 0,
+  HTTP_COMPRESS_DEFLATE = 1,
+  HTTP_COMPRESS_GZIP = 2,
+  HTTP_COMPRESS_BR = 4,
+} http_compress_e;
+
+/** An opaque streaming compression context. */
+typedef struct http_compress_s http_compress_s;
+
+/** Flush modes for `http_compress_write`. */
+typedef enum {
+  /** Buffer data for better compression. */
+  HTTP_COMPRESS_NO_FLUSH = 0,
+  /** Write all the data received so far (on a byte boundary). */
+  HTTP_COMPRESS_FLUSH = 1,
+  /** Write all the data and finish the compressed stream. */
+  HTTP_COMPRESS_FINISH = 2,
+} http_compress_flush_e;
+
+/**
+ * Returns the preferred content encoding supported by both the client (the
+ * `Accept-Encoding` header value) and facil.io, limited to the `allowed`
+ * encodings (a bitwise OR of `http_compress_e` values).
+ */
+http_compress_e http_compress_negotiate(FIOBJ accept_encoding,
+                                        uint8_t allowed);
+
+/** Returns TRUE (1) if the specified Content-Type compresses well. */
+int http_compress_mime(FIOBJ content_type);
+
+/** Returns the `Content-Encoding` header value (remember to `fiobj_free`). */
+FIOBJ http_compress_encoding(http_compress_e encoding);
+
+/**
+ * Returns a new compression context (or NULL on error / no support).
+ *
+ * When `is_static` is set, the (slower) static file compression levels are
+ * used, see `HTTP_COMPRESS_STATIC_GZIP_LEVEL`.
+ */
+http_compress_s *http_compress_new(http_compress_e encoding, uint8_t is_static,
+                                   size_t size_hint);
+
+/**
+ * Compresses `len` bytes, appending the compressed data to the `dest` String.
+ *
+ * Returns -1 on error and 0 on success.
+ */
+int http_compress_write(http_compress_s *c, FIOBJ dest, const void *data,
+                        size_t len, http_compress_flush_e flush);
+
+/** Frees a compression context. */
+void http_compress_free(http_compress_s *c);
+
+/**
+ * Compresses `data` in one go, returning a new String (or FIOBJ_INVALID).
+ *
+ * FIOBJ_INVALID is also returned when compression doesn't reduce the size.
+ */
+FIOBJ http_compress2str(http_compress_e encoding, uint8_t is_static,
+                        const void *data, size_t len);
+
+#endif /* H_HTTP_COMPRESS_H */
@@ -14,6 +14,8 @@ Feel free to copy, use and enjoy according to the license provided.
 #include <fio.h>
 
 #include <http.h>
+#include <http_compress.h>
+#include <http_timing.h>
 
 #include <arpa/inet.h>
 #include <errno.h>
@@ -35,6 +37,10 @@ struct http_vtable_s {
   int (*const http_stream)(http_s *h, void *data, uintptr_t length);
   /** Should send existing headers or complete streaming */
   void (*const http_finish)(http_s *h);
+  /** Should complete streaming, sending any trailers (NOT freeing them). */
+  int (*const http_stream_finish)(http_s *h, FIOBJ trailers);
+  /** Should call `on_ready` once the client caught up with the stream. */
+  int (*const http_stream_on_ready)(http_s *h, void (*on_ready)(http_s *h));
   /** Push for data. */
   int (*const http_push_data)(http_s *h, void *data, uintptr_t length,
                               FIOBJ mime_type);
@@ -58,10 +64,22 @@ struct http_vtable_s {
   int (*http_sse_close)(http_sse_s *sse);
 };
 
+/* a request's timestamps (in microseconds), see `http_timing.h` */
+typedef struct {
+  uint64_t start;    /* the request line was parsed */
+  uint64_t headers;  /* the headers were parsed */
+  uint64_t dispatch; /* the request was dispatched */
+  uint64_t queued;   /* the response was queued */
+  const char *label; /* set by `http_timing_label` */
+  FIOBJ method;      /* kept for the slow request log */
+  FIOBJ path;        /* kept for the slow request log */
+} http_timing_s;
+
 struct http_fio_protocol_s {
   fio_protocol_s protocol;   /* facil.io protocol */
   intptr_t uuid;             /* socket uuid */
   http_settings_s *settings; /* pointer to HTTP settings */
+  http_timing_s timing;      /* the current request's timing (if enabled) */
 };
 
 #define http2protocol(h) ((http_fio_protocol_s *)h->private_data.flag)
@@ -73,9 +91,12 @@ Constants that shouldn't be accessed by the users (`fiobj_dup` required).
 extern FIOBJ HTTP_HEADER_ACCEPT_RANGES;
 extern FIOBJ HTTP_HEADER_WS_SEC_CLIENT_KEY;
 extern FIOBJ HTTP_HEADER_WS_SEC_KEY;
+extern FIOBJ HTTP_HVALUE_ACCEPT_ENCODING;
+extern FIOBJ HTTP_HVALUE_BR;
 extern FIOBJ HTTP_HVALUE_BYTES;
 extern FIOBJ HTTP_HVALUE_CLOSE;
 extern FIOBJ HTTP_HVALUE_CONTENT_TYPE_DEFAULT;
+extern FIOBJ HTTP_HVALUE_DEFLATE;
 extern FIOBJ HTTP_HVALUE_GZIP;
 extern FIOBJ HTTP_HVALUE_KEEP_ALIVE;
 extern FIOBJ HTTP_HVALUE_MAX_AGE;
@@ -148,6 +169,89 @@ void http_on_response_handler______internal(http_s *h,
                                             http_settings_s *settings);
 int http_send_error2(size_t error, intptr_t uuid, http_settings_s *settings);
 
+/**
+ * Allocates a settings object, filling in the defaults.
+ *
+ * The allocation has room for two extra pointers after the settings object
+ * (the client's `on_close` callback and the server's response cache).
+ */
+http_settings_s *http_settings_new(http_settings_s arg_settings);
+/** Frees a settings object allocated by `http_settings_new`. */
+void http_settings_free(http_settings_s *s);
+
+/** sends the body as is (no compression), used by the response cache. */
+int http_send_body_uncompressed______internal(http_s *r, void *data,
+                                              uintptr_t length);
+
+/**
+ * Negotiates the compression of a (server side) response, setting the Vary
+ * header. The caller sets the Content-Encoding header (used by streams).
+ */
+http_compress_e http_compress_response______internal(http_s *r);
+
+/* *****************************************************************************
+Shared Memory Response Cache (see `cache_size`)
+***************************************************************************** */
+
+typedef struct http_cache_s http_cache_s;
+
+/** The response cache of a server's settings (stored after the settings). */
+#define http_settings2cache(s) (((http_cache_s **)((s) + 1))[1])
+
+/**
+ * Creates a shared memory response cache.
+ *
+ * `vary` is a comma separated list of request headers that are part of the
+ * cache key. If `vary_encoding` is set, `accept-encoding` is also part of the
+ * key.
+ */
+http_cache_s *http_cache_new(size_t size, const char *vary,
+                             uint8_t vary_encoding);
+
+/** Frees the (process's) cache object, unmapping the shared memory. */
+void http_cache_free(http_cache_s *c);
+
+/**
+ * Sends the cached response for the request, if any.
+ *
+ * Returns 0 if the response was sent and -1 otherwise.
+ */
+int http_cache_serve(http_cache_s *c, http_s *h);
+
+/**
+ * Stores a response (sent using `http_send_body`) if both the request and the
+ * response allow it.
+ */
+void http_cache_store(http_cache_s *c, http_s *h, void *body, size_t len);
+
+/** Returns the number of cache hits and misses (all processes). */
+void http_cache_stats(http_cache_s *c, size_t *hits, size_t *misses);
+
+#if DEBUG
+/** Testing: starts writing the first entry and never finishes (or unlocks). */
+void http_cache_test_abandon(http_cache_s *c);
+#endif
+
+/* *****************************************************************************
+Request Timing (see `timing` and `http_timing.h`)
+***************************************************************************** */
+
+/** Returns a monotonic timestamp in microseconds. */
+static inline uint64_t http_timing_now(void) {
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return ((uint64_t)t.tv_sec * 1000000) + ((uint64_t)t.tv_nsec / 1000);
+}
+
+/**
+ * Records the timing of a response that was written to the socket at
+ * `flushed` (0 if unknown), logging slow requests.
+ *
+ * Releases the timing's `method` and `path` objects.
+ */
+void http_timing_finish______internal(http_timing_s *t, uint64_t flushed,
+                                      intptr_t uuid, http_settings_s *settings);
+
 /* *****************************************************************************
 EventSource Support (SSE)
 ***************************************************************************** */
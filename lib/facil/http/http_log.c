@@ -0,0 +1,591 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#include <fio.h>
+
+#include <http_internal.h>
+#include <http_log.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+
+#if (HTTP_LOG_BUFFER_SIZE & (HTTP_LOG_BUFFER_SIZE - 1))
+#error HTTP_LOG_BUFFER_SIZE must be a power of 2
+#endif
+
+#if HTTP_LOG_LINE_LIMIT < 128 || HTTP_LOG_LINE_LIMIT > HTTP_LOG_BUFFER_SIZE
+#error HTTP_LOG_LINE_LIMIT must be between 128 and HTTP_LOG_BUFFER_SIZE
+#endif
+
+/* *****************************************************************************
+Log State
+***************************************************************************** */
+
+/* a single producer (the owning thread), single consumer (flusher) ring */
+typedef struct http_log_buffer_s http_log_buffer_s;
+struct http_log_buffer_s {
+  http_log_buffer_s *next;
+  volatile size_t head; /* total bytes written by the owning thread */
+  volatile size_t tail; /* total bytes consumed by the flusher */
+  char data[HTTP_LOG_BUFFER_SIZE];
+};
+
+static struct {
+  http_log_buffer_s *buffers; /* new buffers are added at the head */
+  int fd;
+  http_log_format_e format;
+  uint8_t syslog;
+  volatile uint8_t initialized;
+  volatile uint8_t scheduled;
+  fio_lock_i lock;       /* protects the buffer list and initialization */
+  fio_lock_i flush_lock; /* protects the target and the output buffer */
+  volatile size_t dropped;
+  size_t reported;
+  uint64_t referer_hash;
+  uint64_t user_agent_hash;
+  char out[HTTP_LOG_BUFFER_SIZE];
+} http_log = {.fd = STDERR_FILENO};
+
+static __thread http_log_buffer_s *http_log_local;
+
+/* *****************************************************************************
+Writing to the target (called with the `flush_lock` held)
+***************************************************************************** */
+
+/* counts the lines in a slice of the log */
+static size_t http_log_count_lines(const char *data, size_t len) {
+  size_t count = 0;
+  const char *eol;
+  while (len && (eol = memchr(data, '\n', len))) {
+    ++count;
+    len -= (eol + 1) - data;
+    data = eol + 1;
+  }
+  return count;
+}
+
+static void http_log_emit(const char *data, size_t len) {
+  if (http_log.syslog) {
+    while (len) {
+      const char *eol = memchr(data, '\n', len);
+      size_t line = eol ? (size_t)(eol - data) + 1 : len;
+      size_t printable = line;
+      while (printable &&
+             (data[printable - 1] == '\n' || data[printable - 1] == '\r'))
+        --printable;
+      if (printable)
+        syslog(LOG_INFO, "%.*s", (int)printable, data);
+      data += line;
+      len -= line;
+    }
+    return;
+  }
+  while (len) {
+    ssize_t written = write(http_log.fd, data, len);
+    if (written > 0) {
+      data += written;
+      len -= written;
+      continue;
+    }
+    if (written < 0 && errno == EINTR)
+      continue;
+    /* the target is unavailable (or non-blocking and full), drop the rest */
+    fio_atomic_add(&http_log.dropped, http_log_count_lines(data, len));
+    return;
+  }
+}
+
+/* writes complete lines, returning the length of the incomplete remainder */
+static size_t http_log_emit_lines(size_t len) {
+  size_t complete = len;
+  while (complete && http_log.out[complete - 1] != '\n')
+    --complete;
+  if (!complete) /* a line longer than the buffer (shouldn't happen) */
+    complete = len;
+  http_log_emit(http_log.out, complete);
+  if (complete < len)
+    memmove(http_log.out, http_log.out + complete, len - complete);
+  return len - complete;
+}
+
+static void http_log_flush_unsafe(void) {
+  size_t len = 0;
+  http_log_buffer_s *b;
+  fio_lock(&http_log.lock);
+  b = http_log.buffers;
+  fio_unlock(&http_log.lock);
+  /* buffers are only added at the head of the list, so `b` is stable */
+  for (; b; b = b->next) {
+    size_t head = fio_atomic_add(&b->head, 0);
+    size_t tail = b->tail;
+    if (head == tail)
+      continue;
+    while (tail != head) {
+      size_t pos = tail & (HTTP_LOG_BUFFER_SIZE - 1);
+      size_t chunk = head - tail;
+      if (chunk > HTTP_LOG_BUFFER_SIZE - pos)
+        chunk = HTTP_LOG_BUFFER_SIZE - pos;
+      if (chunk > HTTP_LOG_BUFFER_SIZE - len)
+        chunk = HTTP_LOG_BUFFER_SIZE - len;
+      memcpy(http_log.out + len, b->data + pos, chunk);
+      len += chunk;
+      tail += chunk;
+      if (len == HTTP_LOG_BUFFER_SIZE)
+        len = http_log_emit_lines(len);
+    }
+    fio_atomic_xchange(&b->tail, head);
+  }
+  if (len)
+    http_log_emit(http_log.out, len);
+  size_t dropped = http_log.dropped;
+  if (dropped != http_log.reported) {
+    FIO_LOG_WARNING("(http) access log fell behind, %zu lines dropped.",
+                    dropped - http_log.reported);
+    http_log.reported = dropped;
+  }
+}
+
+/** Writes any buffered log lines to the log's target (called automatically). */
+void http_log_flush(void) {
+  if (fio_trylock(&http_log.flush_lock))
+    return; /* another thread is flushing */
+  http_log_flush_unsafe();
+  fio_unlock(&http_log.flush_lock);
+}
+
+/** Returns the number of log lines dropped because the log fell behind. */
+size_t http_log_dropped(void) { return http_log.dropped; }
+
+/* closes the current target (called with the `flush_lock` held) */
+static void http_log_close_target(void) {
+  if (http_log.syslog)
+    closelog();
+  else if (http_log.fd > STDERR_FILENO)
+    close(http_log.fd);
+  http_log.fd = STDERR_FILENO;
+  http_log.syslog = 0;
+}
+
+/* *****************************************************************************
+Background flushing and lifetime management
+***************************************************************************** */
+
+static void http_log_flush_task(void *ignr1, void *ignr2) {
+  http_log.scheduled = 0;
+  http_log_flush();
+  (void)ignr1;
+  (void)ignr2;
+}
+
+static void http_log_on_timer(void *ignr) {
+  http_log_flush();
+  (void)ignr;
+}
+
+static void http_log_on_start(void *ignr) {
+  fio_run_every(HTTP_LOG_FLUSH_INTERVAL, 0, http_log_on_timer, NULL, NULL);
+  (void)ignr;
+}
+
+static void http_log_on_flush_event(void *ignr) {
+  http_log_flush();
+  (void)ignr;
+}
+
+static void http_log_in_child(void *ignr) {
+  /* the buffers were flushed before forking, but locks might be held. */
+  http_log.lock = FIO_LOCK_INIT;
+  http_log.flush_lock = FIO_LOCK_INIT;
+  http_log.scheduled = 0;
+  (void)ignr;
+}
+
+static void http_log_at_exit(void *ignr) {
+  fio_lock(&http_log.flush_lock);
+  http_log_flush_unsafe();
+  http_log_close_target();
+  fio_lock(&http_log.lock);
+  while (http_log.buffers) {
+    http_log_buffer_s *b = http_log.buffers;
+    http_log.buffers = b->next;
+    fio_free(b);
+  }
+  http_log_local = NULL;
+  fio_unlock(&http_log.lock);
+  fio_unlock(&http_log.flush_lock);
+  (void)ignr;
+}
+
+static void http_log_init(void) {
+  fio_lock(&http_log.lock);
+  if (http_log.initialized) {
+    fio_unlock(&http_log.lock);
+    return;
+  }
+  http_log.referer_hash = fiobj_hash_string("referer", 7);
+  http_log.user_agent_hash = fiobj_hash_string("user-agent", 10);
+  fio_state_callback_add(FIO_CALL_ON_START, http_log_on_start, NULL);
+  fio_state_callback_add(FIO_CALL_BEFORE_FORK, http_log_on_flush_event, NULL);
+  fio_state_callback_add(FIO_CALL_IN_CHILD, http_log_in_child, NULL);
+  fio_state_callback_add(FIO_CALL_ON_FINISH, http_log_on_flush_event, NULL);
+  fio_state_callback_add(FIO_CALL_AT_EXIT, http_log_at_exit, NULL);
+  http_log.initialized = 1;
+  fio_unlock(&http_log.lock);
+  if (fio_is_running())
+    http_log_on_start(NULL); /* the ON_START event was already performed */
+}
+
+/* *****************************************************************************
+Adding lines to the log
+***************************************************************************** */
+
+static http_log_buffer_s *http_log_buffer(void) {
+  if (http_log_local)
+    return http_log_local;
+  http_log_buffer_s *b = fio_malloc(sizeof(*b));
+  if (!b)
+    return NULL;
+  b->head = 0;
+  b->tail = 0;
+  fio_lock(&http_log.lock);
+  b->next = http_log.buffers;
+  http_log.buffers = b;
+  fio_unlock(&http_log.lock);
+  http_log_local = b;
+  return b;
+}
+
+/* adds a complete line (or lines) to the thread's buffer */
+static void http_log_push(const char *line, size_t len) {
+  if (!http_log.initialized)
+    http_log_init();
+  http_log_buffer_s *b = http_log_buffer();
+  if (!b)
+    goto dropped;
+  size_t head = b->head;
+  size_t used = head - b->tail;
+  if (len > HTTP_LOG_BUFFER_SIZE - used)
+    goto dropped;
+  size_t pos = head & (HTTP_LOG_BUFFER_SIZE - 1);
+  size_t first = HTTP_LOG_BUFFER_SIZE - pos;
+  if (first > len)
+    first = len;
+  memcpy(b->data + pos, line, first);
+  memcpy(b->data, line + first, len - first);
+  fio_atomic_add(&b->head, len);
+  if (used + len >= (HTTP_LOG_BUFFER_SIZE >> 1) &&
+      !fio_atomic_xchange(&http_log.scheduled, 1))
+    fio_defer(http_log_flush_task, NULL, NULL);
+  return;
+dropped:
+  fio_atomic_add(&http_log.dropped, 1);
+}
+
+/**
+ * Adds a raw line to the access log. A missing EOL marker is added.
+ *
+ * The line is dropped (and counted) if the thread's buffer is full.
+ */
+void http_log_write(const char *line, size_t len) {
+  if (len && line[len - 1] == '\n' && len <= HTTP_LOG_LINE_LIMIT) {
+    http_log_push(line, len);
+    return;
+  }
+  char buf[HTTP_LOG_LINE_LIMIT];
+  if (len > HTTP_LOG_LINE_LIMIT - 1)
+    len = HTTP_LOG_LINE_LIMIT - 1;
+  memcpy(buf, line, len);
+  buf[len++] = '\n';
+  http_log_push(buf, len);
+}
+
+/*
+ * Starts a command reading from a pipe, returning the pipe's writing end.
+ *
+ * The command is started by an intermediate process, so it isn't our child
+ * (the root process waits for its children, the workers, to exit).
+ */
+static int http_log_spawn(const char *cmd) {
+  int fds[2];
+  if (pipe(fds))
+    return -1;
+  fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+  pid_t pid = fork();
+  if (pid == -1) {
+    close(fds[0]);
+    close(fds[1]);
+    return -1;
+  }
+  if (!pid) {
+    if (fork())
+      _exit(0);
+    if (fds[0] != STDIN_FILENO) {
+      dup2(fds[0], STDIN_FILENO);
+      close(fds[0]);
+    }
+    execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+    _exit(127);
+  }
+  close(fds[0]);
+  waitpid(pid, NULL, 0);
+  return fds[1];
+}
+
+/**
+ * Sets the access log's target and format.
+ */
+int http_log_open FIO_IGNORE_MACRO(http_log_settings_s settings) {
+  int fd = STDERR_FILENO;
+  if (settings.syslog) {
+    openlog(NULL, LOG_PID | LOG_NDELAY, LOG_USER);
+  } else if (settings.target && settings.target[0] == '|') {
+    fd = http_log_spawn(settings.target + 1);
+    if (fd == -1) {
+      FIO_LOG_ERROR("(http) couldn't open access log pipe (%s): %s",
+                    settings.target + 1, strerror(errno));
+      return -1;
+    }
+  } else if (settings.target &&
+             (settings.target[0] != '-' || settings.target[1])) {
+    fd = open(settings.target, O_WRONLY | O_APPEND | O_CREAT,
+              S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd == -1) {
+      FIO_LOG_ERROR("(http) couldn't open access log file (%s): %s",
+                    settings.target, strerror(errno));
+      return -1;
+    }
+  }
+  if (!http_log.initialized)
+    http_log_init();
+  fio_lock(&http_log.flush_lock);
+  http_log_flush_unsafe();
+  http_log_close_target();
+  http_log.fd = fd;
+  http_log.syslog = settings.syslog;
+  http_log.format = settings.format;
+  fio_unlock(&http_log.flush_lock);
+  return 0;
+}
+
+/* *****************************************************************************
+Request log lines
+***************************************************************************** */
+
+typedef struct {
+  char *pos;
+  char *end;
+} http_log_line_s;
+
+static inline void http_log_cat(http_log_line_s *l, const char *data,
+                                size_t len) {
+  if (len > (size_t)(l->end - l->pos))
+    len = l->end - l->pos;
+  memcpy(l->pos, data, len);
+  l->pos += len;
+}
+
+static inline void http_log_cat_num(http_log_line_s *l, int64_t num) {
+  char tmp[24];
+  http_log_cat(l, tmp, fio_ltoa(tmp, num, 10));
+}
+
+/* escapes quotes, backslashes and control characters (prevents log forging) */
+static void http_log_cat_escaped(http_log_line_s *l, fio_str_info_s s,
+                                 uint8_t json) {
+  static const char hex[] = "0123456789abcdef";
+  for (size_t i = 0; i < s.len; ++i) {
+    uint8_t c = (uint8_t)s.data[i];
+    if (c == '"' || c == '\\') {
+      if (l->end - l->pos < 2)
+        return;
+      l->pos[0] = '\\';
+      l->pos[1] = c;
+      l->pos += 2;
+    } else if (c < 0x20 || c == 0x7f) {
+      if (l->end - l->pos < (json ? 6 : 4))
+        return;
+      if (json) {
+        memcpy(l->pos, "\\u00", 4);
+        l->pos += 4;
+      } else {
+        memcpy(l->pos, "\\x", 2);
+        l->pos += 2;
+      }
+      l->pos[0] = hex[c >> 4];
+      l->pos[1] = hex[c & 15];
+      l->pos += 2;
+    } else {
+      if (l->pos == l->end)
+        return;
+      *(l->pos++) = c;
+    }
+  }
+}
+
+static inline fio_str_info_s http_log_str(FIOBJ o) {
+  if (!o)
+    return (fio_str_info_s){.data = NULL};
+  return fiobj_obj2cstr(o);
+}
+
+/* the formatted date is cached per thread, per second */
+static fio_str_info_s http_log_date(time_t t, http_log_format_e format) {
+  static __thread struct {
+    time_t t;
+    http_log_format_e format;
+    size_t len;
+    char str[48];
+  } cache = {.t = -1};
+  if (cache.t != t || cache.format != format) {
+    struct tm tm;
+    cache.t = t;
+    cache.format = format;
+    switch (format) {
+    case HTTP_LOG_FORMAT_COMBINED:
+      http_gmtime(t, &tm);
+      cache.len = strftime(cache.str, sizeof(cache.str),
+                           "%d/%b/%Y:%H:%M:%S +0000", &tm);
+      break;
+    case HTTP_LOG_FORMAT_JSON:
+      http_gmtime(t, &tm);
+      cache.len =
+          strftime(cache.str, sizeof(cache.str), "%Y-%m-%dT%H:%M:%SZ", &tm);
+      break;
+    case HTTP_LOG_FORMAT_DEFAULT: /* fallthrough */
+    default:
+      cache.len = http_time2str(cache.str, t);
+      break;
+    }
+  }
+  return (fio_str_info_s){.data = cache.str, .len = cache.len};
+}
+
+/**
+ * Writes a log line about the request / response object to the access log.
+ *
+ * This function is called automatically if the `.log` setting is enabled.
+ */
+void http_write_log(http_s *h) {
+  if (!http_log.initialized)
+    http_log_init();
+  char buf[HTTP_LOG_LINE_LIMIT];
+  /* leave room for the line's termination */
+  http_log_line_s l = {.pos = buf, .end = buf + HTTP_LOG_LINE_LIMIT - 4};
+  const http_log_format_e format = http_log.format;
+  const uint8_t json = (format == HTTP_LOG_FORMAT_JSON);
+
+  intptr_t bytes_sent = fiobj_obj2num(fiobj_hash_get2(
+      h->private_data.out_headers, fiobj_obj2hash(HTTP_HEADER_CONTENT_LENGTH)));
+
+  struct timespec end;
+  clock_gettime(CLOCK_REALTIME, &end);
+  int64_t ms = ((end.tv_sec - h->received_at.tv_sec) * 1000) +
+               ((end.tv_nsec - h->received_at.tv_nsec) / 1000000);
+
+  // TODO Guess IP address from headers (forwarded) where possible
+  fio_str_info_s peer = fio_peer_addr(http2protocol(h)->uuid);
+  if (!peer.len)
+    peer = (fio_str_info_s){.data = "[unknown]", .len = 9};
+  fio_str_info_s date = http_log_date(end.tv_sec, format);
+
+  if (json) {
+    http_log_cat(&l, "{\"time\":\"", 9);
+    http_log_cat(&l, date.data, date.len);
+    http_log_cat(&l, "\",\"peer\":\"", 10);
+    http_log_cat_escaped(&l, peer, 1);
+    http_log_cat(&l, "\",\"method\":\"", 12);
+    http_log_cat_escaped(&l, http_log_str(h->method), 1);
+    http_log_cat(&l, "\",\"path\":\"", 10);
+    http_log_cat_escaped(&l, http_log_str(h->path), 1);
+    http_log_cat(&l, "\",\"query\":\"", 11);
+    http_log_cat_escaped(&l, http_log_str(h->query), 1);
+    http_log_cat(&l, "\",\"version\":\"", 13);
+    http_log_cat_escaped(&l, http_log_str(h->version), 1);
+    http_log_cat(&l, "\",\"status\":", 11);
+    http_log_cat_num(&l, h->status);
+    http_log_cat(&l, ",\"bytes\":", 9);
+    if (bytes_sent > 0)
+      http_log_cat_num(&l, bytes_sent);
+    else
+      http_log_cat(&l, "null", 4);
+    http_log_cat(&l, ",\"ms\":", 6);
+    http_log_cat_num(&l, ms);
+    http_log_cat(&l, ",\"referer\":\"", 12);
+    http_log_cat_escaped(
+        &l, http_log_str(fiobj_hash_get2(h->headers, http_log.referer_hash)),
+        1);
+    http_log_cat(&l, "\",\"user_agent\":\"", 16);
+    http_log_cat_escaped(
+        &l,
+        http_log_str(fiobj_hash_get2(h->headers, http_log.user_agent_hash)),
+        1);
+    /* the termination always fits, the JSON object is always closed */
+    l.end += 4;
+    http_log_cat(&l, "\"}\n", 3);
+    http_log_push(buf, l.pos - buf);
+    return;
+  }
+
+  http_log_cat(&l, peer.data, peer.len);
+  http_log_cat(&l, " - - [", 6);
+  http_log_cat(&l, date.data, date.len);
+  http_log_cat(&l, "] \"", 3);
+  http_log_cat_escaped(&l, http_log_str(h->method), 0);
+  http_log_cat(&l, " ", 1);
+  http_log_cat_escaped(&l, http_log_str(h->path), 0);
+  if (format == HTTP_LOG_FORMAT_COMBINED && h->query) {
+    http_log_cat(&l, "?", 1);
+    http_log_cat_escaped(&l, http_log_str(h->query), 0);
+  }
+  http_log_cat(&l, " ", 1);
+  http_log_cat_escaped(&l, http_log_str(h->version), 0);
+  http_log_cat(&l, "\" ", 2);
+  http_log_cat_num(&l, h->status);
+
+  if (format == HTTP_LOG_FORMAT_COMBINED) {
+    fio_str_info_s referer =
+        http_log_str(fiobj_hash_get2(h->headers, http_log.referer_hash));
+    fio_str_info_s user_agent =
+        http_log_str(fiobj_hash_get2(h->headers, http_log.user_agent_hash));
+    if (bytes_sent > 0) {
+      http_log_cat(&l, " ", 1);
+      http_log_cat_num(&l, bytes_sent);
+    } else {
+      http_log_cat(&l, " -", 2);
+    }
+    http_log_cat(&l, " \"", 2);
+    if (referer.len)
+      http_log_cat_escaped(&l, referer, 0);
+    else
+      http_log_cat(&l, "-", 1);
+    http_log_cat(&l, "\" \"", 3);
+    if (user_agent.len)
+      http_log_cat_escaped(&l, user_agent, 0);
+    else
+      http_log_cat(&l, "-", 1);
+    l.end += 4;
+    http_log_cat(&l, "\"\n", 2);
+    http_log_push(buf, l.pos - buf);
+    return;
+  }
+
+  if (bytes_sent > 0) {
+    http_log_cat(&l, " ", 1);
+    http_log_cat_num(&l, bytes_sent);
+    http_log_cat(&l, "b ", 2);
+  } else {
+    http_log_cat(&l, " -- ", 4);
+  }
+  http_log_cat_num(&l, ms);
+  l.end += 4;
+  http_log_cat(&l, "ms\r\n", 4);
+  http_log_push(buf, l.pos - buf);
+}
@@ -0,0 +1,93 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#ifndef H_HTTP_LOG_H
+#define H_HTTP_LOG_H
+
+#include <http.h>
+
+/* *****************************************************************************
+Compile Time Settings
+***************************************************************************** */
+
+#ifndef HTTP_LOG_BUFFER_SIZE
+/**
+ * The size of each thread's log buffer (must be a power of 2).
+ *
+ * Lines that don't fit in the buffer are dropped (see `http_log_dropped`).
+ */
+#define HTTP_LOG_BUFFER_SIZE (1UL << 16)
+#endif
+
+#ifndef HTTP_LOG_LINE_LIMIT
+/** The maximum length of a single log line (longer lines are truncated). */
+#define HTTP_LOG_LINE_LIMIT 2048
+#endif
+
+#ifndef HTTP_LOG_FLUSH_INTERVAL
+/** The interval (in milliseconds) between background flushes of the log. */
+#define HTTP_LOG_FLUSH_INTERVAL 100
+#endif
+
+/* *****************************************************************************
+Access Log
+***************************************************************************** */
+
+/** The access log's line format. */
+typedef enum {
+  /** facil.io's classic format: `peer - - [date] "request" status bytes ms` */
+  HTTP_LOG_FORMAT_DEFAULT = 0,
+  /** The Apache / NCSA "combined" log format. */
+  HTTP_LOG_FORMAT_COMBINED,
+  /** A JSON object per line. */
+  HTTP_LOG_FORMAT_JSON,
+} http_log_format_e;
+
+/** Access log settings, used by `http_log_open`. */
+typedef struct {
+  /**
+   * The log's target:
+   *
+   * * NULL (or "-") for `stderr` (the default).
+   * * "|command" to pipe the log to a command's `stdin`.
+   * * Otherwise, a file name (the log is appended to the file).
+   */
+  const char *target;
+  /** The line format. */
+  http_log_format_e format;
+  /** If set, `target` is ignored and lines are sent to `syslog`. */
+  uint8_t syslog;
+} http_log_settings_s;
+
+/**
+ * Sets the access log's target and format.
+ *
+ * Log lines are written to a per-thread buffer on the request's thread and
+ * written to the target in large batches, either by a periodic timer or when a
+ * buffer fills up.
+ *
+ * Should be called before `fio_start`. Any previous target is flushed and
+ * closed.
+ *
+ * Returns -1 on error (the previous target remains in effect) and 0 on success.
+ */
+int http_log_open(http_log_settings_s settings);
+#define http_log_open(...) http_log_open((http_log_settings_s){__VA_ARGS__})
+
+/**
+ * Adds a raw line to the access log. A missing EOL marker is added.
+ *
+ * The line is dropped (and counted) if the thread's buffer is full.
+ */
+void http_log_write(const char *line, size_t len);
+
+/** Writes any buffered log lines to the log's target (called automatically). */
+void http_log_flush(void);
+
+/** Returns the number of log lines dropped because the log fell behind. */
+size_t http_log_dropped(void);
+
+#endif /* H_HTTP_LOG_H */
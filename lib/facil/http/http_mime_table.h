@@ -0,0 +1,1838 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+/* *****************************************************************************
+This file was generated by scripts/mime_table - DON'T EDIT.
+
+Edit scripts/mime_types.txt and run scripts/mime_table instead.
+***************************************************************************** */
+#ifndef H_HTTP_MIME_TABLE_H
+#define H_HTTP_MIME_TABLE_H
+
+#include <stdint.h>
+#include <string.h>
+
+/** The number of extensions in the default MIME table. */
+#define HTTP_MIME_TABLE_SIZE 984
+/** The number of buckets (seeds) in the default MIME table. */
+#define HTTP_MIME_TABLE_BUCKETS 246
+/** The number of distinct MIME types in the default MIME table. */
+#define HTTP_MIME_TABLE_TYPES 765
+
+/** The hash function used to build the table (FNV-1a, seeded). */
+static inline uint32_t http_mime_table_hash(const char *ext, size_t len,
+                                            uint32_t seed) {
+  uint32_t h = 2166136261U ^ seed;
+  for (size_t i = 0; i < len; ++i) {
+    h = (h ^ (uint8_t)ext[i]) * 16777619U;
+  }
+  return h ^ (h >> 15);
+}
+
+/** The distinct MIME types, referenced by the table's `type` index. */
+static const struct {
+  const char *data;
+  size_t len;
+} http_mime_table_types[HTTP_MIME_TABLE_TYPES] = {
+    {"application/andrew-inset", 24},
+    {"application/applixware", 22},
+    {"application/atom+xml", 20},
+    {"application/atomcat+xml", 23},
+    {"application/atomsvc+xml", 23},
+    {"application/ccxml+xml", 21},
+    {"application/cdmi-capability", 27},
+    {"application/cdmi-container", 26},
+    {"application/cdmi-domain", 23},
+    {"application/cdmi-object", 23},
+    {"application/cdmi-queue", 22},
+    {"application/cu-seeme", 20},
+    {"application/davmount+xml", 24},
+    {"application/docbook+xml", 23},
+    {"application/dssc+der", 20},
+    {"application/dssc+xml", 20},
+    {"application/ecmascript", 22},
+    {"application/emma+xml", 20},
+    {"application/epub+zip", 20},
+    {"application/exi", 15},
+    {"application/font-tdpfr", 22},
+    {"application/font-woff", 21},
+    {"application/gml+xml", 19},
+    {"application/gpx+xml", 19},
+    {"application/gxf", 15},
+    {"application/hyperstudio", 23},
+    {"application/inkml+xml", 21},
+    {"application/ipfix", 17},
+    {"application/java-archive", 24},
+    {"application/java-serialized-object", 34},
+    {"application/java-vm", 19},
+    {"application/javascript", 22},
+    {"application/json", 16},
+    {"application/jsonml+json", 23},
+    {"application/lost+xml", 20},
+    {"application/mac-binhex40", 24},
+    {"application/mac-compactpro", 26},
+    {"application/mads+xml", 20},
+    {"application/marc", 16},
+    {"application/marcxml+xml", 23},
+    {"application/mathematica", 23},
+    {"application/mathml+xml", 22},
+    {"application/mbox", 16},
+    {"application/mediaservercontrol+xml", 34},
+    {"application/metalink+xml", 24},
+    {"application/metalink4+xml", 25},
+    {"application/mets+xml", 20},
+    {"application/mods+xml", 20},
+    {"application/mp21", 16},
+    {"application/mp4", 15},
+    {"application/msword", 18},
+    {"application/mxf", 15},
+    {"application/octet-stream", 24},
+    {"application/oda", 15},
+    {"application/oebps-package+xml", 29},
+    {"application/ogg", 15},
+    {"application/omdoc+xml", 21},
+    {"application/onenote", 19},
+    {"application/oxps", 16},
+    {"application/patch-ops-error+xml", 31},
+    {"application/pdf", 15},
+    {"application/pgp-encrypted", 25},
+    {"application/pgp-signature", 25},
+    {"application/pics-rules", 22},
+    {"application/pkcs10", 18},
+    {"application/pkcs7-mime", 22},
+    {"application/pkcs7-signature", 27},
+    {"application/pkcs8", 17},
+    {"application/pkix-attr-cert", 26},
+    {"application/pkix-cert", 21},
+    {"application/pkix-crl", 20},
+    {"application/pkix-pkipath", 24},
+    {"application/pkixcmp", 19},
+    {"application/pls+xml", 19},
+    {"application/postscript", 22},
+    {"application/prs.cww", 19},
+    {"application/pskc+xml", 20},
+    {"application/rdf+xml", 19},
+    {"application/reginfo+xml", 23},
+    {"application/relax-ng-compact-syntax", 35},
+    {"application/resource-lists+xml", 30},
+    {"application/resource-lists-diff+xml", 35},
+    {"application/rls-services+xml", 28},
+    {"application/rpki-ghostbusters", 29},
+    {"application/rpki-manifest", 25},
+    {"application/rpki-roa", 20},
+    {"application/rsd+xml", 19},
+    {"application/rss+xml", 19},
+    {"application/rtf", 15},
+    {"application/sbml+xml", 20},
+    {"application/scvp-cv-request", 27},
+    {"application/scvp-cv-response", 28},
+    {"application/scvp-vp-request", 27},
+    {"application/scvp-vp-response", 28},
+    {"application/sdp", 15},
+    {"application/set-payment-initiation", 34},
+    {"application/set-registration-initiation", 39},
+    {"application/shf+xml", 19},
+    {"application/smil+xml", 20},
+    {"application/sparql-query", 24},
+    {"application/sparql-results+xml", 30},
+    {"application/srgs", 16},
+    {"application/srgs+xml", 20},
+    {"application/sru+xml", 19},
+    {"application/ssdl+xml", 20},
+    {"application/ssml+xml", 20},
+    {"application/tei+xml", 19},
+    {"application/thraud+xml", 22},
+    {"application/timestamped-data", 28},
+    {"application/vnd.3gpp.pic-bw-large", 33},
+    {"application/vnd.3gpp.pic-bw-small", 33},
+    {"application/vnd.3gpp.pic-bw-var", 31},
+    {"application/vnd.3gpp2.tcap", 26},
+    {"application/vnd.3m.post-it-notes", 32},
+    {"application/vnd.accpac.simply.aso", 33},
+    {"application/vnd.accpac.simply.imp", 33},
+    {"application/vnd.acucobol", 24},
+    {"application/vnd.acucorp", 23},
+    {"application/vnd.adobe.air-application-installer-package+zip", 59},
+    {"application/vnd.adobe.formscentral.fcdt", 39},
+    {"application/vnd.adobe.fxp", 25},
+    {"application/vnd.adobe.xdp+xml", 29},
+    {"application/vnd.adobe.xfdf", 26},
+    {"application/vnd.ahead.space", 27},
+    {"application/vnd.airzip.filesecure.azf", 37},
+    {"application/vnd.airzip.filesecure.azs", 37},
+    {"application/vnd.amazon.ebook", 28},
+    {"application/vnd.americandynamics.acc", 36},
+    {"application/vnd.amiga.ami", 25},
+    {"application/vnd.android.package-archive", 39},
+    {"application/vnd.anser-web-certificate-issue-initiation", 54},
+    {"application/vnd.anser-web-funds-transfer-initiation", 51},
+    {"application/vnd.antix.game-component", 36},
+    {"application/vnd.apple.installer+xml", 35},
+    {"application/vnd.apple.mpegurl", 29},
+    {"application/vnd.aristanetworks.swi", 34},
+    {"application/vnd.astraea-software.iota", 37},
+    {"application/vnd.audiograph", 26},
+    {"application/vnd.blueice.multipass", 33},
+    {"application/vnd.bmi", 19},
+    {"application/vnd.businessobjects", 31},
+    {"application/vnd.chemdraw+xml", 28},
+    {"application/vnd.chipnuts.karaoke-mmd", 36},
+    {"application/vnd.cinderella", 26},
+    {"application/vnd.claymore", 24},
+    {"application/vnd.cloanto.rp9", 27},
+    {"application/vnd.clonk.c4group", 29},
+    {"application/vnd.cluetrust.cartomobile-config", 44},
+    {"application/vnd.cluetrust.cartomobile-config-pkg", 48},
+    {"application/vnd.commonspace", 27},
+    {"application/vnd.contact.cmsg", 28},
+    {"application/vnd.cosmocaller", 27},
+    {"application/vnd.crick.clicker", 29},
+    {"application/vnd.crick.clicker.keyboard", 38},
+    {"application/vnd.crick.clicker.palette", 37},
+    {"application/vnd.crick.clicker.template", 38},
+    {"application/vnd.crick.clicker.wordbank", 38},
+    {"application/vnd.criticaltools.wbs+xml", 37},
+    {"application/vnd.ctc-posml", 25},
+    {"application/vnd.cups-ppd", 24},
+    {"application/vnd.curl.car", 24},
+    {"application/vnd.curl.pcurl", 26},
+    {"application/vnd.dart", 20},
+    {"application/vnd.data-vision.rdz", 31},
+    {"application/vnd.dece.data", 25},
+    {"application/vnd.dece.ttml+xml", 29},
+    {"application/vnd.dece.unspecified", 32},
+    {"application/vnd.dece.zip", 24},
+    {"application/vnd.denovo.fcselayout-link", 38},
+    {"application/vnd.dna", 19},
+    {"application/vnd.dolby.mlp", 25},
+    {"application/vnd.dpgraph", 23},
+    {"application/vnd.dreamfactory", 28},
+    {"application/vnd.ds-keypoint", 27},
+    {"application/vnd.dvb.ait", 23},
+    {"application/vnd.dvb.service", 27},
+    {"application/vnd.dynageo", 23},
+    {"application/vnd.ecowin.chart", 28},
+    {"application/vnd.enliven", 23},
+    {"application/vnd.epson.esf", 25},
+    {"application/vnd.epson.msf", 25},
+    {"application/vnd.epson.quickanime", 32},
+    {"application/vnd.epson.salt", 26},
+    {"application/vnd.epson.ssf", 25},
+    {"application/vnd.eszigno3+xml", 28},
+    {"application/vnd.ezpix-album", 27},
+    {"application/vnd.ezpix-package", 29},
+    {"application/vnd.fdf", 19},
+    {"application/vnd.fdsn.mseed", 26},
+    {"application/vnd.fdsn.seed", 25},
+    {"application/vnd.flographit", 26},
+    {"application/vnd.fluxtime.clip", 29},
+    {"application/vnd.framemaker", 26},
+    {"application/vnd.frogans.fnc", 27},
+    {"application/vnd.frogans.ltf", 27},
+    {"application/vnd.fsc.weblaunch", 29},
+    {"application/vnd.fujitsu.oasys", 29},
+    {"application/vnd.fujitsu.oasys2", 30},
+    {"application/vnd.fujitsu.oasys3", 30},
+    {"application/vnd.fujitsu.oasysgp", 31},
+    {"application/vnd.fujitsu.oasysprs", 32},
+    {"application/vnd.fujixerox.ddd", 29},
+    {"application/vnd.fujixerox.docuworks", 35},
+    {"application/vnd.fujixerox.docuworks.binder", 42},
+    {"application/vnd.fuzzysheet", 26},
+    {"application/vnd.genomatix.tuxedo", 32},
+    {"application/vnd.geogebra.file", 29},
+    {"application/vnd.geogebra.tool", 29},
+    {"application/vnd.geometry-explorer", 33},
+    {"application/vnd.geonext", 23},
+    {"application/vnd.geoplan", 23},
+    {"application/vnd.geospace", 24},
+    {"application/vnd.gmx", 19},
+    {"application/vnd.google-earth.kml+xml", 36},
+    {"application/vnd.google-earth.kmz", 32},
+    {"application/vnd.grafeq", 22},
+    {"application/vnd.groove-account", 30},
+    {"application/vnd.groove-help", 27},
+    {"application/vnd.groove-identity-message", 39},
+    {"application/vnd.groove-injector", 31},
+    {"application/vnd.groove-tool-message", 35},
+    {"application/vnd.groove-tool-template", 36},
+    {"application/vnd.groove-vcard", 28},
+    {"application/vnd.hal+xml", 23},
+    {"application/vnd.handheld-entertainment+xml", 42},
+    {"application/vnd.hbci", 20},
+    {"application/vnd.hhe.lesson-player", 33},
+    {"application/vnd.hp-hpgl", 23},
+    {"application/vnd.hp-hpid", 23},
+    {"application/vnd.hp-hps", 22},
+    {"application/vnd.hp-jlyt", 23},
+    {"application/vnd.hp-pcl", 22},
+    {"application/vnd.hp-pclxl", 24},
+    {"application/vnd.hydrostatix.sof-data", 36},
+    {"application/vnd.ibm.minipay", 27},
+    {"application/vnd.ibm.modcap", 26},
+    {"application/vnd.ibm.rights-management", 37},
+    {"application/vnd.ibm.secure-container", 36},
+    {"application/vnd.iccprofile", 26},
+    {"application/vnd.igloader", 24},
+    {"application/vnd.immervision-ivp", 31},
+    {"application/vnd.immervision-ivu", 31},
+    {"application/vnd.insors.igm", 26},
+    {"application/vnd.intercon.formnet", 32},
+    {"application/vnd.intergeo", 24},
+    {"application/vnd.intu.qbo", 24},
+    {"application/vnd.intu.qfx", 24},
+    {"application/vnd.ipunplugged.rcprofile", 37},
+    {"application/vnd.irepository.package+xml", 39},
+    {"application/vnd.is-xpr", 22},
+    {"application/vnd.isac.fcs", 24},
+    {"application/vnd.jam", 19},
+    {"application/vnd.jcp.javame.midlet-rms", 37},
+    {"application/vnd.jisp", 20},
+    {"application/vnd.joost.joda-archive", 34},
+    {"application/vnd.kahootz", 23},
+    {"application/vnd.kde.karbon", 26},
+    {"application/vnd.kde.kchart", 26},
+    {"application/vnd.kde.kformula", 28},
+    {"application/vnd.kde.kivio", 25},
+    {"application/vnd.kde.kontour", 27},
+    {"application/vnd.kde.kpresenter", 30},
+    {"application/vnd.kde.kspread", 27},
+    {"application/vnd.kde.kword", 25},
+    {"application/vnd.kenameaapp", 26},
+    {"application/vnd.kidspiration", 28},
+    {"application/vnd.kinar", 21},
+    {"application/vnd.koan", 20},
+    {"application/vnd.kodak-descriptor", 32},
+    {"application/vnd.las.las+xml", 27},
+    {"application/vnd.llamagraphics.life-balance.desktop", 50},
+    {"application/vnd.llamagraphics.life-balance.exchange+xml", 55},
+    {"application/vnd.lotus-1-2-3", 27},
+    {"application/vnd.lotus-approach", 30},
+    {"application/vnd.lotus-freelance", 31},
+    {"application/vnd.lotus-notes", 27},
+    {"application/vnd.lotus-organizer", 31},
+    {"application/vnd.lotus-screencam", 31},
+    {"application/vnd.lotus-wordpro", 29},
+    {"application/vnd.macports.portpkg", 32},
+    {"application/vnd.mcd", 19},
+    {"application/vnd.medcalcdata", 27},
+    {"application/vnd.mediastation.cdkey", 34},
+    {"application/vnd.mfer", 20},
+    {"application/vnd.mfmp", 20},
+    {"application/vnd.micrografx.flo", 30},
+    {"application/vnd.micrografx.igx", 30},
+    {"application/vnd.mif", 19},
+    {"application/vnd.mobius.daf", 26},
+    {"application/vnd.mobius.dis", 26},
+    {"application/vnd.mobius.mbk", 26},
+    {"application/vnd.mobius.mqy", 26},
+    {"application/vnd.mobius.msl", 26},
+    {"application/vnd.mobius.plc", 26},
+    {"application/vnd.mobius.txf", 26},
+    {"application/vnd.mophun.application", 34},
+    {"application/vnd.mophun.certificate", 34},
+    {"application/vnd.mozilla.xul+xml", 31},
+    {"application/vnd.ms-artgalry", 27},
+    {"application/vnd.ms-cab-compressed", 33},
+    {"application/vnd.ms-excel", 24},
+    {"application/vnd.ms-excel.addin.macroenabled.12", 46},
+    {"application/vnd.ms-excel.sheet.binary.macroenabled.12", 53},
+    {"application/vnd.ms-excel.sheet.macroenabled.12", 46},
+    {"application/vnd.ms-excel.template.macroenabled.12", 49},
+    {"application/vnd.ms-fontobject", 29},
+    {"application/vnd.ms-htmlhelp", 27},
+    {"application/vnd.ms-ims", 22},
+    {"application/vnd.ms-lrm", 22},
+    {"application/vnd.ms-officetheme", 30},
+    {"application/vnd.ms-pki.seccat", 29},
+    {"application/vnd.ms-pki.stl", 26},
+    {"application/vnd.ms-powerpoint", 29},
+    {"application/vnd.ms-powerpoint.addin.macroenabled.12", 51},
+    {"application/vnd.ms-powerpoint.presentation.macroenabled.12", 58},
+    {"application/vnd.ms-powerpoint.slide.macroenabled.12", 51},
+    {"application/vnd.ms-powerpoint.slideshow.macroenabled.12", 55},
+    {"application/vnd.ms-powerpoint.template.macroenabled.12", 54},
+    {"application/vnd.ms-project", 26},
+    {"application/vnd.ms-word.document.macroenabled.12", 48},
+    {"application/vnd.ms-word.template.macroenabled.12", 48},
+    {"application/vnd.ms-works", 24},
+    {"application/vnd.ms-wpl", 22},
+    {"application/vnd.ms-xpsdocument", 30},
+    {"application/vnd.mseq", 20},
+    {"application/vnd.musician", 24},
+    {"application/vnd.muvee.style", 27},
+    {"application/vnd.mynfc", 21},
+    {"application/vnd.neurolanguage.nlu", 33},
+    {"application/vnd.nitf", 20},
+    {"application/vnd.noblenet-directory", 34},
+    {"application/vnd.noblenet-sealer", 31},
+    {"application/vnd.noblenet-web", 28},
+    {"application/vnd.nokia.n-gage.data", 33},
+    {"application/vnd.nokia.n-gage.symbian.install", 44},
+    {"application/vnd.nokia.radio-preset", 34},
+    {"application/vnd.nokia.radio-presets", 35},
+    {"application/vnd.novadigm.edm", 28},
+    {"application/vnd.novadigm.edx", 28},
+    {"application/vnd.novadigm.ext", 28},
+    {"application/vnd.oasis.opendocument.chart", 40},
+    {"application/vnd.oasis.opendocument.chart-template", 49},
+    {"application/vnd.oasis.opendocument.database", 43},
+    {"application/vnd.oasis.opendocument.formula", 42},
+    {"application/vnd.oasis.opendocument.formula-template", 51},
+    {"application/vnd.oasis.opendocument.graphics", 43},
+    {"application/vnd.oasis.opendocument.graphics-template", 52},
+    {"application/vnd.oasis.opendocument.image", 40},
+    {"application/vnd.oasis.opendocument.image-template", 49},
+    {"application/vnd.oasis.opendocument.presentation", 47},
+    {"application/vnd.oasis.opendocument.presentation-template", 56},
+    {"application/vnd.oasis.opendocument.spreadsheet", 46},
+    {"application/vnd.oasis.opendocument.spreadsheet-template", 55},
+    {"application/vnd.oasis.opendocument.text", 39},
+    {"application/vnd.oasis.opendocument.text-master", 46},
+    {"application/vnd.oasis.opendocument.text-template", 48},
+    {"application/vnd.oasis.opendocument.text-web", 43},
+    {"application/vnd.olpc-sugar", 26},
+    {"application/vnd.oma.dd2+xml", 27},
+    {"application/vnd.openofficeorg.extension", 39},
+    {"application/vnd.openxmlformats-officedocument.presentationml.presentation", 73},
+    {"application/vnd.openxmlformats-officedocument.presentationml.slide", 66},
+    {"application/vnd.openxmlformats-officedocument.presentationml.slideshow", 70},
+    {"application/vnd.openxmlformats-officedocument.presentationml.template", 69},
+    {"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet", 65},
+    {"application/vnd.openxmlformats-officedocument.spreadsheetml.template", 68},
+    {"application/vnd.openxmlformats-officedocument.wordprocessingml.document", 71},
+    {"application/vnd.openxmlformats-officedocument.wordprocessingml.template", 71},
+    {"application/vnd.osgeo.mapguide.package", 38},
+    {"application/vnd.osgi.dp", 23},
+    {"application/vnd.osgi.subsystem", 30},
+    {"application/vnd.palm", 20},
+    {"application/vnd.pawaafile", 25},
+    {"application/vnd.pg.format", 25},
+    {"application/vnd.pg.osasli", 25},
+    {"application/vnd.picsel", 22},
+    {"application/vnd.pmi.widget", 26},
+    {"application/vnd.pocketlearn", 27},
+    {"application/vnd.powerbuilder6", 29},
+    {"application/vnd.previewsystems.box", 34},
+    {"application/vnd.proteus.magazine", 32},
+    {"application/vnd.publishare-delta-tree", 37},
+    {"application/vnd.pvi.ptid1", 25},
+    {"application/vnd.quark.quarkxpress", 33},
+    {"application/vnd.realvnc.bed", 27},
+    {"application/vnd.recordare.musicxml", 34},
+    {"application/vnd.recordare.musicxml+xml", 38},
+    {"application/vnd.rig.cryptonote", 30},
+    {"application/vnd.rim.cod", 23},
+    {"application/vnd.rn-realmedia", 28},
+    {"application/vnd.rn-realmedia-vbr", 32},
+    {"application/vnd.route66.link66+xml", 34},
+    {"application/vnd.sailingtracker.track", 36},
+    {"application/vnd.seemail", 23},
+    {"application/vnd.sema", 20},
+    {"application/vnd.semd", 20},
+    {"application/vnd.semf", 20},
+    {"application/vnd.shana.informed.formdata", 39},
+    {"application/vnd.shana.informed.formtemplate", 43},
+    {"application/vnd.shana.informed.interchange", 42},
+    {"application/vnd.shana.informed.package", 38},
+    {"application/vnd.simtech-mindmapper", 34},
+    {"application/vnd.smaf", 20},
+    {"application/vnd.smart.teacher", 29},
+    {"application/vnd.solent.sdkm+xml", 31},
+    {"application/vnd.spotfire.dxp", 28},
+    {"application/vnd.spotfire.sfs", 28},
+    {"application/vnd.stardivision.calc", 33},
+    {"application/vnd.stardivision.draw", 33},
+    {"application/vnd.stardivision.impress", 36},
+    {"application/vnd.stardivision.math", 33},
+    {"application/vnd.stardivision.writer", 35},
+    {"application/vnd.stardivision.writer-global", 42},
+    {"application/vnd.stepmania.package", 33},
+    {"application/vnd.stepmania.stepchart", 35},
+    {"application/vnd.sun.xml.calc", 28},
+    {"application/vnd.sun.xml.calc.template", 37},
+    {"application/vnd.sun.xml.draw", 28},
+    {"application/vnd.sun.xml.draw.template", 37},
+    {"application/vnd.sun.xml.impress", 31},
+    {"application/vnd.sun.xml.impress.template", 40},
+    {"application/vnd.sun.xml.math", 28},
+    {"application/vnd.sun.xml.writer", 30},
+    {"application/vnd.sun.xml.writer.global", 37},
+    {"application/vnd.sun.xml.writer.template", 39},
+    {"application/vnd.sus-calendar", 28},
+    {"application/vnd.svd", 19},
+    {"application/vnd.symbian.install", 31},
+    {"application/vnd.syncml+xml", 26},
+    {"application/vnd.syncml.dm+wbxml", 31},
+    {"application/vnd.syncml.dm+xml", 29},
+    {"application/vnd.tao.intent-module-archive", 41},
+    {"application/vnd.tcpdump.pcap", 28},
+    {"application/vnd.tmobile-livetv", 30},
+    {"application/vnd.trid.tpt", 24},
+    {"application/vnd.triscape.mxs", 28},
+    {"application/vnd.trueapp", 23},
+    {"application/vnd.ufdl", 20},
+    {"application/vnd.uiq.theme", 25},
+    {"application/vnd.umajin", 22},
+    {"application/vnd.unity", 21},
+    {"application/vnd.uoml+xml", 24},
+    {"application/vnd.vcx", 19},
+    {"application/vnd.visio", 21},
+    {"application/vnd.visionary", 25},
+    {"application/vnd.vsf", 19},
+    {"application/vnd.wap.wbxml", 25},
+    {"application/vnd.wap.wmlc", 24},
+    {"application/vnd.wap.wmlscriptc", 30},
+    {"application/vnd.webturbo", 24},
+    {"application/vnd.wolfram.player", 30},
+    {"application/vnd.wordperfect", 27},
+    {"application/vnd.wqd", 19},
+    {"application/vnd.wt.stf", 22},
+    {"application/vnd.xara", 20},
+    {"application/vnd.xfdl", 20},
+    {"application/vnd.yamaha.hv-dic", 29},
+    {"application/vnd.yamaha.hv-script", 32},
+    {"application/vnd.yamaha.hv-voice", 31},
+    {"application/vnd.yamaha.openscoreformat", 38},
+    {"application/vnd.yamaha.openscoreformat.osfpvg+xml", 49},
+    {"application/vnd.yamaha.smaf-audio", 33},
+    {"application/vnd.yamaha.smaf-phrase", 34},
+    {"application/vnd.yellowriver-custom-menu", 39},
+    {"application/vnd.zul", 19},
+    {"application/vnd.zzazz.deck+xml", 30},
+    {"application/voicexml+xml", 24},
+    {"application/widget", 18},
+    {"application/winhlp", 18},
+    {"application/wsdl+xml", 20},
+    {"application/wspolicy+xml", 24},
+    {"application/x-7z-compressed", 27},
+    {"application/x-abiword", 21},
+    {"application/x-ace-compressed", 28},
+    {"application/x-apple-diskimage", 29},
+    {"application/x-authorware-bin", 28},
+    {"application/x-authorware-map", 28},
+    {"application/x-authorware-seg", 28},
+    {"application/x-bcpio", 19},
+    {"application/x-bittorrent", 24},
+    {"application/x-blorb", 19},
+    {"application/x-bzip", 18},
+    {"application/x-bzip2", 19},
+    {"application/x-cbr", 17},
+    {"application/x-cdlink", 20},
+    {"application/x-cfs-compressed", 28},
+    {"application/x-chat", 18},
+    {"application/x-chess-pgn", 23},
+    {"application/x-conference", 24},
+    {"application/x-cpio", 18},
+    {"application/x-csh", 17},
+    {"application/x-debian-package", 28},
+    {"application/x-dgc-compressed", 28},
+    {"application/x-director", 22},
+    {"application/x-doom", 18},
+    {"application/x-dtbncx+xml", 24},
+    {"application/x-dtbook+xml", 24},
+    {"application/x-dtbresource+xml", 29},
+    {"application/x-dvi", 17},
+    {"application/x-envoy", 19},
+    {"application/x-eva", 17},
+    {"application/x-font-bdf", 22},
+    {"application/x-font-ghostscript", 30},
+    {"application/x-font-linux-psf", 28},
+    {"application/x-font-otf", 22},
+    {"application/x-font-pcf", 22},
+    {"application/x-font-snf", 22},
+    {"application/x-font-ttf", 22},
+    {"application/x-font-type1", 24},
+    {"application/x-freearc", 21},
+    {"application/x-futuresplash", 26},
+    {"application/x-gca-compressed", 28},
+    {"application/x-glulx", 19},
+    {"application/x-gnumeric", 22},
+    {"application/x-gramps-xml", 24},
+    {"application/x-gtar", 18},
+    {"application/x-hdf", 17},
+    {"application/x-install-instructions", 34},
+    {"application/x-iso9660-image", 27},
+    {"application/x-java-jnlp-file", 28},
+    {"application/x-latex", 19},
+    {"application/x-lzh-compressed", 28},
+    {"application/x-mie", 17},
+    {"application/x-mobipocket-ebook", 30},
+    {"application/x-ms-application", 28},
+    {"application/x-ms-shortcut", 25},
+    {"application/x-ms-wmd", 20},
+    {"application/x-ms-wmz", 20},
+    {"application/x-ms-xbap", 21},
+    {"application/x-msaccess", 22},
+    {"application/x-msbinder", 22},
+    {"application/x-mscardfile", 24},
+    {"application/x-msclip", 20},
+    {"application/x-msdownload", 24},
+    {"application/x-msmediaview", 25},
+    {"application/x-msmetafile", 24},
+    {"application/x-msmoney", 21},
+    {"application/x-mspublisher", 25},
+    {"application/x-msschedule", 24},
+    {"application/x-msterminal", 24},
+    {"application/x-mswrite", 21},
+    {"application/x-netcdf", 20},
+    {"application/x-nzb", 17},
+    {"application/x-pkcs12", 20},
+    {"application/x-pkcs7-certificates", 32},
+    {"application/x-pkcs7-certreqresp", 31},
+    {"application/x-rar-compressed", 28},
+    {"application/x-research-info-systems", 35},
+    {"application/x-sh", 16},
+    {"application/x-shar", 18},
+    {"application/x-shockwave-flash", 29},
+    {"application/x-silverlight-app", 29},
+    {"application/x-sql", 17},
+    {"application/x-stuffit", 21},
+    {"application/x-stuffitx", 22},
+    {"application/x-subrip", 20},
+    {"application/x-sv4cpio", 21},
+    {"application/x-sv4crc", 20},
+    {"application/x-t3vm-image", 24},
+    {"application/x-tads", 18},
+    {"application/x-tar", 17},
+    {"application/x-tcl", 17},
+    {"application/x-tex", 17},
+    {"application/x-tex-tfm", 21},
+    {"application/x-texinfo", 21},
+    {"application/x-tgif", 18},
+    {"application/x-ustar", 19},
+    {"application/x-wais-source", 25},
+    {"application/x-x509-ca-cert", 26},
+    {"application/x-xfig", 18},
+    {"application/x-xliff+xml", 23},
+    {"application/x-xpinstall", 23},
+    {"application/x-xz", 16},
+    {"application/x-zmachine", 22},
+    {"application/xaml+xml", 20},
+    {"application/xcap-diff+xml", 25},
+    {"application/xenc+xml", 20},
+    {"application/xhtml+xml", 21},
+    {"application/xml", 15},
+    {"application/xml-dtd", 19},
+    {"application/xop+xml", 19},
+    {"application/xproc+xml", 21},
+    {"application/xslt+xml", 20},
+    {"application/xspf+xml", 20},
+    {"application/xv+xml", 18},
+    {"application/yang", 16},
+    {"application/yin+xml", 19},
+    {"application/zip", 15},
+    {"audio/adpcm", 11},
+    {"audio/basic", 11},
+    {"audio/midi", 10},
+    {"audio/mp4", 9},
+    {"audio/mpeg", 10},
+    {"audio/ogg", 9},
+    {"audio/s3m", 9},
+    {"audio/silk", 10},
+    {"audio/vnd.dece.audio", 20},
+    {"audio/vnd.digital-winds", 23},
+    {"audio/vnd.dra", 13},
+    {"audio/vnd.dts", 13},
+    {"audio/vnd.dts.hd", 16},
+    {"audio/vnd.lucent.voice", 22},
+    {"audio/vnd.ms-playready.media.pya", 32},
+    {"audio/vnd.nuera.ecelp4800", 25},
+    {"audio/vnd.nuera.ecelp7470", 25},
+    {"audio/vnd.nuera.ecelp9600", 25},
+    {"audio/vnd.rip", 13},
+    {"audio/webm", 10},
+    {"audio/x-aac", 11},
+    {"audio/x-aiff", 12},
+    {"audio/x-caf", 11},
+    {"audio/x-flac", 12},
+    {"audio/x-matroska", 16},
+    {"audio/x-mpegurl", 15},
+    {"audio/x-ms-wax", 14},
+    {"audio/x-ms-wma", 14},
+    {"audio/x-pn-realaudio", 20},
+    {"audio/x-pn-realaudio-plugin", 27},
+    {"audio/x-wav", 11},
+    {"audio/xm", 8},
+    {"chemical/x-cdx", 14},
+    {"chemical/x-cif", 14},
+    {"chemical/x-cmdf", 15},
+    {"chemical/x-cml", 14},
+    {"chemical/x-csml", 15},
+    {"chemical/x-xyz", 14},
+    {"image/bmp", 9},
+    {"image/cgm", 9},
+    {"image/g3fax", 11},
+    {"image/gif", 9},
+    {"image/ief", 9},
+    {"image/jpeg", 10},
+    {"image/ktx", 9},
+    {"image/png", 9},
+    {"image/prs.btif", 14},
+    {"image/sgi", 9},
+    {"image/svg+xml", 13},
+    {"image/tiff", 10},
+    {"image/vnd.adobe.photoshop", 25},
+    {"image/vnd.dece.graphic", 22},
+    {"image/vnd.djvu", 14},
+    {"image/vnd.dwg", 13},
+    {"image/vnd.dxf", 13},
+    {"image/vnd.fastbidsheet", 22},
+    {"image/vnd.fpx", 13},
+    {"image/vnd.fst", 13},
+    {"image/vnd.fujixerox.edmics-mmr", 30},
+    {"image/vnd.fujixerox.edmics-rlc", 30},
+    {"image/vnd.ms-modi", 17},
+    {"image/vnd.ms-photo", 18},
+    {"image/vnd.net-fpx", 17},
+    {"image/vnd.wap.wbmp", 18},
+    {"image/vnd.xiff", 14},
+    {"image/webp", 10},
+    {"image/x-3ds", 11},
+    {"image/x-cmu-raster", 18},
+    {"image/x-cmx", 11},
+    {"image/x-freehand", 16},
+    {"image/x-icon", 12},
+    {"image/x-mrsid-image", 19},
+    {"image/x-pcx", 11},
+    {"image/x-pict", 12},
+    {"image/x-portable-anymap", 23},
+    {"image/x-portable-bitmap", 23},
+    {"image/x-portable-graymap", 24},
+    {"image/x-portable-pixmap", 23},
+    {"image/x-rgb", 11},
+    {"image/x-tga", 11},
+    {"image/x-xbitmap", 15},
+    {"image/x-xpixmap", 15},
+    {"image/x-xwindowdump", 19},
+    {"message/rfc822", 14},
+    {"model/iges", 10},
+    {"model/mesh", 10},
+    {"model/vnd.collada+xml", 21},
+    {"model/vnd.dwf", 13},
+    {"model/vnd.gdl", 13},
+    {"model/vnd.gtw", 13},
+    {"model/vnd.mts", 13},
+    {"model/vnd.vtu", 13},
+    {"model/vrml", 10},
+    {"model/x3d+binary", 16},
+    {"model/x3d+vrml", 14},
+    {"model/x3d+xml", 13},
+    {"text/cache-manifest", 19},
+    {"text/calendar", 13},
+    {"text/css", 8},
+    {"text/csv", 8},
+    {"text/html", 9},
+    {"text/markdown", 13},
+    {"text/n3", 7},
+    {"text/plain", 10},
+    {"text/prs.lines.tag", 18},
+    {"text/richtext", 13},
+    {"text/sgml", 9},
+    {"text/tab-separated-values", 25},
+    {"text/troff", 10},
+    {"text/turtle", 11},
+    {"text/uri-list", 13},
+    {"text/vcard", 10},
+    {"text/vnd.curl", 13},
+    {"text/vnd.curl.dcurl", 19},
+    {"text/vnd.curl.mcurl", 19},
+    {"text/vnd.curl.scurl", 19},
+    {"text/vnd.dvb.subtitle", 21},
+    {"text/vnd.fly", 12},
+    {"text/vnd.fmi.flexstor", 21},
+    {"text/vnd.graphviz", 17},
+    {"text/vnd.in3d.3dml", 18},
+    {"text/vnd.in3d.spot", 18},
+    {"text/vnd.sun.j2me.app-descriptor", 32},
+    {"text/vnd.wap.wml", 16},
+    {"text/vnd.wap.wmlscript", 22},
+    {"text/x-asm", 10},
+    {"text/x-c", 8},
+    {"text/x-fortran", 14},
+    {"text/x-java-source", 18},
+    {"text/x-nfo", 10},
+    {"text/x-opml", 11},
+    {"text/x-pascal", 13},
+    {"text/x-setext", 13},
+    {"text/x-sfv", 10},
+    {"text/x-uuencode", 15},
+    {"text/x-vcalendar", 16},
+    {"text/x-vcard", 12},
+    {"video/3gpp", 10},
+    {"video/3gpp2", 11},
+    {"video/h261", 10},
+    {"video/h263", 10},
+    {"video/h264", 10},
+    {"video/jpeg", 10},
+    {"video/jpm", 9},
+    {"video/mj2", 9},
+    {"video/mp4", 9},
+    {"video/mpeg", 10},
+    {"video/ogg", 9},
+    {"video/quicktime", 15},
+    {"video/vnd.dece.hd", 17},
+    {"video/vnd.dece.mobile", 21},
+    {"video/vnd.dece.pd", 17},
+    {"video/vnd.dece.sd", 17},
+    {"video/vnd.dece.video", 20},
+    {"video/vnd.dvb.file", 18},
+    {"video/vnd.fvt", 13},
+    {"video/vnd.mpegurl", 17},
+    {"video/vnd.ms-playready.media.pyv", 32},
+    {"video/vnd.uvvu.mp4", 18},
+    {"video/vnd.vivo", 14},
+    {"video/webm", 10},
+    {"video/x-f4v", 11},
+    {"video/x-fli", 11},
+    {"video/x-flv", 11},
+    {"video/x-m4v", 11},
+    {"video/x-matroska", 16},
+    {"video/x-mng", 11},
+    {"video/x-ms-asf", 14},
+    {"video/x-ms-vob", 14},
+    {"video/x-ms-wm", 13},
+    {"video/x-ms-wmv", 14},
+    {"video/x-ms-wmx", 14},
+    {"video/x-ms-wvx", 14},
+    {"video/x-msvideo", 15},
+    {"video/x-sgi-movie", 17},
+    {"video/x-smv", 11},
+    {"x-conference/x-cooltalk", 23},
+};
+
+/** The table's slots, each extension is stored in the slot its seed selects. */
+static const struct {
+  const char *ext;
+  uint8_t len;
+  uint16_t type;
+} http_mime_table[HTTP_MIME_TABLE_SIZE] = {
+    {"gam", 3, 559},
+    {"m2v", 3, 734},
+    {"xlsb", 4, 302},
+    {"ltf", 3, 194},
+    {"lnk", 3, 525},
+    {"z6", 2, 573},
+    {"kne", 3, 266},
+    {"dgc", 3, 492},
+    {"rcprofile", 9, 247},
+    {"cc", 2, 714},
+    {"exe", 3, 533},
+    {"xfdf", 4, 122},
+    {"m21", 3, 48},
+    {"docm", 4, 319},
+    {"mpc", 3, 296},
+    {"slt", 3, 182},
+    {"sdkd", 4, 404},
+    {"cdxml", 5, 141},
+    {"bdf", 3, 501},
+    {"mdi", 3, 648},
+    {"mbox", 4, 42},
+    {"flv", 3, 751},
+    {"evy", 3, 499},
+    {"dd2", 3, 358},
+    {"kmz", 3, 214},
+    {"wbs", 3, 157},
+    {"sitx", 4, 554},
+    {"uvs", 3, 740},
+    {"xpl", 3, 581},
+    {"xbd", 3, 203},
+    {"vst", 3, 443},
+    {"mp4v", 4, 733},
+    {"f77", 3, 715},
+    {"jpgm", 4, 731},
+    {"gram", 4, 101},
+    {"mif", 3, 287},
+    {"sldm", 4, 315},
+    {"ecelp9600", 9, 605},
+    {"sgi", 3, 635},
+    {"vcd", 3, 484},
+    {"pbd", 3, 378},
+    {"ghf", 3, 217},
+    {"hps", 3, 229},
+    {"aac", 3, 608},
+    {"qps", 3, 381},
+    {"susp", 4, 425},
+    {"3ds", 3, 654},
+    {"vrml", 4, 680},
+    {"ami", 3, 128},
+    {"mpg", 3, 734},
+    {"mmr", 3, 646},
+    {"xo", 2, 357},
+    {"potx", 4, 363},
+    {"link66", 6, 391},
+    {"sgl", 3, 412},
+    {"sgml", 4, 694},
+    {"x3d", 3, 683},
+    {"mp2a", 4, 592},
+    {"aab", 3, 475},
+    {"cab", 3, 299},
+    {"odb", 3, 342},
+    {"atx", 3, 132},
+    {"roa", 3, 85},
+    {"cii", 3, 130},
+    {"oa3", 3, 198},
+    {"xls", 3, 300},
+    {"sxc", 3, 415},
+    {"qxb", 3, 383},
+    {"fpx", 3, 644},
+    {"snd", 3, 589},
+    {"cxt", 3, 493},
+    {"m3a", 3, 592},
+    {"xer", 3, 59},
+    {"dsc", 3, 692},
+    {"mny", 3, 536},
+    {"f90", 3, 715},
+    {"wsdl", 4, 469},
+    {"ustar", 5, 566},
+    {"musicxml", 8, 386},
+    {"ifb", 3, 685},
+    {"text", 4, 691},
+    {"trm", 3, 539},
+    {"texi", 4, 564},
+    {"rip", 3, 606},
+    {"cap", 3, 432},
+    {"sid", 3, 659},
+    {"tao", 3, 431},
+    {"wmv", 3, 758},
+    {"sdp", 3, 94},
+    {"ssml", 4, 105},
+    {"jad", 3, 710},
+    {"rdf", 3, 77},
+    {"curl", 4, 700},
+    {"kml", 3, 213},
+    {"m2a", 3, 592},
+    {"dbk", 3, 13},
+    {"bpk", 3, 52},
+    {"dms", 3, 52},
+    {"asx", 3, 755},
+    {"csml", 4, 624},
+    {"sh", 2, 548},
+    {"sv4crc", 6, 557},
+    {"dir", 3, 493},
+    {"vcg", 3, 222},
+    {"tfi", 3, 107},
+    {"h", 1, 714},
+    {"ksp", 3, 262},
+    {"opml", 4, 718},
+    {"ppm", 3, 665},
+    {"odf", 3, 343},
+    {"uvvv", 4, 741},
+    {"uvvu", 4, 746},
+    {"x3db", 4, 681},
+    {"crd", 3, 531},
+    {"vss", 3, 443},
+    {"cml", 3, 623},
+    {"sdw", 3, 411},
+    {"f4v", 3, 749},
+    {"onetmp", 6, 57},
+    {"g3", 2, 628},
+    {"ppam", 4, 313},
+    {"weba", 4, 607},
+    {"mb", 2, 40},
+    {"listafp", 7, 235},
+    {"prf", 3, 63},
+    {"svgz", 4, 636},
+    {"s3m", 3, 594},
+    {"html", 4, 688},
+    {"hvs", 3, 457},
+    {"gv", 2, 707},
+    {"geo", 3, 176},
+    {"mks", 3, 753},
+    {"osfpvg", 6, 460},
+    {"fcdt", 4, 119},
+    {"smzip", 5, 413},
+    {"sda", 3, 408},
+    {"fgd", 3, 493},
+    {"frame", 5, 192},
+    {"js", 2, 31},
+    {"metalink", 8, 44},
+    {"xpr", 3, 249},
+    {"cdx", 3, 620},
+    {"pdf", 3, 60},
+    {"blb", 3, 480},
+    {"webp", 4, 653},
+    {"wml", 3, 711},
+    {"u32", 3, 475},
+    {"lbe", 3, 271},
+    {"cmdf", 4, 622},
+    {"pya", 3, 602},
+    {"smv", 3, 763},
+    {"dts", 3, 599},
+    {"skd", 3, 267},
+    {"i2g", 3, 244},
+    {"wmz", 3, 527},
+    {"jpgv", 4, 730},
+    {"pcurl", 5, 161},
+    {"h264", 4, 729},
+    {"tpl", 3, 221},
+    {"oa2", 3, 197},
+    {"emz", 3, 535},
+    {"vox", 3, 475},
+    {"ntf", 3, 329},
+    {"conf", 4, 691},
+    {"rtf", 3, 88},
+    {"mpkg", 4, 133},
+    {"dvb", 3, 742},
+    {"mpt", 3, 318},
+    {"bz2", 3, 482},
+    {"spq", 3, 92},
+    {"shar", 4, 549},
+    {"see", 3, 393},
+    {"svg", 3, 636},
+    {"mesh", 4, 673},
+    {"csh", 3, 490},
+    {"txd", 3, 205},
+    {"xar", 3, 454},
+    {"c4p", 3, 146},
+    {"dotm", 4, 320},
+    {"x3dz", 4, 683},
+    {"mar", 3, 52},
+    {"fh5", 3, 657},
+    {"spp", 3, 93},
+    {"pls", 3, 73},
+    {"xdf", 3, 575},
+    {"tsd", 3, 108},
+    {"mpg4", 4, 733},
+    {"et3", 3, 184},
+    {"clkx", 4, 152},
+    {"ttl", 3, 697},
+    {"asc", 3, 62},
+    {"htm", 3, 688},
+    {"nbp", 3, 450},
+    {"hvp", 3, 458},
+    {"cbr", 3, 483},
+    {"lwp", 3, 278},
+    {"scm", 3, 277},
+    {"oas", 3, 196},
+    {"xhvml", 5, 584},
+    {"dae", 3, 674},
+    {"fzs", 3, 204},
+    {"z5", 2, 573},
+    {"pptm", 4, 314},
+    {"latex", 5, 520},
+    {"mfm", 3, 284},
+    {"wks", 3, 321},
+    {"qwt", 3, 383},
+    {"so", 2, 52},
+    {"btif", 4, 634},
+    {"rtx", 3, 693},
+    {"fh", 2, 657},
+    {"asf", 3, 755},
+    {"fvt", 3, 743},
+    {"rif", 3, 78},
+    {"nitf", 4, 329},
+    {"x32", 3, 475},
+    {"uvvz", 4, 167},
+    {"xif", 3, 652},
+    {"kia", 3, 265},
+    {"h263", 4, 728},
+    {"cfs", 3, 485},
+    {"jpm", 3, 731},
+    {"dvi", 3, 498},
+    {"ms", 2, 696},
+    {"nns", 3, 331},
+    {"apr", 3, 273},
+    {"bz", 2, 481},
+    {"aifc", 4, 609},
+    {"c", 1, 714},
+    {"rq", 2, 99},
+    {"sxg", 3, 423},
+    {"ipk", 3, 400},
+    {"twds", 4, 401},
+    {"oprc", 4, 371},
+    {"wdb", 3, 321},
+    {"mxf", 3, 51},
+    {"pwn", 3, 113},
+    {"ufdl", 4, 437},
+    {"tga", 3, 667},
+    {"jpeg", 4, 631},
+    {"gbr", 3, 83},
+    {"svc", 3, 175},
+    {"c4f", 3, 146},
+    {"tfm", 3, 563},
+    {"gmx", 3, 212},
+    {"midi", 4, 590},
+    {"dp", 2, 369},
+    {"cdbcmsg", 7, 150},
+    {"arc", 3, 509},
+    {"cdmid", 5, 8},
+    {"ncx", 3, 495},
+    {"bmi", 3, 139},
+    {"cif", 3, 621},
+    {"wcm", 3, 321},
+    {"wqd", 3, 452},
+    {"install", 7, 517},
+    {"uvx", 3, 166},
+    {"uvvt", 4, 165},
+    {"chrt", 4, 257},
+    {"daf", 3, 288},
+    {"ssf", 3, 183},
+    {"eml", 3, 671},
+    {"qwd", 3, 383},
+    {"flac", 4, 611},
+    {"unityweb", 8, 440},
+    {"java", 4, 716},
+    {"gqs", 3, 215},
+    {"dpg", 3, 171},
+    {"mpga", 4, 592},
+    {"z7", 2, 573},
+    {"irm", 3, 236},
+    {"bat", 3, 533},
+    {"ps", 2, 74},
+    {"atomcat", 7, 3},
+    {"vxml", 4, 466},
+    {"p", 1, 719},
+    {"aif", 3, 609},
+    {"acc", 3, 127},
+    {"vcs", 3, 723},
+    {"wspolicy", 8, 470},
+    {"fh4", 3, 657},
+    {"ecma", 4, 16},
+    {"x3dvz", 5, 682},
+    {"mng", 3, 754},
+    {"docx", 4, 366},
+    {"emf", 3, 535},
+    {"seed", 4, 189},
+    {"mp4s", 4, 49},
+    {"mods", 4, 47},
+    {"sema", 4, 394},
+    {"fst", 3, 645},
+    {"hlp", 3, 468},
+    {"nsc", 3, 488},
+    {"cxx", 3, 714},
+    {"dist", 4, 52},
+    {"ftc", 3, 191},
+    {"pki", 3, 72},
+    {"teacher", 7, 403},
+    {"ppt", 3, 312},
+    {"plc", 3, 293},
+    {"swa", 3, 493},
+    {"tcl", 3, 561},
+    {"cpp", 3, 714},
+    {"ppsx", 4, 362},
+    {"xfdl", 4, 455},
+    {"stc", 3, 416},
+    {"wri", 3, 540},
+    {"nc", 2, 541},
+    {"skt", 3, 267},
+    {"der", 3, 568},
+    {"ufd", 3, 437},
+    {"cil", 3, 298},
+    {"vor", 3, 411},
+    {"inkml", 5, 26},
+    {"sfv", 3, 721},
+    {"rgb", 3, 666},
+    {"kfo", 3, 258},
+    {"fxp", 3, 120},
+    {"webm", 4, 748},
+    {"svd", 3, 426},
+    {"ace", 3, 473},
+    {"odi", 3, 347},
+    {"onetoc", 6, 57},
+    {"xpx", 3, 243},
+    {"djv", 3, 640},
+    {"uvh", 3, 737},
+    {"lha", 3, 521},
+    {"mgp", 3, 368},
+    {"zir", 3, 464},
+    {"oxt", 3, 359},
+    {"fig", 3, 569},
+    {"xpw", 3, 243},
+    {"pfx", 3, 543},
+    {"xlt", 3, 300},
+    {"es3", 3, 184},
+    {"ram", 3, 616},
+    {"mdb", 3, 529},
+    {"gtw", 3, 677},
+    {"sse", 3, 268},
+    {"rp9", 3, 145},
+    {"rs", 2, 82},
+    {"xhtml", 5, 577},
+    {"cmc", 3, 151},
+    {"cmp", 3, 463},
+    {"c11amz", 6, 148},
+    {"gsf", 3, 502},
+    {"xps", 3, 323},
+    {"m1v", 3, 734},
+    {"wmd", 3, 526},
+    {"apk", 3, 129},
+    {"otp", 3, 350},
+    {"gpx", 3, 23},
+    {"rmvb", 4, 390},
+    {"rpss", 4, 336},
+    {"eps", 3, 74},
+    {"exi", 3, 19},
+    {"vob", 3, 756},
+    {"cryptonote", 10, 387},
+    {"dot", 3, 50},
+    {"ktr", 3, 255},
+    {"lasxml", 6, 269},
+    {"pnm", 3, 662},
+    {"mmf", 3, 402},
+    {"aam", 3, 476},
+    {"dmp", 3, 432},
+    {"tar", 3, 560},
+    {"cba", 3, 483},
+    {"hqx", 3, 35},
+    {"org", 3, 276},
+    {"abw", 3, 472},
+    {"sbml", 4, 89},
+    {"karbon", 6, 256},
+    {"x3dv", 4, 682},
+    {"xdssc", 5, 15},
+    {"torrent", 7, 479},
+    {"n3", 2, 690},
+    {"srx", 3, 100},
+    {"tif", 3, 637},
+    {"deb", 3, 491},
+    {"djvu", 4, 640},
+    {"scurl", 5, 703},
+    {"kwd", 3, 263},
+    {"npx", 3, 650},
+    {"m4a", 3, 591},
+    {"semd", 4, 395},
+    {"vsf", 3, 445},
+    {"xyz", 3, 625},
+    {"otf", 3, 504},
+    {"taglet", 6, 327},
+    {"spx", 3, 593},
+    {"cct", 3, 493},
+    {"bh2", 3, 200},
+    {"mie", 3, 522},
+    {"pub", 3, 537},
+    {"pclxl", 5, 232},
+    {"aw", 2, 1},
+    {"mseq", 4, 324},
+    {"ivu", 3, 241},
+    {"mvb", 3, 534},
+    {"kar", 3, 590},
+    {"wbxml", 5, 446},
+    {"lrf", 3, 52},
+    {"odm", 3, 354},
+    {"flo", 3, 285},
+    {"appcache", 8, 684},
+    {"hpgl", 4, 227},
+    {"sxw", 3, 422},
+    {"odp", 3, 349},
+    {"rlc", 3, 647},
+    {"ez2", 3, 185},
+    {"wma", 3, 615},
+    {"fm", 2, 192},
+    {"rmi", 3, 590},
+    {"uoml", 4, 441},
+    {"wg", 2, 376},
+    {"vsd", 3, 443},
+    {"jpg", 3, 631},
+    {"mp4a", 4, 591},
+    {"zirz", 4, 464},
+    {"esa", 3, 370},
+    {"pcap", 4, 432},
+    {"pfm", 3, 508},
+    {"psb", 3, 110},
+    {"dssc", 4, 14},
+    {"mpn", 3, 295},
+    {"qxd", 3, 383},
+    {"meta4", 5, 45},
+    {"markdown", 8, 689},
+    {"yin", 3, 586},
+    {"smil", 4, 98},
+    {"utz", 3, 438},
+    {"icm", 3, 238},
+    {"dtb", 3, 496},
+    {"twd", 3, 401},
+    {"mets", 4, 46},
+    {"mft", 3, 84},
+    {"qbo", 3, 245},
+    {"otc", 3, 341},
+    {"snf", 3, 506},
+    {"htke", 4, 264},
+    {"png", 3, 633},
+    {"aiff", 4, 609},
+    {"aep", 3, 137},
+    {"ott", 3, 355},
+    {"plb", 3, 109},
+    {"lbd", 3, 270},
+    {"kon", 3, 260},
+    {"uvz", 3, 167},
+    {"aso", 3, 114},
+    {"sql", 3, 552},
+    {"caf", 3, 610},
+    {"wav", 3, 618},
+    {"fti", 3, 131},
+    {"dwg", 3, 641},
+    {"au", 2, 589},
+    {"pic", 3, 661},
+    {"sxm", 3, 421},
+    {"ttf", 3, 507},
+    {"nnd", 3, 330},
+    {"mlp", 3, 170},
+    {"ser", 3, 29},
+    {"box", 3, 379},
+    {"edx", 3, 338},
+    {"skm", 3, 267},
+    {"tr", 2, 696},
+    {"cb7", 3, 483},
+    {"cdf", 3, 541},
+    {"msl", 3, 292},
+    {"pfa", 3, 508},
+    {"ktx", 3, 632},
+    {"rms", 3, 252},
+    {"fnc", 3, 193},
+    {"uvvd", 4, 164},
+    {"wps", 3, 321},
+    {"fly", 3, 705},
+    {"wmlsc", 5, 448},
+    {"rss", 3, 87},
+    {"ivp", 3, 240},
+    {"xbap", 4, 528},
+    {"uvvf", 4, 164},
+    {"sm", 2, 414},
+    {"ext", 3, 339},
+    {"avi", 3, 761},
+    {"sus", 3, 425},
+    {"list", 4, 691},
+    {"uvm", 3, 738},
+    {"std", 3, 418},
+    {"obd", 3, 530},
+    {"xpm", 3, 669},
+    {"g2w", 3, 210},
+    {"gxf", 3, 24},
+    {"flx", 3, 706},
+    {"pgn", 3, 487},
+    {"wad", 3, 494},
+    {"xht", 3, 577},
+    {"clkp", 4, 154},
+    {"ppd", 3, 159},
+    {"pkipath", 7, 71},
+    {"ttc", 3, 507},
+    {"xdm", 3, 430},
+    {"sub", 3, 704},
+    {"distz", 5, 52},
+    {"davmount", 8, 12},
+    {"mj2", 3, 732},
+    {"f", 1, 715},
+    {"gex", 3, 208},
+    {"ez", 2, 0},
+    {"stw", 3, 424},
+    {"azf", 3, 124},
+    {"wtb", 3, 449},
+    {"ggt", 3, 207},
+    {"oth", 3, 356},
+    {"qxt", 3, 383},
+    {"m13", 3, 534},
+    {"list3820", 8, 235},
+    {"ggb", 3, 206},
+    {"jpe", 3, 631},
+    {"sig", 3, 62},
+    {"sxd", 3, 417},
+    {"atom", 4, 2},
+    {"ulx", 3, 512},
+    {"z3", 2, 573},
+    {"bin", 3, 52},
+    {"les", 3, 226},
+    {"xpi", 3, 571},
+    {"onetoc2", 7, 57},
+    {"vcard", 5, 699},
+    {"ptid", 4, 382},
+    {"mcd", 3, 280},
+    {"mpe", 3, 734},
+    {"mp2", 3, 592},
+    {"xlf", 3, 570},
+    {"hh", 2, 714},
+    {"mmd", 3, 142},
+    {"fdf", 3, 187},
+    {"log", 3, 691},
+    {"cdkey", 5, 282},
+    {"msty", 4, 326},
+    {"nsf", 3, 275},
+    {"efif", 4, 375},
+    {"mcurl", 5, 702},
+    {"str", 3, 373},
+    {"ppsm", 4, 316},
+    {"sc", 2, 237},
+    {"dcr", 3, 493},
+    {"gim", 3, 218},
+    {"pcl", 3, 231},
+    {"mp4", 3, 733},
+    {"blorb", 5, 480},
+    {"odc", 3, 340},
+    {"wpd", 3, 451},
+    {"dmg", 3, 474},
+    {"xdp", 3, 121},
+    {"qt", 2, 736},
+    {"mpp", 3, 318},
+    {"bmp", 3, 626},
+    {"kwt", 3, 263},
+    {"yang", 4, 585},
+    {"xltm", 4, 304},
+    {"eva", 3, 500},
+    {"sti", 3, 420},
+    {"flw", 3, 259},
+    {"cdmio", 5, 9},
+    {"swf", 3, 550},
+    {"dwf", 3, 675},
+    {"clp", 3, 532},
+    {"uvvp", 4, 739},
+    {"emma", 4, 17},
+    {"lrm", 3, 308},
+    {"for", 3, 715},
+    {"oti", 3, 348},
+    {"psd", 3, 638},
+    {"rar", 3, 546},
+    {"spl", 3, 510},
+    {"uvv", 3, 741},
+    {"obj", 3, 565},
+    {"xspf", 4, 583},
+    {"nfo", 3, 717},
+    {"dra", 3, 598},
+    {"xenc", 4, 576},
+    {"xlam", 4, 301},
+    {"wmlc", 4, 447},
+    {"cmx", 3, 656},
+    {"swi", 3, 135},
+    {"mime", 4, 671},
+    {"epub", 4, 18},
+    {"azw", 3, 126},
+    {"fg5", 3, 199},
+    {"xwd", 3, 670},
+    {"vcf", 3, 724},
+    {"iso", 3, 518},
+    {"tei", 3, 106},
+    {"s", 1, 713},
+    {"setreg", 6, 96},
+    {"sfs", 3, 406},
+    {"iges", 4, 672},
+    {"mc1", 3, 281},
+    {"uvi", 3, 639},
+    {"rl", 2, 80},
+    {"xul", 3, 297},
+    {"ods", 3, 351},
+    {"ico", 3, 658},
+    {"vcx", 3, 442},
+    {"icc", 3, 238},
+    {"ogg", 3, 593},
+    {"grv", 3, 219},
+    {"vtu", 3, 679},
+    {"omdoc", 5, 56},
+    {"xml", 3, 578},
+    {"gca", 3, 511},
+    {"atomsvc", 7, 4},
+    {"esf", 3, 179},
+    {"ots", 3, 352},
+    {"asm", 3, 713},
+    {"jar", 3, 28},
+    {"tiff", 4, 637},
+    {"mag", 3, 177},
+    {"pkg", 3, 52},
+    {"uvvs", 4, 740},
+    {"viv", 3, 747},
+    {"sil", 3, 595},
+    {"grxml", 5, 102},
+    {"p12", 3, 543},
+    {"spf", 3, 462},
+    {"sisx", 4, 427},
+    {"mrcx", 4, 39},
+    {"m3u8", 4, 134},
+    {"wax", 3, 614},
+    {"psf", 3, 503},
+    {"dotx", 4, 367},
+    {"portpkg", 7, 279},
+    {"prc", 3, 523},
+    {"bdm", 3, 429},
+    {"mov", 3, 736},
+    {"mgz", 3, 380},
+    {"sfd-hdstx", 9, 233},
+    {"sldx", 4, 361},
+    {"woff", 4, 21},
+    {"crl", 3, 70},
+    {"wrl", 3, 680},
+    {"mts", 3, 678},
+    {"uvt", 3, 165},
+    {"roff", 4, 696},
+    {"uvvh", 4, 737},
+    {"rep", 3, 140},
+    {"gml", 3, 22},
+    {"cpio", 4, 489},
+    {"gph", 3, 190},
+    {"joda", 4, 254},
+    {"plf", 3, 377},
+    {"jam", 3, 251},
+    {"urls", 4, 698},
+    {"hdf", 3, 516},
+    {"sru", 3, 103},
+    {"xlsx", 4, 364},
+    {"pfb", 3, 508},
+    {"p7r", 3, 545},
+    {"m4u", 3, 744},
+    {"cgm", 3, 627},
+    {"gdl", 3, 676},
+    {"com", 3, 533},
+    {"mxml", 4, 584},
+    {"onepkg", 6, 57},
+    {"air", 3, 118},
+    {"pgm", 3, 664},
+    {"uvvm", 4, 738},
+    {"wbmp", 4, 651},
+    {"elc", 3, 52},
+    {"css", 3, 686},
+    {"texinfo", 7, 564},
+    {"msi", 3, 533},
+    {"wm", 2, 757},
+    {"ief", 3, 630},
+    {"mseed", 5, 188},
+    {"xz", 2, 572},
+    {"mxu", 3, 744},
+    {"igm", 3, 242},
+    {"kpt", 3, 261},
+    {"cdmic", 5, 7},
+    {"3g2", 3, 726},
+    {"jisp", 4, 253},
+    {"mwf", 3, 283},
+    {"uvp", 3, 739},
+    {"imp", 3, 115},
+    {"xlc", 3, 300},
+    {"z1", 2, 573},
+    {"json", 4, 32},
+    {"sxi", 3, 419},
+    {"sdd", 3, 409},
+    {"odg", 3, 345},
+    {"afm", 3, 508},
+    {"ahead", 5, 123},
+    {"stl", 3, 311},
+    {"rmp", 3, 617},
+    {"pyv", 3, 745},
+    {"xm", 2, 619},
+    {"skp", 3, 267},
+    {"xltx", 4, 365},
+    {"scs", 3, 91},
+    {"silo", 4, 673},
+    {"c4u", 3, 146},
+    {"igl", 3, 239},
+    {"jnlp", 4, 519},
+    {"saf", 3, 461},
+    {"c11amc", 6, 147},
+    {"mk3d", 4, 753},
+    {"xop", 3, 580},
+    {"mka", 3, 612},
+    {"lzh", 3, 521},
+    {"etx", 3, 720},
+    {"cdmia", 5, 6},
+    {"123", 3, 272},
+    {"rld", 3, 81},
+    {"csp", 3, 149},
+    {"sdkm", 4, 404},
+    {"uvvi", 4, 639},
+    {"hpid", 4, 228},
+    {"def", 3, 691},
+    {"scd", 3, 538},
+    {"lostxml", 7, 34},
+    {"chat", 4, 486},
+    {"mathml", 6, 41},
+    {"eot", 3, 305},
+    {"me", 2, 696},
+    {"man", 3, 696},
+    {"hbci", 4, 225},
+    {"jsonml", 6, 33},
+    {"oda", 3, 53},
+    {"wpl", 3, 322},
+    {"ras", 3, 655},
+    {"ei6", 3, 374},
+    {"gre", 3, 208},
+    {"xap", 3, 551},
+    {"uvg", 3, 639},
+    {"nnw", 3, 332},
+    {"ra", 2, 616},
+    {"wdp", 3, 649},
+    {"nzb", 3, 542},
+    {"ice", 3, 764},
+    {"zmm", 3, 224},
+    {"dtshd", 5, 600},
+    {"fh7", 3, 657},
+    {"txf", 3, 294},
+    {"mqy", 3, 291},
+    {"nml", 3, 178},
+    {"smf", 3, 410},
+    {"h261", 4, 727},
+    {"mp21", 4, 48},
+    {"ai", 2, 74},
+    {"ssdl", 4, 104},
+    {"spot", 4, 709},
+    {"ink", 3, 26},
+    {"ecelp4800", 9, 603},
+    {"fbs", 3, 643},
+    {"rsd", 3, 86},
+    {"ecelp7470", 9, 604},
+    {"m3u", 3, 613},
+    {"p10", 3, 64},
+    {"zip", 3, 587},
+    {"mid", 3, 590},
+    {"pgp", 3, 61},
+    {"gramps", 6, 514},
+    {"xvml", 4, 584},
+    {"pas", 3, 719},
+    {"teicorpus", 9, 106},
+    {"in", 2, 691},
+    {"clkk", 4, 153},
+    {"qfx", 3, 246},
+    {"z8", 2, 573},
+    {"acu", 3, 116},
+    {"iota", 4, 136},
+    {"xlsm", 4, 303},
+    {"mpm", 3, 138},
+    {"setpay", 6, 95},
+    {"dxf", 3, 642},
+    {"fe_launch", 9, 168},
+    {"xslt", 4, 582},
+    {"chm", 3, 306},
+    {"z2", 2, 573},
+    {"cod", 3, 388},
+    {"msf", 3, 180},
+    {"ngdat", 5, 333},
+    {"xsm", 3, 428},
+    {"pre", 3, 274},
+    {"lvp", 3, 601},
+    {"iif", 3, 399},
+    {"gtm", 3, 220},
+    {"spc", 3, 544},
+    {"mp3", 3, 592},
+    {"pot", 3, 312},
+    {"oxps", 4, 58},
+    {"pcf", 3, 505},
+    {"xvm", 3, 584},
+    {"umj", 3, 439},
+    {"fli", 3, 750},
+    {"cer", 3, 69},
+    {"vis", 3, 444},
+    {"uvu", 3, 746},
+    {"sv4cpio", 7, 556},
+    {"stf", 3, 453},
+    {"wvx", 3, 760},
+    {"semf", 4, 396},
+    {"itp", 3, 398},
+    {"mpeg", 4, 734},
+    {"mscml", 5, 43},
+    {"gif", 3, 629},
+    {"bcpio", 5, 478},
+    {"mus", 3, 325},
+    {"zaz", 3, 465},
+    {"mbk", 3, 290},
+    {"acutc", 5, 117},
+    {"uvvx", 4, 166},
+    {"xbm", 3, 668},
+    {"ccxml", 5, 5},
+    {"uvva", 4, 596},
+    {"xsl", 3, 578},
+    {"odft", 4, 344},
+    {"hal", 3, 223},
+    {"xla", 3, 300},
+    {"pcx", 3, 660},
+    {"cat", 3, 310},
+    {"dart", 4, 162},
+    {"kpxx", 4, 173},
+    {"ogv", 3, 735},
+    {"hvd", 3, 456},
+    {"ris", 3, 547},
+    {"nb", 2, 40},
+    {"cdy", 3, 143},
+    {"dtd", 3, 579},
+    {"bed", 3, 384},
+    {"dic", 3, 714},
+    {"fsc", 3, 195},
+    {"dna", 3, 169},
+    {"afp", 3, 235},
+    {"xdw", 3, 202},
+    {"ma", 2, 40},
+    {"cbt", 3, 483},
+    {"smi", 3, 98},
+    {"fcs", 3, 250},
+    {"wmf", 3, 535},
+    {"dcurl", 5, 701},
+    {"qam", 3, 181},
+    {"m4v", 3, 752},
+    {"tsv", 3, 695},
+    {"dump", 4, 52},
+    {"uvd", 3, 164},
+    {"ifm", 3, 397},
+    {"dis", 3, 289},
+    {"p7m", 3, 65},
+    {"car", 3, 160},
+    {"t3", 2, 558},
+    {"pml", 3, 158},
+    {"x3dbz", 5, 681},
+    {"rdz", 3, 163},
+    {"pps", 3, 312},
+    {"dll", 3, 533},
+    {"irp", 3, 248},
+    {"jlt", 3, 230},
+    {"mrc", 3, 38},
+    {"csv", 3, 687},
+    {"mkv", 3, 753},
+    {"ait", 3, 174},
+    {"xaml", 4, 574},
+    {"dxr", 3, 493},
+    {"clkw", 4, 156},
+    {"edm", 3, 337},
+    {"w3d", 3, 493},
+    {"ics", 3, 685},
+    {"oga", 3, 593},
+    {"uri", 3, 698},
+    {"pptx", 4, 360},
+    {"cpt", 3, 36},
+    {"azs", 3, 125},
+    {"mobi", 4, 523},
+    {"atc", 3, 117},
+    {"srt", 3, 555},
+    {"mjp2", 4, 732},
+    {"p8", 2, 67},
+    {"aas", 3, 477},
+    {"ipfix", 5, 27},
+    {"vsw", 3, 443},
+    {"nlu", 3, 328},
+    {"movie", 5, 762},
+    {"fxpl", 4, 120},
+    {"boz", 3, 482},
+    {"tpt", 3, 434},
+    {"res", 3, 497},
+    {"ez3", 3, 186},
+    {"sit", 3, 553},
+    {"application", 11, 524},
+    {"knp", 3, 266},
+    {"dataless", 8, 189},
+    {"3gp", 3, 725},
+    {"wgt", 3, 467},
+    {"cst", 3, 493},
+    {"ims", 3, 307},
+    {"c4g", 3, 146},
+    {"m14", 3, 534},
+    {"dfac", 4, 172},
+    {"opf", 3, 54},
+    {"mxs", 3, 435},
+    {"eol", 3, 597},
+    {"mpy", 3, 234},
+    {"ddd", 3, 201},
+    {"uu", 2, 722},
+    {"pvb", 3, 111},
+    {"gxt", 3, 209},
+    {"cdmiq", 5, 10},
+    {"cww", 3, 75},
+    {"wmx", 3, 759},
+    {"scq", 3, 90},
+    {"igx", 3, 286},
+    {"cu", 2, 11},
+    {"kpr", 3, 261},
+    {"rnc", 3, 79},
+    {"pfr", 3, 20},
+    {"pbm", 3, 663},
+    {"pct", 3, 661},
+    {"cla", 3, 144},
+    {"doc", 3, 50},
+    {"clkt", 4, 155},
+    {"gac", 3, 216},
+    {"txt", 3, 691},
+    {"qxl", 3, 383},
+    {"p7b", 3, 544},
+    {"t", 1, 696},
+    {"pdb", 3, 371},
+    {"thmx", 4, 309},
+    {"fhc", 3, 657},
+    {"adp", 3, 588},
+    {"ac", 2, 68},
+    {"uvf", 3, 164},
+    {"mxl", 3, 385},
+    {"pqa", 3, 371},
+    {"rm", 2, 389},
+    {"maker", 5, 192},
+    {"osf", 3, 459},
+    {"p7s", 3, 66},
+    {"dxp", 3, 405},
+    {"st", 2, 392},
+    {"tmo", 3, 433},
+    {"rpst", 4, 335},
+    {"g3w", 3, 211},
+    {"potm", 4, 317},
+    {"deploy", 6, 52},
+    {"p7c", 3, 65},
+    {"gnumeric", 8, 513},
+    {"c4d", 3, 146},
+    {"3dml", 4, 708},
+    {"sdc", 3, 407},
+    {"ktz", 3, 255},
+    {"uris", 4, 698},
+    {"n-gage", 6, 334},
+    {"shf", 3, 97},
+    {"tra", 3, 436},
+    {"class", 5, 30},
+    {"7z", 2, 471},
+    {"tex", 3, 562},
+    {"md", 2, 689},
+    {"mads", 4, 37},
+    {"udeb", 4, 491},
+    {"stk", 3, 25},
+    {"xlm", 3, 300},
+    {"book", 4, 192},
+    {"msh", 3, 673},
+    {"pskcxml", 7, 76},
+    {"odt", 3, 353},
+    {"uvvg", 4, 639},
+    {"otg", 3, 346},
+    {"igs", 3, 672},
+    {"xlw", 3, 300},
+    {"sgm", 3, 694},
+    {"crt", 3, 568},
+    {"wmls", 4, 712},
+    {"gtar", 4, 515},
+    {"ogx", 3, 55},
+    {"gqf", 3, 215},
+    {"src", 3, 567},
+    {"paw", 3, 372},
+    {"z4", 2, 573},
+    {"cbz", 3, 483},
+    {"uva", 3, 596},
+    {"sis", 3, 427},
+    {"tcap", 4, 112},
+};
+
+/** Each bucket's seed. */
+static const uint16_t http_mime_table_seeds[HTTP_MIME_TABLE_BUCKETS] = {
+    62, 25, 12, 75, 14, 103, 109, 286, 17, 1, 2, 389,
+    1, 32, 64, 14, 15, 1, 192, 99, 53, 6, 1, 36,
+    87, 2, 6, 69, 3, 6, 3, 17, 1, 5, 47, 1,
+    67, 63, 1, 16, 2, 6, 164, 11, 72, 2, 7, 3,
+    11, 27, 6, 1, 76, 34, 54, 1, 84, 95, 376, 164,
+    40, 24, 20, 25, 13, 10, 3, 36, 302, 19, 529, 60,
+    190, 68, 29, 9, 91, 8, 531, 22, 138, 1, 4, 2,
+    201, 1, 27, 31, 112, 34, 9, 310, 3, 99, 170, 20,
+    11, 29, 161, 281, 29, 3, 2, 271, 26, 222, 102, 4,
+    9, 1, 22, 6, 4, 172, 128, 8, 75, 49, 4, 125,
+    34, 94, 20, 556, 356, 1, 15, 187, 359, 32, 101, 4,
+    22, 137, 6, 35, 6, 157, 29, 1, 17, 2, 12, 398,
+    26, 259, 11, 139, 698, 818, 4, 5, 88, 6, 39, 57,
+    424, 25, 24, 113, 73, 152, 685, 13, 576, 63, 91, 6,
+    1, 28, 173, 7, 25, 90, 1270, 112, 7, 3, 69, 374,
+    70, 2, 33, 3, 52, 2, 219, 1, 0, 12, 198, 537,
+    46, 900, 391, 222, 3, 216, 4, 52, 2, 167, 32, 138,
+    177, 429, 60, 41, 554, 1, 328, 6, 451, 895, 270, 36,
+    598, 2, 208, 97, 1, 69, 710, 369, 1, 29, 152, 83,
+    102, 2, 236, 10, 481, 2150, 50, 71, 28, 4340, 6, 27,
+    186, 803, 322, 226, 12, 27,
+};
+
+/**
+ * Returns the extension's slot in the default MIME table, or -1 if the
+ * extension isn't in the table.
+ */
+static inline int http_mime_table_find(const char *ext, size_t len) {
+  uint32_t seed = http_mime_table_seeds[http_mime_table_hash(ext, len, 0) %
+                                        HTTP_MIME_TABLE_BUCKETS];
+  uint32_t pos = http_mime_table_hash(ext, len, seed) % HTTP_MIME_TABLE_SIZE;
+  if (http_mime_table[pos].len != len ||
+      memcmp(http_mime_table[pos].ext, ext, len))
+    return -1;
+  return (int)pos;
+}
+
+#endif /* H_HTTP_MIME_TABLE_H */
@@ -0,0 +1,522 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#include <fio.h>
+
+#include <http_internal.h>
+#include <http_router.h>
+
+#include <string.h>
+
+/* *****************************************************************************
+Router Types
+***************************************************************************** */
+
+/* a route, as collected before the router is frozen */
+typedef struct {
+  char *method; /* NULL for any method */
+  size_t method_len;
+  void (*handler)(http_s *h, http_route_s *route);
+  void *udata;
+  char *label; /* "METHOD /pattern", for `http_timing_label` */
+  size_t count;
+  fio_str_info_s names[HTTP_ROUTER_MAX_CAPTURES];
+} http_router_broute_s;
+
+/* a trie node, as collected before the router is frozen */
+typedef struct http_router_bnode_s http_router_bnode_s;
+struct http_router_bnode_s {
+  char *label; /* static segment(s), NULL for parameter / wildcard nodes */
+  size_t label_len;
+  http_router_bnode_s **children; /* static children */
+  size_t count;
+  http_router_bnode_s *param;
+  http_router_bnode_s *wildcard;
+  http_router_broute_s *routes;
+  size_t route_count;
+};
+
+/* a frozen route */
+typedef struct {
+  void (*handler)(http_s *h, http_route_s *route);
+  void *udata;
+  const char *method; /* NULL for any method */
+  size_t method_len;
+  const char *label;
+  size_t count;
+  fio_str_info_s names[HTTP_ROUTER_MAX_CAPTURES];
+} http_router_route_s;
+
+/* a frozen trie node (indexes into the router's arrays) */
+typedef struct {
+  uint32_t label; /* offset into the string arena */
+  uint32_t label_len;
+  uint32_t first_child; /* static children are sorted and contiguous */
+  uint32_t child_count;
+  uint32_t param;    /* 0 == none (the root is never a child) */
+  uint32_t wildcard; /* 0 == none */
+  uint32_t first_route;
+  uint32_t route_count;
+} http_router_node_s;
+
+struct http_router_s {
+  http_router_bnode_s *root; /* NULL once the router was frozen */
+  /* the frozen router - a single allocation (nodes, routes, string arena) */
+  http_router_node_s *nodes;
+  http_router_route_s *routes;
+  char *arena;
+};
+
+/* *****************************************************************************
+Building Routes
+***************************************************************************** */
+
+static http_router_bnode_s *http_router_bnode_new(const char *label,
+                                                  size_t len) {
+  http_router_bnode_s *n = malloc(sizeof(*n));
+  FIO_ASSERT_ALLOC(n);
+  *n = (http_router_bnode_s){.label_len = len};
+  if (label) {
+    n->label = malloc(len + 1);
+    FIO_ASSERT_ALLOC(n->label);
+    memcpy(n->label, label, len);
+    n->label[len] = 0;
+  }
+  return n;
+}
+
+static void http_router_bnode_free(http_router_bnode_s *n) {
+  if (!n)
+    return;
+  for (size_t i = 0; i < n->count; ++i)
+    http_router_bnode_free(n->children[i]);
+  http_router_bnode_free(n->param);
+  http_router_bnode_free(n->wildcard);
+  for (size_t i = 0; i < n->route_count; ++i) {
+    free(n->routes[i].method);
+    free(n->routes[i].label);
+    for (size_t j = 0; j < n->routes[i].count; ++j)
+      free(n->routes[i].names[j].data);
+  }
+  free(n->routes);
+  free(n->children);
+  free(n->label);
+  free(n);
+}
+
+/** Creates a new (empty) router. */
+http_router_s *http_router_new(void) {
+  http_router_s *r = malloc(sizeof(*r));
+  FIO_ASSERT_ALLOC(r);
+  *r = (http_router_s){.root = http_router_bnode_new(NULL, 0)};
+  return r;
+}
+
+/** Adds a route to the router. */
+int http_router_add(http_router_s *router, const char *method,
+                    const char *pattern,
+                    void (*handler)(http_s *h, http_route_s *route),
+                    void *udata) {
+  if (!router || !router->root || !pattern || !handler)
+    return -1;
+  if (method && method[0] == '*' && !method[1])
+    method = NULL;
+  http_router_broute_s route = {
+      .method_len = method ? strlen(method) : 0,
+      .handler = handler,
+      .udata = udata,
+  };
+  http_router_bnode_s *n = router->root;
+  const char *pos = pattern;
+  while (*pos) {
+    if (*pos == '/') {
+      ++pos;
+      continue;
+    }
+    const char *end = strchr(pos, '/');
+    if (!end)
+      end = pos + strlen(pos);
+    const size_t len = (size_t)(end - pos);
+    if (pos[0] == ':' || pos[0] == '*') {
+      if (route.count == HTTP_ROUTER_MAX_CAPTURES ||
+          (pos[0] == ':' && len == 1) || (pos[0] == '*' && *end))
+        goto error;
+      route.names[route.count].data = malloc(len);
+      FIO_ASSERT_ALLOC(route.names[route.count].data);
+      memcpy(route.names[route.count].data, pos + 1, len - 1);
+      route.names[route.count].data[len - 1] = 0;
+      route.names[route.count].len = len - 1;
+      ++route.count;
+      http_router_bnode_s **next = pos[0] == ':' ? &n->param : &n->wildcard;
+      if (!*next)
+        *next = http_router_bnode_new(NULL, 0);
+      n = *next;
+    } else {
+      size_t i = 0;
+      while (i < n->count && (n->children[i]->label_len != len ||
+                              memcmp(n->children[i]->label, pos, len)))
+        ++i;
+      if (i == n->count) {
+        n->children =
+            realloc(n->children, sizeof(*n->children) * (n->count + 1));
+        FIO_ASSERT_ALLOC(n->children);
+        n->children[n->count++] = http_router_bnode_new(pos, len);
+      }
+      n = n->children[i];
+    }
+    pos = end;
+  }
+  for (size_t i = 0; i < n->route_count; ++i) {
+    if (n->routes[i].method_len == route.method_len &&
+        (!method || !memcmp(n->routes[i].method, method, route.method_len))) {
+      FIO_LOG_ERROR("(http_router) route already exists: %s %s",
+                    (method ? method : "*"), pattern);
+      goto error;
+    }
+  }
+  if (method) {
+    route.method = malloc(route.method_len + 1);
+    FIO_ASSERT_ALLOC(route.method);
+    memcpy(route.method, method, route.method_len + 1);
+  }
+  {
+    const size_t pattern_len = strlen(pattern);
+    route.label = malloc(route.method_len + pattern_len + 2);
+    FIO_ASSERT_ALLOC(route.label);
+    if (method) {
+      memcpy(route.label, method, route.method_len);
+      route.label[route.method_len] = ' ';
+      memcpy(route.label + route.method_len + 1, pattern, pattern_len + 1);
+    } else {
+      memcpy(route.label, pattern, pattern_len + 1);
+    }
+  }
+  n->routes = realloc(n->routes, sizeof(*n->routes) * (n->route_count + 1));
+  FIO_ASSERT_ALLOC(n->routes);
+  n->routes[n->route_count++] = route;
+  return 0;
+error:
+  for (size_t i = 0; i < route.count; ++i)
+    free(route.names[i].data);
+  return -1;
+}
+
+/* *****************************************************************************
+Freezing the Router
+***************************************************************************** */
+
+/* compares a path segment to the first segment of a (compressed) label */
+static inline int http_router_segcmp(const char *seg, size_t seg_len,
+                                     const char *label, size_t label_len) {
+  const char *slash = memchr(label, '/', label_len);
+  if (slash)
+    label_len = (size_t)(slash - label);
+  int ret = memcmp(seg, label, (seg_len < label_len ? seg_len : label_len));
+  if (ret)
+    return ret;
+  return (seg_len > label_len) - (seg_len < label_len);
+}
+
+static int http_router_bnode_cmp(const void *a_, const void *b_) {
+  const http_router_bnode_s *a = *(const http_router_bnode_s **)a_;
+  const http_router_bnode_s *b = *(const http_router_bnode_s **)b_;
+  const char *slash = memchr(a->label, '/', a->label_len);
+  return http_router_segcmp(
+      a->label, (slash ? (size_t)(slash - a->label) : a->label_len), b->label,
+      b->label_len);
+}
+
+/* merges single child static chains ("a" -> "b" becomes "a/b") and sorts */
+static void http_router_compress(http_router_bnode_s *n) {
+  for (size_t i = 0; i < n->count; ++i) {
+    http_router_bnode_s *c = n->children[i];
+    while (c->count == 1 && !c->route_count && !c->param && !c->wildcard) {
+      http_router_bnode_s *g = c->children[0];
+      char *label = malloc(c->label_len + g->label_len + 2);
+      FIO_ASSERT_ALLOC(label);
+      memcpy(label, c->label, c->label_len);
+      label[c->label_len] = '/';
+      memcpy(label + c->label_len + 1, g->label, g->label_len + 1);
+      free(c->label);
+      free(c->children);
+      c->label = label;
+      c->label_len += g->label_len + 1;
+      c->children = g->children;
+      c->count = g->count;
+      c->param = g->param;
+      c->wildcard = g->wildcard;
+      c->routes = g->routes;
+      c->route_count = g->route_count;
+      free(g->label);
+      free(g);
+    }
+    http_router_compress(c);
+  }
+  if (n->count > 1)
+    qsort(n->children, n->count, sizeof(*n->children), http_router_bnode_cmp);
+  if (n->param)
+    http_router_compress(n->param);
+  if (n->wildcard)
+    http_router_compress(n->wildcard);
+}
+
+/* collects the memory requirements for the frozen router */
+static void http_router_measure(http_router_bnode_s *n, size_t *nodes,
+                                size_t *routes, size_t *bytes) {
+  ++*nodes;
+  *routes += n->route_count;
+  *bytes += n->label_len;
+  for (size_t i = 0; i < n->route_count; ++i) {
+    *bytes += n->routes[i].method_len + 1;
+    *bytes += strlen(n->routes[i].label) + 1;
+    for (size_t j = 0; j < n->routes[i].count; ++j)
+      *bytes += n->routes[i].names[j].len + 1;
+  }
+  for (size_t i = 0; i < n->count; ++i)
+    http_router_measure(n->children[i], nodes, routes, bytes);
+  if (n->param)
+    http_router_measure(n->param, nodes, routes, bytes);
+  if (n->wildcard)
+    http_router_measure(n->wildcard, nodes, routes, bytes);
+}
+
+/* copies a string to the arena */
+static inline char *http_router_arena_push(char **arena, const char *str,
+                                           size_t len) {
+  char *ret = *arena;
+  memcpy(ret, str, len);
+  ret[len] = 0;
+  *arena += len + 1;
+  return ret;
+}
+
+/** Compiles the routes into a compressed, read-only, layout. */
+int http_router_freeze(http_router_s *router) {
+  if (!router)
+    return -1;
+  if (!router->root)
+    return 0; /* already frozen */
+  http_router_compress(router->root);
+  size_t node_count = 0, route_count = 0, bytes = 0;
+  http_router_measure(router->root, &node_count, &route_count, &bytes);
+  if (node_count >= UINT32_MAX || bytes >= UINT32_MAX)
+    return -1;
+  char *mem = malloc(sizeof(http_router_node_s) * node_count +
+                     sizeof(http_router_route_s) * route_count + bytes +
+                     node_count);
+  http_router_bnode_s **queue = malloc(sizeof(*queue) * node_count);
+  FIO_ASSERT_ALLOC(mem);
+  FIO_ASSERT_ALLOC(queue);
+  router->nodes = (http_router_node_s *)mem;
+  router->routes =
+      (http_router_route_s *)(mem + sizeof(http_router_node_s) * node_count);
+  router->arena = (char *)(router->routes + route_count);
+  char *arena = router->arena;
+
+  /* breadth first layout, so siblings are contiguous */
+  size_t next = 1, next_route = 0;
+  queue[0] = router->root;
+  for (size_t i = 0; i < node_count; ++i) {
+    http_router_bnode_s *n = queue[i];
+    http_router_node_s *f = router->nodes + i;
+    *f = (http_router_node_s){
+        .label = (uint32_t)(arena - router->arena),
+        .label_len = (uint32_t)n->label_len,
+        .first_child = (uint32_t)next,
+        .child_count = (uint32_t)n->count,
+        .first_route = (uint32_t)next_route,
+        .route_count = (uint32_t)n->route_count,
+    };
+    http_router_arena_push(&arena, (n->label ? n->label : ""), n->label_len);
+    for (size_t j = 0; j < n->count; ++j)
+      queue[next++] = n->children[j];
+    if (n->param) {
+      f->param = (uint32_t)next;
+      queue[next++] = n->param;
+    }
+    if (n->wildcard) {
+      f->wildcard = (uint32_t)next;
+      queue[next++] = n->wildcard;
+    }
+    for (size_t j = 0; j < n->route_count; ++j) {
+      http_router_broute_s *b = n->routes + j;
+      http_router_route_s *r = router->routes + next_route++;
+      *r = (http_router_route_s){
+          .handler = b->handler,
+          .udata = b->udata,
+          .method_len = b->method_len,
+          .count = b->count,
+      };
+      if (b->method)
+        r->method = http_router_arena_push(&arena, b->method, b->method_len);
+      r->label = http_router_arena_push(&arena, b->label, strlen(b->label));
+      for (size_t k = 0; k < b->count; ++k) {
+        r->names[k].len = b->names[k].len;
+        r->names[k].data =
+            http_router_arena_push(&arena, b->names[k].data, b->names[k].len);
+      }
+    }
+  }
+  free(queue);
+  http_router_bnode_free(router->root);
+  router->root = NULL;
+  return 0;
+}
+
+/* *****************************************************************************
+Routing Requests
+***************************************************************************** */
+
+typedef struct {
+  const http_router_s *r;
+  const char *path;
+  size_t len;
+  fio_str_info_s method;
+  http_route_s *route;
+  const http_router_route_s *found;
+  uint8_t path_matched;
+} http_router_match_s;
+
+/* selects a node's route according to the request method */
+static inline const http_router_route_s *
+http_router_method(http_router_match_s *m, const http_router_node_s *n) {
+  const http_router_route_s *any = NULL, *get = NULL;
+  m->path_matched = 1;
+  for (uint32_t i = 0; i < n->route_count; ++i) {
+    const http_router_route_s *r = m->r->routes + n->first_route + i;
+    if (!r->method)
+      any = r;
+    else if (r->method_len == m->method.len &&
+             !memcmp(r->method, m->method.data, m->method.len))
+      return r;
+    else if (r->method_len == 3 && m->method.len == 4 &&
+             !memcmp(m->method.data, "HEAD", 4) && !memcmp(r->method, "GET", 3))
+      get = r;
+  }
+  return get ? get : any;
+}
+
+/* `pos` points at the '/' preceding the next segment (or the path's end) */
+static int http_router_find(http_router_match_s *m, uint32_t index,
+                            size_t pos) {
+  const http_router_node_s *n = m->r->nodes + index;
+  const size_t count = m->route->count;
+  if (pos + 1 >= m->len) {
+    /* end of path (a trailing slash is ignored) */
+    if (n->route_count && (m->found = http_router_method(m, n)))
+      return 1;
+    if (n->wildcard && m->r->nodes[n->wildcard].route_count &&
+        count < HTTP_ROUTER_MAX_CAPTURES) {
+      m->route->values[count].offset = (uint32_t)m->len;
+      m->route->values[count].len = 0;
+      m->route->count = count + 1;
+      if ((m->found = http_router_method(m, m->r->nodes + n->wildcard)))
+        return 1;
+      m->route->count = count;
+    }
+    return 0;
+  }
+  const char *seg = m->path + pos + 1;
+  const size_t remaining = m->len - (pos + 1);
+  const char *end = memchr(seg, '/', remaining);
+  const size_t seg_len = end ? (size_t)(end - seg) : remaining;
+
+  if (n->child_count && seg_len) {
+    /* static children - a binary search on the label's first segment */
+    uint32_t lo = n->first_child;
+    uint32_t hi = lo + n->child_count;
+    while (lo < hi) {
+      const uint32_t mid = (lo + hi) >> 1;
+      const http_router_node_s *c = m->r->nodes + mid;
+      const char *label = m->r->arena + c->label;
+      const int cmp = http_router_segcmp(seg, seg_len, label, c->label_len);
+      if (cmp < 0) {
+        hi = mid;
+      } else if (cmp > 0) {
+        lo = mid + 1;
+      } else {
+        /* compressed labels might span a number of segments */
+        if (c->label_len <= remaining && !memcmp(seg, label, c->label_len) &&
+            (c->label_len == remaining || seg[c->label_len] == '/') &&
+            http_router_find(m, mid, pos + 1 + c->label_len))
+          return 1;
+        break;
+      }
+    }
+  }
+  if (n->param && seg_len && count < HTTP_ROUTER_MAX_CAPTURES) {
+    m->route->values[count].offset = (uint32_t)(pos + 1);
+    m->route->values[count].len = (uint32_t)seg_len;
+    m->route->count = count + 1;
+    if (http_router_find(m, n->param, pos + 1 + seg_len))
+      return 1;
+    m->route->count = count;
+  }
+  if (n->wildcard && m->r->nodes[n->wildcard].route_count &&
+      count < HTTP_ROUTER_MAX_CAPTURES) {
+    m->route->values[count].offset = (uint32_t)(pos + 1);
+    m->route->values[count].len = (uint32_t)remaining;
+    m->route->count = count + 1;
+    if ((m->found = http_router_method(m, m->r->nodes + n->wildcard)))
+      return 1;
+    m->route->count = count;
+  }
+  return 0;
+}
+
+/** Routes the request to the matching handler. */
+int http_router_route(http_router_s *router, http_s *h) {
+  if (!router || !router->nodes || HTTP_INVALID_HANDLE(h))
+    return -1;
+  http_route_s route = {.count = 0};
+  http_router_match_s m = {
+      .r = router,
+      .method = fiobj_obj2cstr(h->method),
+      .route = &route,
+  };
+  fio_str_info_s path = fiobj_obj2cstr(h->path);
+  if (!path.len || path.data[0] != '/')
+    return -1;
+  m.path = path.data;
+  m.len = path.len;
+  if (http_router_find(&m, 0, 0)) {
+    route.udata = m.found->udata;
+    route.names = m.found->names;
+    http_timing_label(h, m.found->label);
+    m.found->handler(h, &route);
+    return 0;
+  }
+  if (m.path_matched) {
+    http_send_error(h, 405);
+    return 0;
+  }
+  return -1;
+}
+
+/** Returns a named captured value (a slice of `h->path`). */
+fio_str_info_s http_route_param(http_s *h, http_route_s *route,
+                                const char *name) {
+  if (!h || !route || !name)
+    return (fio_str_info_s){.data = NULL};
+  const size_t len = strlen(name);
+  for (size_t i = 0; i < route->count; ++i) {
+    if (route->names[i].len == len && !memcmp(route->names[i].data, name, len))
+      return (fio_str_info_s){
+          .data = fiobj_obj2cstr(h->path).data + route->values[i].offset,
+          .len = route->values[i].len,
+      };
+  }
+  return (fio_str_info_s){.data = NULL};
+}
+
+/** Frees the router. */
+void http_router_free(http_router_s *router) {
+  if (!router)
+    return;
+  http_router_bnode_free(router->root);
+  free(router->nodes);
+  free(router);
+}
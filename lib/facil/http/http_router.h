@@ -0,0 +1,112 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#ifndef H_HTTP_ROUTER_H
+#define H_HTTP_ROUTER_H
+
+#include <http.h>
+
+/* *****************************************************************************
+Compile Time Settings
+***************************************************************************** */
+
+#ifndef HTTP_ROUTER_MAX_CAPTURES
+/** The maximum number of captures (parameters and wildcard) in a route. */
+#define HTTP_ROUTER_MAX_CAPTURES 8
+#endif
+
+/* *****************************************************************************
+Request Routing
+***************************************************************************** */
+
+/**
+ * The route information passed to the route's handler.
+ *
+ * Captured values are stored as offsets into the request's path (`h->path`).
+ */
+typedef struct {
+  /** The route's opaque user data. */
+  void *udata;
+  /** The number of captured values. */
+  size_t count;
+  /** The names of the captures, in the order they appear in the pattern. */
+  const fio_str_info_s *names;
+  /** The captured values (offsets into the request's path). */
+  struct {
+    uint32_t offset;
+    uint32_t len;
+  } values[HTTP_ROUTER_MAX_CAPTURES];
+} http_route_s;
+
+/**
+ * Creates a new (empty) router. Routes are added using `http_router_add`.
+ *
+ * Set the `router` field in the `http_settings_s` to use the router.
+ */
+http_router_s *http_router_new(void);
+
+/**
+ * Adds a route to the router.
+ *
+ * `method` is the HTTP method ("GET", "POST", etc'). NULL (or "*") routes any
+ * method. A "GET" route also answers "HEAD" requests, unless a "HEAD" route
+ * exists.
+ *
+ * `pattern` is a path where segments can be:
+ *
+ * * static text (i.e., "/users").
+ * * a named parameter capturing a single segment (i.e., "/users/:id").
+ * * a named wildcard segment (i.e., "*path") capturing the rest of the path.
+ *   Wildcards must be the last segment.
+ *
+ * Static segments take precedence over parameters, which take precedence over
+ * wildcards.
+ *
+ * Returns -1 on error (i.e., the router was frozen or the pattern is invalid)
+ * and 0 on success.
+ */
+int http_router_add(http_router_s *router, const char *method,
+                    const char *pattern,
+                    void (*handler)(http_s *h, http_route_s *route),
+                    void *udata);
+
+/**
+ * Compiles the routes into a compressed, read-only, layout shared by all
+ * threads. No routes can be added afterwards.
+ *
+ * `http_listen` and `http_connect` freeze the router automatically.
+ *
+ * Returns -1 on error and 0 on success.
+ */
+int http_router_freeze(http_router_s *router);
+
+/**
+ * Routes the request to the matching handler.
+ *
+ * When the path matches but the method doesn't, a 405 error is sent.
+ *
+ * Returns 0 if the request was handled and -1 if no route matched (or the
+ * router wasn't frozen).
+ */
+int http_router_route(http_router_s *router, http_s *h);
+
+/**
+ * Returns a named captured value (a slice of `h->path`).
+ *
+ * Returns `{.data = NULL}` if the name wasn't captured.
+ */
+fio_str_info_s http_route_param(http_s *h, http_route_s *route,
+                                const char *name);
+
+/**
+ * Frees the router.
+ *
+ * The router must outlive the HTTP services using it (i.e., free it after
+ * `fio_start` returns).
+ */
+void http_router_free(http_router_s *router);
+
+#endif /* H_HTTP_ROUTER_H */
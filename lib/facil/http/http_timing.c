@@ -0,0 +1,252 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#include <fio.h>
+
+#include <http_internal.h>
+#include <http_timing.h>
+
+#include <string.h>
+
+/* *****************************************************************************
+Timing State
+***************************************************************************** */
+
+typedef struct {
+  char *label;
+  size_t len;
+  http_timing_histogram_s phases[HTTP_TIMING_PHASES];
+} http_timing_entry_s;
+
+#define FIO_SET_NAME http_timing_set
+#define FIO_SET_OBJ_TYPE http_timing_entry_s *
+#define FIO_SET_OBJ_COMPARE(o1, o2)                                            \
+  ((o1)->len == (o2)->len && !memcmp((o1)->label, (o2)->label, (o1)->len))
+#include <fio.h>
+
+static struct {
+  http_timing_set_s labels;
+  fio_lock_i lock;
+} http_timing = {.labels = FIO_SET_INIT, .lock = FIO_LOCK_INIT};
+
+static const char *http_timing_phase_names[HTTP_TIMING_PHASES] = {
+    "headers", "body", "handler", "flush", "total",
+};
+
+#define HTTP_TIMING_UNKNOWN UINT64_MAX
+
+/* the duration between two timestamps, if both are known */
+static inline uint64_t http_timing_span(uint64_t from, uint64_t to) {
+  if (!from || !to || to < from)
+    return HTTP_TIMING_UNKNOWN;
+  return to - from;
+}
+
+static inline size_t http_timing_bucket(uint64_t us) {
+  size_t i = 0;
+  while (us && i < HTTP_TIMING_BUCKETS - 1) {
+    us >>= 1;
+    ++i;
+  }
+  return i;
+}
+
+/* *****************************************************************************
+Collecting Samples
+***************************************************************************** */
+
+/** Sets the label under which the request's timing is collected. */
+void http_timing_label(http_s *h, const char *label) {
+  if (!h || !h->private_data.flag)
+    return;
+  http2protocol(h)->timing.label = label;
+}
+
+/** Adds a sample to the label's histograms. */
+void http_timing_record(const char *label,
+                        const uint64_t phases[HTTP_TIMING_PHASES]) {
+  if (!label)
+    label = "-";
+  http_timing_entry_s key = {.label = (char *)label, .len = strlen(label)};
+  const uint64_t hash = FIO_HASH_FN(label, key.len, 0, 0);
+  fio_lock(&http_timing.lock);
+  http_timing_entry_s *e =
+      http_timing_set_find(&http_timing.labels, hash, &key);
+  if (!e) {
+    e = malloc(sizeof(*e) + key.len + 1);
+    FIO_ASSERT_ALLOC(e);
+    *e = (http_timing_entry_s){.label = (char *)(e + 1), .len = key.len};
+    memcpy(e->label, label, key.len + 1);
+    http_timing_set_insert(&http_timing.labels, hash, e);
+  }
+  for (size_t i = 0; i < HTTP_TIMING_PHASES; ++i) {
+    if (phases[i] == HTTP_TIMING_UNKNOWN)
+      continue;
+    http_timing_histogram_s *hist = e->phases + i;
+    ++hist->count;
+    hist->sum += phases[i];
+    if (hist->max < phases[i])
+      hist->max = phases[i];
+    ++hist->buckets[http_timing_bucket(phases[i])];
+  }
+  fio_unlock(&http_timing.lock);
+}
+
+/* formats a duration (in microseconds) as milliseconds */
+static char *http_timing_ms(char *dest, size_t capa, uint64_t us) {
+  if (us == HTTP_TIMING_UNKNOWN)
+    snprintf(dest, capa, "-");
+  else
+    snprintf(dest, capa, "%llu.%03llums", (unsigned long long)(us / 1000),
+             (unsigned long long)(us % 1000));
+  return dest;
+}
+
+/** Records a request's timing, logging slow requests. */
+void http_timing_finish______internal(http_timing_s *t, uint64_t flushed,
+                                      intptr_t uuid,
+                                      http_settings_s *settings) {
+  uint64_t phases[HTTP_TIMING_PHASES] = {
+      [HTTP_TIMING_HEADERS] = http_timing_span(t->start, t->headers),
+      [HTTP_TIMING_BODY] = http_timing_span(t->headers, t->dispatch),
+      [HTTP_TIMING_HANDLER] = http_timing_span(t->dispatch, t->queued),
+      [HTTP_TIMING_FLUSH] = http_timing_span(t->queued, flushed),
+      [HTTP_TIMING_TOTAL] =
+          http_timing_span(t->start, (flushed ? flushed : t->queued)),
+  };
+  http_timing_record(t->label, phases);
+  if (settings->slow_request &&
+      phases[HTTP_TIMING_TOTAL] != HTTP_TIMING_UNKNOWN &&
+      phases[HTTP_TIMING_TOTAL] >= settings->slow_request * 1000) {
+    char buf[HTTP_TIMING_PHASES][32];
+    fio_str_info_s peer = fio_peer_addr(uuid);
+    FIO_LOG_WARNING("(HTTP) slow request %s %s (%s) from %.*s: %s - headers "
+                    "%s, body %s, handler %s, flush %s",
+                    fiobj_obj2cstr(t->method).data,
+                    fiobj_obj2cstr(t->path).data, (t->label ? t->label : "-"),
+                    (peer.len ? (int)peer.len : 1),
+                    (peer.len ? peer.data : "-"),
+                    http_timing_ms(buf[HTTP_TIMING_TOTAL], 32,
+                                   phases[HTTP_TIMING_TOTAL]),
+                    http_timing_ms(buf[HTTP_TIMING_HEADERS], 32,
+                                   phases[HTTP_TIMING_HEADERS]),
+                    http_timing_ms(buf[HTTP_TIMING_BODY], 32,
+                                   phases[HTTP_TIMING_BODY]),
+                    http_timing_ms(buf[HTTP_TIMING_HANDLER], 32,
+                                   phases[HTTP_TIMING_HANDLER]),
+                    http_timing_ms(buf[HTTP_TIMING_FLUSH], 32,
+                                   phases[HTTP_TIMING_FLUSH]));
+  }
+  fiobj_free(t->method);
+  fiobj_free(t->path);
+  t->method = t->path = FIOBJ_INVALID;
+}
+
+/* *****************************************************************************
+Reporting
+***************************************************************************** */
+
+/** Calls `task` for each label with a copy of its histograms. */
+void http_timing_each(int (*task)(const char *label,
+                                  const http_timing_histogram_s *phases,
+                                  void *udata),
+                      void *udata) {
+  if (!task)
+    return;
+  /* copy the labels, so `task` runs without holding the lock */
+  fio_lock(&http_timing.lock);
+  size_t count = http_timing_set_count(&http_timing.labels);
+  size_t bytes = 0;
+  FIO_SET_FOR_LOOP(&http_timing.labels, pos) {
+    bytes += sizeof(http_timing_entry_s) + pos->obj->len + 1;
+  }
+  http_timing_entry_s *copy = malloc(bytes + 1);
+  FIO_ASSERT_ALLOC(copy);
+  char *strings = (char *)(copy + count);
+  size_t i = 0;
+  FIO_SET_FOR_LOOP(&http_timing.labels, pos) {
+    copy[i] = *pos->obj;
+    copy[i].label = strings;
+    memcpy(strings, pos->obj->label, pos->obj->len + 1);
+    strings += pos->obj->len + 1;
+    ++i;
+  }
+  fio_unlock(&http_timing.lock);
+  for (i = 0; i < count; ++i) {
+    if (task(copy[i].label, copy[i].phases, udata) == -1)
+      break;
+  }
+  free(copy);
+}
+
+/** Returns the estimated `percentile` of a histogram, in microseconds. */
+uint64_t http_timing_percentile(const http_timing_histogram_s *histogram,
+                                double percentile) {
+  if (!histogram || !histogram->count)
+    return 0;
+  if (percentile > 100)
+    percentile = 100;
+  uint64_t target = (uint64_t)((histogram->count * percentile) / 100);
+  if ((double)target < (histogram->count * percentile) / 100 || !target)
+    ++target;
+  uint64_t seen = 0;
+  for (size_t i = 0; i < HTTP_TIMING_BUCKETS - 1; ++i) {
+    seen += histogram->buckets[i];
+    if (seen >= target) {
+      const uint64_t bound = i ? ((uint64_t)1 << i) - 1 : 0;
+      return (bound < histogram->max ? bound : histogram->max);
+    }
+  }
+  return histogram->max;
+}
+
+static int http_timing_report_task(const char *label,
+                                   const http_timing_histogram_s *phases,
+                                   void *report) {
+  FIOBJ entry = fiobj_hash_new();
+  for (size_t i = 0; i < HTTP_TIMING_PHASES; ++i) {
+    if (!phases[i].count)
+      continue;
+    FIOBJ phase = fiobj_hash_new2(6);
+#define HTTP_TIMING_REPORT_SET(name, value)                                    \
+  do {                                                                         \
+    FIOBJ k = fiobj_str_new((name), sizeof(name) - 1);                         \
+    fiobj_hash_set(phase, k, fiobj_num_new((intptr_t)(value)));                \
+    fiobj_free(k);                                                             \
+  } while (0)
+    HTTP_TIMING_REPORT_SET("count", phases[i].count);
+    HTTP_TIMING_REPORT_SET("mean", phases[i].sum / phases[i].count);
+    HTTP_TIMING_REPORT_SET("p50", http_timing_percentile(phases + i, 50));
+    HTTP_TIMING_REPORT_SET("p90", http_timing_percentile(phases + i, 90));
+    HTTP_TIMING_REPORT_SET("p99", http_timing_percentile(phases + i, 99));
+    HTTP_TIMING_REPORT_SET("max", phases[i].max);
+#undef HTTP_TIMING_REPORT_SET
+    FIOBJ k = fiobj_str_new(http_timing_phase_names[i],
+                            strlen(http_timing_phase_names[i]));
+    fiobj_hash_set(entry, k, phase);
+    fiobj_free(k);
+  }
+  FIOBJ k = fiobj_str_new(label, strlen(label));
+  fiobj_hash_set((FIOBJ)report, k, entry);
+  fiobj_free(k);
+  return 0;
+}
+
+/** Returns a Hash with the process's timing statistics. */
+FIOBJ http_timing_report(void) {
+  FIOBJ report = fiobj_hash_new();
+  http_timing_each(http_timing_report_task, (void *)report);
+  return report;
+}
+
+/** Clears all the histograms. */
+void http_timing_reset(void) {
+  fio_lock(&http_timing.lock);
+  FIO_SET_FOR_LOOP(&http_timing.labels, pos) {
+    memset(pos->obj->phases, 0, sizeof(pos->obj->phases));
+  }
+  fio_unlock(&http_timing.lock);
+}
@@ -0,0 +1,126 @@
+/*
+Copyright: Boaz Segev, 2016-2019
+License: MIT
+
+Feel free to copy, use and enjoy according to the license provided.
+*/
+#ifndef H_HTTP_TIMING_H
+#define H_HTTP_TIMING_H
+
+#include <http.h>
+
+/* *****************************************************************************
+Compile Time Settings
+***************************************************************************** */
+
+#ifndef HTTP_TIMING_BUCKETS
+/**
+ * The number of (log2, microsecond) buckets in each histogram.
+ *
+ * Bucket `i` counts durations shorter than `2^i` microseconds (and at least
+ * `2^(i-1)`), the last bucket counts anything longer.
+ */
+#define HTTP_TIMING_BUCKETS 32
+#endif
+
+#ifndef HTTP_TIMING_PENDING
+/**
+ * The number of responses per connection that can wait for the socket to
+ * flush. When more responses are queued (pipelining), the oldest is recorded
+ * without a flush phase.
+ */
+#define HTTP_TIMING_PENDING 8
+#endif
+
+/* *****************************************************************************
+Request Timing
+***************************************************************************** */
+
+/** The phases of a request, measured when `timing` is set. */
+typedef enum {
+  /** The request line was parsed -> the headers were parsed. */
+  HTTP_TIMING_HEADERS = 0,
+  /** The headers were parsed -> the body was received (dispatch). */
+  HTTP_TIMING_BODY,
+  /** The request was dispatched -> the response was queued. */
+  HTTP_TIMING_HANDLER,
+  /** The response was queued -> the response was written to the socket. */
+  HTTP_TIMING_FLUSH,
+  /** The request line was parsed -> the response was written. */
+  HTTP_TIMING_TOTAL,
+  /** The number of phases. */
+  HTTP_TIMING_PHASES,
+} http_timing_phase_e;
+
+/** A latency histogram (durations are in microseconds). */
+typedef struct {
+  /** The number of samples. */
+  uint64_t count;
+  /** The sum of all the samples. */
+  uint64_t sum;
+  /** The longest sample. */
+  uint64_t max;
+  /** The log2 buckets (see `HTTP_TIMING_BUCKETS`). */
+  uint64_t buckets[HTTP_TIMING_BUCKETS];
+} http_timing_histogram_s;
+
+/**
+ * Sets the label under which the request's timing is collected.
+ *
+ * The router sets the label to the matched route ("GET /users/:id"), static
+ * files are labeled "static", cache hits "cache" and requests handled by
+ * `on_request` are labeled "on_request". Requests answered before they were
+ * dispatched (i.e., errors) are labeled "-".
+ *
+ * The label must remain valid until the response was sent (string literals
+ * are best). Should be called before the response is sent.
+ */
+void http_timing_label(http_s *h, const char *label);
+
+/**
+ * Adds a sample (the duration of each phase, in microseconds) to the label's
+ * histograms.
+ *
+ * A `UINT64_MAX` phase duration is unknown and isn't recorded.
+ *
+ * Called automatically for requests on connections with `timing` set.
+ */
+void http_timing_record(const char *label,
+                        const uint64_t phases[HTTP_TIMING_PHASES]);
+
+/**
+ * Calls `task` for each label with a copy of its histograms (indexed by
+ * `http_timing_phase_e`). Return -1 from `task` to stop the iteration.
+ *
+ * Histograms are collected per process (every worker has its own).
+ */
+void http_timing_each(int (*task)(const char *label,
+                                  const http_timing_histogram_s *phases,
+                                  void *udata),
+                      void *udata);
+
+/**
+ * Returns the estimated `percentile` (0-100) of a histogram, in microseconds.
+ *
+ * The estimate is the upper bound of the bucket containing the percentile,
+ * capped by the histogram's `max`.
+ */
+uint64_t http_timing_percentile(const http_timing_histogram_s *histogram,
+                                double percentile);
+
+/**
+ * Returns a Hash with the process's timing statistics, i.e.:
+ *
+ *     {"GET /users/:id": {"handler": {"count": 10, "mean": 12, "p50": 16,
+ *                         "p90": 32, "p99": 64, "max": 41}, ...}, ...}
+ *
+ * Durations are in microseconds. Use `fiobj_obj2json` to export the report.
+ *
+ * The Hash must be freed using `fiobj_free`.
+ */
+FIOBJ http_timing_report(void);
+
+/** Clears all the histograms. */
+void http_timing_reset(void);
+
+#endif /* H_HTTP_TIMING_H */
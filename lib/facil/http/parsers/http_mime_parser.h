@@ -155,13 +155,17 @@ consume_partial:
               memcmp(end + 2, parser->boundary, parser->boundary_len)));
     if (!end) {
       end = (char *)stop;
+      /* a trailing CR might belong to the next boundary */
+      if (end > start && end[-1] == '\r')
+        --end;
       pos = end;
       if (end - start)
         http_mime_parser_on_partial_data(parser, start, (size_t)(end - start));
       goto end_of_data;
     } else if (end + 4 + parser->boundary_len >= stop) {
-      end -= 2;
-      if (end[0] == '\r')
+      /* keep the (possible) boundary's line break for the next round */
+      --end;
+      if (end > start && end[-1] == '\r')
         --end;
       pos = end;
       if (end - start)
@@ -169,7 +173,7 @@ consume_partial:
       goto end_of_data;
     }
     size_t len = (end - start) - 1;
-    if (start[len - 1] == '\r')
+    if (len && start[len - 1] == '\r')
       --len;
     if (len)
       http_mime_parser_on_partial_data(parser, start, len);
@@ -183,6 +187,8 @@ consume_partial:
     goto error;
   /* We're at a boundary */
   while (pos < stop) {
+    if ((size_t)(stop - pos) < 4 + parser->boundary_len)
+      goto end_of_data;
     char *start;
     char *end;
     char *name = NULL;
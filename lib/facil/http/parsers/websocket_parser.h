@@ -21,6 +21,29 @@ must be implemented by the including file (the callbacks).
 #if DEBUG
 #include <stdio.h>
 #endif
+
+/* *****************************************************************************
+Compile Time Settings
+***************************************************************************** */
+
+#ifndef WEBSOCKET_SIMD
+/**
+ * Enables the SSE2 / AVX2 unmasking and UTF-8 validation kernels on x86_64.
+ *
+ * The kernel is selected at runtime (AVX2 is used only when the CPU supports
+ * it). Set to 0 to use the portable implementation.
+ */
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define WEBSOCKET_SIMD 1
+#else
+#define WEBSOCKET_SIMD 0
+#endif
+#endif
+
+#if WEBSOCKET_SIMD
+#include <immintrin.h>
+#endif
+
 /* *****************************************************************************
 API - Message Wrapping
 ***************************************************************************** */
@@ -59,6 +82,20 @@ websocket_server_wrap(void *target, void *msg, uint64_t len,
                       unsigned char opcode, unsigned char first,
                       unsigned char last, unsigned char rsv);
 
+/**
+ * Writes only the header of a WebSocket server message (up to 10 bytes) to the
+ * target buffer, so the message itself can be sent without copying it.
+ *
+ * The arguments are the same as `websocket_server_wrap`.
+ *
+ * Returns the number of bytes written. Always `websocket_wrapped_len(len) -
+ * len`.
+ */
+inline static uint64_t __attribute__((unused))
+websocket_server_wrap_head(void *target, uint64_t len, unsigned char opcode,
+                           unsigned char first, unsigned char last,
+                           unsigned char rsv);
+
 /**
  * Wraps a WebSocket client message and writes it to the target buffer.
  *
@@ -134,12 +171,327 @@ API - Internal Helpers
 /** used internally to mask and unmask client messages. */
 inline static void websocket_xmask(void *msg, uint64_t len, uint32_t mask);
 
+/**
+ * Returns 1 if the data is valid UTF-8 and 0 if not.
+ *
+ * Overlong encodings, surrogates and code points above U+10FFFF are rejected
+ * (RFC 3629), as required for WebSocket text frames.
+ */
+inline static __attribute__((unused)) int websocket_utf8_valid(const void *data,
+                                                               uint64_t len);
+
+/**
+ * Returns the kernel used by `websocket_xmask` and `websocket_utf8_valid`:
+ * 0 (portable), 1 (SSE2) or 2 (AVX2).
+ */
+inline static __attribute__((unused)) int websocket_simd_level(void);
+
 /* *****************************************************************************
 
                                 Implementation
 
 ***************************************************************************** */
 
+/* *****************************************************************************
+SIMD kernels (runtime selection)
+***************************************************************************** */
+
+/**
+ * The kernel level in use, -1 until detected.
+ *
+ * Benchmarks may lower it (after calling `websocket_simd_level`) to compare the
+ * kernels on the same machine.
+ */
+static int websocket_simd_level_detected = -1;
+
+inline static int websocket_simd_level(void) {
+  if (websocket_simd_level_detected == -1) {
+#if WEBSOCKET_SIMD
+    __builtin_cpu_init();
+    websocket_simd_level_detected = __builtin_cpu_supports("avx2") ? 2 : 1;
+#else
+    websocket_simd_level_detected = 0;
+#endif
+  }
+  return websocket_simd_level_detected;
+}
+
+#if WEBSOCKET_SIMD
+/* XORs 32 byte blocks, returning the number of bytes processed. */
+static uint64_t websocket_xmask_sse2(uint8_t *msg, uint64_t len,
+                                     uint64_t xmask) {
+  const __m128i m = _mm_set1_epi64x((long long)xmask);
+  uint64_t i = 0;
+  for (; i + 32 <= len; i += 32) {
+    __m128i a = _mm_loadu_si128((__m128i *)(msg + i));
+    __m128i b = _mm_loadu_si128((__m128i *)(msg + i + 16));
+    _mm_storeu_si128((__m128i *)(msg + i), _mm_xor_si128(a, m));
+    _mm_storeu_si128((__m128i *)(msg + i + 16), _mm_xor_si128(b, m));
+  }
+  return i;
+}
+
+/* XORs 64 byte blocks (and a trailing 32 byte block), see above. */
+__attribute__((target("avx2"))) static uint64_t
+websocket_xmask_avx2(uint8_t *msg, uint64_t len, uint64_t xmask) {
+  const __m256i m = _mm256_set1_epi64x((long long)xmask);
+  uint64_t i = 0;
+  for (; i + 64 <= len; i += 64) {
+    __m256i a = _mm256_loadu_si256((__m256i *)(msg + i));
+    __m256i b = _mm256_loadu_si256((__m256i *)(msg + i + 32));
+    _mm256_storeu_si256((__m256i *)(msg + i), _mm256_xor_si256(a, m));
+    _mm256_storeu_si256((__m256i *)(msg + i + 32), _mm256_xor_si256(b, m));
+  }
+  if (i + 32 <= len) {
+    __m256i a = _mm256_loadu_si256((__m256i *)(msg + i));
+    _mm256_storeu_si256((__m256i *)(msg + i), _mm256_xor_si256(a, m));
+    i += 32;
+  }
+  return i;
+}
+#endif
+
+/* *****************************************************************************
+UTF-8 validation
+***************************************************************************** */
+
+/**
+ * Validates the characters starting before `stop` (but possibly ending as late
+ * as `end`), returning the position after the last one, or NULL on error.
+ */
+static const uint8_t *websocket_utf8_scan(const uint8_t *pos,
+                                          const uint8_t *stop,
+                                          const uint8_t *end) {
+  while (pos < stop) {
+    if (pos + 8 <= stop) {
+      uint64_t word;
+      memcpy(&word, pos, 8);
+      if (!(word & 0x8080808080808080ULL)) {
+        pos += 8;
+        continue;
+      }
+    }
+    if (pos[0] < 0x80) {
+      ++pos;
+      continue;
+    }
+    if (pos[0] < 0xC2)
+      return NULL; /* continuation byte or overlong 2 byte sequence */
+    if (pos[0] < 0xE0) {
+      if (pos + 2 > end || (pos[1] & 0xC0) != 0x80)
+        return NULL;
+      pos += 2;
+      continue;
+    }
+    if (pos[0] < 0xF0) {
+      if (pos + 3 > end || (pos[1] & 0xC0) != 0x80 ||
+          (pos[2] & 0xC0) != 0x80 || (pos[0] == 0xE0 && pos[1] < 0xA0) ||
+          (pos[0] == 0xED && pos[1] > 0x9F))
+        return NULL; /* overlong 3 byte sequence or surrogate */
+      pos += 3;
+      continue;
+    }
+    if (pos[0] > 0xF4 || pos + 4 > end || (pos[1] & 0xC0) != 0x80 ||
+        (pos[2] & 0xC0) != 0x80 || (pos[3] & 0xC0) != 0x80 ||
+        (pos[0] == 0xF0 && pos[1] < 0x90) || (pos[0] == 0xF4 && pos[1] > 0x8F))
+      return NULL; /* overlong 4 byte sequence or above U+10FFFF */
+    pos += 4;
+  }
+  return pos;
+}
+
+#if WEBSOCKET_SIMD
+/* Skips the leading pure ASCII 16 byte blocks, leaving the rest to the portable
+ * scan (without a byte shuffle, SSE2 can't validate multi-byte characters any
+ * faster, and switching back and forth costs more than it saves). */
+static int websocket_utf8_valid_sse2(const uint8_t *pos, const uint8_t *end) {
+  while (pos + 16 <= end &&
+         !_mm_movemask_epi8(_mm_loadu_si128((__m128i *)pos)))
+    pos += 16;
+  return websocket_utf8_scan(pos, end, end) != NULL;
+}
+
+/* Error flags for the AVX2 lookup validator (Keiser & Lemire, "Validating
+ * UTF-8 In Less Than One Instruction Per Byte"). Each pair of adjacent bytes
+ * is classified by three nibble lookups - an error is any bit set in all
+ * three. */
+#define WS_UTF8_TOO_SHORT (1 << 0)
+#define WS_UTF8_TOO_LONG (1 << 1)
+#define WS_UTF8_OVERLONG_3 (1 << 2)
+#define WS_UTF8_TOO_LARGE (1 << 3)
+#define WS_UTF8_SURROGATE (1 << 4)
+#define WS_UTF8_OVERLONG_2 (1 << 5)
+#define WS_UTF8_TOO_LARGE_1000 (1 << 6)
+#define WS_UTF8_OVERLONG_4 (1 << 6)
+#define WS_UTF8_TWO_CONTS (1 << 7)
+#define WS_UTF8_CARRY                                                          \
+  (WS_UTF8_TOO_SHORT | WS_UTF8_TOO_LONG | WS_UTF8_TWO_CONTS)
+#define WS_UTF8_TABLE(...)                                                     \
+  { __VA_ARGS__, __VA_ARGS__ }
+
+__attribute__((target("avx2"))) static inline __m256i
+websocket_utf8_lookup(const uint8_t *table, __m256i index) {
+  return _mm256_shuffle_epi8(_mm256_loadu_si256((__m256i *)table), index);
+}
+
+__attribute__((target("avx2"))) static inline __m256i
+websocket_utf8_block(__m256i input, __m256i prev_input) {
+  static const uint8_t byte_1_high[32] = WS_UTF8_TABLE(
+      /* 0_______ (ASCII followed by a continuation byte) */
+      WS_UTF8_TOO_LONG, WS_UTF8_TOO_LONG, WS_UTF8_TOO_LONG, WS_UTF8_TOO_LONG,
+      WS_UTF8_TOO_LONG, WS_UTF8_TOO_LONG, WS_UTF8_TOO_LONG, WS_UTF8_TOO_LONG,
+      /* 10______ */
+      WS_UTF8_TWO_CONTS, WS_UTF8_TWO_CONTS, WS_UTF8_TWO_CONTS,
+      WS_UTF8_TWO_CONTS,
+      /* 1100____ */
+      WS_UTF8_TOO_SHORT | WS_UTF8_OVERLONG_2,
+      /* 1101____ */
+      WS_UTF8_TOO_SHORT,
+      /* 1110____ */
+      WS_UTF8_TOO_SHORT | WS_UTF8_OVERLONG_3 | WS_UTF8_SURROGATE,
+      /* 1111____ */
+      WS_UTF8_TOO_SHORT | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000 |
+          WS_UTF8_OVERLONG_4);
+  static const uint8_t byte_1_low[32] = WS_UTF8_TABLE(
+      /* ____0000 */
+      WS_UTF8_CARRY | WS_UTF8_OVERLONG_3 | WS_UTF8_OVERLONG_2 |
+          WS_UTF8_OVERLONG_4,
+      /* ____0001 */
+      WS_UTF8_CARRY | WS_UTF8_OVERLONG_2,
+      /* ____001_ */
+      WS_UTF8_CARRY, WS_UTF8_CARRY,
+      /* ____0100 */
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE,
+      /* ____0101 - ____1100 */
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000,
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000,
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000,
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000,
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000,
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000,
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000,
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000,
+      /* ____1101 */
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000 |
+          WS_UTF8_SURROGATE,
+      /* ____111_ */
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000,
+      WS_UTF8_CARRY | WS_UTF8_TOO_LARGE | WS_UTF8_TOO_LARGE_1000);
+  static const uint8_t byte_2_high[32] = WS_UTF8_TABLE(
+      /* ________ 0_______ */
+      WS_UTF8_TOO_SHORT, WS_UTF8_TOO_SHORT, WS_UTF8_TOO_SHORT,
+      WS_UTF8_TOO_SHORT, WS_UTF8_TOO_SHORT, WS_UTF8_TOO_SHORT,
+      WS_UTF8_TOO_SHORT, WS_UTF8_TOO_SHORT,
+      /* ________ 1000____ */
+      WS_UTF8_TOO_LONG | WS_UTF8_OVERLONG_2 | WS_UTF8_TWO_CONTS |
+          WS_UTF8_OVERLONG_3 | WS_UTF8_TOO_LARGE_1000 | WS_UTF8_OVERLONG_4,
+      /* ________ 1001____ */
+      WS_UTF8_TOO_LONG | WS_UTF8_OVERLONG_2 | WS_UTF8_TWO_CONTS |
+          WS_UTF8_OVERLONG_3 | WS_UTF8_TOO_LARGE,
+      /* ________ 101_____ */
+      WS_UTF8_TOO_LONG | WS_UTF8_OVERLONG_2 | WS_UTF8_TWO_CONTS |
+          WS_UTF8_SURROGATE | WS_UTF8_TOO_LARGE,
+      WS_UTF8_TOO_LONG | WS_UTF8_OVERLONG_2 | WS_UTF8_TWO_CONTS |
+          WS_UTF8_SURROGATE | WS_UTF8_TOO_LARGE,
+      /* ________ 11______ */
+      WS_UTF8_TOO_SHORT, WS_UTF8_TOO_SHORT, WS_UTF8_TOO_SHORT,
+      WS_UTF8_TOO_SHORT);
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  /* the previous 1, 2 and 3 bytes for every byte in the block */
+  const __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+  const __m256i prev1 = _mm256_alignr_epi8(input, shifted, 15);
+  const __m256i prev2 = _mm256_alignr_epi8(input, shifted, 14);
+  const __m256i prev3 = _mm256_alignr_epi8(input, shifted, 13);
+  __m256i special = _mm256_and_si256(
+      websocket_utf8_lookup(
+          byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+      websocket_utf8_lookup(byte_1_low, _mm256_and_si256(prev1, nibble)));
+  special = _mm256_and_si256(
+      special, websocket_utf8_lookup(
+                   byte_2_high,
+                   _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+  /* continuation bytes required by 3 and 4 byte sequences cancel TWO_CONTS */
+  const __m256i must23 = _mm256_or_si256(
+      _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80)),
+      _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80)));
+  return _mm256_xor_si256(
+      special, _mm256_and_si256(must23, _mm256_set1_epi8((char)0x80)));
+}
+
+/* Returns a non-zero vector if the block ends mid-character. */
+__attribute__((target("avx2"))) static inline __m256i
+websocket_utf8_incomplete(__m256i input) {
+  const __m256i max = _mm256_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (char)(0xF0 - 1),
+      (char)(0xE0 - 1), (char)(0xC0 - 1));
+  return _mm256_subs_epu8(input, max);
+}
+
+__attribute__((target("avx2"))) static int
+websocket_utf8_valid_avx2(const uint8_t *pos, const uint8_t *end) {
+  __m256i error = _mm256_setzero_si256();
+  __m256i prev_input = _mm256_setzero_si256();
+  __m256i prev_incomplete = _mm256_setzero_si256();
+  for (size_t blocks = 1;; ++blocks) {
+    __m256i input;
+    if (pos + 32 <= end) {
+      input = _mm256_loadu_si256((__m256i *)pos);
+      pos += 32;
+    } else if (pos < end) {
+      /* zero padding is ASCII, so a truncated character is still detected */
+      uint8_t tail[32] = {0};
+      memcpy(tail, pos, end - pos);
+      input = _mm256_loadu_si256((__m256i *)tail);
+      pos = end;
+    } else {
+      break;
+    }
+    if (!_mm256_movemask_epi8(input)) {
+      error = _mm256_or_si256(error, prev_incomplete);
+    } else {
+      error = _mm256_or_si256(error, websocket_utf8_block(input, prev_input));
+      prev_incomplete = websocket_utf8_incomplete(input);
+    }
+    prev_input = input;
+    if (!(blocks & 31) && !_mm256_testz_si256(error, error))
+      return 0; /* stop early (tested every 1Kb) */
+  }
+  error = _mm256_or_si256(error, prev_incomplete);
+  return _mm256_testz_si256(error, error);
+}
+#undef WS_UTF8_TOO_SHORT
+#undef WS_UTF8_TOO_LONG
+#undef WS_UTF8_OVERLONG_3
+#undef WS_UTF8_TOO_LARGE
+#undef WS_UTF8_SURROGATE
+#undef WS_UTF8_OVERLONG_2
+#undef WS_UTF8_TOO_LARGE_1000
+#undef WS_UTF8_OVERLONG_4
+#undef WS_UTF8_TWO_CONTS
+#undef WS_UTF8_CARRY
+#undef WS_UTF8_TABLE
+#endif
+
+inline static int websocket_utf8_valid(const void *data, uint64_t len) {
+  const uint8_t *pos = (const uint8_t *)data;
+  if (!len)
+    return 1;
+  if (!pos)
+    return 0;
+#if WEBSOCKET_SIMD
+  if (len >= 32) {
+    switch (websocket_simd_level()) {
+    case 2:
+      return websocket_utf8_valid_avx2(pos, pos + len);
+    case 1:
+      return websocket_utf8_valid_sse2(pos, pos + len);
+    }
+  }
+#endif
+  return websocket_utf8_scan(pos, pos + len, pos + len) != NULL;
+}
+
 /* *****************************************************************************
 Message masking
 ***************************************************************************** */
@@ -183,6 +535,16 @@ void websocket_xmask(void *msg, uint64_t len, uint32_t mask) {
     }
     /* intrinsic / XOR by 8 byte block, memory aligned */
     const uint64_t xmask = (((uint64_t)mask) << 32) | mask;
+#if WEBSOCKET_SIMD
+    if (len >= 32 && websocket_simd_level()) {
+      const uint64_t done =
+          (websocket_simd_level() == 2 ? websocket_xmask_avx2
+                                       : websocket_xmask_sse2)(
+              (uint8_t *)msg, len, xmask);
+      len -= done;
+      msg = (void *)((uintptr_t)msg + done);
+    }
+#endif
     while (len >= 8) {
       *((uint64_t *)msg) ^= xmask;
       len -= 8;
@@ -293,26 +655,35 @@ static inline uint64_t websocket_wrapped_len(uint64_t len) {
 static uint64_t websocket_server_wrap(void *target, void *msg, uint64_t len,
                                       unsigned char opcode, unsigned char first,
                                       unsigned char last, unsigned char rsv) {
+  const uint64_t head =
+      websocket_server_wrap_head(target, len, opcode, first, last, rsv);
+  memcpy(((uint8_t *)target) + head, msg, len);
+  return len + head;
+}
+
+/** Writes only the header of a WebSocket server message. */
+static uint64_t websocket_server_wrap_head(void *target, uint64_t len,
+                                           unsigned char opcode,
+                                           unsigned char first,
+                                           unsigned char last,
+                                           unsigned char rsv) {
   ((uint8_t *)target)[0] = 0 |
                            /* opcode */ (((first ? opcode : 0) & 15)) |
                            /* rsv */ ((rsv & 7) << 4) |
                            /*fin*/ ((last & 1) << 7);
   if (len < 126) {
     ((uint8_t *)target)[1] = len;
-    memcpy(((uint8_t *)target) + 2, msg, len);
-    return len + 2;
+    return 2;
   } else if (len < (1UL << 16)) {
     /* head is 4 bytes */
     ((uint8_t *)target)[1] = 126;
     websocket_u2str16(((uint8_t *)target + 2), len);
-    memcpy((uint8_t *)target + 4, msg, len);
-    return len + 4;
+    return 4;
   }
   /* Really Long Message  */
   ((uint8_t *)target)[1] = 127;
   websocket_u2str64(((uint8_t *)target + 2), len);
-  memcpy((uint8_t *)target + 10, msg, len);
-  return len + 10;
+  return 10;
 }
 
 /**
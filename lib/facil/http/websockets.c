@@ -26,6 +26,13 @@ Feel free to copy, use and enjoy according to the license provided.
 
 #include <websocket_parser.h>
 
+#ifndef HAVE_ZLIB
+#define HAVE_ZLIB 0
+#endif
+#if HAVE_ZLIB
+#include <zlib.h>
+#endif
+
 #if !defined(__BIG_ENDIAN__) && !defined(__LITTLE_ENDIAN__)
 #include <endian.h>
 #if !defined(__BIG_ENDIAN__) && !defined(__LITTLE_ENDIAN__) &&                 \
@@ -59,8 +66,8 @@ void free_ws_buffer(ws_s *owner, struct buffer_s);
 
 /*******************************************************************************
 Buffer management - simple implementation...
-Since Websocket connections have a long life expectancy, optimizing this part of
-the code probably wouldn't offer a high performance boost.
+Since Websocket connections have a long life expectancy, the buffers are taken
+from the facil.io allocator's size classes rather than the system's heap.
 */
 
 // buffer increments by 4,096 Bytes (4Kb)
@@ -70,16 +77,15 @@ struct buffer_s create_ws_buffer(ws_s *owner) {
   (void)(owner);
   struct buffer_s buff;
   buff.size = WS_INITIAL_BUFFER_SIZE;
-  buff.data = malloc(buff.size);
+  buff.data = fio_malloc(buff.size);
   return buff;
 }
 
 struct buffer_s resize_ws_buffer(ws_s *owner, struct buffer_s buff) {
   buff.size = round_up_buffer_size(buff.size);
-  void *tmp = realloc(buff.data, buff.size);
+  void *tmp = fio_realloc(buff.data, buff.size);
   if (!tmp) {
     free_ws_buffer(owner, buff);
-    buff.data = NULL;
     buff.size = 0;
   }
   buff.data = tmp;
@@ -87,7 +93,7 @@ struct buffer_s resize_ws_buffer(ws_s *owner, struct buffer_s buff) {
 }
 void free_ws_buffer(ws_s *owner, struct buffer_s buff) {
   (void)(owner);
-  free(buff.data);
+  fio_free(buff.data);
 }
 
 #undef round_up_buffer_size
@@ -99,6 +105,33 @@ Create/Destroy the websocket object (prototypes)
 static ws_s *new_websocket();
 static void destroy_ws(ws_s *ws);
 
+/*******************************************************************************
+The permessage-deflate state (RFC 7692)
+*/
+
+/* the `deflate` configuration passed to `websocket_attach` */
+#define WS_DEFLATE_WINDOW(config) ((config)&15)
+#define WS_DEFLATE_NO_CONTEXT 16
+/* the offer included `server_max_window_bits` (negotiation only) */
+#define WS_DEFLATE_WINDOW_OFFERED 32
+
+typedef struct {
+#if HAVE_ZLIB
+  z_stream deflate;
+  z_stream inflate;
+#endif
+  /** orders compression with the outgoing queue (context takeover). */
+  fio_lock_i lock;
+  /** the server's window, in bits. */
+  uint8_t window;
+  /** each message is compressed on its own, using a shared state. */
+  uint8_t no_context;
+  uint8_t deflate_ready;
+  uint8_t inflate_ready;
+  /** the decompressed message buffer. */
+  FIOBJ inflated;
+} ws_deflate_s;
+
 /*******************************************************************************
 The Websocket object (protocol + parser)
 */
@@ -109,6 +142,8 @@ struct ws_s {
   intptr_t fd;
   /** callbacks */
   void (*on_message)(ws_s *ws, fio_str_info_s msg, uint8_t is_text);
+  void (*on_message_chunk)(ws_s *ws, fio_str_info_s chunk, uint8_t first,
+                           uint8_t last, uint8_t is_text);
   void (*on_shutdown)(ws_s *ws);
   void (*on_ready)(ws_s *ws);
   void (*on_open)(ws_s *ws);
@@ -124,14 +159,183 @@ struct ws_s {
   struct buffer_s buffer;
   /** data length (how much of the buffer actually used). */
   size_t length;
+  /** the payload still expected for a streamed frame (`on_message_chunk`). */
+  uint64_t stream_left;
+  /** the streamed frame's masking key, rotated to the next payload byte. */
+  uint32_t stream_mask;
+  /** the next streamed chunk starts a message. */
+  uint8_t stream_first;
+  /** the streamed frame is the message's last (FIN). */
+  uint8_t stream_fin;
   /** message buffer. */
   FIOBJ msg;
+  /** permessage-deflate state (NULL unless negotiated). */
+  ws_deflate_s *deflate;
+  /** pub/sub messages held back from a slow client (see `max_queued`). */
+  fio_ls_embd_s backlog;
+  /** the total length of the held back messages. */
+  size_t backlog_bytes;
+  /** protects the held back messages (pub/sub tasks and `on_ready`). */
+  fio_lock_i backlog_lock;
+  /** slow consumer policy (see `websocket_settings_s`). */
+  size_t max_queued;
+  void (*on_slow)(ws_s *ws, fio_str_info_s channel, size_t queued);
+  websocket_slow_policy_e slow_policy;
+  uint16_t close_code;
   /** latest text state. */
   uint8_t is_text;
+  /** latest compression state (RSV1). */
+  uint8_t is_compressed;
   /** websocket connection type. */
   uint8_t is_client;
+  /** set once a slow consumer policy closed the connection. */
+  volatile uint8_t is_slow_closed;
 };
 
+/* *****************************************************************************
+Compression (permessage-deflate)
+***************************************************************************** */
+
+#if HAVE_ZLIB
+
+/* the trailer removed from (and added to) each compressed message */
+static const char ws_deflate_trailer[4] = {0, 0, (char)0xFF, (char)0xFF};
+
+/* compression states shared by broadcasts and `server_no_context_takeover`
+ * connections, one for each window size (9-15) */
+typedef struct {
+  z_stream z;
+  fio_lock_i lock;
+  uint8_t ready;
+} ws_deflate_shared_s;
+static ws_deflate_shared_s ws_deflate_shared[7];
+
+static void ws_deflate_shared_free(void *slot_) {
+  ws_deflate_shared_s *slot = slot_;
+  if (slot->ready)
+    deflateEnd(&slot->z);
+  slot->ready = 0;
+}
+
+/* compresses a message, returning the payload of a compressed frame */
+static FIOBJ ws_deflate_message(z_stream *z, fio_str_info_s msg) {
+  FIOBJ out = fiobj_str_buf(msg.len + 64);
+  size_t used = 0;
+  z->next_in = (Bytef *)msg.data;
+  z->avail_in = msg.len;
+  do {
+    size_t capa = fiobj_str_capa(out);
+    if (capa - used < 64)
+      capa = fiobj_str_capa_assert(out, capa << 1);
+    char *buf = fiobj_obj2cstr(out).data;
+    z->next_out = (Bytef *)buf + used;
+    z->avail_out = capa - used - 1;
+    int r = deflate(z, Z_SYNC_FLUSH);
+    used = (char *)z->next_out - buf;
+    fiobj_str_resize(out, used); /* growing the String copies only its data */
+    if (r != Z_OK && r != Z_BUF_ERROR) {
+      deflateReset(z);
+      fiobj_free(out);
+      return FIOBJ_INVALID;
+    }
+  } while (!z->avail_out);
+  /* remove the sync flush trailer (RFC 7692, section 7.2.1) */
+  if (used < 4 || memcmp(fiobj_obj2cstr(out).data + used - 4,
+                         ws_deflate_trailer, 4)) {
+    deflateReset(z);
+    fiobj_free(out);
+    return FIOBJ_INVALID;
+  }
+  fiobj_str_resize(out, used - 4);
+  return out;
+}
+
+/* compresses a message on its own, using a shared compression state */
+static FIOBJ ws_deflate_shared_message(uint8_t window, fio_str_info_s msg) {
+  ws_deflate_shared_s *slot = ws_deflate_shared + (window - 9);
+  FIOBJ ret = FIOBJ_INVALID;
+  fio_lock(&slot->lock);
+  if (!slot->ready) {
+    if (deflateInit2(&slot->z, WEBSOCKET_DEFLATE_LEVEL, Z_DEFLATED,
+                     0 - (int)window, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+      goto finish;
+    slot->ready = 1;
+    fio_state_callback_add(FIO_CALL_AT_EXIT, ws_deflate_shared_free, slot);
+  }
+  ret = ws_deflate_message(&slot->z, msg);
+  deflateReset(&slot->z);
+finish:
+  fio_unlock(&slot->lock);
+  return ret;
+}
+
+/* decompresses a message into the connection's buffer, -1 on error */
+static int ws_inflate_message(ws_s *ws, fio_str_info_s data,
+                              fio_str_info_s *msg) {
+  ws_deflate_s *d = ws->deflate;
+  if (!d->inflate_ready) {
+    if (inflateInit2(&d->inflate, -15) != Z_OK)
+      return -1;
+    d->inflate_ready = 1;
+  }
+  if (!d->inflated)
+    d->inflated = fiobj_str_buf(data.len << 2);
+  size_t used = 0;
+  for (int i = 0; i < 2; ++i) {
+    /* the message and the trailer removed by the peer */
+    d->inflate.next_in = (Bytef *)(i ? ws_deflate_trailer : data.data);
+    d->inflate.avail_in = (i ? 4 : data.len);
+    for (;;) {
+      size_t capa = fiobj_str_capa(d->inflated);
+      if (capa - used < 256)
+        capa = fiobj_str_capa_assert(d->inflated, capa << 1);
+      char *buf = fiobj_obj2cstr(d->inflated).data;
+      d->inflate.next_out = (Bytef *)buf + used;
+      d->inflate.avail_out = capa - used - 1;
+      int r = inflate(&d->inflate, Z_SYNC_FLUSH);
+      used = (char *)d->inflate.next_out - buf;
+      fiobj_str_resize(d->inflated, used);
+      if (used > ws->max_msg_size)
+        return -1;
+      if (r == Z_STREAM_END) {
+        /* the peer ended the stream (BFINAL), start a new one */
+        inflateReset(&d->inflate);
+        i = 1;
+        break;
+      }
+      if (r != Z_OK && r != Z_BUF_ERROR)
+        return -1;
+      if (!d->inflate.avail_in && d->inflate.avail_out)
+        break;
+    }
+  }
+  *msg = fiobj_obj2cstr(d->inflated);
+  return 0;
+}
+
+/* releases the decompression buffer once a large message was handled */
+static void ws_inflate_trim(ws_deflate_s *d) {
+  if (d->inflated && fiobj_str_capa(d->inflated) > WEBSOCKET_INFLATE_KEEP) {
+    fiobj_free(d->inflated);
+    d->inflated = FIOBJ_INVALID;
+  }
+}
+
+#endif /* HAVE_ZLIB */
+
+static void ws_deflate_free(ws_deflate_s *d) {
+  if (!d)
+    return;
+#if HAVE_ZLIB
+  if (d->deflate_ready)
+    deflateEnd(&d->deflate);
+  if (d->inflate_ready)
+    inflateEnd(&d->inflate);
+#endif
+  fiobj_free(d->inflated);
+  free(d);
+}
+
 /* *****************************************************************************
 Create/Destroy the websocket subscription objects
 ***************************************************************************** */
@@ -144,6 +348,55 @@ static inline void clear_subscriptions(ws_s *ws) {
   fio_unlock(&ws->sub_lock);
 }
 
+typedef struct websocket_sub_data_s websocket_sub_data_s;
+/* implemented later, releases a reference to the subscription's data */
+static void websocket_sub_data_free(websocket_sub_data_s *d);
+
+/* a pub/sub message held back from a slow client */
+typedef struct {
+  fio_ls_embd_s node;
+  FIOBJ channel;
+  FIOBJ msg;
+  /** the subscription (a reference is held). */
+  websocket_sub_data_s *sub;
+  /** 0 - binary, 1 - text, 2 - test for UTF-8, 3 - `on_message` callback. */
+  uint8_t txt;
+} ws_backlog_s;
+
+/* the `txt` value of messages handled by the subscription's callback */
+#define WS_BACKLOG_CALLBACK 3
+
+/* removes a held back message from the backlog (the lock must be held). */
+static ws_backlog_s *ws_backlog_remove(ws_s *ws, ws_backlog_s *b) {
+  fio_ls_embd_remove(&b->node);
+  ws->backlog_bytes -= fiobj_obj2cstr(b->msg).len;
+  return b;
+}
+
+/* removes the oldest held back message, if any. */
+static ws_backlog_s *ws_backlog_shift(ws_s *ws) {
+  ws_backlog_s *b = NULL;
+  fio_lock(&ws->backlog_lock);
+  if (fio_ls_embd_any(&ws->backlog))
+    b = ws_backlog_remove(
+        ws, FIO_LS_EMBD_OBJ(ws_backlog_s, node, ws->backlog.next));
+  fio_unlock(&ws->backlog_lock);
+  return b;
+}
+
+static void ws_backlog_free(ws_backlog_s *b) {
+  fiobj_free(b->channel);
+  fiobj_free(b->msg);
+  websocket_sub_data_free(b->sub);
+  free(b);
+}
+
+static inline void clear_backlog(ws_s *ws) {
+  ws_backlog_s *b;
+  while ((b = ws_backlog_shift(ws)))
+    ws_backlog_free(b);
+}
+
 /* *****************************************************************************
 Callbacks - Required functions for websocket_parser.h
 ***************************************************************************** */
@@ -152,23 +405,60 @@ static void websocket_on_unwrapped(void *ws_p, void *msg, uint64_t len,
                                    char first, char last, char text,
                                    unsigned char rsv) {
   ws_s *ws = ws_p;
-  if (last && first) {
+  if (first) {
+    /* RSV1 marks a compressed message (only valid if negotiated) */
+    ws->is_compressed = ((rsv & 4) && ws->deflate);
+    if ((rsv & 4) && !ws->deflate) {
+      websocket_close(ws);
+      return;
+    }
+  }
+  if (ws->on_message_chunk && !ws->is_compressed) {
+    /* streaming: each frame is a chunk, nothing is collected */
+    if (first)
+      ws->is_text = (uint8_t)text;
+    ws->on_message_chunk(ws, (fio_str_info_s){.data = msg, .len = len},
+                         (uint8_t)first, (uint8_t)last, ws->is_text);
+    return;
+  }
+  if (last && first && !ws->is_compressed) {
     ws->on_message(ws, (fio_str_info_s){.data = msg, .len = len},
                    (uint8_t)text);
     return;
   }
-  if (first) {
+  fio_str_info_s data = {.data = msg, .len = len};
+  if (!last || !first) {
+    if (first) {
+      ws->is_text = (uint8_t)text;
+      if (ws->msg == FIOBJ_INVALID)
+        ws->msg = fiobj_str_buf(len);
+      fiobj_str_resize(ws->msg, 0);
+    }
+    fiobj_str_write(ws->msg, msg, len);
+    if (!last)
+      return;
+    data = fiobj_obj2cstr(ws->msg);
+  } else {
     ws->is_text = (uint8_t)text;
-    if (ws->msg == FIOBJ_INVALID)
-      ws->msg = fiobj_str_buf(len);
-    fiobj_str_resize(ws->msg, 0);
   }
-  fiobj_str_write(ws->msg, msg, len);
-  if (last) {
-    ws->on_message(ws, fiobj_obj2cstr(ws->msg), ws->is_text);
+  if (ws->is_compressed) {
+#if HAVE_ZLIB
+    if (ws_inflate_message(ws, data, &data)) {
+      websocket_close(ws);
+      return;
+    }
+#endif
+  }
+  if (ws->on_message_chunk) {
+    /* compressed messages are inflated as a whole */
+    ws->on_message_chunk(ws, data, 1, 1, ws->is_text);
+  } else {
+    ws->on_message(ws, data, ws->is_text);
   }
-
-  (void)rsv;
+#if HAVE_ZLIB
+  if (ws->is_compressed)
+    ws_inflate_trim(ws->deflate);
+#endif
 }
 static void websocket_on_protocol_ping(void *ws_p, void *msg_, uint64_t len) {
   ws_s *ws = ws_p;
@@ -224,8 +514,17 @@ static void on_close(intptr_t uuid, fio_protocol_s *_ws) {
   (void)uuid;
 }
 
+/* implemented later, sends (or handles) a held back message, freeing it */
+static void websocket_backlog_send(ws_s *ws, ws_backlog_s *b);
+
 static void on_ready(intptr_t fduuid, fio_protocol_s *ws) {
-  (void)(fduuid);
+  ws_backlog_s *b;
+  /* the outgoing queue was drained, send (or handle) the held back messages,
+   * until the queue fills up again */
+  while (!((ws_s *)ws)->is_slow_closed &&
+         fio_pending_bytes(fduuid) <= ((ws_s *)ws)->max_queued &&
+         (b = ws_backlog_shift((ws_s *)ws)))
+    websocket_backlog_send((ws_s *)ws, b);
   if (((ws_s *)ws)->on_ready)
     ((ws_s *)ws)->on_ready((ws_s *)ws);
 }
@@ -244,28 +543,113 @@ static uint8_t on_shutdown(intptr_t fd, fio_protocol_s *ws) {
   return 0;
 }
 
+/* *****************************************************************************
+Streaming frames that don't fit the buffer (`on_message_chunk`)
+***************************************************************************** */
+
+/* tests if a frame (starting with the `head` byte) could be streamed */
+static inline uint8_t ws_stream_allowed(ws_s *ws, uint8_t head) {
+  const uint8_t opcode = head & 15;
+  /* control frames and compressed (or invalid) messages are collected */
+  return ws->on_message_chunk && opcode <= 2 && !(head & 0x70) &&
+         (opcode || !ws->is_compressed);
+}
+
+/* starts streaming the frame at the head of the buffer (if it doesn't fit) */
+static uint8_t ws_stream_start(ws_s *ws) {
+  uint8_t *pos = ws->buffer.data;
+  struct websocket_packet_info_s info = websocket_buffer_peek(pos, ws->length);
+  if (!info.head_length || info.head_length > ws->length ||
+      info.head_length + info.packet_length <= ws->buffer.size ||
+      !ws_stream_allowed(ws, pos[0]))
+    return 0;
+  const uint8_t opcode = pos[0] & 15;
+  if (!info.masked && !ws->is_client) {
+    websocket_on_protocol_error(ws);
+    ws->length = 0;
+    return 0;
+  }
+  ws->stream_mask = 0;
+  if (info.masked)
+    memcpy(&ws->stream_mask, pos + info.head_length - 4, 4);
+  ws->stream_left = info.packet_length;
+  ws->stream_fin = (pos[0] >> 7) & 1;
+  ws->stream_first = (opcode != 0);
+  if (opcode) {
+    ws->is_text = (opcode == 1);
+    ws->is_compressed = 0;
+  }
+  ws->length -= info.head_length;
+  memmove(pos, pos + info.head_length, ws->length);
+  return 1;
+}
+
+/* unmasks and delivers the streamed payload at the head of the buffer */
+static void ws_stream_chunk(ws_s *ws) {
+  uint8_t *data = ws->buffer.data;
+  size_t len = ws->length;
+  if (len > ws->stream_left)
+    len = (size_t)ws->stream_left;
+  if (ws->stream_mask) {
+    websocket_xmask(data, len, ws->stream_mask);
+    /* rotate the key so it starts at the next payload byte */
+    const uint32_t mask = ws->stream_mask;
+    for (size_t i = 0; i < 4; ++i)
+      ((uint8_t *)&ws->stream_mask)[i] = ((uint8_t *)&mask)[(i + len) & 3];
+  }
+  ws->stream_left -= len;
+  const uint8_t first = ws->stream_first;
+  ws->stream_first = 0;
+  ws->on_message_chunk(ws, (fio_str_info_s){.data = (char *)data, .len = len},
+                       first, (uint8_t)(ws->stream_fin && !ws->stream_left),
+                       ws->is_text);
+  ws->length -= len;
+  memmove(data, data + len, ws->length);
+}
+
+/* parses the buffered data, streaming large frames when possible */
+static void ws_consume_buffer(ws_s *ws) {
+  for (;;) {
+    if (ws->stream_left) {
+      if (!ws->length)
+        return;
+      ws_stream_chunk(ws);
+      continue;
+    }
+    ws->length = websocket_consume(ws->buffer.data, ws->length, ws,
+                                   (~(ws->is_client) & 1));
+    if (!ws->on_message_chunk || !ws_stream_start(ws))
+      return;
+  }
+}
+
 static void on_data(intptr_t sockfd, fio_protocol_s *ws_) {
   ws_s *const ws = (ws_s *)ws_;
   if (ws == NULL)
     return;
-  struct websocket_packet_info_s info =
-      websocket_buffer_peek(ws->buffer.data, ws->length);
-  const uint64_t raw_length = info.packet_length + info.head_length;
-  /* test expected data amount */
-  if (ws->max_msg_size < raw_length) {
-    /* too big */
-    websocket_close(ws);
-    return;
-  }
-  /* test buffer capacity */
-  if (raw_length > ws->buffer.size) {
-    ws->buffer.size = (size_t)raw_length;
-    ws->buffer = resize_ws_buffer(ws, ws->buffer);
-    if (!ws->buffer.data) {
-      // no memory.
+  /* a frame that might be streamed only needs the rest of its header */
+  if (!ws->stream_left &&
+      !(ws->length &&
+        ws_stream_allowed(ws, ((uint8_t *)ws->buffer.data)[0]))) {
+    struct websocket_packet_info_s info =
+        websocket_buffer_peek(ws->buffer.data, ws->length);
+    const uint64_t raw_length = info.packet_length + info.head_length;
+    /* test expected data amount */
+    if (ws->max_msg_size < raw_length) {
+      /* too big */
       websocket_close(ws);
       return;
     }
+    /* test buffer capacity */
+    if (raw_length > ws->buffer.size) {
+      ws->buffer.size = (size_t)raw_length;
+      ws->buffer = resize_ws_buffer(ws, ws->buffer);
+      if (!ws->buffer.data) {
+        // no memory.
+        websocket_close(ws);
+        return;
+      }
+    }
   }
 
   const ssize_t len = fio_read(sockfd, (uint8_t *)ws->buffer.data + ws->length,
@@ -273,8 +657,17 @@ static void on_data(intptr_t sockfd, fio_protocol_s *ws_) {
   if (len <= 0) {
     return;
   }
-  ws->length = websocket_consume(ws->buffer.data, ws->length + len, ws,
-                                 (~(ws->is_client) & 1));
+  ws->length += len;
+  ws_consume_buffer(ws);
+  if (!ws->length && ws->buffer.size > WS_INITIAL_BUFFER_SIZE) {
+    /* a large message was handled, return to the initial buffer size */
+    free_ws_buffer(ws, ws->buffer);
+    ws->buffer = create_ws_buffer(ws);
+    if (!ws->buffer.data) {
+      websocket_close(ws);
+      return;
+    }
+  }
 
   fio_force_event(sockfd, FIO_EVENT_ON_DATA);
 }
@@ -286,17 +679,16 @@ static void on_data_first(intptr_t sockfd, fio_protocol_s *ws_) {
   ws->protocol.on_data = on_data;
   ws->protocol.on_ready = on_ready;
 
-  if (ws->length) {
-    ws->length = websocket_consume(ws->buffer.data, ws->length, ws,
-                                   (~(ws->is_client) & 1));
-  }
+  if (ws->length)
+    ws_consume_buffer(ws);
   fio_force_event(sockfd, FIO_EVENT_ON_DATA);
   fio_force_event(sockfd, FIO_EVENT_ON_READY);
 }
 
 /* later */
 static void websocket_write_impl(intptr_t fd, void *data, size_t len, char text,
-                                 char first, char last, char client);
+                                 char first, char last, char client,
+                                 unsigned char rsv);
 
 /*******************************************************************************
 Create/Destroy the websocket object
@@ -312,6 +704,7 @@ static ws_s *new_websocket(intptr_t uuid) {
       .protocol.on_ready = NULL /* filled in after `on_open` */,
       .protocol.on_shutdown = on_shutdown,
       .subscriptions = FIO_LS_INIT(ws->subscriptions),
+      .backlog = FIO_LS_INIT(ws->backlog),
       .is_client = 0,
       .fd = uuid,
   };
@@ -322,23 +715,40 @@ static void destroy_ws(ws_s *ws) {
     ws->on_close(ws->fd, ws->udata);
   if (ws->msg)
     fiobj_free(ws->msg);
+  ws_deflate_free(ws->deflate);
   clear_subscriptions(ws);
+  clear_backlog(ws);
   free_ws_buffer(ws, ws->buffer);
   free(ws);
 }
 
 void websocket_attach(intptr_t uuid, http_settings_s *http_settings,
-                      websocket_settings_s *args, void *data, size_t length) {
+                      websocket_settings_s *args, void *data, size_t length,
+                      uint8_t deflate) {
   ws_s *ws = new_websocket(uuid);
   FIO_ASSERT_ALLOC(ws);
+  if (deflate) {
+    ws->deflate = malloc(sizeof(*ws->deflate));
+    FIO_ASSERT_ALLOC(ws->deflate);
+    *ws->deflate = (ws_deflate_s){
+        .window = WS_DEFLATE_WINDOW(deflate),
+        .no_context = !!(deflate & WS_DEFLATE_NO_CONTEXT),
+    };
+  }
   // we have an active websocket connection - prep the connection buffer
   ws->buffer = create_ws_buffer(ws);
   // Setup ws callbacks
   ws->on_open = args->on_open;
   ws->on_close = args->on_close;
   ws->on_message = args->on_message;
+  ws->on_message_chunk = args->on_message_chunk;
   ws->on_ready = args->on_ready;
   ws->on_shutdown = args->on_shutdown;
+  // slow consumer policy
+  ws->max_queued = args->max_queued;
+  ws->on_slow = args->on_slow;
+  ws->slow_policy = args->slow_policy;
+  ws->close_code = (args->close_code ? args->close_code : 1008);
   // setup any user data
   ws->udata = args->udata;
   if (http_settings) {
@@ -380,28 +790,240 @@ Writing to the Websocket
   (FIO_MEMORY_BLOCK_ALLOC_LIMIT - 4096) // should be less then `unsigned short`
 
 static void websocket_write_impl(intptr_t fd, void *data, size_t len, char text,
-                                 char first, char last, char client) {
+                                 char first, char last, char client,
+                                 unsigned char rsv) {
+  /* the RSV bits (i.e., compression) are only set on the first frame */
+  if (!first)
+    rsv = 0;
   if (len <= WS_MAX_FRAME_SIZE) {
     void *buff = fio_malloc(len + 16);
     len = (client ? websocket_client_wrap(buff, data, len, (text ? 1 : 2),
-                                          first, last, 0)
+                                          first, last, rsv)
                   : websocket_server_wrap(buff, data, len, (text ? 1 : 2),
-                                          first, last, 0));
+                                          first, last, rsv));
     fio_write2(fd, .data.buffer = buff, .length = len,
                .after.dealloc = fio_free);
   } else {
     /* frame fragmentation is better for large data then large frames */
     while (len > WS_MAX_FRAME_SIZE) {
-      websocket_write_impl(fd, data, WS_MAX_FRAME_SIZE, text, first, 0, client);
+      websocket_write_impl(fd, data, WS_MAX_FRAME_SIZE, text, first, 0, client,
+                           rsv);
       data = ((uint8_t *)data) + WS_MAX_FRAME_SIZE;
       first = 0;
       len -= WS_MAX_FRAME_SIZE;
     }
-    websocket_write_impl(fd, data, len, text, first, 1, client);
+    websocket_write_impl(fd, data, len, text, first, 1, client, rsv);
   }
   return;
 }
 
+/* writes a server message held by a String, consuming the reference. */
+static void websocket_write_str(intptr_t fd, FIOBJ str, char text,
+                                unsigned char rsv) {
+  fio_str_info_s s = fiobj_obj2cstr(str);
+  if (s.len < WEBSOCKET_ZERO_COPY_MIN || !FIOBJ_TYPE_IS(str, FIOBJ_T_STRING)) {
+    websocket_write_impl(fd, s.data, s.len, text, 1, 1, 0, rsv);
+    fiobj_free(str);
+    return;
+  }
+  /* a single frame: the payload isn't allocated, so it needn't be split */
+  uint8_t head[16];
+  const uint8_t head_len = (uint8_t)websocket_server_wrap_head(
+      head, s.len, (text ? 1 : 2), 1, 1, rsv);
+  fio_write2(fd, .data.buffer = (void *)str,
+             .offset = (uintptr_t)s.data - (uintptr_t)str, .length = s.len,
+             .header = head, .header_len = head_len,
+             .after.dealloc = fiobj4sock_dealloc);
+}
+
+/* compresses and writes a message, returns -1 if the message wasn't sent */
+static int websocket_deflate_write(ws_s *ws, fio_str_info_s msg,
+                                   uint8_t is_text) {
+#if HAVE_ZLIB
+  ws_deflate_s *d = ws->deflate;
+  FIOBJ payload;
+  if (d->no_context) {
+    /* messages are independent, so the order of compression doesn't matter */
+    payload = ws_deflate_shared_message(d->window, msg);
+    if (!payload)
+      return -1;
+    websocket_write_str(ws->fd, payload, is_text, 4);
+    return 0;
+  }
+  /* the peer decompresses messages in the order they were compressed */
+  fio_lock(&d->lock);
+  if (!d->deflate_ready) {
+    if (deflateInit2(&d->deflate, WEBSOCKET_DEFLATE_LEVEL, Z_DEFLATED,
+                     0 - (int)d->window, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+      fio_unlock(&d->lock);
+      return -1;
+    }
+    d->deflate_ready = 1;
+  }
+  payload = ws_deflate_message(&d->deflate, msg);
+  if (payload)
+    websocket_write_str(ws->fd, payload, is_text, 4);
+  fio_unlock(&d->lock);
+  return (payload ? 0 : -1);
+#else
+  return -1;
+  (void)ws;
+  (void)msg;
+  (void)is_text;
+#endif
+}
+
+/*******************************************************************************
+Negotiating permessage-deflate
+*/
+
+#if HAVE_ZLIB
+/* trims white space (and quotes) around a token */
+static fio_str_info_s ws_deflate_token(char *start, char *end) {
+  while (start < end && (*start == ' ' || *start == '\t'))
+    ++start;
+  while (end > start && (end[-1] == ' ' || end[-1] == '\t'))
+    --end;
+  if (end - start >= 2 && start[0] == '"' && end[-1] == '"') {
+    ++start;
+    --end;
+  }
+  return (fio_str_info_s){.data = start, .len = (size_t)(end - start)};
+}
+
+/* parses a window size parameter (8-15), returns 0 if invalid */
+static uint8_t ws_deflate_window_bits(fio_str_info_s value) {
+  if (!value.len || value.len > 2 || value.data[0] < '0' ||
+      value.data[0] > '9' ||
+      (value.len == 2 && (value.data[1] < '0' || value.data[1] > '9')))
+    return 0;
+  uint8_t bits = value.data[0] - '0';
+  if (value.len == 2)
+    bits = (bits * 10) + (value.data[1] - '0');
+  return ((bits >= 8 && bits <= 15) ? bits : 0);
+}
+
+/* evaluates a single offer, returns the configuration (0 if declined) */
+static uint8_t ws_deflate_offer(char *pos, char *end,
+                                http_settings_s *settings) {
+  char *sep = memchr(pos, ';', end - pos);
+  if (!sep)
+    sep = end;
+  fio_str_info_s name = ws_deflate_token(pos, sep);
+  if (name.len != 18 || strncasecmp(name.data, "permessage-deflate", 18))
+    return 0;
+  uint8_t window = settings->ws_compress_window;
+  uint8_t no_context = settings->ws_compress_no_context;
+  uint8_t seen = 0;
+  while (sep < end) {
+    pos = sep + 1;
+    sep = memchr(pos, ';', end - pos);
+    if (!sep)
+      sep = end;
+    char *eq = memchr(pos, '=', sep - pos);
+    fio_str_info_s key = ws_deflate_token(pos, (eq ? eq : sep));
+    fio_str_info_s value = (eq ? ws_deflate_token(eq + 1, sep)
+                               : (fio_str_info_s){.data = NULL});
+    uint8_t flag;
+    if (key.len == 26 &&
+        !strncasecmp(key.data, "server_no_context_takeover", 26)) {
+      flag = 1;
+      if (eq)
+        return 0;
+      no_context = 1;
+    } else if (key.len == 26 &&
+               !strncasecmp(key.data, "client_no_context_takeover", 26)) {
+      flag = 2;
+      if (eq)
+        return 0;
+    } else if (key.len == 22 &&
+               !strncasecmp(key.data, "server_max_window_bits", 22)) {
+      flag = 4;
+      uint8_t bits = ws_deflate_window_bits(value);
+      /* zlib's raw deflate can't produce an 8 bit window, decline */
+      if (bits < 9)
+        return 0;
+      if (window > bits)
+        window = bits;
+    } else if (key.len == 22 &&
+               !strncasecmp(key.data, "client_max_window_bits", 22)) {
+      /* the client may use any window, we decompress using a 15 bit window */
+      flag = 8;
+      if (eq && !ws_deflate_window_bits(value))
+        return 0;
+    } else {
+      return 0;
+    }
+    if (seen & flag)
+      return 0;
+    seen |= flag;
+  }
+  return window | (no_context ? WS_DEFLATE_NO_CONTEXT : 0) |
+         ((seen & 4) ? WS_DEFLATE_WINDOW_OFFERED : 0);
+}
+
+/* evaluates a (comma separated) list of offers, returns the first accepted */
+static uint8_t ws_deflate_offers(fio_str_info_s offers,
+                                 http_settings_s *settings) {
+  char *pos = offers.data;
+  char *end = offers.data + offers.len;
+  while (pos < end) {
+    char *sep = memchr(pos, ',', end - pos);
+    if (!sep)
+      sep = end;
+    uint8_t config = ws_deflate_offer(pos, sep, settings);
+    if (config)
+      return config;
+    pos = sep + 1;
+  }
+  return 0;
+}
+#endif /* HAVE_ZLIB */
+
+/**
+ * Negotiates the `permessage-deflate` extension, setting the response header.
+ * Returns the configuration for `websocket_attach` (0 if not negotiated).
+ */
+uint8_t websocket_deflate_negotiate(http_s *h, http_settings_s *settings) {
+#if HAVE_ZLIB
+  static uint64_t extensions_hash;
+  if (!settings || !settings->ws_compress || settings->is_client)
+    return 0;
+  if (!extensions_hash)
+    extensions_hash = fiobj_hash_string("sec-websocket-extensions", 24);
+  FIOBJ offers = fiobj_hash_get2(h->headers, extensions_hash);
+  uint8_t config = 0;
+  if (FIOBJ_TYPE_IS(offers, FIOBJ_T_ARRAY)) {
+    for (size_t i = 0; !config && i < fiobj_ary_count(offers); ++i)
+      config = ws_deflate_offers(fiobj_obj2cstr(fiobj_ary_index(offers, i)),
+                                 settings);
+  } else if (offers) {
+    config = ws_deflate_offers(fiobj_obj2cstr(offers), settings);
+  }
+  if (!config)
+    return 0;
+  char buf[80];
+  int len = snprintf(buf, sizeof(buf), "permessage-deflate%s",
+                     ((config & WS_DEFLATE_NO_CONTEXT)
+                          ? "; server_no_context_takeover"
+                          : ""));
+  /* a window limit in the offer must be answered (RFC 7692, 7.1.2.1) */
+  if (WS_DEFLATE_WINDOW(config) < 15 || (config & WS_DEFLATE_WINDOW_OFFERED))
+    len += snprintf(buf + len, sizeof(buf) - len,
+                    "; server_max_window_bits=%u",
+                    (unsigned)WS_DEFLATE_WINDOW(config));
+  http_set_header2(h,
+                   (fio_str_info_s){.data = "sec-websocket-extensions",
+                                    .len = 24},
+                   (fio_str_info_s){.data = buf, .len = (size_t)len});
+  return config & ~WS_DEFLATE_WINDOW_OFFERED;
+#else
+  return 0;
+  (void)h;
+  (void)settings;
+#endif
+}
+
 /* *****************************************************************************
 Multi-client broadcast optimizations
 ***************************************************************************** */
@@ -423,13 +1045,39 @@ static inline fio_msg_metadata_s websocket_optimize(fio_str_info_s msg,
   };
   return ret;
 }
+/* a compressed (permessage-deflate) frame, compressed once for all clients */
+static inline fio_msg_metadata_s
+websocket_optimize_deflate(fio_str_info_s msg, unsigned char opcode,
+                           intptr_t type_id) {
+  fio_msg_metadata_s ret = {.type_id = 0};
+#if HAVE_ZLIB
+  if (msg.len < WEBSOCKET_DEFLATE_MIN)
+    return ret;
+  FIOBJ payload = ws_deflate_shared_message(15, msg);
+  if (!payload)
+    return ret;
+  fio_str_info_s p = fiobj_obj2cstr(payload);
+  FIOBJ out = fiobj_str_buf(p.len + 10);
+  fiobj_str_resize(out, websocket_server_wrap(fiobj_obj2cstr(out).data, p.data,
+                                              p.len, opcode, 1, 1, 4));
+  fiobj_free(payload);
+  ret = (fio_msg_metadata_s){
+      .type_id = type_id,
+      .on_finish = websocket_optimize_free,
+      .metadata = (void *)out,
+  };
+#endif
+  return ret;
+  (void)msg;
+  (void)opcode;
+  (void)type_id;
+}
+
 static fio_msg_metadata_s websocket_optimize_generic(fio_str_info_s ch,
                                                      fio_str_info_s msg,
                                                      uint8_t is_json) {
-  fio_str_s tmp = FIO_STR_INIT_EXISTING(ch.data, ch.len, 0); // don't free
-  tmp.dealloc = NULL;
   unsigned char opcode = 2;
-  if (tmp.len <= (2 << 19) && fio_str_utf8_valid(&tmp)) {
+  if (msg.len <= (2 << 19) && websocket_utf8_valid(msg.data, msg.len)) {
     opcode = 1;
   }
   fio_msg_metadata_s ret = websocket_optimize(msg, opcode);
@@ -459,6 +1107,36 @@ static fio_msg_metadata_s websocket_optimize_binary(fio_str_info_s ch,
   (void)is_json;
 }
 
+static fio_msg_metadata_s websocket_optimize_generic_deflate(fio_str_info_s ch,
+                                                             fio_str_info_s msg,
+                                                             uint8_t is_json) {
+  return websocket_optimize_deflate(
+      msg,
+      ((msg.len <= (2 << 19) && websocket_utf8_valid(msg.data, msg.len)) ? 1
+                                                                         : 2),
+      WEBSOCKET_OPTIMIZE_PUBSUB_DEFLATE);
+  (void)ch;
+  (void)is_json;
+}
+
+static fio_msg_metadata_s websocket_optimize_text_deflate(fio_str_info_s ch,
+                                                          fio_str_info_s msg,
+                                                          uint8_t is_json) {
+  return websocket_optimize_deflate(msg, 1,
+                                    WEBSOCKET_OPTIMIZE_PUBSUB_TEXT_DEFLATE);
+  (void)ch;
+  (void)is_json;
+}
+
+static fio_msg_metadata_s
+websocket_optimize_binary_deflate(fio_str_info_s ch, fio_str_info_s msg,
+                                  uint8_t is_json) {
+  return websocket_optimize_deflate(msg, 2,
+                                    WEBSOCKET_OPTIMIZE_PUBSUB_BINARY_DEFLATE);
+  (void)ch;
+  (void)is_json;
+}
+
 /**
  * Enables (or disables) broadcast optimizations.
  *
@@ -481,6 +1159,9 @@ static fio_msg_metadata_s websocket_optimize_binary(fio_str_info_s ch,
  * * WEBSOCKET_OPTIMIZE_PUBSUB_TEXT - optimize direct pub/sub text messages.
  * * WEBSOCKET_OPTIMIZE_PUBSUB_BINARY - optimize direct pub/sub binary messages.
  *
+ * The `_DEFLATE` variants compress each message once for all the
+ * `permessage-deflate` connections.
+ *
  * Note: to disable an optimization it should be disabled the same amount of
  * times it was enabled - multiple optimization enablements for the same type
  * are merged, but reference counted (disabled when reference is zero).
@@ -489,6 +1170,9 @@ void websocket_optimize4broadcasts(intptr_t type, int enable) {
   static intptr_t generic = 0;
   static intptr_t text = 0;
   static intptr_t binary = 0;
+  static intptr_t generic_deflate = 0;
+  static intptr_t text_deflate = 0;
+  static intptr_t binary_deflate = 0;
   fio_msg_metadata_s (*callback)(fio_str_info_s, fio_str_info_s, uint8_t);
   intptr_t *counter;
   switch ((0 - type)) {
@@ -504,6 +1188,18 @@ void websocket_optimize4broadcasts(intptr_t type, int enable) {
     counter = &binary;
     callback = websocket_optimize_binary;
     break;
+  case (0 - WEBSOCKET_OPTIMIZE_PUBSUB_DEFLATE):
+    counter = &generic_deflate;
+    callback = websocket_optimize_generic_deflate;
+    break;
+  case (0 - WEBSOCKET_OPTIMIZE_PUBSUB_TEXT_DEFLATE):
+    counter = &text_deflate;
+    callback = websocket_optimize_text_deflate;
+    break;
+  case (0 - WEBSOCKET_OPTIMIZE_PUBSUB_BINARY_DEFLATE):
+    counter = &binary_deflate;
+    callback = websocket_optimize_binary_deflate;
+    break;
   default:
     return;
   }
@@ -522,12 +1218,161 @@ void websocket_optimize4broadcasts(intptr_t type, int enable) {
 Subscription handling
 ***************************************************************************** */
 
-typedef struct {
+struct websocket_sub_data_s {
   void (*on_message)(ws_s *ws, fio_str_info_s channel, fio_str_info_s msg,
                      void *udata);
   void (*on_unsubscribe)(void *udata);
   void *udata;
-} websocket_sub_data_s;
+  /** the `_DEFLATE` broadcast optimization enabled for the subscription. */
+  intptr_t deflate_type;
+  /** the subscription and each held back message hold a reference. */
+  volatile uintptr_t ref;
+  /** held back messages aren't sent once the subscription was revoked. */
+  volatile uint8_t unsubscribed;
+};
+
+static void websocket_sub_data_free(websocket_sub_data_s *d) {
+  if (fio_atomic_sub(&d->ref, 1))
+    return;
+  if (d->on_unsubscribe) {
+    d->on_unsubscribe(d->udata);
+  }
+
+  if (d->deflate_type)
+    websocket_optimize4broadcasts(d->deflate_type, 0);
+  if ((intptr_t)d->on_message == (intptr_t)WEBSOCKET_OPTIMIZE_PUBSUB) {
+    websocket_optimize4broadcasts(WEBSOCKET_OPTIMIZE_PUBSUB, 0);
+  } else if ((intptr_t)d->on_message ==
+             (intptr_t)WEBSOCKET_OPTIMIZE_PUBSUB_TEXT) {
+    websocket_optimize4broadcasts(WEBSOCKET_OPTIMIZE_PUBSUB_TEXT, 0);
+  } else if ((intptr_t)d->on_message ==
+             (intptr_t)WEBSOCKET_OPTIMIZE_PUBSUB_BINARY) {
+    websocket_optimize4broadcasts(WEBSOCKET_OPTIMIZE_PUBSUB_BINARY, 0);
+  }
+  free(d);
+}
+
+static void websocket_force_close_task(void *uuid) {
+  fio_force_close((intptr_t)uuid);
+}
+
+/* drops the queued data, sends a close frame and closes the connection. */
+static void websocket_close_slow(ws_s *ws) {
+  if (fio_atomic_xchange(&ws->is_slow_closed, 1))
+    return;
+  clear_backlog(ws);
+  /* the close frame follows the frame being sent, the others are dropped */
+  fio_drop_pending(ws->fd);
+  uint8_t payload[2] = {(uint8_t)(ws->close_code >> 8),
+                        (uint8_t)(ws->close_code & 0xFF)};
+  void *buff = fio_malloc(16);
+  size_t len = (ws->is_client
+                    ? websocket_client_wrap(buff, payload, 2, 8, 1, 1, 0)
+                    : websocket_server_wrap(buff, payload, 2, 8, 1, 1, 0));
+  fio_write2(ws->fd, .data.buffer = buff, .length = len,
+             .after.dealloc = fio_free);
+  fio_close(ws->fd);
+  /* don't wait for a slow client to read a large frame */
+  fio_run_every(WEBSOCKET_SLOW_CLOSE_TIMEOUT, 1, websocket_force_close_task,
+                (void *)ws->fd, NULL);
+}
+
+/*
+ * Applies the connection's slow consumer policy (if the client is slow).
+ *
+ * The held back messages are limited to `max_queued` on their own, so a slow
+ * client may cost up to twice `max_queued` bytes (the queue that made it slow
+ * plus the messages held back until that queue is drained).
+ *
+ * Returns 1 if the message was held back, dropped or the connection was
+ * closed, and 0 if the message should be sent (or handled).
+ */
+static int websocket_throttle(ws_s *ws, websocket_sub_data_s *d, fio_msg_s *msg,
+                              uint8_t txt) {
+  const size_t queued = fio_pending_bytes(ws->fd) + ws->backlog_bytes;
+  if (!queued || (!fio_ls_embd_any(&ws->backlog) &&
+                  queued + msg->msg.len <= ws->max_queued))
+    return 0;
+  if (queued + msg->msg.len > ws->max_queued) {
+    if (ws->on_slow)
+      ws->on_slow(ws, msg->channel, queued + msg->msg.len);
+    if (ws->slow_policy == WEBSOCKET_SLOW_DISCONNECT) {
+      websocket_close_slow(ws);
+      return 1;
+    }
+  }
+  fio_ls_embd_s dropped = FIO_LS_INIT(dropped);
+  ws_backlog_s *b = malloc(sizeof(*b));
+  FIO_ASSERT_ALLOC(b);
+  *b = (ws_backlog_s){
+      .channel = fiobj_str_new(msg->channel.data, msg->channel.len),
+      .msg = fiobj_str_new(msg->msg.data, msg->msg.len),
+      .sub = d,
+      .txt = txt,
+  };
+  fio_atomic_add(&d->ref, 1);
+  fio_lock(&ws->backlog_lock);
+  if (ws->slow_policy == WEBSOCKET_SLOW_COALESCE) {
+    /* the message replaces the one held back for the same channel (and
+     * subscription), if any, and is sent after the ones published before it */
+    FIO_LS_EMBD_FOR(&ws->backlog, node) {
+      ws_backlog_s *old = FIO_LS_EMBD_OBJ(ws_backlog_s, node, node);
+      fio_str_info_s ch = fiobj_obj2cstr(old->channel);
+      if (old->sub != d || ch.len != msg->channel.len ||
+          memcmp(ch.data, msg->channel.data, ch.len))
+        continue;
+      fio_ls_embd_push(&dropped, &ws_backlog_remove(ws, old)->node);
+      break;
+    }
+  }
+  fio_ls_embd_push(&ws->backlog, &b->node);
+  ws->backlog_bytes += msg->msg.len;
+  /* drop the oldest messages (possibly including this one) */
+  while (ws->backlog_bytes > ws->max_queued && fio_ls_embd_any(&ws->backlog))
+    fio_ls_embd_push(&dropped,
+                     &ws_backlog_remove(ws, FIO_LS_EMBD_OBJ(ws_backlog_s, node,
+                                                            ws->backlog.next))
+                          ->node);
+  fio_unlock(&ws->backlog_lock);
+  while (fio_ls_embd_any(&dropped))
+    ws_backlog_free(
+        FIO_LS_EMBD_OBJ(ws_backlog_s, node, fio_ls_embd_shift(&dropped)));
+  return 1;
+}
+
+/* sends (or handles) a held back message, freeing it */
+static void websocket_backlog_send(ws_s *ws, ws_backlog_s *b) {
+  if (b->sub->unsubscribed) {
+    ws_backlog_free(b);
+    return;
+  }
+  if (b->txt == WS_BACKLOG_CALLBACK) {
+    b->sub->on_message(ws, fiobj_obj2cstr(b->channel), fiobj_obj2cstr(b->msg),
+                       b->sub->udata);
+  } else {
+    uint8_t txt = b->txt;
+    if (txt == 2) {
+      fio_str_info_s tmp = fiobj_obj2cstr(b->msg);
+      txt = (tmp.len >= (2 << 14) ? 0
+                                  : websocket_utf8_valid(tmp.data, tmp.len));
+    }
+    websocket_write_fiobj(ws, fiobj_dup(b->msg), txt);
+  }
+  ws_backlog_free(b);
+}
+
+/* sends a frame compressed once for all clients (websocket_optimize_deflate) */
+static void websocket_deflate_send_shared(ws_s *ws, FIOBJ frame) {
+  ws_deflate_s *d = ws->deflate;
+  fio_lock(&d->lock);
+#if HAVE_ZLIB
+  /* the client's window now holds data our compression state never saw */
+  if (d->deflate_ready)
+    deflateReset(&d->deflate);
+#endif
+  fiobj_send_free(ws->fd, fiobj_dup(frame));
+  fio_unlock(&d->lock);
+}
 
 static inline void websocket_on_pubsub_message_direct_internal(fio_msg_s *msg,
                                                                uint8_t txt) {
@@ -541,7 +1386,27 @@ static inline void websocket_on_pubsub_message_direct_internal(fio_msg_s *msg,
   }
   FIOBJ message = FIOBJ_INVALID;
   FIOBJ pre_wrapped = FIOBJ_INVALID;
-  if (!((ws_s *)pr)->is_client) {
+  ws_s *ws = (ws_s *)pr;
+  websocket_sub_data_s *d = msg->udata2;
+  if (ws->is_slow_closed ||
+      (ws->max_queued && websocket_throttle(ws, d, msg, txt)))
+    goto finish;
+  if (ws->deflate && msg->msg.len >= WEBSOCKET_DEFLATE_MIN) {
+    /* compressed frames were encoded with a 15 bit window, but back references
+     * can't be longer than the message */
+    if (ws->deflate->window == 15 ||
+        msg->msg.len <= ((size_t)1 << ws->deflate->window)) {
+      pre_wrapped = (FIOBJ)fio_message_metadata(
+          msg, (txt == 2 ? WEBSOCKET_OPTIMIZE_PUBSUB_DEFLATE
+                         : txt ? WEBSOCKET_OPTIMIZE_PUBSUB_TEXT_DEFLATE
+                               : WEBSOCKET_OPTIMIZE_PUBSUB_BINARY_DEFLATE));
+      if (pre_wrapped) {
+        websocket_deflate_send_shared(ws, pre_wrapped);
+        goto finish;
+      }
+    }
+    /* compress for this connection (see `websocket_write`) */
+  } else if (!((ws_s *)pr)->is_client) {
     /* pre-wrapping is only for client data */
     switch (txt) {
     case 0:
@@ -567,9 +1432,9 @@ static inline void websocket_on_pubsub_message_direct_internal(fio_msg_s *msg,
   }
   if (txt == 2) {
     /* unknown text state */
-    fio_str_s tmp =
-        FIO_STR_INIT_STATIC2(msg->msg.data, msg->msg.len); // don't free
-    txt = (tmp.len >= (2 << 14) ? 0 : fio_str_utf8_valid(&tmp));
+    txt = (msg->msg.len >= (2 << 14)
+               ? 0
+               : websocket_utf8_valid(msg->msg.data, msg->msg.len));
   }
   websocket_write((ws_s *)pr, msg->msg, txt & 1);
   fiobj_free(message);
@@ -599,28 +1464,20 @@ static void websocket_on_pubsub_message(fio_msg_s *msg) {
     return;
   }
   websocket_sub_data_s *d = msg->udata2;
-
+  ws_s *ws = (ws_s *)pr;
+  if (ws->is_slow_closed ||
+      (ws->max_queued && websocket_throttle(ws, d, msg, WS_BACKLOG_CALLBACK)))
+    goto finish;
   if (d->on_message)
-    d->on_message((ws_s *)pr, msg->channel, msg->msg, d->udata);
+    d->on_message(ws, msg->channel, msg->msg, d->udata);
+finish:
   fio_protocol_unlock(pr, FIO_PR_LOCK_TASK);
 }
 
 static void websocket_on_unsubscribe(void *u1, void *u2) {
   websocket_sub_data_s *d = u2;
-  if (d->on_unsubscribe) {
-    d->on_unsubscribe(d->udata);
-  }
-
-  if ((intptr_t)d->on_message == (intptr_t)WEBSOCKET_OPTIMIZE_PUBSUB) {
-    websocket_optimize4broadcasts(WEBSOCKET_OPTIMIZE_PUBSUB, 0);
-  } else if ((intptr_t)d->on_message ==
-             (intptr_t)WEBSOCKET_OPTIMIZE_PUBSUB_TEXT) {
-    websocket_optimize4broadcasts(WEBSOCKET_OPTIMIZE_PUBSUB_TEXT, 0);
-  } else if ((intptr_t)d->on_message ==
-             (intptr_t)WEBSOCKET_OPTIMIZE_PUBSUB_BINARY) {
-    websocket_optimize4broadcasts(WEBSOCKET_OPTIMIZE_PUBSUB_BINARY, 0);
-  }
-  free(d);
+  d->unsubscribed = 1;
+  websocket_sub_data_free(d);
   (void)u1;
 }
 
@@ -637,6 +1494,7 @@ uintptr_t websocket_subscribe(struct websocket_subscribe_s args) {
       .udata = args.udata,
       .on_message = args.on_message,
       .on_unsubscribe = args.on_unsubscribe,
+      .ref = 1,
   };
   void (*handler)(fio_msg_s *) = websocket_on_pubsub_message;
   if (!args.on_message) {
@@ -652,6 +1510,11 @@ uintptr_t websocket_subscribe(struct websocket_subscribe_s args) {
       handler = websocket_on_pubsub_message_direct;
     }
     websocket_optimize4broadcasts(br_type, 1);
+    if (args.ws->deflate) {
+      /* the `_DEFLATE` variants follow their uncompressed counterparts */
+      d->deflate_type = br_type - 3;
+      websocket_optimize4broadcasts(d->deflate_type, 1);
+    }
     d->on_message =
         (void (*)(ws_s *, fio_str_info_s, fio_str_info_s, void *))br_type;
   }
@@ -716,12 +1579,42 @@ uint8_t websocket_is_client(ws_s *ws) { return ws->is_client; }
 /** Writes data to the websocket. Returns -1 on failure (0 on success). */
 int websocket_write(ws_s *ws, fio_str_info_s msg, uint8_t is_text) {
   if (fio_is_valid(ws->fd)) {
+    if (ws->deflate && msg.len >= WEBSOCKET_DEFLATE_MIN &&
+        !websocket_deflate_write(ws, msg, is_text))
+      return 0;
     websocket_write_impl(ws->fd, msg.data, msg.len, is_text, 1, 1,
-                         ws->is_client);
+                         ws->is_client, 0);
     return 0;
   }
   return -1;
 }
+
+/**
+ * Writes a String object to the websocket without copying it (server
+ * connections only).
+ */
+int websocket_write_fiobj(ws_s *ws, FIOBJ msg, uint8_t is_text) {
+  fio_str_info_s s = fiobj_obj2cstr(msg);
+  if (ws->is_client || (ws->deflate && s.len >= WEBSOCKET_DEFLATE_MIN)) {
+    int ret = websocket_write(ws, s, is_text);
+    fiobj_free(msg);
+    return ret;
+  }
+  if (!fio_is_valid(ws->fd)) {
+    fiobj_free(msg);
+    return -1;
+  }
+  websocket_write_str(ws->fd, msg, is_text, 0);
+  return 0;
+}
+/**
+ * Returns the number of bytes waiting to be sent to the client, including
+ * pub/sub messages held back by a slow consumer policy.
+ */
+size_t websocket_queued(ws_s *ws) {
+  return fio_pending_bytes(ws->fd) + ws->backlog_bytes;
+}
+
 /** Closes a websocket connection. */
 void websocket_close(ws_s *ws) {
   fio_write2(ws->fd, .data.buffer = "\x88\x00", .length = 2,
@@ -729,3 +1622,569 @@ void websocket_close(ws_s *ws) {
   fio_close(ws->fd);
   return;
 }
+
+/* *****************************************************************************
+Tests
+***************************************************************************** */
+#if DEBUG
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* the tested connection and the messages (or chunks) it received */
+static ws_s *ws_test_ws;
+static intptr_t ws_test_uuid = -1;
+static FIOBJ ws_test_received;
+/* data the peer read, but didn't consume yet */
+static FIOBJ ws_test_incoming;
+
+static void ws_test_on_open(ws_s *ws) {
+  ws_test_ws = ws;
+  ws_test_uuid = ws->fd;
+}
+
+static void ws_test_on_message(ws_s *ws, fio_str_info_s msg, uint8_t is_text) {
+  fiobj_ary_push(ws_test_received, fiobj_str_new(msg.data, msg.len));
+  (void)ws;
+  (void)is_text;
+}
+
+/* chunks are recorded with their `first` and `last` flags as a prefix */
+static void ws_test_on_chunk(ws_s *ws, fio_str_info_s chunk, uint8_t first,
+                             uint8_t last, uint8_t is_text) {
+  FIOBJ rec = fiobj_str_buf(chunk.len + 2);
+  fiobj_str_write(rec, first ? "F" : "-", 1);
+  fiobj_str_write(rec, last ? "L" : "-", 1);
+  fiobj_str_write(rec, chunk.data, chunk.len);
+  fiobj_ary_push(ws_test_received, rec);
+  (void)ws;
+  (void)is_text;
+}
+
+/* performs the pending tasks (events and writes) without a running reactor */
+static void ws_test_cycle(void) {
+  for (size_t i = 0; i < 8; ++i) {
+    /* the reactor would report a drained queue */
+    fio_force_event(ws_test_uuid, FIO_EVENT_ON_READY);
+    fio_defer_perform();
+    fio_flush_all();
+  }
+}
+
+/* attaches a WebSocket to one end of a socket pair, returning the other end */
+static int ws_test_open(websocket_settings_s *args, uint8_t deflate,
+                        size_t max_msg_size) {
+  int sv[2];
+  FIO_ASSERT(!socketpair(AF_UNIX, SOCK_STREAM, 0, sv),
+             "couldn't create a socket pair for WebSocket testing");
+  fio_set_non_block(sv[0]);
+  fio_set_non_block(sv[1]);
+  http_settings_s settings = {.ws_max_msg_size = max_msg_size,
+                              .ws_timeout = 40};
+  ws_test_ws = NULL;
+  ws_test_uuid = -1;
+  ws_test_received = fiobj_ary_new();
+  ws_test_incoming = fiobj_str_buf(0);
+  websocket_attach(fio_fd2uuid(sv[0]), &settings, args, NULL, 0, deflate);
+  ws_test_cycle();
+  FIO_ASSERT(ws_test_ws, "WebSocket test connection wasn't opened");
+  return sv[1];
+}
+
+/* the connection might have been closed (and freed) by the test */
+static void ws_test_close(int peer) {
+  fio_force_close(ws_test_uuid);
+  ws_test_cycle();
+  close(peer);
+  fiobj_free(ws_test_received);
+  fiobj_free(ws_test_incoming);
+  ws_test_ws = NULL;
+  ws_test_uuid = -1;
+}
+
+/* the peer writes raw data, which the WebSocket then reads */
+static void ws_test_send(int peer, const void *data, size_t len) {
+  FIO_ASSERT(write(peer, data, len) == (ssize_t)len,
+             "WebSocket test peer couldn't write");
+  /* the reactor isn't running, so the data event is forced */
+  fio_force_event(ws_test_uuid, FIO_EVENT_ON_DATA);
+  ws_test_cycle();
+}
+
+/* the peer wraps and writes a (masked) frame */
+static void ws_test_send_frame(int peer, fio_str_info_s payload,
+                               uint8_t opcode, uint8_t first, uint8_t last,
+                               uint8_t rsv) {
+  char *buf = malloc(payload.len + 16);
+  FIO_ASSERT_ALLOC(buf);
+  ws_test_send(peer, buf,
+               websocket_client_wrap(buf, payload.data, payload.len, opcode,
+                                     first, last, rsv));
+  free(buf);
+}
+
+/* the peer reads the next (unmasked) frame, returning its payload */
+static FIOBJ ws_test_recv(int peer, uint8_t *head) {
+  for (size_t i = 0; i < 256; ++i) {
+    fio_str_info_s in = fiobj_obj2cstr(ws_test_incoming);
+    struct websocket_packet_info_s info =
+        websocket_buffer_peek(in.data, in.len);
+    if (info.head_length && in.len >= 2 &&
+        in.len >= info.head_length + info.packet_length) {
+      FIOBJ ret =
+          fiobj_str_new(in.data + info.head_length, info.packet_length);
+      if (head)
+        *head = (uint8_t)in.data[0];
+      in.len -= info.head_length + info.packet_length;
+      memmove(in.data, in.data + info.head_length + info.packet_length, in.len);
+      fiobj_str_resize(ws_test_incoming, in.len);
+      return ret;
+    }
+    char tmp[4096];
+    ws_test_cycle();
+    ssize_t r = read(peer, tmp, sizeof(tmp));
+    if (r > 0)
+      fiobj_str_write(ws_test_incoming, tmp, r);
+    else
+      fio_reschedule_thread();
+  }
+  FIO_ASSERT(0, "WebSocket test peer didn't receive a frame");
+  return FIOBJ_INVALID;
+}
+
+/* the message (or chunk) the WebSocket received, by order of arrival */
+static fio_str_info_s ws_test_received_at(size_t index) {
+  FIO_ASSERT((size_t)fiobj_ary_count(ws_test_received) > index,
+             "WebSocket message %zu wasn't received", index);
+  return fiobj_obj2cstr(fiobj_ary_index(ws_test_received, index));
+}
+
+static void websocket_message_test(void) {
+  fprintf(stderr, "* testing WebSocket messages.\n");
+  websocket_settings_s args = {.on_open = ws_test_on_open,
+                               .on_message = ws_test_on_message};
+  int peer = ws_test_open(&args, 0, 1 << 20);
+  ws_test_send_frame(peer, (fio_str_info_s){.data = "Hello", .len = 5}, 1, 1,
+                     1, 0);
+  ws_test_send_frame(peer, (fio_str_info_s){.data = "Hello ", .len = 6}, 1, 1,
+                     0, 0);
+  ws_test_send_frame(peer, (fio_str_info_s){.data = "World", .len = 5}, 1, 0,
+                     1, 0);
+  FIO_ASSERT(ws_test_received_at(0).len == 5 &&
+                 !memcmp(ws_test_received_at(0).data, "Hello", 5),
+             "WebSocket message error");
+  FIO_ASSERT(ws_test_received_at(1).len == 11 &&
+                 !memcmp(ws_test_received_at(1).data, "Hello World", 11),
+             "fragmented WebSocket message error");
+  websocket_write(ws_test_ws, (fio_str_info_s){.data = "Hi", .len = 2}, 1);
+  uint8_t head = 0;
+  FIOBJ frame = ws_test_recv(peer, &head);
+  FIO_ASSERT(head == 0x81 && fiobj_obj2cstr(frame).len == 2 &&
+                 !memcmp(fiobj_obj2cstr(frame).data, "Hi", 2),
+             "WebSocket write error");
+  fiobj_free(frame);
+  ws_test_close(peer);
+}
+
+static void websocket_stream_test(void) {
+  fprintf(stderr, "* testing streamed WebSocket messages.\n");
+  const size_t len = 10000;
+  char *payload = malloc(len);
+  char *frame = malloc(len + 16);
+  FIO_ASSERT_ALLOC(payload && frame);
+  for (size_t i = 0; i < len; ++i)
+    payload[i] = 'a' + (char)(i % 23);
+  /* frames that don't fit the buffer are streamed, ignoring ws_max_msg_size */
+  websocket_settings_s args = {.on_open = ws_test_on_open,
+                               .on_message_chunk = ws_test_on_chunk};
+  int peer = ws_test_open(&args, 0, 1024);
+  const size_t frame_len =
+      websocket_client_wrap(frame, payload, len, 2, 1, 1, 0);
+  /* the header arrives in parts (the first read ends before the mask) and the
+   * payload in odd sized parts, so the mask is rotated between reads */
+  static const size_t parts[] = {3, 3, 1, 5, 7, 1000, 3};
+  for (size_t i = 0, pos = 0; pos < frame_len; ++i) {
+    size_t n = (i < sizeof(parts) / sizeof(parts[0]) ? parts[i] : 3001);
+    if (n > frame_len - pos)
+      n = frame_len - pos;
+    ws_test_send(peer, frame + pos, n);
+    pos += n;
+  }
+  /* a frame that fits the buffer is a single chunk */
+  ws_test_send_frame(peer, (fio_str_info_s){.data = "Hello", .len = 5}, 1, 1,
+                     1, 0);
+  const size_t count = (size_t)fiobj_ary_count(ws_test_received);
+  FIO_ASSERT(count > 2, "large frames should be streamed in chunks");
+  FIOBJ collected = fiobj_str_buf(len);
+  for (size_t i = 0; i + 1 < count; ++i) {
+    fio_str_info_s c = ws_test_received_at(i);
+    FIO_ASSERT(c.len >= 2 && c.data[0] == (i ? '-' : 'F') &&
+                   c.data[1] == (i + 2 == count ? 'L' : '-'),
+               "streamed chunk %zu flags error", i);
+    fiobj_str_write(collected, c.data + 2, c.len - 2);
+  }
+  FIO_ASSERT(fiobj_obj2cstr(collected).len == len &&
+                 !memcmp(fiobj_obj2cstr(collected).data, payload, len),
+             "streamed message error");
+  FIO_ASSERT(ws_test_received_at(count - 1).len == 7 &&
+                 !memcmp(ws_test_received_at(count - 1).data, "FLHello", 7),
+             "a frame that fits the buffer should be a single chunk");
+  fiobj_free(collected);
+  ws_test_close(peer);
+#if HAVE_ZLIB
+  /* compressed messages are inflated and delivered in a single chunk */
+  peer = ws_test_open(&args, 15, 1 << 20);
+  {
+    z_stream z;
+    memset(&z, 0, sizeof(z));
+    FIO_ASSERT(deflateInit2(&z, WEBSOCKET_DEFLATE_LEVEL, Z_DEFLATED, -15, 8,
+                            Z_DEFAULT_STRATEGY) == Z_OK,
+               "couldn't initialize the test's compression");
+    FIOBJ compressed =
+        ws_deflate_message(&z, (fio_str_info_s){.data = payload, .len = len});
+    deflateEnd(&z);
+    fio_str_info_s p = fiobj_obj2cstr(compressed);
+    ws_test_send_frame(peer,
+                       (fio_str_info_s){.data = p.data, .len = p.len >> 1}, 2,
+                       1, 0, 4);
+    ws_test_send_frame(peer,
+                       (fio_str_info_s){.data = p.data + (p.len >> 1),
+                                        .len = p.len - (p.len >> 1)},
+                       2, 0, 1, 0);
+    fiobj_free(compressed);
+  }
+  FIO_ASSERT(fiobj_ary_count(ws_test_received) == 1 &&
+                 ws_test_received_at(0).len == len + 2 &&
+                 !memcmp(ws_test_received_at(0).data, "FL", 2) &&
+                 !memcmp(ws_test_received_at(0).data + 2, payload, len),
+             "compressed messages should be delivered in a single chunk");
+  ws_test_close(peer);
+#endif
+  free(frame);
+  free(payload);
+}
+
+static size_t ws_test_slow_count;
+static void ws_test_on_slow(ws_s *ws, fio_str_info_s channel, size_t queued) {
+  ++ws_test_slow_count;
+  (void)ws;
+  (void)channel;
+  (void)queued;
+}
+
+/* an `on_message` subscription callback that forwards the message */
+static void ws_test_on_pubsub(ws_s *ws, fio_str_info_s channel,
+                              fio_str_info_s msg, void *udata) {
+  websocket_write(ws, msg, 1);
+  (void)channel;
+  (void)udata;
+}
+
+static void websocket_slow_test(void) {
+  fprintf(stderr, "* testing slow consumer policies.\n");
+  static const struct {
+    websocket_slow_policy_e policy;
+    /* if set, the subscriptions use an `on_message` callback */
+    uint8_t callback;
+    /* a message is published to each channel (named by a single letter) */
+    const char *published;
+    /* the messages sent after the queue was drained (NULL if closed) */
+    const char *expected;
+  } cases[] = {
+      {WEBSOCKET_SLOW_DROP_OLDEST, 0, "aaaa", "a2a3"},
+      /* the limit is shared by the connection's subscriptions */
+      {WEBSOCKET_SLOW_DROP_OLDEST, 0, "abab", "a2b3"},
+      {WEBSOCKET_SLOW_DROP_OLDEST, 1, "abab", "a2b3"},
+      {WEBSOCKET_SLOW_COALESCE, 0, "abab", "a2b3"},
+      {WEBSOCKET_SLOW_COALESCE, 0, "aba", "b1a2"},
+      {WEBSOCKET_SLOW_COALESCE, 1, "aba", "b1a2"},
+      {WEBSOCKET_SLOW_DISCONNECT, 0, "a", NULL},
+      {WEBSOCKET_SLOW_DISCONNECT, 1, "a", NULL},
+  };
+  const size_t big_len = 1 << 16;
+  char *big = malloc(big_len);
+  FIO_ASSERT_ALLOC(big);
+  memset(big, 'x', big_len);
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    websocket_settings_s args = {.on_open = ws_test_on_open,
+                                 .on_message = ws_test_on_message,
+                                 .max_queued = 250,
+                                 .slow_policy = cases[i].policy,
+                                 .on_slow = ws_test_on_slow};
+    int peer = ws_test_open(&args, 0, 1 << 20);
+    ws_test_slow_count = 0;
+    websocket_subscribe(
+        (struct websocket_subscribe_s){
+            .ws = ws_test_ws,
+            .channel = {.data = (char *)"a", .len = 1},
+            .on_message = (cases[i].callback ? ws_test_on_pubsub : NULL),
+        });
+    websocket_subscribe(
+        (struct websocket_subscribe_s){
+            .ws = ws_test_ws,
+            .channel = {.data = (char *)"b", .len = 1},
+            .on_message = (cases[i].callback ? ws_test_on_pubsub : NULL),
+        });
+    /* the client stops reading while a large message is sent, followed by a
+     * small one that's still queued */
+    int buffer_size = 4096;
+    setsockopt(fio_uuid2fd(ws_test_uuid), SOL_SOCKET, SO_SNDBUF, &buffer_size,
+               sizeof(buffer_size));
+    setsockopt(peer, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
+    websocket_write(ws_test_ws,
+                    (fio_str_info_s){.data = big, .len = big_len}, 0);
+    websocket_write(ws_test_ws, (fio_str_info_s){.data = big, .len = 10}, 0);
+    ws_test_cycle();
+    FIO_ASSERT(websocket_queued(ws_test_ws) > 250,
+               "WebSocket test queue should be clogged");
+    /* 100 byte messages (named by their channel and index) */
+    for (size_t j = 0; cases[i].published[j]; ++j) {
+      char msg[100];
+      memset(msg, ' ', sizeof(msg));
+      msg[0] = cases[i].published[j];
+      msg[1] = '0' + (char)j;
+      fio_publish(.channel = {.data = msg, .len = 1},
+                  .message = {.data = msg, .len = sizeof(msg)},
+                  .engine = FIO_PUBSUB_PROCESS);
+      ws_test_cycle();
+    }
+    FIO_ASSERT(ws_test_slow_count == strlen(cases[i].published),
+               "on_slow should be called for every message (%zu)", i);
+    /* the client catches up */
+    FIOBJ names = fiobj_str_buf(0);
+    size_t big_read = 0;
+    uint16_t close_code = 0;
+    while (!close_code && (big_read < big_len + 10 ||
+                           fiobj_obj2cstr(names).len <
+                               strlen(cases[i].expected ? cases[i].expected
+                                                        : ""))) {
+      uint8_t head = 0;
+      FIOBJ frame = ws_test_recv(peer, &head);
+      fio_str_info_s f = fiobj_obj2cstr(frame);
+      if ((head & 15) == 8 && f.len == 2)
+        close_code =
+            (uint16_t)(((uint8_t)f.data[0] << 8) | (uint8_t)f.data[1]);
+      else if ((head & 15) == 1)
+        fiobj_str_write(names, f.data, 2);
+      else
+        big_read += f.len;
+      fiobj_free(frame);
+    }
+    if (cases[i].expected) {
+      FIO_ASSERT(big_read == big_len + 10 &&
+                     !strcmp(fiobj_obj2cstr(names).data, cases[i].expected),
+                 "slow consumer policy error (%zu): %s", i,
+                 fiobj_obj2cstr(names).data);
+      FIO_ASSERT(!websocket_queued(ws_test_ws),
+                 "held back messages should have been sent (%zu)", i);
+    } else {
+      /* the frame being sent is completed (the close frame may follow any
+       * fragment), the queued frames are dropped */
+      FIO_ASSERT(close_code == 1008 && !fiobj_obj2cstr(names).len &&
+                     big_read < big_len,
+                 "slow consumers should be disconnected (1008 != %u)",
+                 (unsigned)close_code);
+      ssize_t r = -1;
+      for (size_t j = 0; r && j < 256; ++j) {
+        char tmp[512];
+        ws_test_cycle();
+        r = read(peer, tmp, sizeof(tmp));
+        if (r > 0)
+          fiobj_str_write(ws_test_incoming, tmp, r);
+        else if (r)
+          fio_reschedule_thread();
+      }
+      FIO_ASSERT(!r && !fiobj_obj2cstr(ws_test_incoming).len,
+                 "slow consumers should be closed after the close frame");
+    }
+    fiobj_free(names);
+    ws_test_close(peer);
+  }
+  free(big);
+}
+
+/* compares the SIMD kernels (if any) with the portable implementation */
+static void websocket_simd_test(void) {
+  const int max_level = websocket_simd_level();
+  fprintf(stderr, "* testing the unmasking / UTF-8 kernels (level %d).\n",
+          max_level);
+  uint8_t buf[320], expected[320];
+  const uint32_t mask = 0x9A3C51E7;
+  for (int level = 0; level <= max_level; ++level) {
+    websocket_simd_level_detected = level;
+    /* every alignment, lengths that aren't a multiple of the block sizes */
+    for (size_t offset = 0; offset < 8; ++offset) {
+      for (size_t len = 0; len + offset <= sizeof(buf); ++len) {
+        for (size_t i = 0; i < sizeof(buf); ++i)
+          buf[i] = expected[i] = (uint8_t)(i * 7);
+        websocket_xmask(buf + offset, len, mask);
+        for (size_t i = 0; i < len; ++i)
+          expected[offset + i] ^= ((uint8_t *)&mask)[i & 3];
+        FIO_ASSERT(!memcmp(buf, expected, sizeof(buf)),
+                   "websocket_xmask error (level %d, offset %zu, len %zu)",
+                   level, offset, len);
+      }
+    }
+  }
+  static const struct {
+    const char *str;
+    int valid;
+  } samples[] = {
+      {"\xC3\xA9", 1},             {"\xE2\x82\xAC", 1},
+      {"\xF0\x9F\x98\x80", 1},     {"\xF4\x8F\xBF\xBF", 1},
+      {"\xC0\xAF", 0},             {"\xE0\x80\xAF", 0},
+      {"\xED\xA0\x80", 0},         {"\xF4\x90\x80\x80", 0},
+      {"\xF0\x9F\x98\x80\x80", 0}, {"\xF0\x9F\x98", 0},
+  };
+  for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+    const size_t len = strlen(samples[i].str);
+    /* the sequence crosses the 16 / 32 byte block boundaries, the data ends
+     * with the sequence, right after it, or in the middle of a block */
+    for (size_t offset = 12; offset < 68; ++offset) {
+      const size_t ends[] = {offset + len, offset + len + 1, 96 + 13};
+      memset(buf, 'x', sizeof(buf));
+      memcpy(buf + offset, samples[i].str, len);
+      for (size_t e = 0; e < sizeof(ends) / sizeof(ends[0]); ++e) {
+        websocket_simd_level_detected = 0;
+        const int reference = websocket_utf8_valid(buf, ends[e]);
+        FIO_ASSERT(reference == samples[i].valid,
+                   "UTF-8 validation error (sample %zu @ %zu)", i, offset);
+        for (int level = 1; level <= max_level; ++level) {
+          websocket_simd_level_detected = level;
+          FIO_ASSERT(websocket_utf8_valid(buf, ends[e]) == reference,
+                     "UTF-8 kernel %d disagrees (sample %zu @ %zu, len %zu)",
+                     level, i, offset, ends[e]);
+        }
+      }
+    }
+  }
+  /* random multibyte text, with (and without) a corrupted byte */
+  for (size_t round = 0; round < 512; ++round) {
+    size_t len = 0;
+    const size_t limit = 33 + (fio_rand64() % 260);
+    while (len + 4 <= limit) {
+      const char *ch[] = {"a", "\xC3\xA9", "\xE2\x82\xAC",
+                          "\xF0\x9F\x98\x80"};
+      const char *c = ch[fio_rand64() & 3];
+      memcpy(buf + len, c, strlen(c));
+      len += strlen(c);
+    }
+    if (round & 1)
+      buf[fio_rand64() % len] = (uint8_t)fio_rand64();
+    websocket_simd_level_detected = 0;
+    const int reference = websocket_utf8_valid(buf, len);
+    FIO_ASSERT((round & 1) || reference, "UTF-8 validation error (random)");
+    for (int level = 1; level <= max_level; ++level) {
+      websocket_simd_level_detected = level;
+      FIO_ASSERT(websocket_utf8_valid(buf, len) == reference,
+                 "UTF-8 kernel %d disagrees (random, len %zu)", level, len);
+    }
+  }
+  websocket_simd_level_detected = max_level;
+}
+
+#if HAVE_ZLIB
+static void websocket_deflate_test(void) {
+  fprintf(stderr, "* testing permessage-deflate messages.\n");
+  char msg[512];
+  for (size_t i = 0; i < sizeof(msg); ++i)
+    msg[i] = "permessage-deflate "[i % 19] + (char)((i / 76) & 1);
+  websocket_settings_s args = {.on_open = ws_test_on_open,
+                               .on_message = ws_test_on_message};
+  int peer = ws_test_open(&args, 15, 1 << 20);
+
+  /* the peer's compression state is kept between messages */
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  FIO_ASSERT(deflateInit2(&z, WEBSOCKET_DEFLATE_LEVEL, Z_DEFLATED, -15, 8,
+                          Z_DEFAULT_STRATEGY) == Z_OK,
+             "couldn't initialize the test's compression");
+  FIOBJ payload =
+      ws_deflate_message(&z, (fio_str_info_s){.data = msg, .len = 300});
+  ws_test_send_frame(peer, fiobj_obj2cstr(payload), 1, 1, 1, 4);
+  fiobj_free(payload);
+  /* a fragmented message, compressed using the previous message's context */
+  payload = ws_deflate_message(&z, (fio_str_info_s){.data = msg, .len = 400});
+  fio_str_info_s p = fiobj_obj2cstr(payload);
+  ws_test_send_frame(peer, (fio_str_info_s){.data = p.data, .len = p.len >> 1},
+                     1, 1, 0, 4);
+  ws_test_send_frame(peer,
+                     (fio_str_info_s){.data = p.data + (p.len >> 1),
+                                      .len = p.len - (p.len >> 1)},
+                     1, 0, 1, 0);
+  fiobj_free(payload);
+  deflateEnd(&z);
+  FIO_ASSERT(ws_test_received_at(0).len == 300 &&
+                 !memcmp(ws_test_received_at(0).data, msg, 300),
+             "compressed WebSocket message error");
+  FIO_ASSERT(ws_test_received_at(1).len == 400 &&
+                 !memcmp(ws_test_received_at(1).data, msg, 400),
+             "fragmented compressed WebSocket message error");
+  FIO_ASSERT(ws_test_ws->deflate->inflated,
+             "the decompression buffer should be kept for small messages");
+  {
+    /* a large message, the decompression buffer shouldn't be kept */
+    const size_t big_len = WEBSOCKET_INFLATE_KEEP * 2 + 7;
+    char *big = malloc(big_len);
+    FIO_ASSERT_ALLOC(big);
+    for (size_t i = 0; i < big_len; ++i)
+      big[i] = msg[i % sizeof(msg)];
+    z_stream tmp;
+    memset(&tmp, 0, sizeof(tmp));
+    FIO_ASSERT(deflateInit2(&tmp, WEBSOCKET_DEFLATE_LEVEL, Z_DEFLATED, -15, 8,
+                            Z_DEFAULT_STRATEGY) == Z_OK,
+               "couldn't initialize the test's compression");
+    payload = ws_deflate_message(
+        &tmp, (fio_str_info_s){.data = big, .len = big_len});
+    ws_test_send_frame(peer, fiobj_obj2cstr(payload), 1, 1, 1, 4);
+    fiobj_free(payload);
+    deflateEnd(&tmp);
+    FIO_ASSERT(ws_test_received_at(2).len == big_len &&
+                   !memcmp(ws_test_received_at(2).data, big, big_len),
+               "large compressed WebSocket message error");
+    FIO_ASSERT(!ws_test_ws->deflate->inflated,
+               "the decompression buffer should be released after a large "
+               "message");
+    free(big);
+  }
+
+  /* a broadcast frame (compressed on its own) between context takeover
+   * messages: the peer's window holds data the connection's state never saw */
+  ws_s client = {.max_msg_size = 1 << 20};
+  client.deflate = calloc(1, sizeof(*client.deflate));
+  FIO_ASSERT_ALLOC(client.deflate);
+  websocket_write(ws_test_ws, (fio_str_info_s){.data = msg, .len = 300}, 1);
+  fio_msg_metadata_s meta = websocket_optimize_deflate(
+      (fio_str_info_s){.data = msg + 100, .len = 400}, 1,
+      WEBSOCKET_OPTIMIZE_PUBSUB_TEXT_DEFLATE);
+  FIO_ASSERT(meta.metadata, "broadcast compression error");
+  websocket_deflate_send_shared(ws_test_ws, (FIOBJ)meta.metadata);
+  meta.on_finish(NULL, meta.metadata);
+  websocket_write(ws_test_ws, (fio_str_info_s){.data = msg, .len = 300}, 1);
+  for (size_t i = 0; i < 3; ++i) {
+    const size_t offset = (i == 1 ? 100 : 0), len = (i == 1 ? 400 : 300);
+    uint8_t head = 0;
+    FIOBJ frame = ws_test_recv(peer, &head);
+    fio_str_info_s data;
+    FIO_ASSERT((head & 0xF0) == 0xC0 &&
+                   !ws_inflate_message(&client, fiobj_obj2cstr(frame), &data),
+               "compressed WebSocket frame %zu error", i);
+    FIO_ASSERT(data.len == len && !memcmp(data.data, msg + offset, len),
+               "compressed WebSocket frame %zu didn't inflate correctly", i);
+    fiobj_free(frame);
+  }
+  ws_deflate_free(client.deflate);
+  ws_test_close(peer);
+}
+#endif
+
+void websocket_tests(void) {
+  fprintf(stderr, "=== Testing WebSocket connections\n");
+  websocket_message_test();
+  websocket_stream_test();
+  websocket_slow_test();
+  websocket_simd_test();
+#if HAVE_ZLIB
+  websocket_deflate_test();
+#endif
+}
+#endif
@@ -14,9 +14,61 @@ Feel free to copy, use and enjoy according to the license provided.
 extern "C" {
 #endif
 
+/* *****************************************************************************
+Compile Time Settings
+***************************************************************************** */
+
+#ifndef WEBSOCKET_DEFLATE_MIN
+/**
+ * When `permessage-deflate` was negotiated (see `ws_compress`), messages
+ * shorter than this are sent uncompressed.
+ */
+#define WEBSOCKET_DEFLATE_MIN 128
+#endif
+
+#ifndef WEBSOCKET_DEFLATE_LEVEL
+/** The `permessage-deflate` compression level (1-9). */
+#define WEBSOCKET_DEFLATE_LEVEL 6
+#endif
+
+#ifndef WEBSOCKET_ZERO_COPY_MIN
+/**
+ * Server messages held by a String (see `websocket_write_fiobj`) are sent by
+ * reference, instead of being copied, when they are at least this long.
+ *
+ * Shorter messages are cheaper to copy than to queue as a separate header.
+ */
+#define WEBSOCKET_ZERO_COPY_MIN 1024
+#endif
+
+#ifndef WEBSOCKET_INFLATE_KEEP
+/**
+ * The `permessage-deflate` decompression buffer is released after a message
+ * grows it beyond this size (in bytes), so a single large message doesn't
+ * hold on to the memory for the connection's lifetime.
+ */
+#define WEBSOCKET_INFLATE_KEEP 65536
+#endif
+
+#ifndef WEBSOCKET_SLOW_CLOSE_TIMEOUT
+/**
+ * The time (in milliseconds) `WEBSOCKET_SLOW_DISCONNECT` waits for the frame
+ * being sent (and the close frame) before closing the connection anyway.
+ */
+#define WEBSOCKET_SLOW_CLOSE_TIMEOUT 1000
+#endif
+
+/**
+ * used internally: negotiates the `permessage-deflate` extension, setting the
+ * response header. Returns the configuration for `websocket_attach` (0 if the
+ * extension wasn't negotiated).
+ */
+uint8_t websocket_deflate_negotiate(http_s *h, http_settings_s *http_settings);
+
 /** used internally: attaches the Websocket protocol to the socket. */
 void websocket_attach(intptr_t uuid, http_settings_s *http_settings,
-                      websocket_settings_s *args, void *data, size_t length);
+                      websocket_settings_s *args, void *data, size_t length,
+                      uint8_t deflate);
 
 /* *****************************************************************************
 Websocket information
@@ -53,9 +105,25 @@ Websocket Connection Management (write / close)
 
 /** Writes data to the websocket. Returns -1 on failure (0 on success). */
 int websocket_write(ws_s *ws, fio_str_info_s msg, uint8_t is_text);
+/**
+ * Writes a String object to the websocket without copying it (server
+ * connections only, client messages must be masked).
+ *
+ * The reference to `msg` is consumed (`fiobj_free` is called once the data was
+ * sent), use `fiobj_dup` to keep the object.
+ *
+ * Returns -1 on failure (0 on success).
+ */
+int websocket_write_fiobj(ws_s *ws, FIOBJ msg, uint8_t is_text);
 /** Closes a websocket connection. */
 void websocket_close(ws_s *ws);
 
+/**
+ * Returns the number of bytes waiting to be sent to the client, including
+ * pub/sub messages held back by a slow consumer policy.
+ */
+size_t websocket_queued(ws_s *ws);
+
 /* *****************************************************************************
 Websocket Pub/Sub
 =================
@@ -148,6 +216,12 @@ void websocket_unsubscribe(ws_s *ws, uintptr_t subscription_id);
 #define WEBSOCKET_OPTIMIZE_PUBSUB_TEXT (-33)
 /** Optimize binary broadcasts, for use in websocket_optimize4broadcasts. */
 #define WEBSOCKET_OPTIMIZE_PUBSUB_BINARY (-34)
+/** Compress generic broadcasts once (for `permessage-deflate` clients). */
+#define WEBSOCKET_OPTIMIZE_PUBSUB_DEFLATE (-35)
+/** Compress text broadcasts once (for `permessage-deflate` clients). */
+#define WEBSOCKET_OPTIMIZE_PUBSUB_TEXT_DEFLATE (-36)
+/** Compress binary broadcasts once (for `permessage-deflate` clients). */
+#define WEBSOCKET_OPTIMIZE_PUBSUB_BINARY_DEFLATE (-37)
 
 /**
  * Enables (or disables) broadcast optimizations.
@@ -162,6 +236,10 @@ void websocket_unsubscribe(ws_s *ws, uintptr_t subscription_id);
  *                               best attempt to detect Text vs. Binary data.
  * * WEBSOCKET_OPTIMIZE_PUBSUB_TEXT - optimize direct pub/sub text messages.
  * * WEBSOCKET_OPTIMIZE_PUBSUB_BINARY - optimize direct pub/sub binary messages.
+ * * WEBSOCKET_OPTIMIZE_PUBSUB_DEFLATE (and the `_TEXT_DEFLATE` and
+ *   `_BINARY_DEFLATE` variants) - compress direct pub/sub messages once, for
+ *   all the connections that negotiated `permessage-deflate` (messages shorter
+ *   than `WEBSOCKET_DEFLATE_MIN` have no compressed variant).
  *
  * Note: to disable an optimization it should be disabled the same amount of
  * times it was enabled - multiple optimization enablements for the same type
@@ -178,6 +256,10 @@ void websocket_unsubscribe(ws_s *ws, uintptr_t subscription_id);
  */
 void websocket_optimize4broadcasts(intptr_t type, int enable);
 
+#if DEBUG
+void websocket_tests(void);
+#endif
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
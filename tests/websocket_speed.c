@@ -0,0 +1,168 @@
+/*
+This program compares the WebSocket unmasking and UTF-8 validation kernels
+(portable, SSE2 and AVX2) and checks that they agree.
+
+Compile with (from the repository's root folder):
+
+    gcc -O2 -Ilib/facil/http/parsers tests/websocket_speed.c -o /tmp/ws_speed
+
+use: ws_speed [payload size in bytes (default 65536)]
+*/
+#include <websocket_parser.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* the parser's callbacks aren't used here */
+static void websocket_on_unwrapped(void *udata, void *msg, uint64_t len,
+                                   char first, char last, char text,
+                                   unsigned char rsv) {
+  (void)udata, (void)msg, (void)len, (void)first, (void)last, (void)text,
+      (void)rsv;
+}
+static void websocket_on_protocol_ping(void *udata, void *msg, uint64_t len) {
+  (void)udata, (void)msg, (void)len;
+}
+static void websocket_on_protocol_pong(void *udata, void *msg, uint64_t len) {
+  (void)udata, (void)msg, (void)len;
+}
+static void websocket_on_protocol_close(void *udata) { (void)udata; }
+static void websocket_on_protocol_error(void *udata) { (void)udata; }
+
+#define TOTAL_BYTES (1ULL << 31)
+
+static const char *kernel_names[] = {"portable", "SSE2", "AVX2"};
+
+static double seconds_since(clock_t start) {
+  return (clock() - start) / (1.0 * CLOCKS_PER_SEC);
+}
+
+/* a byte at a time, the reference implementation for the tests */
+static void xmask_reference(uint8_t *msg, size_t len, uint32_t mask) {
+  for (size_t i = 0; i < len; ++i)
+    msg[i] ^= ((uint8_t *)&mask)[i & 3];
+}
+
+static int test_xmask(int max_level) {
+  uint8_t buf[512], expected[512];
+  for (int level = 0; level <= max_level; ++level) {
+    websocket_simd_level_detected = level;
+    for (size_t offset = 0; offset < 8; ++offset) {
+      for (size_t len = 0; len + offset <= sizeof(buf); len += 1 + (len > 96)) {
+        for (size_t i = 0; i < sizeof(buf); ++i)
+          buf[i] = expected[i] = (uint8_t)(i * 7);
+        websocket_xmask(buf + offset, len, 0x9A3C51E7);
+        xmask_reference(expected + offset, len, 0x9A3C51E7);
+        if (memcmp(buf, expected, sizeof(buf))) {
+          fprintf(stderr, "ERROR: %s unmasking failed (offset %zu, len %zu)\n",
+                  kernel_names[level], offset, len);
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+static int test_utf8(int max_level) {
+  static const struct {
+    const char *str;
+    int valid;
+  } samples[] = {
+      {"plain ASCII", 1},
+      {"\xC3\xA9t\xC3\xA9 \xE2\x82\xAC \xF0\x9F\x98\x80", 1},
+      {"\xED\x9F\xBF \xEE\x80\x80 \xF4\x8F\xBF\xBF", 1},
+      {"\xC0\xAF", 0},             /* overlong '/' */
+      {"\xE0\x80\xAF", 0},         /* overlong '/' */
+      {"\xF0\x80\x80\xAF", 0},     /* overlong '/' */
+      {"\xED\xA0\x80", 0},         /* surrogate */
+      {"\xF4\x90\x80\x80", 0},     /* above U+10FFFF */
+      {"\xF5\x80\x80\x80", 0},     /* invalid lead byte */
+      {"\x80", 0},                 /* lone continuation */
+      {"\xC3", 0},                 /* truncated */
+      {"\xE2\x82", 0},             /* truncated */
+      {"\xE2\x82\xAC\xAC", 0},     /* too long */
+      {"\xF0\x9F\x98\x80\x80", 0}, /* too long */
+  };
+  /* place each sample at every offset of a 96 byte ASCII frame, so that it
+   * crosses the block boundaries of every kernel. */
+  char buf[96 + 8];
+  for (int level = 0; level <= max_level; ++level) {
+    websocket_simd_level_detected = level;
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); ++i) {
+      const size_t len = strlen(samples[i].str);
+      for (size_t offset = 0; offset + len <= 96; ++offset) {
+        memset(buf, 'x', 96);
+        memcpy(buf + offset, samples[i].str, len);
+        if (websocket_utf8_valid(buf, 96) != samples[i].valid ||
+            websocket_utf8_valid(buf, offset + len) != samples[i].valid) {
+          fprintf(stderr, "ERROR: %s UTF-8 validation failed (%zu @ %zu)\n",
+                  kernel_names[level], i, offset);
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+static void bench_xmask(int max_level, size_t size) {
+  uint8_t *buf = malloc(size + 1);
+  memset(buf, 'a', size + 1);
+  fprintf(stderr, "\nUnmasking %zu byte payloads (unaligned):\n", size);
+  for (int level = 0; level <= max_level; ++level) {
+    websocket_simd_level_detected = level;
+    clock_t start = clock();
+    for (size_t total = 0; total < TOTAL_BYTES; total += size)
+      websocket_xmask(buf + 1, size, 0x9A3C51E7);
+    const double secs = seconds_since(start);
+    fprintf(stderr, "  %-9s %8.2f GB/s\n", kernel_names[level],
+            TOTAL_BYTES / secs / 1e9);
+  }
+  free(buf);
+}
+
+static void bench_utf8(int max_level, size_t size, const char *name,
+                       const char *pattern) {
+  const size_t pattern_len = strlen(pattern);
+  char *buf = malloc(size);
+  size_t len = 0;
+  while (len + pattern_len <= size) {
+    memcpy(buf + len, pattern, pattern_len);
+    len += pattern_len;
+  }
+  fprintf(stderr, "\nValidating %zu bytes of %s text:\n", len, name);
+  for (int level = 0; level <= max_level; ++level) {
+    websocket_simd_level_detected = level;
+    size_t valid = 0;
+    clock_t start = clock();
+    for (size_t total = 0; total < TOTAL_BYTES; total += len)
+      valid += websocket_utf8_valid(buf, len);
+    const double secs = seconds_since(start);
+    fprintf(stderr, "  %-9s %8.2f GB/s%s\n", kernel_names[level],
+            TOTAL_BYTES / secs / 1e9, (valid ? "" : " (ERROR: invalid)"));
+  }
+  free(buf);
+}
+
+int main(int argc, char const *argv[]) {
+  size_t size = 65536;
+  if (argc > 1)
+    size = strtoul(argv[1], NULL, 10);
+  if (size < 16)
+    size = 16;
+  const int max_level = websocket_simd_level();
+  fprintf(stderr, "Best kernel on this machine: %s\n", kernel_names[max_level]);
+  if (test_xmask(max_level) || test_utf8(max_level))
+    return -1;
+  fprintf(stderr, "All kernels agree.\n");
+  bench_xmask(max_level, size);
+  bench_utf8(max_level, size, "ASCII", "{\"event\":\"message\",\"id\":42}\n");
+  bench_utf8(max_level, size, "mixed",
+             "caf\xC3\xA9 \xE2\x82\xAC\xE6\x97\xA5\xE6\x9C\xAC "
+             "\xF0\x9F\x98\x80 chat message\n");
+  websocket_simd_level_detected = max_level;
+  return 0;
+}